@@ -27,6 +27,9 @@
 #include "pwiz/utility/misc/Std.hpp"
 #include "ChromatogramList_XICGenerator.hpp"
 #include "pwiz/data/vendor_readers/Thermo/ChromatogramList_Thermo.hpp"
+#include "pwiz/data/msdata/SpectrumListWrapper.hpp"
+#include "pwiz/data/msdata/SpectrumListMetadata.hpp"
+#include "pwiz/data/msdata/SpectrumWorkerThreads.hpp"
 
 
 namespace pwiz {
@@ -38,6 +41,175 @@ using namespace msdata::detail;
 //using namespace pwiz::util;
 
 
+namespace {
+
+
+// the spectra of a list which need to be decoded, so that SpectrumWorkerThreads reads ahead only those
+class SpectrumListSubset : public SpectrumListWrapper
+{
+    public:
+
+    SpectrumListSubset(const SpectrumListPtr& inner, const vector<size_t>& indexes)
+    :   SpectrumListWrapper(inner), indexes_(indexes)
+    {}
+
+    virtual size_t size() const {return indexes_.size();}
+    virtual const SpectrumIdentity& spectrumIdentity(size_t index) const {return inner_->spectrumIdentity(indexes_.at(index));}
+    virtual SpectrumPtr spectrum(size_t index, bool getBinaryData = false) const {return inner_->spectrum(indexes_.at(index), getBinaryData);}
+    virtual const vector<size_t>* innerIndexMap() const {return &indexes_;}
+
+    private:
+    vector<size_t> indexes_;
+};
+
+
+// four independent partial results, which the compiler can keep in vector registers
+double sumIntensities(const double* begin, const double* end)
+{
+    double sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+    for (; end - begin >= 4; begin += 4)
+    {
+        sum0 += begin[0];
+        sum1 += begin[1];
+        sum2 += begin[2];
+        sum3 += begin[3];
+    }
+    for (; begin != end; ++begin)
+        sum0 += *begin;
+    return (sum0 + sum1) + (sum2 + sum3);
+}
+
+
+double maxIntensity(const double* begin, const double* end)
+{
+    double max0 = 0, max1 = 0, max2 = 0, max3 = 0;
+    for (; end - begin >= 4; begin += 4)
+    {
+        max0 = max(max0, begin[0]);
+        max1 = max(max1, begin[1]);
+        max2 = max(max2, begin[2]);
+        max3 = max(max3, begin[3]);
+    }
+    for (; begin != end; ++begin)
+        max0 = max(max0, *begin);
+    return max(max(max0, max1), max(max2, max3));
+}
+
+
+enum ChromatogramType {ChromatogramType_XIC, ChromatogramType_TIC, ChromatogramType_BPC};
+
+
+// sums (or for a BPC, takes the maximum of) the intensities of the peaks within massRanges,
+// or of all peaks if massRanges is empty; the ranges are found by binary search on the m/z array
+double spectrumIntensity(const Spectrum& spectrum, const boost::icl::interval_set<double>& massRanges, ChromatogramType type)
+{
+    BinaryDataArrayPtr mzArray = spectrum.getMZArray();
+    BinaryDataArrayPtr intensityArray = spectrum.getIntensityArray();
+    if (!mzArray.get() || !intensityArray.get() || intensityArray->data.empty())
+        return 0;
+
+    const vector<double>& mz = mzArray->data;
+    const double* intensity = &intensityArray->data[0];
+    size_t size = min(mz.size(), intensityArray->data.size());
+
+    double (*summarize)(const double*, const double*) = type == ChromatogramType_BPC ? maxIntensity : sumIntensities;
+
+    if (massRanges.empty())
+        return summarize(intensity, intensity + size);
+
+    double result = 0;
+    BOOST_FOREACH(const boost::icl::interval_set<double>::interval_type& range, massRanges)
+    {
+        size_t first = lower_bound(mz.begin(), mz.begin() + size, range.lower()) - mz.begin();
+        size_t last = upper_bound(mz.begin() + first, mz.begin() + size, range.upper()) - mz.begin();
+        double rangeResult = summarize(intensity + first, intensity + last);
+        result = type == ChromatogramType_BPC ? max(result, rangeResult) : result + rangeResult;
+    }
+    return result;
+}
+
+
+ChromatogramPtr generateChromatogram(const SpectrumListPtr& spectra,
+                                     double startTime, double endTime,
+                                     const boost::icl::interval_set<double>& massRanges,
+                                     int msLevel, ChromatogramType type)
+{
+    // the spectra are selected, and TICs and BPCs taken where known, from the metadata table
+    SpectrumListMetadataPtr metadata = SpectrumListMetadata::get(spectra);
+
+    vector<double> times, intensities;
+    vector<size_t> decodeIndexes; // spectra whose data are needed
+    vector<size_t> decodePositions; // and their positions in the chromatogram
+    for (size_t i=0, end=metadata->size(); i < end; ++i)
+    {
+        double time = metadata->scanStartTime[i] / 60;
+        if (metadata->msLevel[i] != msLevel || time < startTime || time > endTime)
+            continue;
+
+        double intensity = type == ChromatogramType_TIC ? metadata->totalIonCurrent[i] :
+                           type == ChromatogramType_BPC ? metadata->basePeakIntensity[i] : 0;
+        if (type == ChromatogramType_XIC || intensity == 0)
+        {
+            decodeIndexes.push_back(i);
+            decodePositions.push_back(times.size());
+        }
+        times.push_back(time);
+        intensities.push_back(intensity);
+    }
+
+    // the spectra are decoded on worker threads and summarized in order on this one
+    if (!decodeIndexes.empty())
+    {
+        SpectrumListPtr decodeList(new SpectrumListSubset(spectra, decodeIndexes));
+        SpectrumWorkerThreads workers(*decodeList);
+        for (size_t i=0; i < decodeIndexes.size(); ++i)
+        {
+            SpectrumPtr spectrum = workers.processBatch(i, true);
+            intensities[decodePositions[i]] = spectrumIntensity(*spectrum, massRanges, type);
+        }
+    }
+
+    string msLevelFilter("ms");
+    if (msLevel > 1)
+        msLevelFilter += lexical_cast<string>(msLevel);
+
+    ChromatogramPtr result(new Chromatogram);
+    switch (type)
+    {
+        case ChromatogramType_XIC:
+        {
+            stringstream massRange;
+            bool first = true;
+            BOOST_FOREACH(const boost::icl::interval_set<double>::interval_type& range, massRanges)
+            {
+                if (!first)
+                    massRange << ",";
+                first = false;
+                massRange << range.lower() << "-" << range.upper();
+            }
+            result->id = (boost::format("XIC %1% %2% [%3%-%4%]") % msLevelFilter % massRange.str() % startTime % endTime).str();
+            result->set(MS_selected_ion_current_chromatogram);
+            break;
+        }
+
+        case ChromatogramType_TIC:
+            result->id = (boost::format("TIC %1% [%2%-%3%]") % msLevelFilter % startTime % endTime).str();
+            result->set(MS_TIC_chromatogram);
+            break;
+
+        case ChromatogramType_BPC:
+            result->id = (boost::format("BPC %1% [%2%-%3%]") % msLevelFilter % startTime % endTime).str();
+            result->set(MS_basepeak_chromatogram);
+            break;
+    }
+    result->setTimeIntensityArrays(times, intensities, UO_minute, MS_number_of_detector_counts);
+    return result;
+}
+
+
+} // namespace
+
+
 PWIZ_API_DECL ChromatogramList_XICGenerator::ChromatogramList_XICGenerator(const msdata::ChromatogramListPtr& inner)
 :   ChromatogramListWrapper(inner)
 {
@@ -45,6 +217,13 @@ PWIZ_API_DECL ChromatogramList_XICGenerator::ChromatogramList_XICGenerator(const
 }
 
 
+PWIZ_API_DECL ChromatogramList_XICGenerator::ChromatogramList_XICGenerator(const msdata::ChromatogramListPtr& inner,
+                                                                           const msdata::SpectrumListPtr& spectra)
+:   ChromatogramListWrapper(inner), spectra_(spectra)
+{
+}
+
+
 PWIZ_API_DECL bool ChromatogramList_XICGenerator::accept(const msdata::ChromatogramListPtr& inner)
 {
     return true;
@@ -54,13 +233,32 @@ PWIZ_API_DECL bool ChromatogramList_XICGenerator::accept(const msdata::Chromatog
 PWIZ_API_DECL ChromatogramPtr ChromatogramList_XICGenerator::xic(double startTime, double endTime, const boost::icl::interval_set<double>& massRanges, int msLevel)
 {
     ChromatogramList_Thermo* thermo = dynamic_cast<ChromatogramList_Thermo*>(inner_.get());
-    if (thermo == NULL)
-        throw runtime_error("[ChromatogramList_XICGenerator] only works directly on Thermo ChromatogramLists");
 #ifdef PWIZ_READER_THERMO
-    return thermo->xic(startTime, endTime, massRanges, msLevel);
-#else
-    throw runtime_error("[ChromatogramList_XICGenerator] only works directly on Thermo ChromatogramLists, and only when ProteoWizard is built with windows DLL vendor support.");
+    if (thermo != NULL)
+        return thermo->xic(startTime, endTime, massRanges, msLevel);
 #endif
+    if (spectra_.get())
+        return generateChromatogram(spectra_, startTime, endTime, massRanges, msLevel, ChromatogramType_XIC);
+
+    if (thermo == NULL)
+        throw runtime_error("[ChromatogramList_XICGenerator] only works directly on Thermo ChromatogramLists, or when given the run's SpectrumList");
+    throw runtime_error("[ChromatogramList_XICGenerator] only works directly on Thermo ChromatogramLists, and only when ProteoWizard is built with windows DLL vendor support.");
+}
+
+
+PWIZ_API_DECL ChromatogramPtr ChromatogramList_XICGenerator::tic(double startTime, double endTime, int msLevel)
+{
+    if (!spectra_.get())
+        throw runtime_error("[ChromatogramList_XICGenerator::tic] only works when given the run's SpectrumList");
+    return generateChromatogram(spectra_, startTime, endTime, boost::icl::interval_set<double>(), msLevel, ChromatogramType_TIC);
+}
+
+
+PWIZ_API_DECL ChromatogramPtr ChromatogramList_XICGenerator::bpc(double startTime, double endTime, int msLevel)
+{
+    if (!spectra_.get())
+        throw runtime_error("[ChromatogramList_XICGenerator::bpc] only works when given the run's SpectrumList");
+    return generateChromatogram(spectra_, startTime, endTime, boost::icl::interval_set<double>(), msLevel, ChromatogramType_BPC);
 }
 
 
@@ -35,16 +35,32 @@ namespace pwiz {
 namespace analysis {
 
 
-/// ChromatogramList implementation to return native centroided chromatogram data
+/// ChromatogramList implementation to return native centroided chromatogram data,
+/// or to generate chromatograms from the spectra of the run
 class PWIZ_API_DECL ChromatogramList_XICGenerator : public ChromatogramListWrapper
 {
     public:
 
     ChromatogramList_XICGenerator(const msdata::ChromatogramListPtr& inner);
 
+    /// chromatograms which the inner list cannot generate natively are generated from these spectra
+    ChromatogramList_XICGenerator(const msdata::ChromatogramListPtr& inner, const msdata::SpectrumListPtr& spectra);
+
     static bool accept(const msdata::ChromatogramListPtr& inner);
 
+    /// sums the intensities within massRanges of the msLevel spectra between startTime and endTime (in minutes)
     virtual msdata::ChromatogramPtr xic(double startTime, double endTime, const boost::icl::interval_set<double>& massRanges, int msLevel);
+
+    /// total ion current of the msLevel spectra between startTime and endTime (in minutes);
+    /// only spectra without a total ion current in their metadata are decoded
+    virtual msdata::ChromatogramPtr tic(double startTime, double endTime, int msLevel);
+
+    /// base peak intensity of the msLevel spectra between startTime and endTime (in minutes);
+    /// only spectra without a base peak intensity in their metadata are decoded
+    virtual msdata::ChromatogramPtr bpc(double startTime, double endTime, int msLevel);
+
+    private:
+    msdata::SpectrumListPtr spectra_;
 };
 
 
@@ -0,0 +1,143 @@
+//
+// $Id$
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "ChromatogramList_XICGenerator.hpp"
+#include "pwiz/utility/misc/unit.hpp"
+#include "pwiz/utility/misc/Std.hpp"
+
+using namespace pwiz::analysis;
+using namespace pwiz::cv;
+using namespace pwiz::msdata;
+using namespace pwiz::util;
+
+
+ostream* os_ = 0;
+
+
+// MS1 spectra at 0, 1, ... 9 minutes, each followed by an MS2 spectrum;
+// MS1 spectrum i has peaks at m/z 100, 101, ... 199 with intensity i+1, except at m/z 150 (intensity 100*(i+1));
+// only the even MS1 spectra have their TIC and base peak intensity in their metadata
+SpectrumListPtr createSpectrumList()
+{
+    SpectrumListSimplePtr sl(new SpectrumListSimple);
+    for (size_t i=0; i < 10; ++i)
+    {
+        for (int msLevel=1; msLevel <= 2; ++msLevel)
+        {
+            SpectrumPtr s(new Spectrum);
+            s->index = sl->spectra.size();
+            s->id = "scan=" + lexical_cast<string>(s->index + 1);
+            s->set(MS_ms_level, msLevel);
+            s->scanList.scans.push_back(Scan());
+            s->scanList.scans[0].set(MS_scan_start_time, i * 60 + (msLevel - 1) * 30, UO_second);
+
+            vector<double> mz, intensity;
+            for (size_t j=0; j < 100; ++j)
+            {
+                mz.push_back(100 + j);
+                intensity.push_back((i + 1) * (j == 50 ? 100 : 1) * (msLevel == 2 ? 1000 : 1));
+            }
+            s->setMZIntensityArrays(mz, intensity, MS_number_of_detector_counts);
+
+            if (msLevel == 1 && i % 2 == 0)
+            {
+                // wrong, so that the test can tell that they were used
+                s->set(MS_total_ion_current, 1);
+                s->set(MS_base_peak_intensity, 2);
+            }
+            sl->spectra.push_back(s);
+        }
+    }
+    return sl;
+}
+
+
+void test()
+{
+    SpectrumListPtr sl = createSpectrumList();
+    ChromatogramListPtr cl(new ChromatogramListSimple);
+
+    ChromatogramList_XICGenerator nativeOnly(cl);
+    unit_assert_throws(nativeOnly.xic(0, 10, boost::icl::interval_set<double>(), 1), runtime_error);
+    unit_assert_throws(nativeOnly.tic(0, 10, 1), runtime_error);
+
+    ChromatogramList_XICGenerator generator(cl, sl);
+
+    // two mass ranges: [120,129.5] has 10 peaks, [149.5,150.5] only the tall one
+    boost::icl::interval_set<double> massRanges;
+    massRanges.insert(boost::icl::continuous_interval<double>::closed(120, 129.5));
+    massRanges.insert(boost::icl::continuous_interval<double>::closed(149.5, 150.5));
+
+    ChromatogramPtr xic = generator.xic(2, 7, massRanges, 1);
+    if (os_) *os_ << xic->id << endl;
+    unit_assert(xic->hasCVParam(MS_selected_ion_current_chromatogram));
+
+    vector<TimeIntensityPair> pairs;
+    xic->getTimeIntensityPairs(pairs);
+    unit_assert_operator_equal(6, pairs.size());
+    for (size_t k=0; k < pairs.size(); ++k)
+    {
+        size_t i = k + 2;
+        unit_assert_equal(pairs[k].time, (double) i, 1e-10);
+        unit_assert_equal(pairs[k].intensity, 110.0 * (i + 1), 1e-10);
+    }
+
+    // MS2 spectra only
+    xic = generator.xic(0, 100, massRanges, 2);
+    xic->getTimeIntensityPairs(pairs);
+    unit_assert_operator_equal(10, pairs.size());
+    unit_assert_equal(pairs[3].time, 3.5, 1e-10);
+    unit_assert_equal(pairs[3].intensity, 110.0 * 4 * 1000, 1e-10);
+
+    // TIC and BPC use the metadata when they have it
+    ChromatogramPtr tic = generator.tic(0, 100, 1);
+    unit_assert(tic->hasCVParam(MS_TIC_chromatogram));
+    tic->getTimeIntensityPairs(pairs);
+    unit_assert_operator_equal(10, pairs.size());
+    for (size_t i=0; i < pairs.size(); ++i)
+        unit_assert_equal(pairs[i].intensity, i % 2 == 0 ? 1.0 : 199.0 * (i + 1), 1e-10);
+
+    ChromatogramPtr bpc = generator.bpc(0, 100, 1);
+    unit_assert(bpc->hasCVParam(MS_basepeak_chromatogram));
+    bpc->getTimeIntensityPairs(pairs);
+    unit_assert_operator_equal(10, pairs.size());
+    for (size_t i=0; i < pairs.size(); ++i)
+        unit_assert_equal(pairs[i].intensity, i % 2 == 0 ? 2.0 : 100.0 * (i + 1), 1e-10);
+}
+
+
+int main(int argc, char* argv[])
+{
+    TEST_PROLOG(argc, argv)
+
+    try
+    {
+        if (argc>1 && !strcmp(argv[1],"-v")) os_ = &cout;
+        test();
+    }
+    catch (exception& e)
+    {
+        TEST_FAILED(e.what())
+    }
+    catch (...)
+    {
+        TEST_FAILED("Caught unknown exception.")
+    }
+
+    TEST_EPILOG
+}
@@ -39,6 +39,7 @@ struct DistanceAttribute
     DistanceAttribute(){}
     virtual double score(const Entry& a, const Entry& b){ return 0;}
     virtual double operator()(const Entry& a, const Entry& b){ return this->score(a,b);}
+    virtual bool threadSafe() const { return false;} // true if score() may be called from several threads at once
     virtual ~DistanceAttribute(){}
 
 };
@@ -47,6 +48,7 @@ struct NumberOfMS2IDs : public DistanceAttribute
 {
      NumberOfMS2IDs(){}
      virtual double score(const AMTContainer& a, const AMTContainer& b);
+     virtual bool threadSafe() const { return true;}
 
 };
 
@@ -59,6 +61,7 @@ struct RandomDistance : public DistanceAttribute
 struct RTDiffDistribution : public DistanceAttribute
 {
     virtual double score(const Entry& a, const Entry& b);
+    virtual bool threadSafe() const { return true;}
 
 };
 
@@ -66,6 +69,7 @@ struct HammingDistance : public DistanceAttribute
 {
     HammingDistance(const vector<boost::shared_ptr<Entry> >& v);
     virtual double score(const Entry& a, const Entry& b);
+    virtual bool threadSafe() const { return true;}
     
     vector<string> allUniquePeptides;
 
@@ -75,6 +79,7 @@ struct WeightedHammingDistance : public DistanceAttribute
 {
     WeightedHammingDistance(const vector<boost::shared_ptr<Entry> >& v);
     virtual double score(const Entry& a, const Entry& b);
+    virtual bool threadSafe() const { return true;}
 
     double normalizationFactor;
     vector<string> allUniquePeptides;
@@ -85,6 +90,7 @@ struct EditDistance : public DistanceAttribute
 {
     EditDistance();
     virtual double score(const Entry& a, const Entry& b);
+    virtual bool threadSafe() const { return true;}
 
     double insertionCost;
     double deletionCost;
@@ -125,12 +125,12 @@ void test()
 
     // unit_assert on rows and columns
     const double epsilon = 2*numeric_limits<double>::epsilon();
-    unit_assert_equal(nj._rows.at(1).at(0), 1.0666666666666666, epsilon);
-    unit_assert_equal(nj._rows.at(2).at(0), 0.80, epsilon);
-    unit_assert_equal(nj._rows.at(3).at(0), 0.80, epsilon);
-    unit_assert_equal(nj._rows.at(2).at(1), 0.2666666666666666, epsilon);
-    unit_assert_equal(nj._rows.at(3).at(1), 0.2666666666666666, epsilon);
-    unit_assert_equal(nj._rows.at(3).at(2), 0, epsilon);
+    unit_assert_equal(nj.access(1,0), 1.0666666666666666, epsilon);
+    unit_assert_equal(nj.access(2,0), 0.80, epsilon);
+    unit_assert_equal(nj.access(3,0), 0.80, epsilon);
+    unit_assert_equal(nj.access(2,1), 0.2666666666666666, epsilon);
+    unit_assert_equal(nj.access(3,1), 0.2666666666666666, epsilon);
+    unit_assert_equal(nj.access(3,2), 0, epsilon);
 
 }
 
@@ -26,6 +26,7 @@
 
 #include "Matrix.hpp"
 #include <iostream>
+#include <stdexcept>
 
 using namespace pwiz;
 using namespace eharmony;
@@ -52,7 +53,12 @@ void Matrix::insert(const double& value, const int& rowCoordinate, const int& co
     pair<int, int> coords = make_pair(rowCoordinate, columnCoordinate);
     
     multimap<double, pair<int,int> >::iterator it = candidates.first;
-    for(; it != candidates.second; ++it ) if (it->second == coords) _data.erase(it);
+    for(; it != candidates.second; ++it )
+        if (it->second == coords)
+            {
+                _data.erase(it); // each location is in the map once
+                break;
+            }
 
     _rows.at(rowCoordinate).at(columnCoordinate) = value;
     _columns.at(columnCoordinate).at(rowCoordinate) = value;
@@ -85,3 +91,120 @@ ostream& Matrix::write(ostream& os)
 
     return os;
 }
+
+DistanceMatrix::DistanceMatrix(const int& n)
+{
+    if (n < 0) throw runtime_error("[DistanceMatrix::DistanceMatrix] negative size");
+
+    _data.resize(size_t(n) * (n > 0 ? n-1 : 0) / 2, 0);
+    for(int index = 0; index != n; ++index) _slots.push_back(index);
+    _nearest.resize(n, n);
+    _stale.resize(n, 1);
+
+}
+
+double& DistanceMatrix::at(size_t slotA, size_t slotB)
+{
+    if (slotA > slotB) swap(slotA, slotB);
+    return _data[slotB * (slotB - 1) / 2 + slotA];
+
+}
+
+double DistanceMatrix::at(size_t slotA, size_t slotB) const
+{
+    if (slotA > slotB) swap(slotA, slotB);
+    return _data[slotB * (slotB - 1) / 2 + slotA];
+
+}
+
+void DistanceMatrix::insert(const double& value, const int& rowCoordinate, const int& columnCoordinate)
+{
+    if (rowCoordinate == columnCoordinate) throw runtime_error("[DistanceMatrix::insert] The diagonal is always 0.");
+
+    size_t a = _slots.at(min(rowCoordinate, columnCoordinate));
+    size_t b = _slots.at(max(rowCoordinate, columnCoordinate));
+    double& distance = at(a, b);
+    const double oldValue = distance;
+    distance = value;
+
+    // only a's row has b after it
+    if (_stale[a]) return;
+    if (_nearest[a] == b)
+        {
+            if (value > oldValue) _stale[a] = 1;
+            return;
+        }
+
+    const double nearestValue = at(a, _nearest[a]);
+    if (value < nearestValue || (value == nearestValue && b < _nearest[a])) _nearest[a] = b;
+
+}
+
+double DistanceMatrix::access(const int& rowCoordinate, const int& columnCoordinate) const
+{
+    if (rowCoordinate == columnCoordinate && size_t(rowCoordinate) < _slots.size()) return 0;
+    return at(_slots.at(rowCoordinate), _slots.at(columnCoordinate));
+
+}
+
+void DistanceMatrix::remove(const int& coordinate)
+{
+    size_t slot = _slots.at(coordinate);
+    _slots.erase(_slots.begin() + coordinate);
+
+    for(int index = 0; index != coordinate; ++index)
+        if (_nearest[_slots[index]] == slot) _stale[_slots[index]] = 1;
+
+}
+
+void DistanceMatrix::findNearest(size_t slot)
+{
+    _nearest[slot] = _nearest.size();
+    _stale[slot] = 0;
+
+    vector<size_t>::const_iterator it = upper_bound(_slots.begin(), _slots.end(), slot);
+    for(; it != _slots.end(); ++it)
+        if (_nearest[slot] == _nearest.size() || at(slot, *it) < at(slot, _nearest[slot])) _nearest[slot] = *it;
+
+}
+
+pair<int, int> DistanceMatrix::getMinValLocation()
+{
+    if (_slots.size() < 2) throw runtime_error("[DistanceMatrix::getMinValLocation] Fewer than two entries.");
+
+    int row = -1;
+    double minValue = 0;
+    for(size_t index = 0; index + 1 < _slots.size(); ++index)
+        {
+            size_t slot = _slots[index];
+            if (_stale[slot]) findNearest(slot);
+
+            double value = at(slot, _nearest[slot]);
+            if (row < 0 || value < minValue)
+                {
+                    row = index;
+                    minValue = value;
+                }
+        }
+
+    size_t column = lower_bound(_slots.begin(), _slots.end(), _nearest[_slots[row]]) - _slots.begin();
+    return make_pair(row, int(column));
+
+}
+
+ostream& DistanceMatrix::write(ostream& os) const
+{
+    for(int row_index = 0; row_index != size(); ++row_index)
+        {
+            for(int column_index = 0; column_index != size(); ++column_index)
+                {
+                    os << access(row_index, column_index) << "    ";
+
+                }
+
+            os << endl;
+
+        }
+
+    return os;
+}
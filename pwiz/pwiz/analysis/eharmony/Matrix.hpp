@@ -59,6 +59,42 @@ struct Matrix
 
     ostream& write(ostream& os);
 
+};
+
+///
+/// Symmetric matrix of the distances between entries, stored as the n(n-1)/2 values below the diagonal.
+/// Entries are addressed by their current position; removing one shifts the positions after it down.
+/// The nearest neighbor of each row among the rows after it is cached, so finding the nearest pair
+/// only rescans the rows whose cached neighbor was changed or removed.
+///
+struct DistanceMatrix
+{
+    DistanceMatrix(){}
+    DistanceMatrix(const int& n);
+
+    int size() const { return _slots.size(); }
+
+    void insert(const double& value, const int& rowCoordinate, const int& columnCoordinate);
+    double access(const int& rowCoordinate, const int& columnCoordinate) const; // 0 on the diagonal
+    void remove(const int& coordinate);
+
+    // the pair of positions (first < second) with the smallest distance; if more than one, returns
+    // the first one lexically w.r.t. row/column indices, as Matrix::getMinValLocation does
+    pair<int, int> getMinValLocation();
+
+    ostream& write(ostream& os) const;
+
+private:
+
+    double& at(size_t slotA, size_t slotB);
+    double at(size_t slotA, size_t slotB) const;
+    void findNearest(size_t slot);
+
+    vector<double> _data; // the distance between slots a < b is at b*(b-1)/2 + a
+    vector<size_t> _slots; // maps position -> slot; sorted, so positions and slots have the same order
+    vector<size_t> _nearest; // the cached nearest slot after each slot, or _nearest.size() if none
+    vector<char> _stale; // whether each slot's cached neighbor must be searched for again
+
 };
 
     //ostream& operator<<(ostream& os, const Matrix& m);
@@ -27,6 +27,7 @@
 #include "Matrix.hpp"
 #include "pwiz/utility/misc/unit.hpp"
 #include <limits>
+#include <cstdlib>
 
 using namespace pwiz;
 using namespace eharmony;
@@ -49,9 +50,71 @@ void testMatrix()
 
 }
 
+// the first pair (lexically) with the smallest distance, by scanning the whole matrix
+pair<int, int> bruteForceMinValLocation(const vector<vector<double> >& distances)
+{
+    pair<int, int> result(-1, -1);
+    for(size_t row = 0; row < distances.size(); ++row)
+        for(size_t column = row + 1; column < distances.size(); ++column)
+            if (result.first < 0 || distances[row][column] < distances[result.first][result.second]) result = make_pair(row, column);
+
+    return result;
+
+}
+
+void testDistanceMatrix()
+{
+    // few distinct values, so there are many ties
+    const int n = 40;
+    vector<vector<double> > expected(n, vector<double>(n, 0));
+    DistanceMatrix m(n);
+    unit_assert(m.size() == n);
+
+    srand(42);
+    for(int row = 0; row < n; ++row)
+        for(int column = row + 1; column < n; ++column)
+            {
+                double value = rand() % 20;
+                expected[row][column] = expected[column][row] = value;
+                m.insert(value, row, column);
+            }
+
+    unit_assert_equal(m.access(3,7), expected[3][7], epsilon);
+    unit_assert_equal(m.access(7,3), expected[3][7], epsilon);
+    unit_assert_equal(m.access(5,5), 0, epsilon);
+
+    // agglomerate: merge the nearest pair into its first entry and give it new distances
+    while (m.size() > 1)
+        {
+            pair<int, int> nearest = m.getMinValLocation();
+            unit_assert(nearest == bruteForceMinValLocation(expected));
+
+            expected.erase(expected.begin() + nearest.second);
+            for(size_t row = 0; row < expected.size(); ++row) expected[row].erase(expected[row].begin() + nearest.second);
+            m.remove(nearest.second);
+            unit_assert(m.size() == int(expected.size()));
+
+            for(int index = 0; index < m.size(); ++index)
+                {
+                    if (index == nearest.first) continue;
+                    double value = rand() % 20;
+                    expected[nearest.first][index] = expected[index][nearest.first] = value;
+                    m.insert(value, nearest.first, index);
+                }
+
+            for(int row = 0; row < m.size(); ++row)
+                for(int column = 0; column < m.size(); ++column)
+                    unit_assert_equal(m.access(row, column), expected[row][column], epsilon);
+        }
+
+    unit_assert_throws(m.getMinValLocation(), runtime_error);
+
+}
+
 int main()
 {
     testMatrix();
+    testDistanceMatrix();
     return 0;
 
 }
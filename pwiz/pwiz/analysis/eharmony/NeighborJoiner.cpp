@@ -25,12 +25,60 @@
 ///
 
 #include "NeighborJoiner.hpp"
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
 #include <iostream>
 
 using namespace pwiz;
 using namespace eharmony;
 
-NeighborJoiner::NeighborJoiner(const vector<boost::shared_ptr<Entry> >& entries, const WarpFunctionEnum& wfe) : Matrix(entries.size(), entries.size()), _wfe(wfe)
+namespace{
+
+void scoreSomePairs(DistanceAttribute& attribute, const vector<Entry>& entries, const vector<pair<int, int> >& pairs, vector<double>& scores, size_t first, size_t stride, string& error)
+{
+    try
+    {
+        for(size_t index = first; index < pairs.size(); index += stride)
+            scores[index] = attribute.score(entries[pairs[index].first], entries[pairs[index].second]);
+    }
+    catch (exception& e)
+    {
+        error = e.what();
+    }
+    catch (...)
+    {
+        error = "unknown exception";
+    }
+
+}
+
+// scores the pairs of entries, spreading them over the available processors if the attribute allows it
+void scorePairs(DistanceAttribute& attribute, const vector<Entry>& entries, const vector<pair<int, int> >& pairs, vector<double>& scores)
+{
+    scores.resize(pairs.size());
+    size_t threadCount = attribute.threadSafe() ? max(1u, boost::thread::hardware_concurrency()) : 1;
+    threadCount = min(threadCount, pairs.size());
+    if (threadCount <= 1)
+        {
+            for(size_t index = 0; index < pairs.size(); ++index)
+                scores[index] = attribute.score(entries[pairs[index].first], entries[pairs[index].second]);
+            return;
+        }
+
+    vector<string> errors(threadCount);
+    boost::thread_group threads;
+    for(size_t thread = 0; thread < threadCount; ++thread)
+        threads.create_thread(boost::bind(&scoreSomePairs, boost::ref(attribute), boost::cref(entries), boost::cref(pairs), boost::ref(scores), thread, threadCount, boost::ref(errors[thread])));
+    threads.join_all();
+
+    for(size_t thread = 0; thread < threadCount; ++thread)
+        if (!errors[thread].empty()) throw runtime_error("[NeighborJoiner] error calculating distance: " + errors[thread]);
+
+}
+
+} // anonymous namespace
+
+NeighborJoiner::NeighborJoiner(const vector<boost::shared_ptr<Entry> >& entries, const WarpFunctionEnum& wfe) : DistanceMatrix(entries.size()), _wfe(wfe)
 {
     vector<boost::shared_ptr<Entry> >::const_iterator it = entries.begin();
     for(; it!= entries.end(); ++it)
@@ -44,37 +92,41 @@ NeighborJoiner::NeighborJoiner(const vector<boost::shared_ptr<Entry> >& entries,
 
 void NeighborJoiner::calculateDistanceMatrix()
 {
-    vector<boost::shared_ptr<DistanceAttribute> >::iterator it = _attributes.begin();
-    for(; it!= _attributes.end(); ++it) // just overwrites right now. later aggregate euclideanly or as desired
-        {
-            size_t index = 0;
-            vector<Entry>::iterator i_it = _rowEntries.begin();
-            for(; i_it != _rowEntries.end(); ++i_it, ++index)
-                {
-                    size_t jindex = 0;
-                    vector<Entry>::iterator j_it = _columnEntries.begin(); // square so doesn't really matter..
-                    for(; j_it != _columnEntries.end(); ++j_it, ++jindex)
-                        {
-			  if (index == jindex) 
-			      {
-			          this->insert(10000000000, index, jindex);				 
-                      continue;
-			      }
-			  
-			  double score = (*it)->score(*i_it, *j_it);			  
-			  this->insert(score, index, jindex);
- 
-                        } 
-                  
-                }
-
-        }  
+    if (_attributes.empty()) return;
+
+    // the row and column entries share their data fetchers, so scoring the row entries against each other
+    // gives the same distances; only the last attribute is used right now. later aggregate euclideanly or as desired
+    vector<pair<int, int> > pairs;
+    pairs.reserve(_rowEntries.size() * (_rowEntries.size() - 1) / 2);
+    for(size_t index = 0; index < _rowEntries.size(); ++index)
+        for(size_t jindex = index + 1; jindex < _rowEntries.size(); ++jindex)
+            pairs.push_back(make_pair(index, jindex));
+
+    vector<double> scores;
+    scorePairs(*_attributes.back(), _rowEntries, pairs, scores);
+    for(size_t index = 0; index < pairs.size(); ++index)
+        this->insert(scores[index], pairs[index].first, pairs[index].second);
+
+}
+
+void NeighborJoiner::calculateDistances(const int& index)
+{
+    if (_attributes.empty()) return;
+
+    vector<pair<int, int> > pairs;
+    for(int jindex = 0; jindex < int(_rowEntries.size()); ++jindex)
+        if (jindex != index) pairs.push_back(make_pair(index, jindex));
+
+    vector<double> scores;
+    scorePairs(*_attributes.back(), _rowEntries, pairs, scores);
+    for(size_t jindex = 0; jindex < pairs.size(); ++jindex)
+        this->insert(scores[jindex], pairs[jindex].first, pairs[jindex].second);
 
 }
 
 void NeighborJoiner::joinNearest()
 {
-    if (_rowEntries.size() == 1) return;    
+    if (_rowEntries.size() <= 1) return;    
     pair<int,int> nearest = getMinValLocation();
 
     cout << "Joining nearest neighbors at current matrix indices: " << nearest.first << " , " << nearest.second << endl;
@@ -83,7 +135,6 @@ void NeighborJoiner::joinNearest()
     AMTContainer rb = _rowEntries.at(nearest.second);
 
     cout << "Merging: " << ra._id << " and " << rb._id << endl;
-    AMTContainer ra_copy = ra;
 
     // adjust rt and warp entries
 
@@ -97,19 +148,17 @@ void NeighborJoiner::joinNearest()
 
     // merge using the row indices
     ra.merge(rb);
-    replace(_rowEntries.begin(), _rowEntries.end(), ra_copy, ra);
-    _rowEntries.erase(find(_rowEntries.begin(), _rowEntries.end(),rb));
+    _rowEntries.at(nearest.first) = ra;
+    _rowEntries.erase(_rowEntries.begin() + nearest.second);
     
     // no need to merge the column indices (shared ptrs) but do need to erase
-    AMTContainer cb = _columnEntries.at(nearest.second);
-    _columnEntries.erase(find(_columnEntries.begin(), _columnEntries.end(), cb));
+    _columnEntries.erase(_columnEntries.begin() + nearest.second);
     
     // store indices of merging
     _tree.push_back(nearest); 
 
-    // recalculate distance matrix with new entries
-    _data.clear(); 
-    calculateDistanceMatrix();
+    // only the distances to the merged entry have changed
+    remove(nearest.second);
+    calculateDistances(nearest.first);
 
 }
-
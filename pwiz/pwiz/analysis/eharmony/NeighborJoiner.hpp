@@ -36,13 +36,14 @@ namespace eharmony{
 
 typedef AMTContainer Entry;
 
-struct NeighborJoiner : public Matrix
+struct NeighborJoiner : public DistanceMatrix
 {     
     NeighborJoiner(const vector<boost::shared_ptr<Entry> >& entries, const WarpFunctionEnum& wfe = Default);
 
     void addDistanceAttribute(boost::shared_ptr<DistanceAttribute> attr) { _attributes.push_back(attr); }
-    void calculateDistanceMatrix();
-    void joinNearest();
+    void calculateDistanceMatrix(); // scores every pair of entries on worker threads
+    void calculateDistances(const int& index); // rescores one entry against all the others
+    void joinNearest(); // merges the nearest pair and rescores only the merged entry
     void joinAll() { while (_rowEntries.size() > 1) joinNearest(); }
 
     vector<Entry > _rowEntries;
@@ -25,6 +25,8 @@
 
 #include "MSDataAnalyzer.hpp"
 #include "pwiz/utility/misc/Std.hpp"
+#include <boost/thread.hpp>
+#include <boost/exception_ptr.hpp>
 
 
 namespace pwiz {
@@ -86,16 +88,126 @@ PWIZ_API_DECL void MSDataAnalyzerContainer::close(const DataInfo& dataInfo)
 }
 
 
+PWIZ_API_DECL MSDataAnalyzerPtr MSDataAnalyzerContainer::createShard(const DataInfo& dataInfo) const
+{
+    boost::shared_ptr<MSDataAnalyzerContainer> shard(new MSDataAnalyzerContainer);
+
+    for (const_iterator it=begin(); it!=end(); ++it)
+    {
+        MSDataAnalyzerPtr childShard;
+        if (it->get() && !(childShard = (*it)->createShard(dataInfo)))
+            return MSDataAnalyzerPtr();
+        shard->push_back(childShard);
+    }
+
+    return shard;
+}
+
+
+PWIZ_API_DECL void MSDataAnalyzerContainer::mergeShard(MSDataAnalyzer& shard)
+{
+    MSDataAnalyzerContainer& container = dynamic_cast<MSDataAnalyzerContainer&>(shard);
+    if (container.size() != size())
+        throw runtime_error("[MSDataAnalyzerContainer::mergeShard()] Shard does not match container.");
+
+    for (size_t i=0; i < size(); ++i)
+    if (at(i).get())
+        at(i)->mergeShard(*container[i]);
+}
+
+
 //
 // MSDataAnalyzerDriver
 //
 
 
-PWIZ_API_DECL MSDataAnalyzerDriver::MSDataAnalyzerDriver(MSDataAnalyzer& analyzer)
-:   analyzer_(analyzer)
+PWIZ_API_DECL MSDataAnalyzerDriver::MSDataAnalyzerDriver(MSDataAnalyzer& analyzer, size_t maxThreadCount)
+:   analyzer_(analyzer), maxThreadCount_(maxThreadCount)
 {}
 
 
+namespace {
+
+void updateAnalyzer(MSDataAnalyzer& analyzer, const MSDataAnalyzer::DataInfo& dataInfo,
+                    const SpectrumList& spectrumList, size_t index)
+{
+    // only send request if analyzer really wants it (more than UpdateRequest_Ok) 
+
+    MSDataAnalyzer::UpdateRequest request = 
+        analyzer.updateRequested(dataInfo, spectrumList.spectrumIdentity(index));
+
+    if (request < MSDataAnalyzer::UpdateRequest_NoBinary) 
+        return;
+
+    // retrieve the spectrum and update the analyzer
+
+    bool getBinaryData = (request == MSDataAnalyzer::UpdateRequest_Full);
+    SpectrumPtr spectrum = spectrumList.spectrum(index, getBinaryData);
+    analyzer.update(dataInfo, *spectrum);
+}
+
+
+// like SpectrumWorkerThreads, don't read Bruker data on several threads
+bool canReadOnSeveralThreads(const SpectrumList& spectrumList)
+{
+    SpectrumPtr s0 = spectrumList.spectrum(0, false);
+    return s0->scanList.scans.empty() ||
+           !s0->scanList.scans[0].instrumentConfigurationPtr.get() ||
+           !s0->scanList.scans[0].instrumentConfigurationPtr->hasCVParamChild(MS_Bruker_Daltonics_instrument_model);
+}
+
+
+// progress of the threads analyzing shards
+struct ShardProgress
+{
+    boost::mutex mutex;
+    boost::condition_variable changed;
+    size_t analyzedCount;
+    size_t finishedShardCount;
+    bool canceled;
+    boost::exception_ptr error;
+
+    ShardProgress() : analyzedCount(0), finishedShardCount(0), canceled(false) {}
+};
+
+
+void analyzeShard(MSDataAnalyzer& shard, const MSDataAnalyzer::DataInfo& dataInfo,
+                  size_t begin, size_t end, ShardProgress& progress)
+{
+    try
+    {
+        const SpectrumList& spectrumList = *dataInfo.msd.run.spectrumListPtr;
+
+        for (size_t i=begin; i < end; ++i)
+        {
+            {
+                boost::lock_guard<boost::mutex> lock(progress.mutex);
+                if (progress.canceled || progress.error)
+                    break;
+            }
+
+            updateAnalyzer(shard, dataInfo, spectrumList, i);
+
+            boost::lock_guard<boost::mutex> lock(progress.mutex);
+            ++progress.analyzedCount;
+            progress.changed.notify_one();
+        }
+    }
+    catch (...)
+    {
+        boost::lock_guard<boost::mutex> lock(progress.mutex);
+        if (!progress.error)
+            progress.error = boost::current_exception();
+    }
+
+    boost::lock_guard<boost::mutex> lock(progress.mutex);
+    ++progress.finishedShardCount;
+    progress.changed.notify_one();
+}
+
+} // namespace
+
+
 PWIZ_API_DECL
 MSDataAnalyzerDriver::Status 
 MSDataAnalyzerDriver::analyze(const MSDataAnalyzer::DataInfo& dataInfo,
@@ -112,26 +224,75 @@ MSDataAnalyzerDriver::analyze(const MSDataAnalyzer::DataInfo& dataInfo,
         const SpectrumList& spectrumList = *dataInfo.msd.run.spectrumListPtr;
         const size_t size = spectrumList.size();
 
-        for (size_t i=0; i<size; ++i)
-        {
-            if (progressCallback && 
-                (i%iterationsPerCallback)==0 &&
-                progressCallback->progress(i, size)==Status_Cancel)
-                return Status_Cancel;
-
-            // only send request if analyzer really wants it (more than UpdateRequest_Ok) 
+        size_t threadCount = maxThreadCount_ > 0 ? maxThreadCount_ : max(1u, boost::thread::hardware_concurrency());
+        threadCount = min(threadCount, size);
+        if (threadCount > 1 && !canReadOnSeveralThreads(spectrumList))
+            threadCount = 1;
 
-            MSDataAnalyzer::UpdateRequest request = 
-                analyzer_.updateRequested(dataInfo, spectrumList.spectrumIdentity(i));
-
-            if (request < MSDataAnalyzer::UpdateRequest_NoBinary) 
-                continue;
+        vector<MSDataAnalyzerPtr> shards;
+        for (size_t i=0; threadCount > 1 && i < threadCount; ++i)
+        {
+            MSDataAnalyzerPtr shard = analyzer_.createShard(dataInfo);
+            if (!shard.get())
+            {
+                shards.clear();
+                break;
+            }
+            shards.push_back(shard);
+        }
 
-            // retrieve the spectrum and update the analyzer
+        if (!shards.empty())
+        {
+            // each shard analyzes a contiguous range of the spectra on its own thread
+            ShardProgress progress;
+            boost::thread_group threads;
+            for (size_t i=0; i < shards.size(); ++i)
+                threads.create_thread(boost::bind(&analyzeShard, boost::ref(*shards[i]), boost::cref(dataInfo),
+                                                  size * i / shards.size(), size * (i+1) / shards.size(),
+                                                  boost::ref(progress)));
+
+            {
+                boost::unique_lock<boost::mutex> lock(progress.mutex);
+                size_t nextCallback = 0;
+                while (progress.finishedShardCount < shards.size())
+                {
+                    if (progressCallback && !progress.canceled && progress.analyzedCount >= nextCallback)
+                    {
+                        size_t analyzedCount = progress.analyzedCount;
+                        nextCallback = analyzedCount + iterationsPerCallback;
+
+                        lock.unlock();
+                        bool canceled = progressCallback->progress(analyzedCount, size)==Status_Cancel;
+                        lock.lock();
+
+                        if (canceled)
+                            progress.canceled = true;
+                        continue;
+                    }
+                    progress.changed.wait(lock);
+                }
+            }
+            threads.join_all();
+
+            if (progress.error)
+                boost::rethrow_exception(progress.error);
+            if (progress.canceled)
+                return Status_Cancel;
 
-            bool getBinaryData = (request == MSDataAnalyzer::UpdateRequest_Full);
-            SpectrumPtr spectrum = spectrumList.spectrum(i, getBinaryData);
-            analyzer_.update(dataInfo, *spectrum);
+            for (size_t i=0; i < shards.size(); ++i)
+                analyzer_.mergeShard(*shards[i]);
+        }
+        else
+        {
+            for (size_t i=0; i<size; ++i)
+            {
+                if (progressCallback && 
+                    (i%iterationsPerCallback)==0 &&
+                    progressCallback->progress(i, size)==Status_Cancel)
+                    return Status_Cancel;
+
+                updateAnalyzer(analyzer_, dataInfo, spectrumList, i);
+            }
         }
 
         if (progressCallback && progressCallback->progress(size, size)==Status_Cancel)
@@ -53,6 +53,10 @@ using namespace msdata;
 ///     - update
 ///   - close
 ///
+/// An analyzer may also support parallel analysis by implementing createShard() and
+/// mergeShard(): MSDataAnalyzerDriver then feeds each shard a contiguous range of the
+/// spectra on its own thread, and merges the shards back in index order before close().
+///
 /// UpdateRequest_Ok handles the following use case: a spectrum cache wants to cache 
 /// only those spectra that are requested by other MSDataAnalyzers; it won't request 
 /// any updates, but it needs to see any update requested by someone else.
@@ -101,6 +105,21 @@ class PWIZ_API_DECL MSDataAnalyzer
     virtual void close(const DataInfo& dataInfo) {} 
     //@}
 
+    /// \name Parallel Analysis
+    //@{
+
+    /// return a new analyzer with this one's configuration but none of its results, ready to
+    /// receive updates for a range of the spectra; called after open(); the default (null)
+    /// means this analyzer must see all of the spectra itself
+    virtual boost::shared_ptr<MSDataAnalyzer> createShard(const DataInfo& dataInfo) const
+    {
+        return boost::shared_ptr<MSDataAnalyzer>();
+    }
+
+    /// add the results of a shard created by this analyzer; shards are merged in index order
+    virtual void mergeShard(MSDataAnalyzer& shard) {}
+    //@}
+
     virtual ~MSDataAnalyzer() {}
 };
 
@@ -147,6 +166,11 @@ class PWIZ_API_DECL MSDataAnalyzerContainer : public MSDataAnalyzer,
                         const Spectrum& spectrum);
 
     virtual void close(const DataInfo& dataInfo);
+
+    /// shardable iff all of the children are
+    virtual boost::shared_ptr<MSDataAnalyzer> createShard(const DataInfo& dataInfo) const;
+
+    virtual void mergeShard(MSDataAnalyzer& shard);
     //@}
 };
 
@@ -158,8 +182,10 @@ class PWIZ_API_DECL MSDataAnalyzerDriver
 {
     public:
 
-    /// instantiate with an MSDataAnalyzer
-    MSDataAnalyzerDriver(MSDataAnalyzer& analyzer);
+    /// instantiate with an MSDataAnalyzer; if the analyzer can be sharded, the spectra are
+    /// analyzed on up to maxThreadCount threads (0 for one per processor), except for
+    /// Bruker data, which is read on a single thread like in SpectrumWorkerThreads
+    MSDataAnalyzerDriver(MSDataAnalyzer& analyzer, size_t maxThreadCount = 1);
 
     enum PWIZ_API_DECL Status {Status_Ok, Status_Cancel};
 
@@ -183,6 +209,7 @@ class PWIZ_API_DECL MSDataAnalyzerDriver
 
     private:
     MSDataAnalyzer& analyzer_;
+    size_t maxThreadCount_;
 };
 
 // helper function for argument parsing
@@ -22,7 +22,10 @@
 
 
 #include "MSDataAnalyzer.hpp"
+#include "RunSummary.hpp"
+#include "SpectrumTable.hpp"
 #include "pwiz/utility/misc/unit.hpp"
+#include "pwiz/utility/misc/Filesystem.hpp"
 #include "pwiz/utility/misc/Std.hpp"
 #include <cstring>
 
@@ -178,6 +181,186 @@ void test()
 }
 
 
+// counts the spectra it sees itself and the shards created from it
+struct ShardCountingAnalyzer : public MSDataAnalyzer
+{
+    size_t updateCount;
+    mutable size_t shardCount;
+
+    ShardCountingAnalyzer() : updateCount(0), shardCount(0) {}
+
+    virtual UpdateRequest updateRequested(const DataInfo& dataInfo, 
+                                          const SpectrumIdentity& entry) const 
+    {
+        return UpdateRequest_NoBinary;
+    }
+
+    virtual void update(const DataInfo& dataInfo, 
+                        const Spectrum& spectrum) 
+    {
+        updateCount++;
+    }
+
+    virtual MSDataAnalyzerPtr createShard(const DataInfo& dataInfo) const
+    {
+        shardCount++;
+        return MSDataAnalyzerPtr(new ShardCountingAnalyzer);
+    }
+
+    virtual void mergeShard(MSDataAnalyzer& shard)
+    {
+        updateCount += dynamic_cast<ShardCountingAnalyzer&>(shard).updateCount;
+    }
+};
+
+
+// alternating MS1 and MS2 spectra with scan times, precursors, peaks and peak statistics
+void initializeRun(MSData& msd, size_t spectrumCount, CVID instrumentModel = CVID_Unknown)
+{
+    InstrumentConfigurationPtr ic(new InstrumentConfiguration("IC1"));
+    if (instrumentModel != CVID_Unknown)
+        ic->set(instrumentModel);
+    msd.instrumentConfigurationPtrs.push_back(ic);
+
+    SpectrumListSimplePtr sl(new SpectrumListSimple);
+    for (size_t i=0; i < spectrumCount; ++i)
+    {
+        SpectrumPtr spectrum(new Spectrum);
+        spectrum->index = i;
+        spectrum->id = "scan=" + lexical_cast<string>(i+1);
+        spectrum->set(MS_ms_level, i%2 + 1);
+        spectrum->scanList.scans.push_back(Scan());
+        spectrum->scanList.scans.back().instrumentConfigurationPtr = ic;
+        spectrum->scanList.scans.back().set(MS_scan_start_time, 10 + i, UO_second);
+
+        if (i%2 == 1)
+        {
+            Precursor precursor(400.0 + i, 2 + (int) (i%3));
+            spectrum->precursors.push_back(precursor);
+        }
+
+        vector<MZIntensityPair> peaks;
+        for (size_t j=0; j < 10; ++j)
+            peaks.push_back(MZIntensityPair(100 + 50*j, (double) ((i*7 + j*3) % 11)));
+        spectrum->setMZIntensityPairs(peaks, MS_number_of_detector_counts);
+        spectrum->set(MS_total_ion_current, 1000 + (i*13)%97);
+        spectrum->set(MS_base_peak_m_z, 100 + 50*(i%10));
+        spectrum->set(MS_base_peak_intensity, 100 + (i*7)%23);
+
+        sl->spectra.push_back(spectrum);
+    }
+    msd.run.spectrumListPtr = sl;
+}
+
+
+void testShardCreation()
+{
+    if (os_) *os_ << "testShardCreation()\n"; 
+
+    MSData msd;
+    initializeRun(msd, 20);
+
+    ShardCountingAnalyzer analyzer;
+    MSDataAnalyzerDriver driver(analyzer, 4);
+    unit_assert(driver.analyze(msd) == MSDataAnalyzerDriver::Status_Ok);
+    unit_assert(analyzer.shardCount == 4);
+    unit_assert(analyzer.updateCount == 20);
+
+    // Bruker data is read on a single thread
+    MSData bruker;
+    initializeRun(bruker, 20, MS_Bruker_Daltonics_micrOTOF_series);
+
+    ShardCountingAnalyzer brukerAnalyzer;
+    MSDataAnalyzerDriver brukerDriver(brukerAnalyzer, 4);
+    unit_assert(brukerDriver.analyze(bruker) == MSDataAnalyzerDriver::Status_Ok);
+    unit_assert(brukerAnalyzer.shardCount == 0);
+    unit_assert(brukerAnalyzer.updateCount == 20);
+}
+
+
+// returns the output of RunSummary and SpectrumTable analyzing the same run on threadCount threads
+pair<string, string> analyzeSummaryAndTable(const MSData& msd, const bfs::path& outputDirectory, size_t threadCount)
+{
+    MSDataAnalyzer::DataInfo dataInfo(msd);
+    dataInfo.sourceFilename = "MSDataAnalyzerTest";
+    dataInfo.outputDirectory = outputDirectory.string();
+
+    boost::shared_ptr<MSDataCache> cache(new MSDataCache);
+    MSDataAnalyzerContainer analyzers;
+    analyzers.push_back(cache);
+    analyzers.push_back(MSDataAnalyzerPtr(new RunSummary(*cache, RunSummary::Config())));
+    analyzers.push_back(MSDataAnalyzerPtr(new SpectrumTable(*cache, SpectrumTable::Config("delimiter=tab"))));
+
+    // RunSummary writes to cout
+    ostringstream summary;
+    std::streambuf* coutBuffer = cout.rdbuf(summary.rdbuf());
+    try
+    {
+        MSDataAnalyzerDriver driver(analyzers, threadCount);
+        unit_assert(driver.analyze(dataInfo) == MSDataAnalyzerDriver::Status_Ok);
+    }
+    catch (...)
+    {
+        cout.rdbuf(coutBuffer);
+        throw;
+    }
+    cout.rdbuf(coutBuffer);
+
+    // the column headers are only written the first time, so compare the last line
+    vector<string> summaryLines;
+    string summaryText = summary.str();
+    bal::split(summaryLines, summaryText, bal::is_any_of("\n"), bal::token_compress_on);
+    while (!summaryLines.empty() && summaryLines.back().empty())
+        summaryLines.pop_back();
+    unit_assert(!summaryLines.empty());
+
+    string table;
+    {
+        bfs::ifstream is(outputDirectory / "MSDataAnalyzerTest.spectrum_table.tsv");
+        unit_assert(is);
+        table.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+    }
+    unit_assert(!table.empty());
+
+    return make_pair(summaryLines.back(), table);
+}
+
+
+void testShardedSummaryAndTable()
+{
+    if (os_) *os_ << "testShardedSummaryAndTable()\n"; 
+
+    MSData msd;
+    initializeRun(msd, 101);
+
+    bfs::path outputDirectory = bfs::temp_directory_path() / bfs::unique_path("MSDataAnalyzerTest-%%%%-%%%%");
+    bfs::create_directories(outputDirectory);
+
+    try
+    {
+        pair<string, string> serial = analyzeSummaryAndTable(msd, outputDirectory, 1);
+        if (os_) *os_ << serial.first << endl << serial.second << endl;
+
+        // every spectrum is in the table, in index order
+        unit_assert(serial.second.find("\n0\t1\t") != string::npos);
+        unit_assert(serial.second.find("\n100\t101\t") != string::npos);
+
+        for (size_t threadCount=2; threadCount <= 8; threadCount *= 2)
+        {
+            pair<string, string> parallel = analyzeSummaryAndTable(msd, outputDirectory, threadCount);
+            unit_assert_operator_equal(serial.first, parallel.first);
+            unit_assert_operator_equal(serial.second, parallel.second);
+        }
+    }
+    catch (...)
+    {
+        bfs::remove_all(outputDirectory);
+        throw;
+    }
+    bfs::remove_all(outputDirectory);
+}
+
+
 int main(int argc, char* argv[])
 {
     TEST_PROLOG(argc, argv)
@@ -186,6 +369,8 @@ int main(int argc, char* argv[])
     {
         if (argc>1 && !strcmp(argv[1],"-v")) os_ = &cout;
         test();
+        testShardCreation();
+        testShardedSummaryAndTable();
     }
     catch (exception& e)
     {
@@ -80,6 +80,40 @@ void MSDataCache::Impl::updateMRU(SpectrumInfo* info)
 }
 
 
+//
+// MSDataCache::Shard
+//
+
+
+class MSDataCache::Shard : public MSDataAnalyzer
+{
+    public:
+
+    Shard(MSDataCache& cache) : cache_(cache), impl_(cache.impl_->config) {}
+
+    virtual UpdateRequest updateRequested(const DataInfo& dataInfo, 
+                                          const SpectrumIdentity& spectrumIdentity) const
+    { 
+        return MSDataAnalyzer::UpdateRequest_Ok;
+    }
+
+    virtual void update(const DataInfo& dataInfo,
+                        const Spectrum& spectrum)
+    {
+        // each shard updates a distinct range of the cache
+        SpectrumInfo& info = cache_.at(spectrum.index);
+        info.update(spectrum, true);
+        impl_.updateMRU(&info);
+    }
+
+    const Impl::MRU& mru() const {return impl_.mru;}
+
+    private:
+    MSDataCache& cache_;
+    Impl impl_;
+};
+
+
 //
 // MSDataCache
 //
@@ -119,6 +153,26 @@ void MSDataCache::update(const DataInfo& dataInfo,
 }
 
 
+PWIZ_API_DECL MSDataAnalyzerPtr MSDataCache::createShard(const DataInfo& dataInfo) const
+{
+    if (!dataInfo.msd.run.spectrumListPtr.get() ||
+        size()!=dataInfo.msd.run.spectrumListPtr->size())
+        throw runtime_error("[MSDataCache::createShard()] Usage error."); 
+
+    return MSDataAnalyzerPtr(new Shard(const_cast<MSDataCache&>(*this)));
+}
+
+
+PWIZ_API_DECL void MSDataCache::mergeShard(MSDataAnalyzer& shard)
+{
+    // the shard's SpectrumInfo objects are already in place; take over its binary data
+    // in least to most recently used order, freeing the data that no longer fits
+    const Impl::MRU& mru = dynamic_cast<Shard&>(shard).mru();
+    for (Impl::MRU::const_reverse_iterator it=mru.rbegin(); it!=mru.rend(); ++it)
+        impl_->updateMRU(*it);
+}
+
+
 PWIZ_API_DECL const SpectrumInfo& MSDataCache::spectrumInfo(size_t index, bool getBinaryData)
 {
     if (!impl_->spectrumListPtr.get() ||
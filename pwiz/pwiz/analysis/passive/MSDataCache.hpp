@@ -71,6 +71,10 @@ using namespace msdata;
 /// automatically updating the cache via call to SpectrumList::spectrum() if
 /// necessary.
 ///
+/// For parallel analysis, shards of the cache update the SpectrumInfo objects
+/// of their own ranges of spectra in place, so that the shards of other
+/// analyzers can keep using the cache they were constructed with.
+///
 class PWIZ_API_DECL MSDataCache : public std::vector<SpectrumInfo>,
                                   public MSDataAnalyzer
                     
@@ -99,6 +103,10 @@ class PWIZ_API_DECL MSDataCache : public std::vector<SpectrumInfo>,
 
     virtual void update(const DataInfo& dataInfo, 
                         const Spectrum& spectrum);
+
+    virtual boost::shared_ptr<MSDataAnalyzer> createShard(const DataInfo& dataInfo) const;
+
+    virtual void mergeShard(MSDataAnalyzer& shard);
     //@}
 
     /// access to SpectrumInfo with automatic update (open() must be called first)
@@ -107,6 +115,7 @@ class PWIZ_API_DECL MSDataCache : public std::vector<SpectrumInfo>,
     private:
     struct Impl;
     boost::shared_ptr<Impl> impl_;
+    class Shard;
     MSDataCache(MSDataCache&);
     MSDataCache& operator=(MSDataCache&);
 };
@@ -84,9 +84,10 @@ struct RegionAnalyzer::Impl
     Stats stats;
     bool done;
     bool osDumpNeedsClosing; // true iff osDump was not passed to us
+    shared_ptr<ostringstream> osShardDump; // a shard's buffered dump
 
     Impl(const Config& _config, const MSDataCache& _cache)
-    :   config(_config), cache(_cache), done(false)
+    :   config(_config), cache(_cache), done(false), osDumpNeedsClosing(false)
     {}
 };
 
@@ -260,6 +261,48 @@ void RegionAnalyzer::update(const DataInfo& dataInfo,
 }
 
 
+PWIZ_API_DECL MSDataAnalyzerPtr RegionAnalyzer::createShard(const DataInfo& dataInfo) const
+{
+    Config shardConfig = impl_->config;
+    shardConfig.dumpRegionData = false;
+
+    shared_ptr<RegionAnalyzer> shard(new RegionAnalyzer(shardConfig, impl_->cache));
+    shard->impl_->spectrumStats.resize(impl_->spectrumStats.size());
+
+    if (impl_->config.osDump)
+    {
+        shard->impl_->osShardDump.reset(new ostringstream);
+        shard->impl_->config.osDump = shard->impl_->osShardDump.get();
+    }
+
+    return shard;
+}
+
+
+PWIZ_API_DECL void RegionAnalyzer::mergeShard(MSDataAnalyzer& shard)
+{
+    const Impl& shardImpl = *dynamic_cast<RegionAnalyzer&>(shard).impl_;
+
+    if (shardImpl.spectrumStats.size() != impl_->spectrumStats.size())
+        throw runtime_error("[RegionAnalyzer::mergeShard()] Shard does not match analyzer.");
+
+    // a serial analysis stops at the first spectrum past the region, so ignore later shards
+    if (impl_->done)
+        return;
+    impl_->done = shardImpl.done;
+
+    for (size_t i=0, end=shardImpl.spectrumStats.size(); i<end; ++i)
+    {
+        const SpectrumStats& ss = shardImpl.spectrumStats[i];
+        if (ss.sumIntensity != 0 || ss.max.mz != 0 || ss.max.intensity != 0)
+            impl_->spectrumStats[i] = ss;
+    }
+
+    if (shardImpl.osShardDump.get())
+        *impl_->config.osDump << shardImpl.osShardDump->str();
+}
+
+
 PWIZ_API_DECL void RegionAnalyzer::close(const DataInfo& dataInfo)
 {
     int count = 0;
@@ -98,6 +98,11 @@ class PWIZ_API_DECL RegionAnalyzer : public MSDataAnalyzer
                         const Spectrum& spectrum);
 
     virtual void close(const DataInfo& dataInfo);
+
+    /// shards buffer their region data dumps, which are written out in order when merged
+    virtual boost::shared_ptr<MSDataAnalyzer> createShard(const DataInfo& dataInfo) const;
+
+    virtual void mergeShard(MSDataAnalyzer& shard);
     //@}
 
     private:
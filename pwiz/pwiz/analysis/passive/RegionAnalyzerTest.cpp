@@ -97,7 +97,7 @@ ostream& operator<<(ostream& os, const RegionAnalyzer::Stats& stats)
 }
 
  
-void testConfig(const RegionAnalyzer::Config& config)
+void testConfig(const RegionAnalyzer::Config& config, size_t threadCount = 1)
 {
     MSData msd;
     initialize(msd);
@@ -109,7 +109,7 @@ void testConfig(const RegionAnalyzer::Config& config)
     analyzers.push_back(cache);
     analyzers.push_back(regionAnalyzer);
 
-    MSDataAnalyzerDriver driver(analyzers);
+    MSDataAnalyzerDriver driver(analyzers, threadCount);
     driver.analyze(msd);
 
     unit_assert(regionAnalyzer->spectrumStats().size() == 5);
@@ -223,6 +223,7 @@ void test()
     for (int n=1; n<(int)delimiter_options.size() &&  delimiter_options[n].size(); n++)
     {
     std::ostringstream txtstream;
+    std::ostringstream parallelstream;
     std::string delim = delimiter_options[0] + delimiter_options[n];
     if (os_) *os_ << "test with delimiter style " << delim <<":\n"; 
 
@@ -234,6 +235,8 @@ void test()
     config.mzRange = make_pair(.5, 5.5);
     config.indexRange = make_pair(1,3);
     testConfig(config);
+    config.osDump = &parallelstream;
+    testConfig(config, 3);
 
     if (os_) *os_ << "test scanNumber:\n"; 
     config = RegionAnalyzer::Config();
@@ -243,6 +246,8 @@ void test()
     config.mzRange = make_pair(.5, 5.5);
     config.scanNumberRange = make_pair(19,21);
     testConfig(config);
+    config.osDump = &parallelstream;
+    testConfig(config, 3);
 
     if (os_) *os_ << "test retentionTime:\n"; 
     config = RegionAnalyzer::Config();
@@ -252,6 +257,11 @@ void test()
     config.mzRange = make_pair(.5, 5.5);
     config.rtRange = make_pair(420.5, 423.5);
     testConfig(config);
+    config.osDump = &parallelstream;
+    testConfig(config, 3);
+
+    // shards dump the same region data in the same order
+    unit_assert(parallelstream.str() == txtstream.str());
 
     // save each output style
     outputs.push_back(txtstream.str());
@@ -129,6 +129,20 @@ void RegionSIC::update(const DataInfo& dataInfo,
 }
 
 
+PWIZ_API_DECL MSDataAnalyzerPtr RegionSIC::createShard(const DataInfo& dataInfo) const
+{
+    shared_ptr<RegionSIC> shard(new RegionSIC(cache_, config_));
+    shard->regionAnalyzer_ = boost::static_pointer_cast<RegionAnalyzer>(regionAnalyzer_->createShard(dataInfo));
+    return shard;
+}
+
+
+PWIZ_API_DECL void RegionSIC::mergeShard(MSDataAnalyzer& shard)
+{
+    regionAnalyzer_->mergeShard(*dynamic_cast<RegionSIC&>(shard).regionAnalyzer_);
+}
+
+
 PWIZ_API_DECL void RegionSIC::close(const DataInfo& dataInfo)
 {
     regionAnalyzer_->close(dataInfo);
@@ -72,6 +72,10 @@ class PWIZ_API_DECL RegionSIC : public MSDataAnalyzer
                         const Spectrum& spectrum);
 
     virtual void close(const DataInfo& dataInfo);
+
+    virtual boost::shared_ptr<MSDataAnalyzer> createShard(const DataInfo& dataInfo) const;
+
+    virtual void mergeShard(MSDataAnalyzer& shard);
     //@}
 
     private:
@@ -102,6 +102,20 @@ void RegionTIC::update(const DataInfo& dataInfo,
 }
 
 
+PWIZ_API_DECL MSDataAnalyzerPtr RegionTIC::createShard(const DataInfo& dataInfo) const
+{
+    shared_ptr<RegionTIC> shard(new RegionTIC(cache_, config_));
+    shard->regionAnalyzer_ = boost::static_pointer_cast<RegionAnalyzer>(regionAnalyzer_->createShard(dataInfo));
+    return shard;
+}
+
+
+PWIZ_API_DECL void RegionTIC::mergeShard(MSDataAnalyzer& shard)
+{
+    regionAnalyzer_->mergeShard(*dynamic_cast<RegionTIC&>(shard).regionAnalyzer_);
+}
+
+
 PWIZ_API_DECL void RegionTIC::close(const DataInfo& dataInfo)
 {
     regionAnalyzer_->close(dataInfo);
@@ -66,6 +66,10 @@ class PWIZ_API_DECL RegionTIC : public MSDataAnalyzer
                         const Spectrum& spectrum);
 
     virtual void close(const DataInfo& dataInfo);
+
+    virtual boost::shared_ptr<MSDataAnalyzer> createShard(const DataInfo& dataInfo) const;
+
+    virtual void mergeShard(MSDataAnalyzer& shard);
     //@}
 
     private:
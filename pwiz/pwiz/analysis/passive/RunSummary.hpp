@@ -57,6 +57,12 @@ class PWIZ_API_DECL RunSummary : public MSDataAnalyzer
                                           const SpectrumIdentity& spectrumIdentity) const;
 
     virtual void close(const DataInfo& dataInfo);
+
+    /// the cache holds everything needed for close(), so shards only request its updates
+    virtual boost::shared_ptr<MSDataAnalyzer> createShard(const DataInfo& dataInfo) const
+    {
+        return boost::shared_ptr<MSDataAnalyzer>(new RunSummary(cache_, config_));
+    }
     //@}
 
     private:
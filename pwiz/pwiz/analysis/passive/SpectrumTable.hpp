@@ -53,6 +53,12 @@ class PWIZ_API_DECL SpectrumTable : public MSDataAnalyzer
                                           const SpectrumIdentity& spectrumIdentity) const;
 
     virtual void close(const DataInfo& dataInfo);
+
+    /// the cache holds everything needed for close(), so shards only request its updates
+    virtual boost::shared_ptr<MSDataAnalyzer> createShard(const DataInfo& dataInfo) const
+    {
+        return boost::shared_ptr<MSDataAnalyzer>(new SpectrumTable(cache_, config_));
+    }
     //@}
 
     private:
@@ -24,7 +24,10 @@
 #define PWIZ_SOURCE
 #include "FeatureDetectorPeakel.hpp"
 #include "pwiz/analysis/passive/MSDataCache.hpp"
+#include "pwiz/data/msdata/SpectrumWorkerThreads.hpp"
 #include "pwiz/utility/misc/Std.hpp"
+#include <boost/thread.hpp>
+#include <boost/exception_ptr.hpp>
 
 
 namespace pwiz {
@@ -43,8 +46,11 @@ shared_ptr<FeatureDetectorPeakel> FeatureDetectorPeakel::create(FeatureDetectorP
         config.peakFinder_SNR.log = config.log;
         config.peakelGrower_Proximity.log = config.log;
         config.peakelPicker_Basic.log = config.log;
+        config.maxThreadCount = 1; // keep the log readable
     }
 
+    config.peakelGrower_Proximity.maxThreadCount = config.maxThreadCount;
+
     shared_ptr<NoiseCalculator> noiseCalculator(
         new NoiseCalculator_2Pass(config.noiseCalculator_2Pass));
 
@@ -55,17 +61,19 @@ shared_ptr<FeatureDetectorPeakel> FeatureDetectorPeakel::create(FeatureDetectorP
     shared_ptr<PeakelPicker> peakelPicker(new PeakelPicker_Basic(config.peakelPicker_Basic));
 
     return shared_ptr<FeatureDetectorPeakel>(
-        new FeatureDetectorPeakel(peakExtractor, peakelGrower, peakelPicker));
+        new FeatureDetectorPeakel(peakExtractor, peakelGrower, peakelPicker, config.maxThreadCount));
 }
 
 
 FeatureDetectorPeakel::FeatureDetectorPeakel(shared_ptr<PeakExtractor> peakExtractor,
                                              shared_ptr<PeakelGrower> peakelGrower,
-                                             shared_ptr<PeakelPicker> peakelPicker)
+                                             shared_ptr<PeakelPicker> peakelPicker,
+                                             size_t maxThreadCount)
 
 :   peakExtractor_(peakExtractor),
     peakelGrower_(peakelGrower),
-    peakelPicker_(peakelPicker)
+    peakelPicker_(peakelPicker),
+    maxThreadCount_(maxThreadCount)
 {
     if (!peakExtractor.get() || !peakelGrower.get() || !peakelPicker.get()) 
         throw runtime_error("[FeatureDetectorPeakel] Null pointer");
@@ -117,12 +125,113 @@ vector< vector<Peak> > extractPeaks(const MSData& msd, const PeakExtractor& peak
     return result;
 }
 
+
+// spectra waiting for peak extraction, handed off in index order by the reading thread
+struct ExtractionQueue
+{
+    boost::mutex mutex;
+    boost::condition_variable changed;
+    deque< pair<size_t, shared_ptr<SpectrumInfo> > > spectra;
+    bool done; // no more spectra will be queued
+    boost::exception_ptr error;
+
+    ExtractionQueue() : done(false) {}
+};
+
+
+void extractQueuedPeaks(ExtractionQueue& queue, const PeakExtractor& peakExtractor, vector< vector<Peak> >& result)
+{
+    try
+    {
+        while (true)
+        {
+            pair<size_t, shared_ptr<SpectrumInfo> > next;
+            {
+                boost::unique_lock<boost::mutex> lock(queue.mutex);
+                while (queue.spectra.empty() && !queue.done && !queue.error)
+                    queue.changed.wait(lock);
+                if (queue.spectra.empty() || queue.error)
+                    return;
+                next = queue.spectra.front();
+                queue.spectra.pop_front();
+                queue.changed.notify_all();
+            }
+
+            // each spectrum's peaks go to their own element of the result
+            vector<Peak>& peaks = result[next.first];
+            peakExtractor.extractPeaks(next.second->data, peaks);
+            for_each(peaks.begin(), peaks.end(), SetPeakMetadata(*next.second));
+        }
+    }
+    catch (...)
+    {
+        boost::lock_guard<boost::mutex> lock(queue.mutex);
+        if (!queue.error)
+            queue.error = boost::current_exception();
+        queue.changed.notify_all();
+    }
+}
+
+
+vector< vector<Peak> > extractPeaks(const MSData& msd, const PeakExtractor& peakExtractor, size_t threadCount)
+{
+    if (threadCount < 2 || !msd.run.spectrumListPtr.get())
+        return extractPeaks(msd, peakExtractor);
+
+    const SpectrumList& spectrumList = *msd.run.spectrumListPtr;
+    vector< vector<Peak> > result(spectrumList.size());
+
+    ExtractionQueue queue;
+    const size_t maxQueued = threadCount * 4;
+
+    boost::thread_group threads;
+    for (size_t i=0; i < threadCount; ++i)
+        threads.create_thread(boost::bind(&extractQueuedPeaks, boost::ref(queue), boost::cref(peakExtractor), boost::ref(result)));
+
+    try
+    {
+        SpectrumWorkerThreads spectrumWorkers(spectrumList);
+        for (size_t index=0; index < result.size(); ++index)
+        {
+            shared_ptr<SpectrumInfo> spectrumInfo(new SpectrumInfo);
+            spectrumInfo->update(*spectrumWorkers.processBatch(index, true), true);
+
+            boost::unique_lock<boost::mutex> lock(queue.mutex);
+            while (queue.spectra.size() >= maxQueued && !queue.error)
+                queue.changed.wait(lock);
+            if (queue.error)
+                break;
+            queue.spectra.push_back(make_pair(index, spectrumInfo));
+            queue.changed.notify_all();
+        }
+    }
+    catch (...)
+    {
+        boost::lock_guard<boost::mutex> lock(queue.mutex);
+        if (!queue.error)
+            queue.error = boost::current_exception();
+    }
+
+    {
+        boost::lock_guard<boost::mutex> lock(queue.mutex);
+        queue.done = true;
+        queue.changed.notify_all();
+    }
+    threads.join_all();
+
+    if (queue.error)
+        boost::rethrow_exception(queue.error);
+
+    return result;
+}
+
 } // namespace
 
 
 void FeatureDetectorPeakel::detect(const MSData& msd, FeatureField& result) const
 {
-    vector< vector<Peak> > peaks = extractPeaks(msd, *peakExtractor_);
+    size_t threadCount = maxThreadCount_ > 0 ? maxThreadCount_ : max(1u, boost::thread::hardware_concurrency());
+    vector< vector<Peak> > peaks = extractPeaks(msd, *peakExtractor_, threadCount);
 
     PeakelField peakelField;
     peakelGrower_->sowPeaks(peakelField, peaks);
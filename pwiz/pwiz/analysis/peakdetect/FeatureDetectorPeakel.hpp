@@ -48,9 +48,11 @@ class PWIZ_API_DECL FeatureDetectorPeakel : public FeatureDetector
 
     typedef pwiz::msdata::MSData MSData;
 
+    /// peaks are extracted from the spectra on up to maxThreadCount threads (0 for one per processor)
     FeatureDetectorPeakel(boost::shared_ptr<PeakExtractor> peakExtractor,
                           boost::shared_ptr<PeakelGrower> peakelGrower,
-                          boost::shared_ptr<PeakelPicker> peakelPicker);
+                          boost::shared_ptr<PeakelPicker> peakelPicker,
+                          size_t maxThreadCount = 1);
 
     virtual void detect(const MSData& msd, FeatureField& result) const;
     
@@ -59,13 +61,14 @@ class PWIZ_API_DECL FeatureDetectorPeakel : public FeatureDetector
     struct Config
     {
         std::ostream* log; // propagates to sub-objects during create()
+        size_t maxThreadCount; // propagates to the PeakelGrower during create(); 0 for one per processor; ignored with a log
         NoiseCalculator_2Pass::Config noiseCalculator_2Pass;
         PeakFinder_SNR::Config peakFinder_SNR;
         PeakFitter_Parabola::Config peakFitter_Parabola;
         PeakelGrower_Proximity::Config peakelGrower_Proximity;
         PeakelPicker_Basic::Config peakelPicker_Basic;
         
-        Config() : log(0) {}
+        Config() : log(0), maxThreadCount(1) {}
     };
     
     static boost::shared_ptr<FeatureDetectorPeakel> create(Config config);
@@ -74,6 +77,7 @@ class PWIZ_API_DECL FeatureDetectorPeakel : public FeatureDetector
     boost::shared_ptr<PeakExtractor> peakExtractor_;
     boost::shared_ptr<PeakelGrower> peakelGrower_;
     boost::shared_ptr<PeakelPicker> peakelPicker_;
+    size_t maxThreadCount_;
 };
 
 
@@ -71,9 +71,18 @@ void verifyBombesinFeatures(const FeatureField& featureField)
 }
 
 
-shared_ptr<FeatureDetectorPeakel> createFeatureDetectorPeakel()
+void verifySameFeatures(const FeatureField& a, const FeatureField& b)
+{
+    unit_assert_operator_equal(a.size(), b.size());
+    for (FeatureField::const_iterator it=a.begin(), jt=b.begin(); it!=a.end(); ++it, ++jt)
+        unit_assert(**it == **jt);
+}
+
+
+shared_ptr<FeatureDetectorPeakel> createFeatureDetectorPeakel(size_t maxThreadCount = 1)
 {
     FeatureDetectorPeakel::Config config;
+    config.maxThreadCount = maxThreadCount;
 
     // these are just the defaults, to demonstrate usage
 
@@ -119,11 +128,110 @@ void testBombesin(const string& filename)
     
     if (os_) *os_ << "featureField:\n" << featureField << endl;
     verifyBombesinFeatures(featureField);
+
+    // peaks extracted and peakels grown on several threads give the same features
+
+    FeatureField featureFieldThreaded;
+    createFeatureDetectorPeakel(4)->detect(msd, featureFieldThreaded);
+    verifySameFeatures(featureField, featureFieldThreaded);
+}
+
+
+// appends a profile peak to the arrays
+void addProfilePeak(vector<double>& mzArray, vector<double>& intensityArray, double mz, double intensity)
+{
+    const double width = .004;
+    for (int i=-10; i <= 10; ++i)
+    {
+        mzArray.push_back(mz + i * width/2);
+        intensityArray.push_back(intensity * exp(-.5 * i*i/4.));
+    }
+}
+
+
+// a run with a charge 2 and a charge 3 isotope envelope eluting over 40 MS1 spectra,
+// on a noisy baseline
+void initializeSimulatedRun(MSData& msd)
+{
+    shared_ptr<SpectrumListSimple> sl(new SpectrumListSimple);
+    msd.run.spectrumListPtr = sl;
+
+    const double mzLow = 530, mzHigh = 830;
+    const double envelopes[][2] = {{810.415, 2}, {540.612, 3}}; // monoisotopic m/z, charge
+    const double isotopeIntensity[] = {1, .8, .45, .2};
+    unsigned int noiseSeed = 1;
+
+    for (size_t index=0; index < 40; ++index)
+    {
+        double rt = 1800 + 2.5 * index;
+        double elution = 1e5 * exp(-.5 * pow((rt - 1850) / 8, 2));
+
+        vector<double> mzArray, intensityArray;
+        for (double mz=mzLow; mz < mzHigh; mz += 1)
+        {
+            // deterministic noise, so the serial and threaded runs see the same data
+            noiseSeed = noiseSeed * 1103515245 + 12345;
+            mzArray.push_back(mz);
+            intensityArray.push_back(10 + (noiseSeed >> 16) % 20);
+        }
+
+        for (size_t i=0; i < 2; ++i)
+            for (size_t j=0; j < 4; ++j)
+                addProfilePeak(mzArray, intensityArray, envelopes[i][0] + j / envelopes[i][1], elution * isotopeIntensity[j]);
+
+        // sort the points by m/z
+        vector< pair<double, double> > points;
+        for (size_t i=0; i < mzArray.size(); ++i)
+            points.push_back(make_pair(mzArray[i], intensityArray[i]));
+        sort(points.begin(), points.end());
+        for (size_t i=0; i < points.size(); ++i)
+        {
+            mzArray[i] = points[i].first;
+            intensityArray[i] = points[i].second;
+        }
+
+        SpectrumPtr s(new Spectrum);
+        s->index = index;
+        s->id = "scan=" + lexical_cast<string>(index + 1);
+        s->set(MS_MS1_spectrum);
+        s->set(MS_ms_level, 1);
+        s->set(MS_profile_spectrum);
+        s->scanList.scans.push_back(pwiz::msdata::Scan());
+        s->scanList.scans.back().set(MS_scan_start_time, rt, UO_second);
+        s->setMZIntensityArrays(mzArray, intensityArray, MS_number_of_detector_counts);
+        sl->spectra.push_back(s);
+    }
+}
+
+
+void testSimulatedRun()
+{
+    if (os_) *os_ << "testSimulatedRun()" << endl;
+
+    MSData msd;
+    initializeSimulatedRun(msd);
+
+    FeatureField featureField;
+    createFeatureDetectorPeakel()->detect(msd, featureField);
+    if (os_) *os_ << "featureField:\n" << featureField << endl;
+    unit_assert_operator_equal(2, featureField.size());
+    unit_assert_operator_equal(3, (*featureField.begin())->charge);
+    unit_assert_operator_equal(2, (*featureField.rbegin())->charge);
+
+    // more spectra than the extraction threads queue, so the reading thread waits for them
+    const size_t threadCounts[] = {2, 4, 8};
+    for (size_t i=0; i < 3; ++i)
+    {
+        FeatureField featureFieldThreaded;
+        createFeatureDetectorPeakel(threadCounts[i])->detect(msd, featureFieldThreaded);
+        verifySameFeatures(featureField, featureFieldThreaded);
+    }
 }
 
 
 void test(const bfs::path& datadir)
 {
+    testSimulatedRun();
     testBombesin((datadir / "FeatureDetectorTest_Bombesin.mzML").string());
 }
 
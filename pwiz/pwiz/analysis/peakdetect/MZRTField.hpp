@@ -32,7 +32,11 @@
 #include "boost/concept/assert.hpp"
 #include "boost/concept/usage.hpp"
 #include <set>
+#include <map>
 #include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 
 namespace pwiz {
@@ -116,6 +120,98 @@ PWIZ_API_DECL std::ostream& operator<<(std::ostream& os, const PeakelField& peak
 PWIZ_API_DECL std::ostream& operator<<(std::ostream& os, const FeatureField& featureField);
 
 
+///
+/// MZRTGrid holds the same objects as MZRTField, but buckets them in a grid of
+/// m/z x retention time cells; each cell is a sorted run of objects with the same
+/// m/z bucket and retentionTimeMin() bucket.  Queries only visit the cells that
+/// may hold matches, and objects are added without allocating a tree node each.
+///
+/// An object's mz and retentionTimeMin() must not change while it is in the grid.
+/// Its retentionTimeMax() may grow, but update() must then be called so that
+/// retention time queries still find it.
+///
+template <typename T>
+class MZRTGrid
+{
+    public:
+
+    typedef boost::shared_ptr<T> TPtr;
+
+    MZRTGrid(double mzBucketWidth = .1, double rtBucketWidth = 60);
+
+    /// add an object; like MZRTField::insert(), returns false if an object
+    /// with equal m/z and retention time is already present
+    bool insert(const TPtr& p);
+
+    /// bulk add; cheaper than adding the objects one at a time
+    template <typename InputIterator>
+    void insert(InputIterator begin, InputIterator end);
+
+    /// find all objects with a given m/z, within a given m/z tolerance,
+    /// satisfying the 'matches' predicate; results are in LessThan_MZRT order,
+    /// the same as MZRTField::find()
+    template <typename RTMatches>
+    std::vector<TPtr> 
+    find(double mz, MZTolerance mzTolerance, RTMatches matches) const;
+
+    /// as above, but only considering objects whose retention time range
+    /// overlaps [rtLow, rtHigh]
+    template <typename RTMatches>
+    std::vector<TPtr> 
+    find(double mz, MZTolerance mzTolerance, double rtLow, double rtHigh, RTMatches matches) const;
+
+    /// notify the grid that an object's retentionTimeMax() has grown
+    void update(const TPtr& p);
+
+    /// remove an object via a shared reference
+    void remove(const TPtr& p); 
+
+    size_t size() const {return size_;}
+    bool empty() const {return size_ == 0;}
+    void clear() {columns_.clear(); size_ = 0;}
+
+    /// all objects, in LessThan_MZRT order
+    std::vector<TPtr> sorted() const;
+
+    private:
+
+    struct Cell
+    {
+        std::vector<TPtr> objects; // in LessThan_MZRT order
+        double retentionTimeMax; // bounds the objects' retentionTimeMax()
+        Cell() : retentionTimeMax(-std::numeric_limits<double>::max()) {}
+    };
+
+    // the cells of one m/z bucket, in retention time order
+    struct Column
+    {
+        int rtIndexBegin;
+        std::vector<Cell> cells;
+        Column() : rtIndexBegin(0) {}
+    };
+
+    typedef std::map<int, Column> Columns;
+
+    double mzBucketWidth_;
+    double rtBucketWidth_;
+    Columns columns_;
+    size_t size_;
+
+    int mzIndex(double mz) const {return (int) std::floor(mz / mzBucketWidth_);}
+    int rtIndex(double rt) const {return (int) std::floor(rt / rtBucketWidth_);}
+    Cell& cell(const T& t);
+    Cell* findCell(const T& t);
+
+    template <typename RTMatches>
+    std::vector<TPtr> 
+    find(double mz, MZTolerance mzTolerance, bool restrictRT, double rtLow, double rtHigh, RTMatches matches) const;
+};
+
+
+typedef MZRTGrid<pwiz::data::peakdata::Peakel> PeakelGrid;
+typedef MZRTGrid<pwiz::data::peakdata::Feature> FeatureGrid;
+
+
 /// predicate always returns true
 template <typename T>
 struct RTMatches_Any
@@ -204,6 +300,209 @@ void MZRTField<T>::remove(const boost::shared_ptr<T>& p)
 }
 
 
+template <typename T>
+MZRTGrid<T>::MZRTGrid(double mzBucketWidth, double rtBucketWidth)
+:   mzBucketWidth_(mzBucketWidth), rtBucketWidth_(rtBucketWidth), size_(0)
+{
+    if (mzBucketWidth <= 0 || rtBucketWidth <= 0)
+        throw std::runtime_error("[MZRTGrid::MZRTGrid()] Bucket widths must be positive.");
+}
+
+
+template <typename T>
+typename MZRTGrid<T>::Cell& MZRTGrid<T>::cell(const T& t)
+{
+    Column& column = columns_[mzIndex(t.mz)];
+    int index = rtIndex(t.retentionTimeMin());
+
+    if (column.cells.empty())
+        column.rtIndexBegin = index;
+    else if (index < column.rtIndexBegin)
+    {
+        column.cells.insert(column.cells.begin(), column.rtIndexBegin - index, Cell());
+        column.rtIndexBegin = index;
+    }
+
+    if (index - column.rtIndexBegin >= (int) column.cells.size())
+        column.cells.resize(index - column.rtIndexBegin + 1);
+
+    return column.cells[index - column.rtIndexBegin];
+}
+
+
+template <typename T>
+typename MZRTGrid<T>::Cell* MZRTGrid<T>::findCell(const T& t)
+{
+    typename Columns::iterator column = columns_.find(mzIndex(t.mz));
+    if (column == columns_.end()) return 0;
+
+    int index = rtIndex(t.retentionTimeMin()) - column->second.rtIndexBegin;
+    if (index < 0 || index >= (int) column->second.cells.size()) return 0;
+
+    return &column->second.cells[index];
+}
+
+
+template <typename T>
+bool MZRTGrid<T>::insert(const TPtr& p)
+{
+    Cell& c = cell(*p);
+
+    typename std::vector<TPtr>::iterator it = 
+        std::lower_bound(c.objects.begin(), c.objects.end(), p, LessThan_MZRT<T>());
+    if (it != c.objects.end() && !LessThan_MZRT<T>()(p, *it))
+        return false;
+
+    c.objects.insert(it, p);
+    c.retentionTimeMax = std::max(c.retentionTimeMax, p->retentionTimeMax());
+    ++size_;
+    return true;
+}
+
+
+template <typename T>
+template <typename InputIterator>
+void MZRTGrid<T>::insert(InputIterator begin, InputIterator end)
+{
+    // sorting first means each object is appended to its cell
+    std::vector<TPtr> objects(begin, end);
+    std::sort(objects.begin(), objects.end(), LessThan_MZRT<T>());
+
+    for (typename std::vector<TPtr>::const_iterator it=objects.begin(); it!=objects.end(); ++it)
+    {
+        Cell& c = cell(**it);
+        if (!c.objects.empty() && !LessThan_MZRT<T>()(c.objects.back(), *it))
+        {
+            insert(*it);
+            continue;
+        }
+
+        c.objects.push_back(*it);
+        c.retentionTimeMax = std::max(c.retentionTimeMax, (*it)->retentionTimeMax());
+        ++size_;
+    }
+}
+
+
+template <typename T>
+template <typename RTMatches>
+std::vector< boost::shared_ptr<T> > 
+MZRTGrid<T>::find(double mz, MZTolerance mzTolerance, RTMatches matches) const
+{
+    return find(mz, mzTolerance, false, 0, 0, matches);
+}
+
+
+template <typename T>
+template <typename RTMatches>
+std::vector< boost::shared_ptr<T> > 
+MZRTGrid<T>::find(double mz, MZTolerance mzTolerance, double rtLow, double rtHigh, RTMatches matches) const
+{
+    return find(mz, mzTolerance, true, rtLow, rtHigh, matches);
+}
+
+
+template <typename T>
+template <typename RTMatches>
+std::vector< boost::shared_ptr<T> > 
+MZRTGrid<T>::find(double mz, MZTolerance mzTolerance, bool restrictRT, double rtLow, double rtHigh, RTMatches matches) const
+{
+    // same bounds as MZRTField::find()
+    TPtr low(new T), high(new T);
+    low->mz = mz - mzTolerance;
+    high->mz = mz + mzTolerance;
+    LessThan_MZRT<T> lessThan;
+
+    std::vector<TPtr> result;
+
+    typename Columns::const_iterator column = columns_.lower_bound(mzIndex(low->mz));
+    typename Columns::const_iterator columnEnd = columns_.upper_bound(mzIndex(high->mz));
+    for (; column != columnEnd; ++column)
+    {
+        const std::vector<Cell>& cells = column->second.cells;
+
+        size_t cellEnd = cells.size();
+        if (restrictRT)
+        {
+            // cells starting after rtHigh cannot overlap
+            double lastCell = std::floor(rtHigh / rtBucketWidth_) - column->second.rtIndexBegin;
+            if (lastCell < 0)
+                continue;
+            if (lastCell + 1 < cellEnd)
+                cellEnd = (size_t) lastCell + 1;
+        }
+
+        for (size_t i=0; i < cellEnd; ++i)
+        {
+            const Cell& c = cells[i];
+            if (restrictRT && c.retentionTimeMax < rtLow)
+                continue;
+
+            typename std::vector<TPtr>::const_iterator it = 
+                std::lower_bound(c.objects.begin(), c.objects.end(), low, lessThan);
+            for (; it != c.objects.end() && !lessThan(high, *it); ++it)
+            {
+                if (restrictRT && ((*it)->retentionTimeMin() > rtHigh || (*it)->retentionTimeMax() < rtLow))
+                    continue;
+                if (matches(**it))
+                    result.push_back(*it);
+            }
+        }
+    }
+
+    std::sort(result.begin(), result.end(), lessThan);
+    return result;
+}
+
+
+template <typename T>
+void MZRTGrid<T>::update(const TPtr& p)
+{
+    Cell* c = findCell(*p);
+    if (!c) throw std::runtime_error("[MZRTGrid::update()] TPtr not found.");
+    c->retentionTimeMax = std::max(c->retentionTimeMax, p->retentionTimeMax());
+}
+
+
+template <typename T>
+void MZRTGrid<T>::remove(const TPtr& p)
+{
+    Cell* c = findCell(*p);
+
+    typename std::vector<TPtr>::iterator found;
+    if (c)
+    {
+        std::pair<typename std::vector<TPtr>::iterator, typename std::vector<TPtr>::iterator>
+            range = std::equal_range(c->objects.begin(), c->objects.end(), p, LessThan_MZRT<T>());
+        found = std::find(range.first, range.second, p);
+        if (found == range.second) c = 0;
+    }
+
+    if (!c) throw std::runtime_error("[MZRTGrid::remove()] TPtr not found.");
+
+    c->objects.erase(found);
+    --size_;
+}
+
+
+template <typename T>
+std::vector< boost::shared_ptr<T> > MZRTGrid<T>::sorted() const
+{
+    std::vector<TPtr> result;
+    result.reserve(size_);
+
+    for (typename Columns::const_iterator column=columns_.begin(); column!=columns_.end(); ++column)
+    {
+        size_t columnBegin = result.size();
+        for (size_t i=0; i < column->second.cells.size(); ++i)
+            result.insert(result.end(), column->second.cells[i].objects.begin(), column->second.cells[i].objects.end());
+        std::sort(result.begin() + columnBegin, result.end(), LessThan_MZRT<T>());
+    }
+
+    return result;
+}
+
+
 } // namespace analysis
 } // namespace pwiz
 
@@ -151,6 +151,80 @@ void testFind()
 }
 
 
+void testGrid()
+{
+    if (os_) *os_ << "testGrid()\n";
+
+    // same objects as testFind(), plus a pseudo-random field spanning many cells
+
+    MZRTField<Simple> simpleField;
+    MZRTGrid<Simple> simpleGrid(1, 2);
+
+    SimplePtr a(new Simple(400, 660, 661));
+    SimplePtr b(new Simple(400, 664, 668));
+    SimplePtr c(new Simple(420, 660, 662));
+    SimplePtr d(new Simple(420, 665, 667));
+    simpleField.insert(a);
+    simpleField.insert(b);
+    simpleGrid.insert(a);
+    simpleGrid.insert(b);
+
+    vector<SimplePtr> simples;
+    simples.push_back(c);
+    simples.push_back(d);
+    unsigned int seed = 1;
+    for (int i=0; i < 1000; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        double mz = 395 + (seed >> 8) % 3000 / 100.;
+        seed = seed * 1103515245 + 12345;
+        double rtMin = 600 + (seed >> 8) % 1200 / 10.;
+        simples.push_back(SimplePtr(new Simple(mz, rtMin, rtMin + i % 7)));
+    }
+
+    for (vector<SimplePtr>::const_iterator it=simples.begin(); it!=simples.end(); ++it)
+        simpleField.insert(*it);
+    simpleGrid.insert(simples.begin(), simples.end());
+
+    unit_assert(simpleGrid.size() == simpleField.size());
+    unit_assert(!simpleGrid.insert(SimplePtr(new Simple(*a)))); // equivalent to a
+
+    vector<SimplePtr> sorted = simpleGrid.sorted();
+    unit_assert(sorted.size() == simpleField.size() && equal(sorted.begin(), sorted.end(), simpleField.begin()));
+
+    vector<SimplePtr> result = simpleGrid.find(410, 11, RTMatches_Contains<Simple>(666,0));
+    unit_assert(result == simpleField.find(410, 11, RTMatches_Contains<Simple>(666,0)));
+    unit_assert(find(result.begin(), result.end(), b) != result.end());
+    unit_assert(find(result.begin(), result.end(), d) != result.end());
+
+    // restricting retention time returns the same matches
+    for (double mz=395; mz < 425; mz += .37)
+    for (double rt=590; rt < 740; rt += 3.1)
+    {
+        MZTolerance tolerance(.5);
+        RTMatches_Contains<Simple> matches(rt, 1);
+        vector<SimplePtr> expected = simpleField.find(mz, tolerance, matches);
+        unit_assert(simpleGrid.find(mz, tolerance, matches) == expected);
+        unit_assert(simpleGrid.find(mz, tolerance, rt-1, rt+1, matches) == expected);
+    }
+
+    unit_assert(simpleGrid.find(420, 1, RTMatches_IsContainedIn<Simple>(*b)) ==
+                simpleField.find(420, 1, RTMatches_IsContainedIn<Simple>(*b)));
+
+    // growing an object's retention time range
+    b->rtMax = 700;
+    simpleGrid.update(b);
+    result = simpleGrid.find(400, .1, 690, 695, RTMatches_Contains<Simple>(692));
+    unit_assert(find(result.begin(), result.end(), b) != result.end());
+
+    simpleGrid.remove(b);
+    unit_assert(simpleGrid.size() == simpleField.size() - 1);
+    result = simpleGrid.find(400, .1, 690, 695, RTMatches_Contains<Simple>(692));
+    unit_assert(find(result.begin(), result.end(), b) == result.end());
+    unit_assert_throws(simpleGrid.remove(b), runtime_error);
+}
+
+
 void testPeakelField()
 {
     if (os_) *os_ << "testPeakelField()\n";
@@ -285,6 +359,7 @@ void test()
     testPredicate_Feature();
     testConceptChecking();
     testFind();
+    testGrid();
     testPeakelField();
     testFeatureField();
 }
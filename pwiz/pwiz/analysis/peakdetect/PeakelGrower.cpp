@@ -24,6 +24,8 @@
 #include "PeakelGrower.hpp"
 #include <functional>
 #include "pwiz/utility/misc/Std.hpp"
+#include <boost/thread.hpp>
+#include <boost/exception_ptr.hpp>
 
 
 namespace pwiz {
@@ -66,7 +68,8 @@ namespace {
 
 //#define PEAKELGROWER_DEBUG
 
-void insertNewPeakel(PeakelField& peakelField, const Peak& peak)
+template <typename Field>
+void insertNewPeakel(Field& peakelField, const Peak& peak)
 {
     PeakelPtr peakel(new Peakel);
     peakel->mz = peak.mz;
@@ -90,32 +93,167 @@ void updatePeakel(Peakel& peakel, const Peak& peak)
 #endif
 }
 
-} // namespace
+
+void peakelUpdated(PeakelField& peakelField, const PeakelPtr& peakel)
+{}
 
 
-void PeakelGrower_Proximity::sowPeak(PeakelField& peakelField, const Peak& peak) const
+void peakelUpdated(PeakelGrid& peakelGrid, const PeakelPtr& peakel)
+{
+    peakelGrid.update(peakel);
+}
+
+
+vector<PeakelPtr> findCandidates(const PeakelField& peakelField, const Peak& peak,
+                                 const PeakelGrower_Proximity::Config& config)
+{
+    return peakelField.find(peak.mz, config.mzTolerance,
+        RTMatches_Contains<Peakel>(peak.retentionTime, config.rtTolerance));
+}
+
+
+vector<PeakelPtr> findCandidates(const PeakelGrid& peakelGrid, const Peak& peak,
+                                 const PeakelGrower_Proximity::Config& config)
+{
+    // only peakels overlapping the peak's retention time (+/- tolerance) can contain it
+    return peakelGrid.find(peak.mz, config.mzTolerance,
+        peak.retentionTime - config.rtTolerance, peak.retentionTime + config.rtTolerance,
+        RTMatches_Contains<Peakel>(peak.retentionTime, config.rtTolerance));
+}
+
+
+template <typename Field>
+void sowPeak(Field& peakelField, const Peak& peak, const PeakelGrower_Proximity::Config& config)
 {
-    vector<PeakelPtr> candidates = peakelField.find(peak.mz, config_.mzTolerance,
-        RTMatches_Contains<Peakel>(peak.retentionTime, config_.rtTolerance));
+    vector<PeakelPtr> candidates = findCandidates(peakelField, peak, config);
 
     if (candidates.empty())
         insertNewPeakel(peakelField, peak);
     else if (candidates.size() == 1)
+    {
         updatePeakel(*candidates.front(), peak);
+        peakelUpdated(peakelField, candidates.front());
+    }
     else
     {
-        if (config_.log)
+        if (config.log)
         {
-            *config_.log << "[PeakelGrower_Proximity::sowPeak()] Warning: multiple candidate peakels.\n"
+            *config.log << "[PeakelGrower_Proximity::sowPeak()] Warning: multiple candidate peakels.\n"
                  << "  peak: " << peak
                  << "  candidates: " << candidates.size() << endl;
             for (vector<PeakelPtr>::const_iterator it=candidates.begin(); it!=candidates.end(); ++it)
-                *config_.log << **it << endl;
-            *config_.log << endl;
+                *config.log << **it << endl;
+            *config.log << endl;
         }
     }
 }
 
+// returns the m/z values splitting the peaks into about stripeCount stripes, such that no peak
+// is within tolerance of a peak or peakel in another stripe
+vector<double> stripeBoundaries(const vector< vector<Peak> >& peaks, const PeakelField& peakelField,
+                                MZTolerance mzTolerance, size_t stripeCount)
+{
+    vector<double> mzs;
+    for (vector< vector<Peak> >::const_iterator it=peaks.begin(); it!= peaks.end(); ++it)
+        for (vector<Peak>::const_iterator jt=it->begin(); jt!=it->end(); ++jt)
+            mzs.push_back(jt->mz);
+    for (PeakelField::const_iterator it=peakelField.begin(); it!=peakelField.end(); ++it)
+        mzs.push_back((*it)->mz);
+    sort(mzs.begin(), mzs.end());
+
+    vector<double> boundaries;
+    size_t stripeSize = mzs.size() / stripeCount + 1;
+    for (size_t i=stripeSize; i < mzs.size(); ++i)
+    {
+        // windows around the m/z values on either side of the boundary must not overlap
+        if (mzs[i-1] + mzTolerance < mzs[i] - mzTolerance)
+        {
+            boundaries.push_back(mzs[i]);
+            i += stripeSize - 1;
+        }
+    }
+    return boundaries;
+}
+
+
+struct Stripe
+{
+    double mzBegin, mzEnd;
+    PeakelGrid peakelGrid;
+};
+
+
+void growStripe(Stripe& stripe, const vector< vector<Peak> >& peaks,
+                const PeakelGrower_Proximity::Config& config, boost::exception_ptr& error)
+{
+    try
+    {
+        for (vector< vector<Peak> >::const_iterator it=peaks.begin(); it!= peaks.end(); ++it)
+            for (vector<Peak>::const_iterator jt=it->begin(); jt!=it->end(); ++jt)
+                if (jt->mz >= stripe.mzBegin && jt->mz < stripe.mzEnd)
+                    sowPeak(stripe.peakelGrid, *jt, config);
+    }
+    catch (...)
+    {
+        error = boost::current_exception();
+    }
+}
+
+} // namespace
+
+
+void PeakelGrower_Proximity::sowPeak(PeakelField& peakelField, const Peak& peak) const
+{
+    pwiz::analysis::sowPeak(peakelField, peak, config_);
+}
+
+
+void PeakelGrower_Proximity::sowPeaks(PeakelField& peakelField, const vector< vector<Peak> >& peaks) const
+{
+    size_t threadCount = config_.maxThreadCount > 0 ? config_.maxThreadCount : max(1u, boost::thread::hardware_concurrency());
+    if (config_.log)
+        threadCount = 1; // keep the log readable
+
+    vector<double> boundaries;
+    if (threadCount > 1)
+        boundaries = stripeBoundaries(peaks, peakelField, config_.mzTolerance, threadCount);
+
+    vector<Stripe> stripes(boundaries.size() + 1);
+    for (size_t i=0; i < stripes.size(); ++i)
+    {
+        stripes[i].mzBegin = i == 0 ? -numeric_limits<double>::max() : boundaries[i-1];
+        stripes[i].mzEnd = i == boundaries.size() ? numeric_limits<double>::max() : boundaries[i];
+    }
+
+    for (PeakelField::const_iterator it=peakelField.begin(); it!=peakelField.end(); ++it)
+        stripes[upper_bound(boundaries.begin(), boundaries.end(), (*it)->mz) - boundaries.begin()].peakelGrid.insert(*it);
+
+    vector<boost::exception_ptr> errors(stripes.size());
+    if (stripes.size() == 1)
+        growStripe(stripes[0], peaks, config_, errors[0]);
+    else
+    {
+        boost::thread_group threads;
+        for (size_t i=0; i < stripes.size(); ++i)
+            threads.create_thread(boost::bind(&growStripe, boost::ref(stripes[i]), boost::cref(peaks),
+                                              boost::cref(config_), boost::ref(errors[i])));
+        threads.join_all();
+    }
+
+    for (size_t i=0; i < errors.size(); ++i)
+        if (errors[i])
+            boost::rethrow_exception(errors[i]);
+
+    // the stripes' peakels are sorted, so each one is inserted at the end of the field
+    peakelField.clear();
+    for (size_t i=0; i < stripes.size(); ++i)
+    {
+        vector<PeakelPtr> peakels = stripes[i].peakelGrid.sorted();
+        for (vector<PeakelPtr>::const_iterator it=peakels.begin(); it!=peakels.end(); ++it)
+            peakelField.insert(peakelField.end(), *it);
+    }
+}
+
 
 } // namespace analysis
 } // namespace pwiz
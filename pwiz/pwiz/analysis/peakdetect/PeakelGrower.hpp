@@ -63,15 +63,22 @@ class PWIZ_API_DECL PeakelGrower_Proximity : public PeakelGrower
         MZTolerance mzTolerance; // m/z units
         double rtTolerance; // seconds
         std::ostream* log;
+        size_t maxThreadCount; // for growing m/z stripes in parallel; 0 for one per processor
         
         Config(double _mzTolerance = .01, double _rtTolerance = 10)
-        :   mzTolerance(_mzTolerance), rtTolerance(_rtTolerance), log(0)
+        :   mzTolerance(_mzTolerance), rtTolerance(_rtTolerance), log(0), maxThreadCount(1)
         {}
     };
 
     PeakelGrower_Proximity(const Config& config = Config());
     virtual void sowPeak(PeakelField&, const Peak& peak) const;
 
+    /// grows the peakels in a PeakelGrid, and adds them to the PeakelField when done;
+    /// with several threads, the peaks are split into m/z stripes at gaps wider than the
+    /// tolerance, so each stripe's peakels can be grown independently with the same result
+    virtual void sowPeaks(PeakelField& peakelField, const std::vector< std::vector<Peak> >& peaks) const;
+    using PeakelGrower::sowPeaks;
+
     private:
     Config config_;
 };
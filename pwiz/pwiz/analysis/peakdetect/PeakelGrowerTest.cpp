@@ -73,13 +73,14 @@ vector< vector<Peak> > createToyPeaks()
 }
 
 
-void testToyExample()
+void testToyExample(size_t maxThreadCount)
 {
     vector< vector<Peak> > peaks = createToyPeaks();
 
     PeakelGrower_Proximity::Config config;
     config.mzTolerance = .1;
     config.rtTolerance = 1.5;
+    config.maxThreadCount = maxThreadCount; // grows m/z stripes in parallel
 
     PeakelGrower_Proximity peakelGrower(config);
 
@@ -110,7 +111,8 @@ void testToyExample()
 
 void test()
 {
-    testToyExample();
+    testToyExample(1);
+    testToyExample(3);
 }
 
 
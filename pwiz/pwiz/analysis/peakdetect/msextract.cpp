@@ -100,6 +100,7 @@ void Config::write_program_options_config(ostream& os) const
     os << "peakelPicker_Basic.mzTolerance=" << fdpConfig.peakelPicker_Basic.mzTolerance << endl;
     os << "peakelPicker_Basic.rtTolerance=" << fdpConfig.peakelPicker_Basic.rtTolerance << endl;
     os << "peakelPicker_Basic.minPeakelCount=" << fdpConfig.peakelPicker_Basic.minPeakelCount << endl;
+    os << "maxThreadCount=" << fdpConfig.maxThreadCount << endl;
     os << "#maxChargeState=TODO" << endl; // TODO
 }
 
@@ -171,6 +172,7 @@ Config parseCommandLine(int argc, char* argv[])
         ("peakelPicker_Basic.mzTolerance", po::value<MZTolerance>(&config.fdpConfig.peakelPicker_Basic.mzTolerance), "")
         ("peakelPicker_Basic.rtTolerance", po::value<double>(&config.fdpConfig.peakelPicker_Basic.rtTolerance)->default_value(config.fdpConfig.peakelPicker_Basic.rtTolerance), "")
         ("peakelPicker_Basic.minPeakelCount", po::value<size_t>(&config.fdpConfig.peakelPicker_Basic.minPeakelCount)->default_value(config.fdpConfig.peakelPicker_Basic.minPeakelCount), "")
+        ("maxThreadCount", po::value<size_t>(&config.fdpConfig.maxThreadCount)->default_value(config.fdpConfig.maxThreadCount), ": threads for peak extraction and peakel growing; 0 for one per processor (runs single-threaded with writeLog)")
         ;    
     
     // append options to usage string
@@ -657,7 +657,7 @@ UsageInfo usage_precursorRecalculation = {"","This filter recalculates the precu
 SpectrumListPtr filterCreator_mzRefine(const MSData& msd, const string& arg, pwiz::util::IterationListenerRegistry* ilr)
 {
     // Example string:
-    // "mzRefiner input1.pepXML input2.mzid msLevels=1- thresholdScore=specEValue thresholdValue=1e-10 thresholdStep=10 maxSteps=3"
+    // "mzRefiner input1.pepXML input2.mzid msLevels=1- thresholdScore=specEValue thresholdValue=1e-10 thresholdStep=10 maxSteps=3 reuseModel=true"
 
     istringstream parser(arg);
     // expand the filenames by globbing to handle wildcards
@@ -667,6 +667,7 @@ SpectrumListPtr filterCreator_mzRefine(const MSData& msd, const string& arg, pwi
     double thresholdStep = 0.0;
     int maxSteps = 0;
     string msLevelSets = "1-";
+    bool reuseModel = false;
 
     string nextStr;
     while (parser >> nextStr)
@@ -710,6 +711,10 @@ SpectrumListPtr filterCreator_mzRefine(const MSData& msd, const string& arg, pwi
             {
                 maxSteps = boost::lexical_cast<int>(paramVal);
             }
+            else if (keyword == "reuseModel")
+            {
+                reuseModel = paramVal == "true" || paramVal == "1";
+            }
         }
     }
     // expand the filenames by globbing to handle wildcards
@@ -753,13 +758,19 @@ SpectrumListPtr filterCreator_mzRefine(const MSData& msd, const string& arg, pwi
         }
     }
 
-    return SpectrumListPtr(new SpectrumList_MZRefiner(msd, identFilePath, thresholdCV, thresholdSet, msLevelsToRefine, thresholdStep, maxSteps, ilr));
+    // the model is kept next to the ident file, like the mzRefinement.tsv statistics
+    string modelFilePath;
+    if (reuseModel && !identFilePath.empty())
+        modelFilePath = bfs::path(identFilePath).replace_extension("mzRefinement.model").string();
+
+    return SpectrumListPtr(new SpectrumList_MZRefiner(msd, identFilePath, thresholdCV, thresholdSet, msLevelsToRefine, thresholdStep, maxSteps, ilr, modelFilePath));
 }
-UsageInfo usage_mzRefine = { "input1.pepXML input2.mzid [msLevels=<1->] [thresholdScore=<CV_Score_Name>] [thresholdValue=<floatset>] [thresholdStep=<float>] [maxSteps=<count>]", "This filter recalculates the m/z and charges, adjusting precursors for MS2 spectra and spectra masses for MS1 spectra. "
+UsageInfo usage_mzRefine = { "input1.pepXML input2.mzid [msLevels=<1->] [thresholdScore=<CV_Score_Name>] [thresholdValue=<floatset>] [thresholdStep=<float>] [maxSteps=<count>] [reuseModel=<true|false (false)>]", "This filter recalculates the m/z and charges, adjusting precursors for MS2 spectra and spectra masses for MS1 spectra. "
 "It uses an ident file with a threshold field and value to calculate the error and will then choose a shifting mechanism to correct masses throughout the file. "
 "It only works on orbitrap, FT, and TOF data. It is designed to work on mzML files created by msconvert from a single dataset (single run), and with an identification file created using that mzML file. "
 "It does not use any 3rd party (vendor DLL) code. "
-"Recommended Scores and thresholds: MS-GF:SpecEValue,-1e-10 (<1e-10); MyriMatch:MVH,35- (>35); xcorr,3- (>3)" };
+"Recommended Scores and thresholds: MS-GF:SpecEValue,-1e-10 (<1e-10); MyriMatch:MVH,35- (>35); xcorr,3- (>3). "
+"With reuseModel=true, the calculated shifts are saved next to the ident file (as .mzRefinement.model) and reused by later conversions of the same run with the same ident file and settings." };
 
 SpectrumListPtr filterCreator_lockmassRefiner(const MSData& msd, const string& carg, pwiz::util::IterationListenerRegistry* ilr)
 {
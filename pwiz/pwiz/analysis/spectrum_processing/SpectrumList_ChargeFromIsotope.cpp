@@ -28,6 +28,8 @@
 #include "pwiz/utility/misc/IntegerSet.hpp"
 #include "pwiz/utility/chemistry/Ion.hpp"
 #include <boost/range/algorithm/remove_if.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
 
 // Predicate for sorting score data structures 
 bool sortScoresByMZ (scoreChain i, scoreChain j) { return (i.mzPvalue < j.mzPvalue); } 
@@ -51,6 +53,42 @@ namespace pwiz {
 namespace analysis {
 
 
+class SpectrumList_ChargeFromIsotope::ParentScanCache
+{
+    public:
+
+    ParentScanCache(size_t capacity) : capacity_(capacity) {}
+
+    SpectrumPtr get(const SpectrumList& sl, size_t index)
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(mutex_);
+            for (MRU::iterator itr = mru_.begin(); itr != mru_.end(); ++itr)
+                if (itr->first == index)
+                {
+                    mru_.splice(mru_.begin(), mru_, itr);
+                    return itr->second;
+                }
+        }
+
+        // read outside the lock so other threads can use the cache meanwhile
+        SpectrumPtr s = sl.spectrum(index, true);
+
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        mru_.push_front(make_pair(index, s));
+        if (mru_.size() > capacity_)
+            mru_.pop_back();
+        return s;
+    }
+
+    private:
+    typedef list<pair<size_t, SpectrumPtr> > MRU; // most recently used first
+    MRU mru_;
+    size_t capacity_;
+    boost::mutex mutex_;
+};
+
+
 PWIZ_API_DECL SpectrumList_ChargeFromIsotope::SpectrumList_ChargeFromIsotope(
     const msdata::MSData& msd,
     int maxCharge,
@@ -69,6 +107,8 @@ PWIZ_API_DECL SpectrumList_ChargeFromIsotope::SpectrumList_ChargeFromIsotope(
     defaultChargeMax_(defaultChargeMax),
     defaultChargeMin_(defaultChargeMin)
 {
+    // room for the parents of the MS/MS spectra being processed concurrently
+    parentScanCache_.reset(new ParentScanCache(max(16, 4 * (parentsBefore_ + parentsAfter_))));
 
     srand( 1234 ); // using the same seed ensures consistency between runs, otherwise we can get different charges and precursors with the exact same settings
 
@@ -817,6 +857,11 @@ void SpectrumList_ChargeFromIsotope::simulateTotIntensity(const int nIsotopePeak
 
 }
 
+SpectrumPtr SpectrumList_ChargeFromIsotope::getParentScan(int index) const
+{
+    return parentScanCache_->get(*inner_, index);
+}
+
 void SpectrumList_ChargeFromIsotope::getParentIndices( const SpectrumPtr s, vector <int> & parents ) const
 {
     int nMS1scans = MS1retentionTimes.size();
@@ -862,18 +907,16 @@ void SpectrumList_ChargeFromIsotope::getParentPeaks(const SpectrumPtr s,const ve
     {
 
         vector< int > currentParent(1,parents[i]);
-        DetailLevel detailLevel = DetailLevel_FullMetadata;
-        SpectrumPtr sSurvey = inner_->spectrum(parents[i], detailLevel);
-        vector<CVParam>& cvParams = sSurvey->cvParams;
-        vector<CVParam>::iterator itr;
+        SpectrumPtr sSurvey = getParentScan(parents[i]); // shared with other threads; don't modify it
+        const vector<CVParam>& cvParams = sSurvey->cvParams;
+        vector<CVParam>::const_iterator itr;
         itr = std::find(cvParams.begin(), cvParams.end(), MS_centroid_spectrum);
 
         if ( itr != cvParams.end() ) // MS1 spectrum already centroided, just grab the peaks in the isolation window
         {
 
-            SpectrumPtr sPar = inner_->spectrum( parents[i], true );
-            vector<double>& peakMZs = sPar->getMZArray()->data;
-            vector<double>& peakIntensities = sPar->getIntensityArray()->data;
+            vector<double> peakMZs = sSurvey->getMZArray()->data;
+            vector<double> peakIntensities = sSurvey->getIntensityArray()->data;
             vector<int> elementsForDeletion;
 
             for (int j=0, jend = peakIntensities.size(); j < jend; ++j)
@@ -960,20 +1003,19 @@ SpectrumListPtr SpectrumList_ChargeFromIsotope::instantiatePeakPicker( const vec
     shared_ptr<SpectrumListSimple> smallSpectrumList(new SpectrumListSimple);
 
     // parameters for re-sampling via linear interpolation
-    SpectrumPtr s = inner_->spectrum( indices[0], true);
     vector<double> summedIntensity;
     vector<double> summedMZ;
 
-    // Grab the binary data for the parent spectrum
-    SpectrumPtr sParent = inner_->spectrum( indices[0], true);
-    vector<double>& parentMz = sParent->getMZArray()->data;
-    vector<double>& parentIntensity = sParent->getIntensityArray()->data;
+    // Grab the binary data for the parent spectrum (shared with other threads; don't modify it)
+    SpectrumPtr sParent = getParentScan(indices[0]);
+    const vector<double>& parentMz = sParent->getMZArray()->data;
+    const vector<double>& parentIntensity = sParent->getIntensityArray()->data;
 
     // Get window of data around the target m/z value
     vector<double> windowMZ,windowIntensity;
-    std::vector<double>::iterator lowerLimit = lower_bound( parentMz.begin(), parentMz.end(), targetIsoMZ - lowerIsoWidth );
+    std::vector<double>::const_iterator lowerLimit = lower_bound( parentMz.begin(), parentMz.end(), targetIsoMZ - lowerIsoWidth );
     lowerLimit = lowerLimit == parentMz.end() ? parentMz.begin() : lowerLimit; // in case value is out of bounds
-    std::vector<double>::iterator upperLimit = lower_bound( parentMz.begin(), parentMz.end(), targetIsoMZ + upperIsoWidth );
+    std::vector<double>::const_iterator upperLimit = lower_bound( parentMz.begin(), parentMz.end(), targetIsoMZ + upperIsoWidth );
     upperLimit = upperLimit == parentMz.end() ? parentMz.end() - 1 : upperLimit; // in case value is out of bounds
     windowMZ.assign( lowerLimit, upperLimit );
             
@@ -90,6 +90,12 @@ class PWIZ_API_DECL SpectrumList_ChargeFromIsotope : public msdata::SpectrumList
     SpectrumListPtr instantiatePeakPicker( const std::vector <int> &, const double, const double, const double ) const;
 
     private:
+    /// recently used survey scans, shared by concurrent spectrum() calls, so that a survey
+    /// scan is read and decoded once for all of the MS/MS spectra that refer to it
+    class ParentScanCache;
+    boost::shared_ptr<ParentScanCache> parentScanCache_;
+    SpectrumPtr getParentScan(int index) const;
+
     bool override_;
     int maxCharge_;
     int minCharge_;
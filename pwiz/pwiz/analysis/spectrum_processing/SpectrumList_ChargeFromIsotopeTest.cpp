@@ -215,6 +215,81 @@ int test()
 }
 
 
+// the charge states reported for the MS/MS spectrum
+vector<int> getCharges(const Spectrum& s)
+{
+    vector<int> charges;
+    BOOST_FOREACH(const CVParam& cvParam, s.precursors[0].selectedIons[0].cvParams)
+        if (cvParam.cvid == MS_charge_state || cvParam.cvid == MS_possible_charge_state)
+            charges.push_back(cvParam.valueAs<int>());
+    return charges;
+}
+
+void testReadOrder()
+{
+    if (os_) *os_ << "testReadOrder()" << endl;
+
+    // a survey scan from each test case in turn, each followed by an MS/MS spectrum of its precursor;
+    // there are more survey scans than the parent scan cache holds
+    MSData msd;
+    SpectrumListSimple* sl = new SpectrumListSimple;
+    msd.run.spectrumListPtr.reset(sl);
+
+    const size_t surveyCount = 3 * testChargeStateCalculatorsSize;
+    for (size_t i=0; i < surveyCount; ++i)
+    {
+        const TestChargeStateCalculator& t = testChargeStateCalculators[i % testChargeStateCalculatorsSize];
+
+        SpectrumPtr sPar(new Spectrum);
+        sPar->set(MS_MSn_spectrum);
+        sPar->set(MS_ms_level,1);
+        sPar->set(MS_profile_spectrum);
+        sPar->scanList.scans.push_back(Scan());
+        sPar->scanList.scans[0].set(MS_scan_start_time,10.0*i,UO_second);
+        sPar->scanList.scans[0].set(MS_preset_scan_configuration,1);
+        vector<double> inputMZArray = parseDoubleArray(t.inputMZArray);
+        vector<double> inputIntensityArray = parseDoubleArray(t.inputIntensityArray);
+        sPar->setMZIntensityArrays(inputMZArray, inputIntensityArray, MS_number_of_detector_counts);
+        sPar->defaultArrayLength = inputMZArray.size();
+        sl->spectra.push_back(sPar);
+
+        SpectrumPtr s(new Spectrum);
+        s->set(MS_MSn_spectrum);
+        s->set(MS_ms_level, 2);
+        s->set(MS_profile_spectrum);
+        s->scanList.scans.push_back(Scan());
+        s->scanList.scans[0].set(MS_scan_start_time,10.0*i+1,UO_second);
+        s->scanList.scans[0].set(MS_preset_scan_configuration,2);
+        s->precursors.push_back(Precursor(t.inputPrecursorMZ));
+        s->defaultArrayLength = 10;
+        sl->spectra.push_back(s);
+    }
+
+    for (size_t i=0; i < sl->spectra.size(); ++i)
+    {
+        sl->spectra[i]->index = i;
+        sl->spectra[i]->id = "scan=" + lexical_cast<string>(i+1);
+    }
+
+    // each MS/MS spectrum uses the survey scans around it, so the forward pass hits the cache
+    SpectrumListPtr calculator(new SpectrumList_ChargeFromIsotope(msd, 6, 2, 2, 1, 1.25, 0, 0));
+    vector< vector<int> > forwardCharges(surveyCount);
+    for (size_t i=0; i < surveyCount; ++i)
+    {
+        forwardCharges[i] = getCharges(*calculator->spectrum(2*i+1, true));
+        unit_assert(!forwardCharges[i].empty());
+    }
+
+    // reading backwards evicts the survey scans the forward pass left in the cache
+    for (size_t i=surveyCount; i > 0; --i)
+        unit_assert(getCharges(*calculator->spectrum(2*i-1, true)) == forwardCharges[i-1]);
+
+    // jumping around the run evicts survey scans and reads them again later
+    for (size_t i=0, j=0; i < surveyCount; ++i, j = (j + 7) % surveyCount)
+        unit_assert(getCharges(*calculator->spectrum(2*j+1, true)) == forwardCharges[j]);
+}
+
+
 int main(int argc, char* argv[])
 {
     TEST_PROLOG(argc, argv)
@@ -224,6 +299,7 @@ int main(int argc, char* argv[])
         if (argc>1 && !strcmp(argv[1],"-v")) os_ = &cout;
         int failedTests = test();
         unit_assert_operator_equal(0, failedTests);
+        testReadOrder();
     }
     catch (exception& e)
     {
@@ -25,7 +25,11 @@
 
 #include "pwiz/data/common/cv.hpp"
 #include "SpectrumList_Filter.hpp"
+#include "pwiz/data/msdata/SpectrumWorkerThreads.hpp"
+#include "pwiz/data/msdata/SpectrumListMetadata.hpp"
 #include "pwiz/utility/misc/Std.hpp"
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
 
 namespace pwiz {
 namespace analysis {
@@ -43,6 +47,20 @@ using boost::logic::tribool;
 //
 
 
+namespace {
+
+// the most metadata-level spectra retrieved during construction that are kept for reuse
+const size_t MaxRetainedSpectra = 50000;
+
+struct RetainedSpectrum
+{
+    SpectrumPtr spectrum;
+    DetailLevel detailLevel;
+};
+
+} // namespace
+
+
 struct SpectrumList_Filter::Impl
 {
     const SpectrumListPtr original;
@@ -50,16 +68,32 @@ struct SpectrumList_Filter::Impl
     std::vector<size_t> indexMap; // maps index -> original index
     DetailLevel detailLevel; // the detail level needed for a non-indeterminate result
 
+    // accepted spectra retrieved while filtering, handed out once to the next reader (e.g. a chained filter)
+    std::vector<RetainedSpectrum> retainedSpectra;
+    size_t retainedSpectrumCount;
+    boost::mutex retainedSpectraMutex;
+
     Impl(SpectrumListPtr original, const Predicate& predicate);
-    void pushSpectrum(const SpectrumIdentity& spectrumIdentity);
+    void pushSpectrum(const SpectrumIdentity& spectrumIdentity, const SpectrumPtr& spectrum = SpectrumPtr());
+    SpectrumPtr takeRetainedSpectrum(size_t index, DetailLevel detailLevel);
 };
 
 
 SpectrumList_Filter::Impl::Impl(SpectrumListPtr _original, const Predicate& predicate)
-:   original(_original), detailLevel(predicate.suggestedDetailLevel())
+:   original(_original), detailLevel(predicate.suggestedDetailLevel()), retainedSpectrumCount(0)
 {
     if (!original.get()) throw runtime_error("[SpectrumList_Filter] Null pointer");
 
+    // spectra needed to decide acceptance are retrieved ahead on worker threads;
+    // the predicate itself is still called in order on this thread
+    boost::scoped_ptr<SpectrumWorkerThreads> workerThreads;
+
+    // the original list's metadata table, if the predicate can use it and another consumer of the list
+    // already built it; a filter by itself retrieves only the spectra it needs, at the detail level it needs
+    SpectrumListMetadataPtr metadata;
+    if (predicate.usesMetadata())
+        metadata = SpectrumListMetadata::getIfBuilt(original);
+
     // iterate through the spectra, using predicate to build the sub-list
     for (size_t i=0, end=original->size(); i<end; i++)
     {
@@ -69,6 +103,10 @@ SpectrumList_Filter::Impl::Impl(SpectrumListPtr _original, const Predicate& pred
         const SpectrumIdentity& spectrumIdentity = original->spectrumIdentity(i);
         tribool accepted = predicate.accept(spectrumIdentity);
 
+        // then try the metadata table
+        if (boost::logic::indeterminate(accepted) && metadata.get())
+            accepted = predicate.accept(*metadata, i);
+
         if (accepted)
         {
             pushSpectrum(spectrumIdentity);            
@@ -80,9 +118,12 @@ SpectrumList_Filter::Impl::Impl(SpectrumListPtr _original, const Predicate& pred
         else // indeterminate
         {
             // not enough info -- we need to retrieve the Spectrum
+            if (!workerThreads)
+                workerThreads.reset(new SpectrumWorkerThreads(*original));
+
             do
             {
-                SpectrumPtr spectrum = original->spectrum(i, detailLevel);
+                SpectrumPtr spectrum = workerThreads->processBatch(i, detailLevel);
                 accepted = predicate.accept(*spectrum);
 
                 if (boost::logic::indeterminate(accepted) && (int) detailLevel < (int) DetailLevel_FullMetadata)
@@ -90,7 +131,7 @@ SpectrumList_Filter::Impl::Impl(SpectrumListPtr _original, const Predicate& pred
                 else
                 {
                     if (accepted)
-                       pushSpectrum(spectrumIdentity);
+                       pushSpectrum(spectrumIdentity, spectrum);
                     break;
                 }
             }
@@ -100,11 +141,35 @@ SpectrumList_Filter::Impl::Impl(SpectrumListPtr _original, const Predicate& pred
 }
 
 
-void SpectrumList_Filter::Impl::pushSpectrum(const SpectrumIdentity& spectrumIdentity)
+void SpectrumList_Filter::Impl::pushSpectrum(const SpectrumIdentity& spectrumIdentity, const SpectrumPtr& spectrum)
 {
     indexMap.push_back(spectrumIdentity.index);
     spectrumIdentities.push_back(spectrumIdentity);
     spectrumIdentities.back().index = spectrumIdentities.size()-1;
+
+    // spectra with binary data are not kept
+    if (spectrum.get() && detailLevel < DetailLevel_FullData && retainedSpectrumCount < MaxRetainedSpectra)
+    {
+        retainedSpectra.resize(indexMap.size());
+        retainedSpectra.back().spectrum = spectrum;
+        retainedSpectra.back().detailLevel = detailLevel;
+        ++retainedSpectrumCount;
+    }
+}
+
+
+SpectrumPtr SpectrumList_Filter::Impl::takeRetainedSpectrum(size_t index, DetailLevel detailLevel)
+{
+    boost::lock_guard<boost::mutex> lock(retainedSpectraMutex);
+
+    if (index >= retainedSpectra.size() || !retainedSpectra[index].spectrum.get())
+        return SpectrumPtr();
+
+    // a retained spectrum is released on the first request for it, even if it does not have enough detail
+    RetainedSpectrum& retained = retainedSpectra[index];
+    SpectrumPtr spectrum;
+    spectrum.swap(retained.spectrum);
+    return retained.detailLevel >= detailLevel ? spectrum : SpectrumPtr();
 }
 
 
@@ -139,7 +204,9 @@ PWIZ_API_DECL SpectrumPtr SpectrumList_Filter::spectrum(size_t index, bool getBi
 PWIZ_API_DECL SpectrumPtr SpectrumList_Filter::spectrum(size_t index, DetailLevel detailLevel) const
 {
     size_t originalIndex = impl_->indexMap.at(index);
-    SpectrumPtr originalSpectrum = impl_->original->spectrum(originalIndex, detailLevel);  
+    SpectrumPtr originalSpectrum = impl_->takeRetainedSpectrum(index, detailLevel);
+    if (!originalSpectrum.get())
+        originalSpectrum = impl_->original->spectrum(originalIndex, detailLevel);
 
     SpectrumPtr newSpectrum(new Spectrum(*originalSpectrum));
     newSpectrum->index = index;
@@ -148,6 +215,12 @@ PWIZ_API_DECL SpectrumPtr SpectrumList_Filter::spectrum(size_t index, DetailLeve
 }
 
 
+PWIZ_API_DECL const std::vector<size_t>* SpectrumList_Filter::innerIndexMap() const
+{
+    return &impl_->indexMap;
+}
+
+
 //
 // SpectrumList_FilterPredicate_IndexSet 
 //
@@ -248,6 +321,16 @@ PWIZ_API_DECL boost::logic::tribool SpectrumList_FilterPredicate_ScanTimeRange::
 }
 
 
+PWIZ_API_DECL boost::logic::tribool SpectrumList_FilterPredicate_ScanTimeRange::accept(const SpectrumListMetadata& metadata, size_t index) const
+{
+    // the table's unknown scan time is 0
+    double time = metadata.scanStartTime[index];
+    if (time == 0) return boost::logic::indeterminate;
+
+    return (time>=scanTimeLow_ && time<=scanTimeHigh_);
+}
+
+
 //
 // SpectrumList_FilterPredicate_MSLevelSet 
 //
@@ -272,6 +355,19 @@ PWIZ_API_DECL boost::logic::tribool SpectrumList_FilterPredicate_MSLevelSet::acc
 }
 
 
+PWIZ_API_DECL boost::logic::tribool SpectrumList_FilterPredicate_MSLevelSet::accept(const SpectrumListMetadata& metadata, size_t index) const
+{
+    CVID spectrumType = metadata.spectrumType[index];
+    if (spectrumType == CVID_Unknown) return boost::logic::indeterminate;
+    if (!cvIsA(spectrumType, MS_mass_spectrum))
+        return true; // MS level filter doesn't affect non-MS spectra
+    int msLevel = metadata.msLevel[index];
+    if (msLevel == 0) return boost::logic::indeterminate;
+    bool result = msLevelSet_.contains(msLevel);
+    return result;
+}
+
+
 //
 // SpectrumList_FilterPredicate_ChargeStateSet 
 //
@@ -323,6 +419,26 @@ PWIZ_API_DECL boost::logic::tribool SpectrumList_FilterPredicate_ChargeStateSet:
 }
 
 
+PWIZ_API_DECL boost::logic::tribool SpectrumList_FilterPredicate_ChargeStateSet::accept(const SpectrumListMetadata& metadata, size_t index) const
+{
+    CVID spectrumType = metadata.spectrumType[index];
+    if (spectrumType == CVID_Unknown) return boost::logic::indeterminate;
+    if (!cvIsA(spectrumType, MS_mass_spectrum))
+        return true; // charge state filter doesn't affect non-MS spectra
+    int msLevel = metadata.msLevel[index];
+    if (msLevel == 0) return boost::logic::indeterminate;
+    if (msLevel == 1)
+        return false; // MS1s don't have charge state
+
+    int charge = metadata.precursorCharge[index];
+    if (charge > 0 && chargeStateSet_.contains(charge))
+        return true;
+
+    // the table only has the first charge state; the others are in the spectrum
+    return boost::logic::indeterminate;
+}
+
+
 //
 // SpectrumList_FilterPredicate_PrecursorMzSet 
 //
@@ -348,6 +464,20 @@ PWIZ_API_DECL boost::logic::tribool SpectrumList_FilterPredicate_PrecursorMzSet:
     return result;
 }
 
+PWIZ_API_DECL boost::logic::tribool SpectrumList_FilterPredicate_PrecursorMzSet::accept(const SpectrumListMetadata& metadata, size_t index) const
+{
+    double precursorMz = metadata.precursorMZ[index];
+    if (precursorMz == 0)
+    {
+        int msLevel = metadata.msLevel[index];
+        if (msLevel == 0) return boost::logic::indeterminate;
+        // If not level 1, then it should have a precursor, so request more meta data.
+        if (msLevel != 1) return boost::logic::indeterminate;
+    }
+    bool result = precursorMzSet_.count(precursorMz)>0;
+    return result;
+}
+
 PWIZ_API_DECL double SpectrumList_FilterPredicate_PrecursorMzSet::getPrecursorMz(const msdata::Spectrum& spectrum) const
 {
     for (size_t i=0; i<spectrum.precursors.size(); i++)
@@ -501,6 +631,13 @@ PWIZ_API_DECL boost::logic::tribool SpectrumList_FilterPredicate_Polarity::accep
     return param.cvid == polarity;
 }
 
+PWIZ_API_DECL boost::logic::tribool SpectrumList_FilterPredicate_Polarity::accept(const SpectrumListMetadata& metadata, size_t index) const
+{
+    if (metadata.polarity[index] == CVID_Unknown)
+        return boost::logic::indeterminate;
+    return metadata.polarity[index] == polarity;
+}
+
 
 //
 // SpectrumList_FilterPredicate_MzPresent
@@ -60,6 +60,14 @@ class PWIZ_API_DECL SpectrumList_Filter : public msdata::SpectrumListWrapper
         /// return true iff Spectrum is accepted
         virtual boost::logic::tribool accept(const msdata::Spectrum& spectrum) const {return false;}
 
+        /// can be overridden in subclasses that can decide from the original list's SpectrumListMetadata;
+        /// the table is used only if another consumer of the list already built it
+        virtual bool usesMetadata() const {return false;}
+
+        /// return values as for accept(Spectrum), decided from the table's row for the spectrum;
+        /// indeterminate: need to see the full Spectrum object to decide
+        virtual boost::logic::tribool accept(const msdata::SpectrumListMetadata& metadata, size_t index) const {return boost::logic::indeterminate;}
+
         /// return true iff done accepting spectra; 
         /// this allows early termination of the iteration through the original
         /// SpectrumList, possibly using assumptions about the order of the
@@ -80,6 +88,8 @@ class PWIZ_API_DECL SpectrumList_Filter : public msdata::SpectrumListWrapper
     virtual msdata::SpectrumPtr spectrum(size_t index, msdata::DetailLevel detailLevel) const;
     //@}
 
+    virtual const std::vector<size_t>* innerIndexMap() const;
+
     private:
     struct Impl;
     boost::shared_ptr<Impl> impl_;
@@ -132,6 +142,8 @@ class PWIZ_API_DECL SpectrumList_FilterPredicate_ScanTimeRange : public Spectrum
     SpectrumList_FilterPredicate_ScanTimeRange(double scanTimeLow, double scanTimeHigh);
     virtual boost::logic::tribool accept(const msdata::SpectrumIdentity& spectrumIdentity) const;
     virtual boost::logic::tribool accept(const msdata::Spectrum& spectrum) const;
+    virtual bool usesMetadata() const {return true;}
+    virtual boost::logic::tribool accept(const msdata::SpectrumListMetadata& metadata, size_t index) const;
 
     private:
     double scanTimeLow_;
@@ -145,6 +157,8 @@ class PWIZ_API_DECL SpectrumList_FilterPredicate_MSLevelSet : public SpectrumLis
     SpectrumList_FilterPredicate_MSLevelSet(const util::IntegerSet& msLevelSet);
     virtual boost::logic::tribool accept(const msdata::SpectrumIdentity& spectrumIdentity) const {return boost::logic::indeterminate;}
     virtual boost::logic::tribool accept(const msdata::Spectrum& spectrum) const;
+    virtual bool usesMetadata() const {return true;}
+    virtual boost::logic::tribool accept(const msdata::SpectrumListMetadata& metadata, size_t index) const;
 
     private:
     util::IntegerSet msLevelSet_;
@@ -157,6 +171,8 @@ class PWIZ_API_DECL SpectrumList_FilterPredicate_ChargeStateSet : public Spectru
     SpectrumList_FilterPredicate_ChargeStateSet(const util::IntegerSet& chargeStateSet);
     virtual boost::logic::tribool accept(const msdata::SpectrumIdentity& spectrumIdentity) const {return boost::logic::indeterminate;}
     virtual boost::logic::tribool accept(const msdata::Spectrum& spectrum) const;
+    virtual bool usesMetadata() const {return true;}
+    virtual boost::logic::tribool accept(const msdata::SpectrumListMetadata& metadata, size_t index) const;
 
     private:
     util::IntegerSet chargeStateSet_;
@@ -169,6 +185,8 @@ class PWIZ_API_DECL SpectrumList_FilterPredicate_PrecursorMzSet : public Spectru
 	SpectrumList_FilterPredicate_PrecursorMzSet(const std::set<double>& precursorMzSet);
     virtual boost::logic::tribool accept(const msdata::SpectrumIdentity& spectrumIdentity) const {return boost::logic::indeterminate;}
     virtual boost::logic::tribool accept(const msdata::Spectrum& spectrum) const;
+    virtual bool usesMetadata() const {return true;}
+    virtual boost::logic::tribool accept(const msdata::SpectrumListMetadata& metadata, size_t index) const;
 
     private:
 	std::set<double> precursorMzSet_;
@@ -220,6 +238,8 @@ class PWIZ_API_DECL SpectrumList_FilterPredicate_Polarity : public SpectrumList_
     SpectrumList_FilterPredicate_Polarity(pwiz::cv::CVID polarity);
     virtual boost::logic::tribool accept(const msdata::SpectrumIdentity& spectrumIdentity) const {return boost::logic::indeterminate;}
     virtual boost::logic::tribool accept(const msdata::Spectrum& spectrum) const;
+    virtual bool usesMetadata() const {return true;}
+    virtual boost::logic::tribool accept(const msdata::SpectrumListMetadata& metadata, size_t index) const;
 
     private:
     pwiz::cv::CVID polarity;
@@ -26,8 +26,11 @@
 #include "pwiz/utility/misc/IntegerSet.hpp"
 #include "pwiz/utility/misc/Std.hpp"
 #include "pwiz/data/msdata/examples.hpp"
+#include "pwiz/data/msdata/SpectrumListMetadata.hpp"
 #include "pwiz/data/msdata/Serializer_mzML.hpp"
 #include <cstring>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
 
 
 using namespace pwiz;
@@ -626,6 +629,160 @@ void testMZPresentFilter(SpectrumListPtr sl)
     unit_assert(filter1.spectrumIdentity(2).id == "scan=109");
 }
 
+// counts the spectra retrieved from the inner list
+class CountingSpectrumList : public SpectrumListWrapper
+{
+    public:
+    CountingSpectrumList(const SpectrumListPtr& inner) : SpectrumListWrapper(inner), count_(0) {}
+
+    size_t count() const {boost::lock_guard<boost::mutex> lock(mutex_); return count_;}
+
+    virtual SpectrumPtr spectrum(size_t index, bool getBinaryData = false) const
+    {
+        {boost::lock_guard<boost::mutex> lock(mutex_); ++count_;}
+        return inner_->spectrum(index, getBinaryData);
+    }
+
+    virtual SpectrumPtr spectrum(size_t index, DetailLevel detailLevel) const
+    {
+        {boost::lock_guard<boost::mutex> lock(mutex_); ++count_;}
+        return inner_->spectrum(index, detailLevel);
+    }
+
+    private:
+    mutable boost::mutex mutex_;
+    mutable size_t count_;
+};
+
+void testChainedFilters(SpectrumListPtr sl)
+{
+    if (os_) *os_ << "testChainedFilters:\n";
+
+    shared_ptr<CountingSpectrumList> countingList(new CountingSpectrumList(sl));
+
+    // a filter by itself retrieves spectra at the detail level it needs and does not build the metadata table
+    IntegerSet msLevelSet;
+    msLevelSet.insert(2);
+    SpectrumListPtr msLevelFilter(new SpectrumList_Filter(countingList, SpectrumList_FilterPredicate_MSLevelSet(msLevelSet)));
+    unit_assert_operator_equal(6, msLevelFilter->size());
+    unit_assert(!SpectrumListMetadata::getIfBuilt(countingList).get());
+
+    // once another consumer of the list builds the table, filters decide from it
+    size_t retrievedCount = countingList->count();
+    SpectrumListMetadata::get(countingList);
+    unit_assert(countingList->count() - retrievedCount >= sl->size());
+    retrievedCount = countingList->count();
+
+    SpectrumListPtr scanTimeFilter(new SpectrumList_Filter(msLevelFilter, SpectrumList_FilterPredicate_ScanTimeRange(421.5, 427.5)));
+    unit_assert_operator_equal(retrievedCount, countingList->count());
+
+    unit_assert_operator_equal(4, scanTimeFilter->size());
+    unit_assert_operator_equal("scan=102", scanTimeFilter->spectrumIdentity(0).id);
+    unit_assert_operator_equal("scan=107", scanTimeFilter->spectrumIdentity(3).id);
+
+    // the spectra have no polarity, so they are retrieved to decide
+    SpectrumList_Filter polarityFilter(scanTimeFilter, SpectrumList_FilterPredicate_Polarity(MS_positive_scan));
+    unit_assert_operator_equal(0, polarityFilter.size());
+    unit_assert(countingList->count() > retrievedCount);
+
+    // the spectra retrieved by the first filter are reused by the second
+    retrievedCount = countingList->count();
+    IntegerSet scanEventSet;
+    scanEventSet.insert(0, 2);
+    SpectrumListPtr scanEventFilter(new SpectrumList_Filter(countingList, SpectrumList_FilterPredicate_ScanEventSet(scanEventSet)));
+    unit_assert_operator_equal(8, scanEventFilter->size());
+    unit_assert(countingList->count() - retrievedCount >= sl->size());
+    retrievedCount = countingList->count();
+
+    IntegerSet scanEventSet2;
+    scanEventSet2.insert(1, 2);
+    SpectrumList_Filter scanEventFilter2(scanEventFilter, SpectrumList_FilterPredicate_ScanEventSet(scanEventSet2));
+
+    if (os_) 
+    {
+        printSpectrumList(scanEventFilter2, *os_);
+        *os_ << endl;
+    }
+
+    unit_assert(countingList->count() - retrievedCount < scanEventFilter->size());
+
+    unit_assert_operator_equal(5, scanEventFilter2.size());
+    unit_assert_operator_equal("scan=101", scanEventFilter2.spectrumIdentity(0).id);
+    unit_assert_operator_equal("scan=102", scanEventFilter2.spectrumIdentity(1).id);
+    unit_assert_operator_equal("scan=105", scanEventFilter2.spectrumIdentity(2).id);
+    unit_assert_operator_equal("scan=106", scanEventFilter2.spectrumIdentity(3).id);
+    unit_assert_operator_equal("scan=109", scanEventFilter2.spectrumIdentity(4).id);
+
+    // a retained spectrum is handed out once; later requests read from the inner list again
+    for (size_t i=0, end=scanEventFilter2.size(); i < end; ++i)
+    {
+        SpectrumPtr s = scanEventFilter2.spectrum(i, true);
+        unit_assert_operator_equal(scanEventFilter2.spectrumIdentity(i).id, s->id);
+        unit_assert_operator_equal(i, s->index);
+        unit_assert(!s->binaryDataArrayPtrs.empty());
+    }
+}
+
+void testChargeStateAndPrecursorMz(SpectrumListPtr sl)
+{
+    if (os_) *os_ << "testChargeStateAndPrecursorMz:\n";
+
+    shared_ptr<CountingSpectrumList> countingList(new CountingSpectrumList(sl));
+    SpectrumListMetadata::get(countingList);
+    size_t retrievedCount = countingList->count();
+
+    // the MS2 spectra have precursor 500 m/z at charge 3, which the metadata table has
+    SpectrumList_Filter chargeFilter(countingList, SpectrumList_FilterPredicate_ChargeStateSet(IntegerSet(3)));
+    unit_assert_operator_equal(6, chargeFilter.size());
+    unit_assert_operator_equal("scan=101", chargeFilter.spectrumIdentity(0).id);
+
+    set<double> precursorMzSet;
+    precursorMzSet.insert(500);
+    SpectrumList_Filter precursorMzFilter(countingList, SpectrumList_FilterPredicate_PrecursorMzSet(precursorMzSet));
+    unit_assert_operator_equal(6, precursorMzFilter.size());
+    unit_assert_operator_equal("scan=108", precursorMzFilter.spectrumIdentity(5).id);
+    unit_assert_operator_equal(retrievedCount, countingList->count());
+
+    // other charge states might be in the spectrum, so it is retrieved to reject it
+    SpectrumList_Filter chargeFilter2(countingList, SpectrumList_FilterPredicate_ChargeStateSet(IntegerSet(2)));
+    unit_assert_operator_equal(0, chargeFilter2.size());
+    unit_assert(countingList->count() > retrievedCount);
+}
+
+// fails to retrieve one spectrum from the inner list
+class ThrowingSpectrumList : public SpectrumListWrapper
+{
+    public:
+    ThrowingSpectrumList(const SpectrumListPtr& inner, size_t badIndex) : SpectrumListWrapper(inner), badIndex_(badIndex) {}
+
+    virtual SpectrumPtr spectrum(size_t index, bool getBinaryData = false) const
+    {
+        if (index == badIndex_) throw runtime_error("[ThrowingSpectrumList] bad spectrum");
+        return inner_->spectrum(index, getBinaryData);
+    }
+
+    virtual SpectrumPtr spectrum(size_t index, DetailLevel detailLevel) const
+    {
+        if (index == badIndex_) throw runtime_error("[ThrowingSpectrumList] bad spectrum");
+        return inner_->spectrum(index, detailLevel);
+    }
+
+    private:
+    size_t badIndex_;
+};
+
+void testWorkerException(SpectrumListPtr sl)
+{
+    if (os_) *os_ << "testWorkerException:\n";
+
+    // the error from the worker thread reaches the constructor instead of leaving it waiting
+    SpectrumListPtr throwingList(new ThrowingSpectrumList(sl, 5));
+    IntegerSet msLevelSet;
+    msLevelSet.insert(2);
+    unit_assert_throws_what(SpectrumList_Filter(throwingList, SpectrumList_FilterPredicate_MSLevelSet(msLevelSet)),
+                            runtime_error, "[ThrowingSpectrumList] bad spectrum");
+}
+
 void test()
 {
     SpectrumListPtr sl = createSpectrumList();
@@ -641,6 +798,9 @@ void test()
     testMS2Activation(sl);
     testMassAnalyzerFilter(sl);
     testMZPresentFilter(sl);
+    testChainedFilters(sl);
+    testChargeStateAndPrecursorMz(sl);
+    testWorkerException(sl);
 }
 
 
@@ -28,11 +28,14 @@
 #include "pwiz/data/common/CVTranslator.hpp"
 #include "pwiz/data/identdata/IdentDataFile.hpp"
 #include "pwiz/data/msdata/MSData.hpp"
+#include "pwiz/data/msdata/SpectrumListMetadata.hpp"
 #include "pwiz/data/proteome/Peptide.hpp"
 #include "pwiz/utility/misc/optimized_lexical_cast.hpp"
 #include "pwiz/utility/misc/Std.hpp"
 #include "pwiz/utility/misc/Filesystem.hpp"
 #include "pwiz/utility/misc/Singleton.hpp"
+#include <boost/thread.hpp>
+#include <boost/exception_ptr.hpp>
 #include <iomanip>
 #include <numeric>
 
@@ -183,6 +186,11 @@ class AdjustmentObject
     virtual void calculate(vector<ShiftDataPtr>& data) = 0;
     virtual string getShiftRange() const = 0;
     virtual string getShiftOutString() const = 0;
+
+    // Save and restore a calculated shift; read() restores everything shift() and the reported statistics need,
+    //   but not the data the shift was calculated from.
+    virtual void write(ostream& os) const;
+    virtual void read(istream& is);
     
     protected:
     string adjustmentType;
@@ -215,6 +223,8 @@ class AdjustSimpleGlobal : public AdjustmentObject
     virtual void calculate(vector<ShiftDataPtr>& data);
     virtual string getShiftRange() const     { return lexical_cast<string>(shiftError); }
     virtual string getShiftOutString() const { return "Global PPM Shift"; }
+    virtual void write(ostream& os) const;
+    virtual void read(istream& is);
     bool checkForPeak() const;
     
     private:
@@ -240,6 +250,8 @@ class BinnedAdjustmentObject : public AdjustmentObject
     virtual void calculate(vector<ShiftDataPtr>& data) = 0;
     virtual string getShiftRange() const;
     virtual string getShiftOutString() const = 0;
+    virtual void write(ostream& os) const;
+    virtual void read(istream& is);
     double getRoughStDev() const           { return roughStDev; }
     double getRoughPctImp() const          { return percentImprovementRough; }
     double getSmoothedStDev() const        { return smoothedStDev; }
@@ -338,6 +350,105 @@ class AdjustByMassToCharge : public BinnedAdjustmentObject
 };
 typedef boost::shared_ptr<AdjustByMassToCharge> AdjustByMassToChargePtr;
 
+/*********************************************************************************************
+ * Save and restore the results common to all shifts; values are written with full precision,
+ *    so that a restored shift produces exactly the same m/z values as the calculated one
+ ********************************************************************************************/
+void AdjustmentObject::write(ostream& os) const
+{
+    os << setprecision(numeric_limits<double>::digits10 + 2)
+       << adjustmentType << ' ' << globalShift << ' ' << globalStDev << ' ' << globalMAD << ' ' << stdev << ' ' << mad;
+}
+
+void AdjustmentObject::read(istream& is)
+{
+    // The adjustment type has already been read to create the right object
+    is >> globalShift >> globalStDev >> globalMAD >> stdev >> mad;
+    percentImprovement = percentImprovementMAD = 0.0;
+}
+
+void AdjustSimpleGlobal::write(ostream& os) const
+{
+    AdjustmentObject::write(os);
+    os << ' ' << shiftError;
+}
+
+void AdjustSimpleGlobal::read(istream& is)
+{
+    AdjustmentObject::read(is);
+    is >> shiftError;
+    medianError = shiftError;
+    medianStDev = stdev;
+
+    // Same description as calculate() produces
+    ostringstream oss2;
+    oss2 << ": " << shiftError << " ppm";
+    prettyAdjustment += oss2.str();
+}
+
+void BinnedAdjustmentObject::write(ostream& os) const
+{
+    AdjustmentObject::write(os);
+    os << ' ' << bins << ' ' << lowestValidBin << ' ' << highestValidBin;
+    for (size_t i = 0; i < bins; ++i)
+    {
+        os << ' ' << shifts[i] << ' ' << counts[i];
+    }
+}
+
+void BinnedAdjustmentObject::read(istream& is)
+{
+    AdjustmentObject::read(is);
+    is >> bins >> lowestValidBin >> highestValidBin;
+    if (!is || lowestValidBin > highestValidBin || highestValidBin >= bins)
+    {
+        is.setstate(std::ios::failbit);
+        return;
+    }
+    shifts.resize(bins);
+    counts.resize(bins);
+    isValidBin.assign(bins, false);
+    for (size_t i = 0; i < bins; ++i)
+    {
+        is >> shifts[i] >> counts[i];
+        isValidBin[i] = lowestValidBin <= i && i <= highestValidBin;
+    }
+}
+
+/*********************************************************************************************
+ * Create and restore a shift saved by AdjustmentObject::write(); returns null if it can't be read
+ ********************************************************************************************/
+AdjustmentObjectPtr readAdjustment(istream& is)
+{
+    string adjustmentType;
+    is >> adjustmentType;
+
+    AdjustmentObjectPtr adjustment;
+    if (adjustmentType == "SimpleGlobal")
+    {
+        adjustment.reset(new AdjustSimpleGlobal);
+    }
+    else if (adjustmentType == "ByScanTime")
+    {
+        adjustment.reset(new AdjustByScanTime(0.0, 0.0, 0.0));
+    }
+    else if (adjustmentType == "ByMassToCharge")
+    {
+        adjustment.reset(new AdjustByMassToCharge(0.0, 0.0, 0.0));
+    }
+    else
+    {
+        return AdjustmentObjectPtr();
+    }
+
+    adjustment->read(is);
+    if (!is)
+    {
+        return AdjustmentObjectPtr();
+    }
+    return adjustment;
+}
+
 /*********************************************************************************************
  * Determine the mode within a specified accuracy for a global shift
  ********************************************************************************************/
@@ -1462,6 +1573,8 @@ public:
     vector<ShiftDataPtr> ms2Data;
     SpectrumListPtr spectrumList; // store a reference to the spectrum list for checking precursor information.
     void configureShift(const MSData& msd, const string& identFile, pwiz::util::IterationListenerRegistry* ilr);
+    bool loadModel(const MSData& msd, const string& identFile, const string& modelFilePath);
+    void saveModel(const MSData& msd, const string& modelFilePath, pwiz::util::IterationListenerRegistry* ilr) const;
     bool getPrecursorHighResAndStartTime(const Precursor& p, double& scanStartTime) const;
     bool containsHighResData(const MSData& msd);
     bool isAllHighRes() { return allHighRes_; }
@@ -1474,13 +1587,39 @@ private:
     int bad_, badByScore_, badByMassError_;
     bool allHighRes_;
     CVConditionalFilter::CVConditionalFilterConfigData filterConfigData_;
+    // A spectrum with identifications: the range of (scanId sorted) data it supplies scan times for,
+    //   and the fragmentation ion errors found in it
+    struct IdentifiedSpectrum
+    {
+        size_t index;
+        size_t dataBegin;
+        size_t dataEnd;
+        vector<ShiftDataPtr> ms2Data;
+    };
+
+    // Progress of the threads reading the identified spectra
+    struct ReadProgress
+    {
+        ReadProgress() : nextSpectrum(0), readCount(0), finishedThreadCount(0), canceled(false) {}
+        boost::mutex mutex;
+        boost::condition_variable changed;
+        size_t nextSpectrum;
+        size_t readCount;
+        size_t finishedThreadCount;
+        bool canceled;
+        boost::exception_ptr error;
+    };
+
     void processIdentData(const MSData& msd, pwiz::util::IterationListenerRegistry* ilr);
     void getMSDataData(const MSData& msd, pwiz::util::IterationListenerRegistry* ilr);
+    void readIdentifiedSpectrum(const SpectrumList& sl, const SpectrumListMetadata* metadata, IdentifiedSpectrum& spectrum) const;
+    void readIdentifiedSpectra(const SpectrumList& sl, const SpectrumListMetadata* metadata, vector<IdentifiedSpectrum>& spectra, ReadProgress& progress) const;
+    string modelKey(const MSData& msd) const;
     void shiftCalculator(pwiz::util::IterationListenerRegistry* ilr);
     void shiftCalculator(pwiz::util::IterationListenerRegistry* ilr, vector<ShiftDataPtr>& shiftData,
                          AdjustSimpleGlobalPtr& globalShift, AdjustByScanTimePtr& scanTimeShift, AdjustByMassToChargePtr& mzShift,
                          AdjustmentObjectPtr& adjustment, string shiftDataType) const;
-    void fragmentationIonPpmErrors(const string& peptideSeq, const int& peptideSeqLength, const SpectrumPtr& s);
+    void fragmentationIonPpmErrors(const string& peptideSeq, const int& peptideSeqLength, const SpectrumPtr& s, vector<ShiftDataPtr>& ms2Data) const;
     bool cleanIsotopes(ScanDataPtr& sd) const; // Utility function. Doesn't really need to be a member function, but it isn't used anywhere else than in processIdentData
     string filterScoreName_;
     string filterThreshold_;
@@ -1589,6 +1728,139 @@ void SpectrumList_MZRefiner::Impl::configureShift(const MSData& msd, const strin
 }
 
 
+/********************************************************************************
+* Describe everything a model depends on: the identifications, the filter settings, and the run.
+* A saved model is only used if its key matches.
+*******************************************************************************/
+string SpectrumList_MZRefiner::Impl::modelKey(const MSData& msd) const
+{
+    ostringstream key;
+    key << "identFile\t" << identFilePath << '\n'
+        << "identFileSize\t" << bfs::file_size(identFilePath) << '\n'
+        << "identFileTime\t" << bfs::last_write_time(identFilePath) << '\n'
+        << "thresholdScore\t" << filterConfigData_.cvTerm << '\n'
+        << "thresholdValue\t" << filterConfigData_.rangeSet << '\n'
+        << "thresholdStep\t" << filterConfigData_.step << '\n'
+        << "maxSteps\t" << filterConfigData_.maxSteps << '\n'
+        << "msLevels\t" << msLevelsToRefine << '\n'
+        << "run\t" << msd.run.id << '\n'
+        << "spectra\t" << (msd.run.spectrumListPtr.get() ? msd.run.spectrumListPtr->size() : 0) << '\n';
+    return key.str();
+}
+
+/********************************************************************************
+* Restore the shifts saved by saveModel() for the same identifications, settings, and run.
+* Returns false (and leaves the shifts unset) if there is no such model.
+*******************************************************************************/
+bool SpectrumList_MZRefiner::Impl::loadModel(const MSData& msd, const string& identFile, const string& modelFilePath)
+{
+    identFilePath = identFile;
+    if (!bfs::exists(modelFilePath) || !bfs::exists(identFilePath))
+    {
+        return false;
+    }
+
+    ifstream is(modelFilePath.c_str());
+    string line, key;
+    getline(is, line);
+    if (line != "mzRefinerModel\t1")
+    {
+        return false;
+    }
+
+    string expectedKey = modelKey(msd);
+    for (size_t lines = count(expectedKey.begin(), expectedKey.end(), '\n'); lines > 0 && getline(is, line); --lines)
+    {
+        key += line + '\n';
+    }
+    if (key != expectedKey)
+    {
+        return false;
+    }
+
+    string scoreName, threshold;
+    if (!getline(is, line) || !bal::starts_with(line, "filterScoreName\t"))
+    {
+        return false;
+    }
+    scoreName = line.substr(line.find('\t') + 1);
+    if (!getline(is, line) || !bal::starts_with(line, "filterThreshold\t"))
+    {
+        return false;
+    }
+    threshold = line.substr(line.find('\t') + 1);
+
+    string label;
+    AdjustmentObjectPtr ms1Shift, ms2Shift;
+    if (!(is >> label) || label != "MS1" || !(ms1Shift = readAdjustment(is)))
+    {
+        return false;
+    }
+    if (!(is >> label) || label != "MS2")
+    {
+        return false;
+    }
+    string ms2Type;
+    is >> ms2Type;
+    if (ms2Type == "MS1")
+    {
+        ms2Shift = ms1Shift;
+    }
+    else if (ms2Type == "shift" && !(ms2Shift = readAdjustment(is)))
+    {
+        return false;
+    }
+
+    filterScoreName_ = scoreName;
+    filterThreshold_ = threshold;
+    adjust = ms1Shift;
+    ms2Adjust = ms2Shift;
+    spectrumList = SpectrumListPtr(msd.run.spectrumListPtr);
+    return true;
+}
+
+/********************************************************************************
+* Save the calculated shifts so that loadModel() can use them in place of recalculating them
+*******************************************************************************/
+void SpectrumList_MZRefiner::Impl::saveModel(const MSData& msd, const string& modelFilePath, pwiz::util::IterationListenerRegistry* ilr) const
+{
+    ofstream os(modelFilePath.c_str());
+    if (!os)
+    {
+        // Not fatal: the shifts are still used, they will just be recalculated next time
+        if (ilr)
+        {
+            string warning = "Unable to write mzRefiner model file \"" + modelFilePath + "\"; the shifts will not be reused";
+            pwiz::util::IterationListener::UpdateMessage message(0, 0, warning);
+            ilr->broadcastUpdateMessage(message);
+        }
+        return;
+    }
+
+    os << "mzRefinerModel\t1\n"
+       << modelKey(msd)
+       << "filterScoreName\t" << filterScoreName_ << '\n'
+       << "filterThreshold\t" << filterThreshold_ << '\n';
+
+    os << "MS1 ";
+    adjust->write(os);
+    os << "\nMS2 ";
+    if (!ms2Adjust)
+    {
+        os << "none";
+    }
+    else if (ms2Adjust == adjust)
+    {
+        os << "MS1";
+    }
+    else
+    {
+        os << "shift ";
+        ms2Adjust->write(os);
+    }
+    os << '\n';
+}
+
 /*********************************************************************************
 * Try to get precursor high-res and scan start time information.
 * Returns false if the spectrum is unavailable or low resolution, unless there are only high-resolution instrument configurations in the data
@@ -1691,7 +1963,8 @@ void SpectrumList_MZRefiner::Impl::processIdentData(const MSData& msd, pwiz::uti
         totalResults += sil->spectrumIdentificationResult.size();
     }
     // Set the total count to the number of results times the max steps; if the progress bar jumps forward, people don't care, but having it move backwards usually isn't appreciated.
-    pwiz::util::IterationListener::UpdateMessage message(0, totalResults * (filterConfigData_.maxSteps > 0 ? filterConfigData_.maxSteps : 1), "Processing and filtering spectrum identifications...");
+    string messageText("Processing and filtering spectrum identifications...");
+    pwiz::util::IterationListener::UpdateMessage message(0, totalResults * (filterConfigData_.maxSteps > 0 ? filterConfigData_.maxSteps : 1), messageText);
     if (ilr && ilr->broadcastUpdateMessage(message) == pwiz::util::IterationListener::Status_Cancel)
     {
         // Cancel requested, return.
@@ -1922,7 +2195,10 @@ void SpectrumList_MZRefiner::Impl::processIdentData(const MSData& msd, pwiz::uti
 
 /***************************************************************
 * Basic function to read the scan times from an MSData object
-* A good improvement would be to use nativeID indexes to only get the spectra we need.
+* Spectra are matched to the identifications by their ids, so only the identified spectra are read;
+*   those are read, and their fragmentation ion errors found, on several threads.
+* If all of the data is high-res, the scan times come from the list's SpectrumListMetadata instead.
+* A good improvement would be to use nativeID indexes to find the spectra directly instead of stepping through the ids.
 * But that improvement would be limited in use to files input from native, mzML, mzXML, and (maybe) text.
 ****************************************************************/
 void SpectrumList_MZRefiner::Impl::getMSDataData(const MSData& msd, pwiz::util::IterationListenerRegistry* ilr)
@@ -1933,16 +2209,7 @@ void SpectrumList_MZRefiner::Impl::getMSDataData(const MSData& msd, pwiz::util::
         return;
     }
 
-    // TODO: Log at a high detail level
-    //cout << "Reading scan start times and/or data arrays from the data file...." << endl;
-    // Report what is going on using the iteration listener...
-    pwiz::util::IterationListener::UpdateMessage message(0, msd.run.spectrumListPtr->size(), "Reading scan start times and/or data arrays from data file...");
-    if (ilr && ilr->broadcastUpdateMessage(message) == pwiz::util::IterationListener::Status_Cancel)
-    {
-        return;
-    }
-    const SpectrumListPtr& sl = msd.run.spectrumListPtr;
-    sl.get();
+    const SpectrumList& sl = *msd.run.spectrumListPtr;
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////
     //
     // Probably need to get something better than scanId to sort by, but needs to be reliable.
@@ -1950,36 +2217,180 @@ void SpectrumList_MZRefiner::Impl::getMSDataData(const MSData& msd, pwiz::util::
     // (Using nativeID indexes would remove this issue) (but would not be applicable to all possible MSData input types)
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////
     std::sort(data.begin(), data.end(), ScanData::byScanIdPtr2);
+    vector<IdentifiedSpectrum> spectra;
     size_t dataIndex = 0;
-    for (size_t i = 0; i < sl->size() && dataIndex < data.size(); ++i)
+    for (size_t i = 0; i < sl.size() && dataIndex < data.size(); ++i)
     {
-        if (ilr)
+        const string& id = sl.spectrumIdentity(i).id;
+        IdentifiedSpectrum spectrum;
+        spectrum.index = i;
+        spectrum.dataBegin = dataIndex;
+        // TODO: potentially unsafe casting, should fix (how?)
+        while (dataIndex < data.size() && boost::static_pointer_cast<ScanData>(data[dataIndex])->nativeID == id)
+        {
+            ++dataIndex;
+        }
+        spectrum.dataEnd = dataIndex;
+        if (spectrum.dataBegin != spectrum.dataEnd)
+        {
+            spectra.push_back(spectrum);
+        }
+    }
+
+    // TODO: Log at a high detail level
+    //cout << "Reading scan start times and/or data arrays from the data file...." << endl;
+    // Report what is going on using the iteration listener...
+    string messageText("Reading scan start times and/or data arrays from data file...");
+    pwiz::util::IterationListener::UpdateMessage message(0, spectra.size(), messageText);
+    if (ilr && ilr->broadcastUpdateMessage(message) == pwiz::util::IterationListener::Status_Cancel)
+    {
+        return;
+    }
+
+    // Like SpectrumWorkerThreads, don't read Bruker data on several threads
+    size_t threadCount = max(1u, boost::thread::hardware_concurrency());
+    if (!spectra.empty())
+    {
+        SpectrumPtr s = sl.spectrum(spectra.front().index, false);
+        if (!s->scanList.scans.empty() && s->scanList.scans[0].instrumentConfigurationPtr.get() &&
+            s->scanList.scans[0].instrumentConfigurationPtr->hasCVParamChild(MS_Bruker_Daltonics_instrument_model))
         {
-            message.iterationIndex = i; // + 1?
-            pwiz::util::IterationListener::Status status = ilr->broadcastUpdateMessage(message);
-            if (status == pwiz::util::IterationListener::Status_Cancel)
+            threadCount = 1;
+        }
+    }
+    threadCount = min(threadCount, spectra.size());
+
+    // If all of the data is high-res, the scan times and MS levels come from the metadata table shared with the other wrappers of the list;
+    //   then only the spectra needed for fragmentation ion errors are read here
+    SpectrumListMetadataPtr metadata;
+    if (allHighRes_ && !spectra.empty())
+    {
+        metadata = SpectrumListMetadata::get(msd.run.spectrumListPtr);
+    }
+
+    // Each thread takes the next unread spectrum; the results are kept per spectrum so that they are combined in the same order regardless of the thread count
+    ReadProgress progress;
+    boost::thread_group threads;
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        threads.create_thread(boost::bind(&Impl::readIdentifiedSpectra, this, boost::cref(sl), metadata.get(), boost::ref(spectra), boost::ref(progress)));
+    }
+
+    {
+        boost::unique_lock<boost::mutex> lock(progress.mutex);
+        while (progress.finishedThreadCount < threadCount)
+        {
+            if (ilr && !progress.canceled)
             {
-                return;
+                message.iterationIndex = progress.readCount;
+                lock.unlock();
+                bool canceled = ilr->broadcastUpdateMessage(message) == pwiz::util::IterationListener::Status_Cancel;
+                lock.lock();
+                if (canceled)
+                {
+                    progress.canceled = true;
+                }
+            }
+            if (progress.finishedThreadCount < threadCount)
+            {
+                progress.changed.wait(lock);
             }
         }
+    }
+    threads.join_all();
 
-        // Don't read the binary data right now - it can take a long time to read, and we don't know if we need it until we have other information about the spectrum.
-        // It is significantly faster than reading binary data by default.
-        SpectrumPtr s = sl->spectrum(i, false); // Not interested in the binary data right now.
+    if (progress.error)
+    {
+        boost::rethrow_exception(progress.error);
+    }
+    if (progress.canceled)
+    {
+        return;
+    }
 
-        // TODO: potentially unsafe casting, should fix (how?)
-        ScanDataPtr datum = boost::static_pointer_cast<ScanData>(data[dataIndex]);
-        if (!s)
+    BOOST_FOREACH(const IdentifiedSpectrum& spectrum, spectra)
+    {
+        ms2Data.insert(ms2Data.end(), spectrum.ms2Data.begin(), spectrum.ms2Data.end());
+    }
+}
+
+
+/********************************************************************************
+* Thread function for getMSDataData: read identified spectra until all have been read
+********************************************************************************/
+void SpectrumList_MZRefiner::Impl::readIdentifiedSpectra(const SpectrumList& sl, const SpectrumListMetadata* metadata, vector<IdentifiedSpectrum>& spectra, ReadProgress& progress) const
+{
+    try
+    {
+        while (true)
         {
-            continue;
+            size_t next;
+            {
+                boost::lock_guard<boost::mutex> lock(progress.mutex);
+                if (progress.canceled || progress.error || progress.nextSpectrum >= spectra.size())
+                {
+                    break;
+                }
+                next = progress.nextSpectrum++;
+            }
+
+            readIdentifiedSpectrum(sl, metadata, spectra[next]);
+
+            boost::lock_guard<boost::mutex> lock(progress.mutex);
+            ++progress.readCount;
+            progress.changed.notify_one();
         }
-        if (s->id != datum->nativeID)
+    }
+    catch (...)
+    {
+        boost::lock_guard<boost::mutex> lock(progress.mutex);
+        if (!progress.error)
         {
-            continue;
+            progress.error = boost::current_exception();
+        }
+    }
+
+    boost::lock_guard<boost::mutex> lock(progress.mutex);
+    ++progress.finishedThreadCount;
+    progress.changed.notify_one();
+}
+
+
+/********************************************************************************
+* Set the scan time and MS level of the data identifying a spectrum, and find its fragmentation ion errors
+* Only touches the spectrum's own data, so spectra can be read concurrently
+********************************************************************************/
+void SpectrumList_MZRefiner::Impl::readIdentifiedSpectrum(const SpectrumList& sl, const SpectrumListMetadata* metadata, IdentifiedSpectrum& spectrum) const
+{
+    SpectrumPtr s;
+    double scanStartTime = 0;
+    bool isHighRes = false;
+    int msLevel = 0;
+
+    if (metadata)
+    {
+        // All of the data is high-res, so the spectrum is only read if its binary data is needed.
+        // The table has an unknown scan start time as 0, which leaves the MSn scan start time in place like a missing precursor scan start time does.
+        isHighRes = true;
+        scanStartTime = metadata->scanStartTime[spectrum.index];
+        size_t precursorIndex = metadata->precursorIndex[spectrum.index];
+        if (precursorIndex < metadata->size() && metadata->scanStartTime[precursorIndex] != 0)
+        {
+            scanStartTime = metadata->scanStartTime[precursorIndex];
+        }
+        msLevel = metadata->spectrumType[spectrum.index] == MS_MS1_spectrum ? 1 : metadata->msLevel[spectrum.index];
+    }
+    else
+    {
+        // Don't read the binary data right now - it can take a long time to read, and we don't know if we need it until we have other information about the spectrum.
+        // It is significantly faster than reading binary data by default.
+        s = sl.spectrum(spectrum.index, false); // Not interested in the binary data right now.
+        if (!s)
+        {
+            return;
         }
 
-        double scanStartTime = 0;
-        bool isHighRes = getSpectrumHighResAndStartTime(s->scanList.scans, scanStartTime);
+        isHighRes = getSpectrumHighResAndStartTime(s->scanList.scans, scanStartTime);
 
         BOOST_FOREACH(Precursor &p, s->precursors)
         {
@@ -1989,7 +2400,6 @@ void SpectrumList_MZRefiner::Impl::getMSDataData(const MSData& msd, pwiz::util::
             break;
         }
 
-        int msLevel = 0;
         if (s->hasCVParam(MS_MS1_spectrum))
         {
             msLevel = 1;
@@ -1998,27 +2408,22 @@ void SpectrumList_MZRefiner::Impl::getMSDataData(const MSData& msd, pwiz::util::
         {
             msLevel = s->cvParam(MS_ms_level).valueAs<int>();
         }
-        while (s->id == datum->nativeID)
+    }
+    for (size_t i = spectrum.dataBegin; i < spectrum.dataEnd; ++i)
+    {
+        // TODO: potentially unsafe casting, should fix (how?)
+        ScanDataPtr datum = boost::static_pointer_cast<ScanData>(data[i]);
+        datum->scanTime = scanStartTime;
+        datum->msLevel = msLevel;
+        if (isHighRes && msLevel > 1 && msLevelsToRefine.contains(msLevel))
         {
-            datum->scanTime = scanStartTime;
-            datum->msLevel = msLevel;
-            if (isHighRes && msLevel > 1 && msLevelsToRefine.contains(msLevel))
+            // We need the binary data now, so re-read the spectrum with binary data.
+            if (!s || !s->hasBinaryData())
             {
-                // We need the binary data now, so re-read the spectrum with binary data.
-                if (!s->hasBinaryData())
-                {
-                    s = sl->spectrum(i, true); // Need binary data for MSn error calculation.
-                }
-                // Add fragmentation ion data to the ms2Data for a separate shift.
-                fragmentationIonPpmErrors(datum->peptideSeq, datum->peptideSeqLength, s);
-            }
-            ++dataIndex;
-            if (dataIndex >= data.size())
-            {
-                break;
+                s = sl.spectrum(spectrum.index, true); // Need binary data for MSn error calculation.
             }
-            // TODO: potentially unsafe casting, should fix (how?)
-            datum = boost::static_pointer_cast<ScanData>(data[dataIndex]);
+            // Add fragmentation ion data to the spectrum's ms2Data for a separate shift.
+            fragmentationIonPpmErrors(datum->peptideSeq, datum->peptideSeqLength, s, spectrum.ms2Data);
         }
     }
 }
@@ -2027,7 +2432,7 @@ void SpectrumList_MZRefiner::Impl::getMSDataData(const MSData& msd, pwiz::util::
 /********************************************************************************
 * Insert the fragmentation ion and error data into ms2Data for the specified peptide and spectrum
 ********************************************************************************/
-void SpectrumList_MZRefiner::Impl::fragmentationIonPpmErrors(const string& peptideSeq, const int& peptideSeqLength, const SpectrumPtr& s)
+void SpectrumList_MZRefiner::Impl::fragmentationIonPpmErrors(const string& peptideSeq, const int& peptideSeqLength, const SpectrumPtr& s, vector<ShiftDataPtr>& ms2Data) const
 {
     const double mzErrorThreshold = 0.1;
     const double ppmErrorThreshold = 25;
@@ -2348,7 +2753,8 @@ void SpectrumList_MZRefiner::Impl::shiftCalculator(pwiz::util::IterationListener
                                                    AdjustSimpleGlobalPtr& globalShift, AdjustByScanTimePtr& scanTimeShift, AdjustByMassToChargePtr& mzShift,
                                                    AdjustmentObjectPtr& adjustment, string shiftDataType) const
 {
-    pwiz::util::IterationListener::UpdateMessage message(0, 4, "Calculating and comparing possible adjustments");
+    string messageText("Calculating and comparing possible adjustments");
+    pwiz::util::IterationListener::UpdateMessage message(0, 4, messageText);
     if (ilr && ilr->broadcastUpdateMessage(message) == pwiz::util::IterationListener::Status_Cancel)
     {
         // Cancel requested, return.
@@ -2446,7 +2852,8 @@ void SpectrumList_MZRefiner::Impl::shiftCalculator(pwiz::util::IterationListener
 //
 
 PWIZ_API_DECL SpectrumList_MZRefiner::SpectrumList_MZRefiner(
-    const MSData& msd, const string& identFilePath, const string& cvTerm, const string& rangeSet, const util::IntegerSet& msLevelsToRefine, double step, int maxStep, pwiz::util::IterationListenerRegistry* ilr)
+    const MSData& msd, const string& identFilePath, const string& cvTerm, const string& rangeSet, const util::IntegerSet& msLevelsToRefine, double step, int maxStep, pwiz::util::IterationListenerRegistry* ilr,
+    const string& modelFilePath)
     : SpectrumListWrapper(msd.run.spectrumListPtr), impl_(new Impl(msLevelsToRefine, CVConditionalFilter::CVConditionalFilterConfigData(cvTerm, rangeSet, step, maxStep)))
 {
     // Determine if file has High-res scans...
@@ -2457,14 +2864,23 @@ PWIZ_API_DECL SpectrumList_MZRefiner::SpectrumList_MZRefiner(
         throw pwiz::util::user_error("[mzRefiner::ctor] No high-resolution data in input file.");
     }
 
-    // Configure and run shift calculations
-    impl_->configureShift(msd, identFilePath, ilr);
-
-    // Exit if the shift calculations did not succeed for some reason
-    if (impl_->data.size() == 0 || !impl_->adjust)
+    // Use the saved shifts if they were calculated from the same identifications and run
+    if (modelFilePath.empty() || !impl_->loadModel(msd, identFilePath, modelFilePath))
     {
-        // Throw exception: Could not shift - Reason unknown (specific reasons are thrown where they occur)
-        throw runtime_error("[mzRefiner::ctor] Shift calculation failed.");
+        // Configure and run shift calculations
+        impl_->configureShift(msd, identFilePath, ilr);
+
+        // Exit if the shift calculations did not succeed for some reason
+        if (impl_->data.size() == 0 || !impl_->adjust)
+        {
+            // Throw exception: Could not shift - Reason unknown (specific reasons are thrown where they occur)
+            throw runtime_error("[mzRefiner::ctor] Shift calculation failed.");
+        }
+
+        if (!modelFilePath.empty())
+        {
+            impl_->saveModel(msd, modelFilePath, ilr);
+        }
     }
     // add processing methods to the copy of the inner SpectrumList's data processing
     ProcessingMethod method;
@@ -61,7 +61,10 @@ namespace analysis {
 class PWIZ_API_DECL SpectrumList_MZRefiner : public msdata::SpectrumListWrapper
 {
     public:
-    SpectrumList_MZRefiner(const msdata::MSData& msd, const std::string& identFilePath, const std::string& cvTerm, const std::string& rangeSet, const util::IntegerSet& msLevelsToRefine, double step = 0.0, int maxStep = 0, pwiz::util::IterationListenerRegistry* ilr = NULL);
+    /// if modelFilePath is given, the shifts are read from it when it was saved for the same identifications, settings, and run;
+    /// otherwise they are calculated and saved to it (if it is writable)
+    SpectrumList_MZRefiner(const msdata::MSData& msd, const std::string& identFilePath, const std::string& cvTerm, const std::string& rangeSet, const util::IntegerSet& msLevelsToRefine, double step = 0.0, int maxStep = 0, pwiz::util::IterationListenerRegistry* ilr = NULL,
+                           const std::string& modelFilePath = "");
 
     /// \name SpectrumList interface
     //@{
@@ -26,6 +26,9 @@
 #include "pwiz/data/identdata/IdentDataFile.hpp"
 #include "pwiz/utility/misc/unit.hpp"
 #include "boost/filesystem/path.hpp"
+#include "boost/filesystem/operations.hpp"
+#include "pwiz/utility/misc/IterationListener.hpp"
+#include "boost/foreach_field.hpp"
 #include "pwiz/utility/misc/Std.hpp"
 #include <cstring>
 
@@ -126,9 +129,122 @@ void testShift(const bfs::path& datadir)
 }
 
 
+// Replace the lines of a saved model file that start with prefix
+void rewriteModelLine(const bfs::path& modelFile, const string& prefix, const string& replacement)
+{
+    vector<string> lines;
+    {
+        ifstream is(modelFile.string().c_str());
+        string line;
+        while (getline(is, line))
+            lines.push_back(bal::starts_with(line, prefix) ? replacement : line);
+    }
+    ofstream os(modelFile.string().c_str());
+    BOOST_FOREACH(const string& line, lines)
+        os << line << '\n';
+}
+
+string readModelLine(const bfs::path& modelFile, const string& prefix)
+{
+    ifstream is(modelFile.string().c_str());
+    string line;
+    while (getline(is, line))
+        if (bal::starts_with(line, prefix))
+            return line;
+    return "";
+}
+
+size_t modelIndexes[] = { 0, 10, 173, 224, 346, 470, 551 };
+
+// Check that m/z values are the expected ones, scaled by (1 - ppmShift / 1e6)
+void verifyModelMZ(const SpectrumListPtr& expectedList, const SpectrumListPtr& actualList, double ppmShift)
+{
+    for (size_t i=0; i < sizeof(modelIndexes) / sizeof(size_t); ++i)
+    {
+        SpectrumPtr expected = expectedList->spectrum(modelIndexes[i], true);
+        SpectrumPtr actual = actualList->spectrum(modelIndexes[i], true);
+        const vector<double>& expectedMZ = expected->getMZArray()->data;
+        const vector<double>& actualMZ = actual->getMZArray()->data;
+        unit_assert_operator_equal(expectedMZ.size(), actualMZ.size());
+        for (size_t j=0; j < expectedMZ.size(); ++j)
+            unit_assert_equal(expectedMZ[j] * (1 - ppmShift / 1.0e6), actualMZ[j], 1e-8);
+        if (ppmShift == 0.0 && !expected->precursors.empty())
+            verifyPrecursorInfo(*actual, 1e-8,
+                                expected->precursors[0].selectedIons[0].cvParam(MS_selected_ion_m_z).valueAs<double>(),
+                                expected->precursors[0].isolationWindow.cvParam(MS_isolation_window_target_m_z).valueAs<double>());
+    }
+}
+
+struct MessageRecorder : public IterationListener
+{
+    vector<string> messages;
+
+    virtual Status update(const UpdateMessage& updateMessage)
+    {
+        messages.push_back(updateMessage.message);
+        return Status_Ok;
+    }
+};
+
+// Refining with a model file saves the fitted model; refining again with the same file reuses it
+// (including any edits to the saved shifts), unless the file was saved for a different run or settings.
+void testModelReuse(const bfs::path& datadir)
+{
+    bfs::path modelFile = bfs::temp_directory_path() / bfs::unique_path("SpectrumList_MZRefinerTest-%%%%-%%%%.model");
+    string mzMLFile = (datadir / "JD_06232014_sample4_C.mzML").string();
+    string identFile = (datadir / "JD_06232014_sample4_C.mzid").string();
+
+    MSDataFile msdFitted(mzMLFile);
+    SpectrumListPtr fitted(new SpectrumList_MZRefiner(msdFitted, identFile, "specEValue", "-1e-10", IntegerSet(1, 2), 0.0, 0, NULL, modelFile.string()));
+    unit_assert(bfs::exists(modelFile));
+    string fittedMS1 = readModelLine(modelFile, "MS1 ");
+    unit_assert(!fittedMS1.empty());
+
+    if (os_) *os_ << "reused model:\n";
+    MSDataFile msdReused(mzMLFile);
+    SpectrumListPtr reused(new SpectrumList_MZRefiner(msdReused, identFile, "specEValue", "-1e-10", IntegerSet(1, 2), 0.0, 0, NULL, modelFile.string()));
+    unit_assert_operator_equal(fitted->size(), reused->size());
+    verifyModelMZ(fitted, reused, 0.0);
+
+    // The saved shifts are applied as they are, without refitting
+    if (os_) *os_ << "edited model:\n";
+    rewriteModelLine(modelFile, "MS1 ", "MS1 SimpleGlobal 0 0 0 0 0 10");
+    rewriteModelLine(modelFile, "MS2 ", "MS2 MS1");
+    MSDataFile msdOriginal(mzMLFile);
+    MSDataFile msdEdited(mzMLFile);
+    SpectrumListPtr edited(new SpectrumList_MZRefiner(msdEdited, identFile, "specEValue", "-1e-10", IntegerSet(1, 2), 0.0, 0, NULL, modelFile.string()));
+    verifyModelMZ(msdOriginal.run.spectrumListPtr, edited, 10.0);
+    unit_assert_operator_equal("MS1 SimpleGlobal 0 0 0 0 0 10", readModelLine(modelFile, "MS1 "));
+
+    // A model saved for a different run is ignored: the shifts are refitted and saved again
+    if (os_) *os_ << "mismatched model:\n";
+    rewriteModelLine(modelFile, "spectra\t", "spectra\t611");
+    MSDataFile msdRefitted(mzMLFile);
+    SpectrumListPtr refitted(new SpectrumList_MZRefiner(msdRefitted, identFile, "specEValue", "-1e-10", IntegerSet(1, 2), 0.0, 0, NULL, modelFile.string()));
+    verifyModelMZ(fitted, refitted, 0.0);
+    unit_assert_operator_equal("spectra\t610", readModelLine(modelFile, "spectra\t"));
+    unit_assert_operator_equal(fittedMS1, readModelLine(modelFile, "MS1 "));
+
+    bfs::remove(modelFile);
+
+    // A model that can't be written is reported to the iteration listeners, and the fitted shifts are still used
+    bfs::path unwritableModelFile = bfs::temp_directory_path() / bfs::unique_path("SpectrumList_MZRefinerTest-%%%%-%%%%") / "missing.model";
+    IterationListenerRegistry ilr;
+    MessageRecorder* recorder = new MessageRecorder;
+    ilr.addListener(IterationListenerPtr(recorder), 1);
+    MSDataFile msdUnsaved(mzMLFile);
+    SpectrumListPtr unsaved(new SpectrumList_MZRefiner(msdUnsaved, identFile, "specEValue", "-1e-10", IntegerSet(1, 2), 0.0, 0, &ilr, unwritableModelFile.string()));
+    unit_assert(!bfs::exists(unwritableModelFile));
+    unit_assert(!recorder->messages.empty());
+    unit_assert(bal::starts_with(recorder->messages.back(), "Unable to write mzRefiner model file"));
+    verifyModelMZ(fitted, unsaved, 0.0);
+}
+
+
 void test(const bfs::path& datadir)
 {
     testShift(datadir);
+    testModelReuse(datadir);
 }
 
 
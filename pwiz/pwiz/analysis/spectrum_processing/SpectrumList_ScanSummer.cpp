@@ -24,11 +24,11 @@
 #define PWIZ_SOURCE
 
 #include "SpectrumList_ScanSummer.hpp"
+#include "pwiz/data/msdata/SpectrumListMetadata.hpp"
 #include "pwiz/utility/misc/Std.hpp"
 #include "pwiz/data/vendor_readers/Waters/SpectrumList_Waters.hpp"
 
 bool sortFunc (parentIon i, parentIon j) { return (i.mz<j.mz); } // comparator for sorting of parentIon by m/z 
-bool sortRtime (precursorGroup i, precursorGroup j) { return (i.rTimeStart<j.rTimeStart); } // comparator for sorting of precursor List by rtime 
 bool pIonCompare (parentIon i, double mz) { return (i.mz<mz); } // comparator for searching parentIon by m/z
 bool pGroupCompare (precursorGroup i, double mz) { return ( i.precursorMZ < mz ); } // comparator for searching precursorGroups by m/z
 
@@ -150,93 +150,158 @@ double SpectrumList_ScanSummer::getPrecursorMz(const msdata::Spectrum& spectrum)
 //
 
 
-void SpectrumList_ScanSummer::sumSubScansNaive( vector<double> & x, vector<double> & y, size_t refIndex, DetailLevel detailLevel ) const
+namespace {
+
+// the next unmerged peak of one sub-scan
+struct PeakCursor
+{
+    const double* mz;
+    const double* mzEnd;
+    const double* intensity;
+    size_t order; // position of the sub-scan in its group
+};
+
+// orders the merge heap by ascending m/z, then by position in the group, so that the intensities
+// of identical m/z values are added in sub-scan order
+struct PeakCursorGreater
+{
+    bool operator() (const PeakCursor& lhs, const PeakCursor& rhs) const
+    {
+        return *lhs.mz > *rhs.mz || (*lhs.mz == *rhs.mz && lhs.order > rhs.order);
+    }
+};
+
+bool peakMZCompare(const pair<double, double>& lhs, const pair<double, double>& rhs) {return lhs.first < rhs.first;}
+
+// adds a cursor over a sub-scan's peaks; peaks that are not sorted by m/z are merged from a sorted copy
+void addPeakCursor(const vector<double>& mzs, const vector<double>& intensities, size_t order,
+                   vector<PeakCursor>& cursors, list<vector<double> >& sortedCopies)
 {
+    if (mzs.size() != intensities.size())
+        throw runtime_error("[SpectrumList_ScanSummer::sumSubScans()] m/z and intensity arrays must be the same size");
+    if (mzs.empty())
+        return;
+
+    const double* mz = &mzs[0];
+    const double* intensity = &intensities[0];
+
+    bool sorted = true;
+    for (size_t i=1; i < mzs.size() && sorted; ++i)
+        sorted = mzs[i-1] <= mzs[i];
+
+    if (!sorted)
+    {
+        vector<pair<double, double> > peaks(mzs.size());
+        for (size_t i=0; i < mzs.size(); ++i)
+            peaks[i] = make_pair(mzs[i], intensities[i]);
+        stable_sort(peaks.begin(), peaks.end(), peakMZCompare);
+
+        sortedCopies.push_back(vector<double>(peaks.size()));
+        vector<double>& sortedMZs = sortedCopies.back();
+        sortedCopies.push_back(vector<double>(peaks.size()));
+        vector<double>& sortedIntensities = sortedCopies.back();
+        for (size_t i=0; i < peaks.size(); ++i)
+        {
+            sortedMZs[i] = peaks[i].first;
+            sortedIntensities[i] = peaks[i].second;
+        }
+        mz = &sortedMZs[0];
+        intensity = &sortedIntensities[0];
+    }
+
+    PeakCursor cursor = {mz, mz + mzs.size(), intensity, order};
+    cursors.push_back(cursor);
+}
 
-    if (x.size() != y.size())
-        throw runtime_error("[SpectrumList_ScanSummer::sumSubScansNaive()] x and y arrays must be the same size");
+// returns a new array with the metadata of the given array and no data
+BinaryDataArrayPtr emptyArrayLike(const BinaryDataArray& array)
+{
+    BinaryDataArrayPtr result(new BinaryDataArray);
+    static_cast<ParamContainer&>(*result) = array;
+    result->dataProcessingPtr = array.dataProcessingPtr;
+    return result;
+}
 
+} // namespace
 
-    // get the index for the precursorGroupList
-    SpectrumPtr s = inner_->spectrum(refIndex, detailLevel ); // get binary data
-    double precursorMZ = getPrecursorMz(*s); // get the precursor value
 
-    vector<precursorGroup>::const_iterator pGroupIt = lower_bound(precursorList.begin(),precursorList.end(),precursorMZ,pGroupCompare); // returns iterator to first element in precursorList where mz >= precursorMZ
-    while ( pGroupIt->indexList[0] != (int)refIndex )
+void SpectrumList_ScanSummer::sumSubScans(Spectrum& summedSpectrum, const precursorGroup& group, DetailLevel detailLevel) const
+{
+    BinaryDataArrayPtr summedMZArray = summedSpectrum.getMZArray();
+    BinaryDataArrayPtr summedIntensityArray = summedSpectrum.getIntensityArray();
+    if (!summedMZArray.get() || !summedIntensityArray.get())
+        throw runtime_error("[SpectrumList_ScanSummer::sumSubScans()] spectrum has no m/z and intensity arrays");
+
+    if (group.indexList.size() < 2)
+        return;
+
+    // the first sub-scan is summedSpectrum itself; each of the others is read exactly once,
+    // and the sub-scans are merged in one pass instead of inserting their peaks one at a time
+    vector<SpectrumPtr> subScans(group.indexList.size());
+    vector<PeakCursor> cursors;
+    cursors.reserve(group.indexList.size());
+    list<vector<double> > sortedCopies;
+    size_t totalPeaks = 0;
+
+    for (size_t i=0; i < group.indexList.size(); ++i)
     {
-        pGroupIt++; // lower_bound returns the first element in a repeat sequence
-        if ( pGroupIt == precursorList.end() )
-            throw runtime_error("[SpectrumList_ScanSummer::sumSubScans()] Cannot find the correct precursorList element...");
+        const Spectrum* subScan = &summedSpectrum;
+        if (i > 0)
+        {
+            subScans[i] = inner_->spectrum(group.indexList[i], detailLevel);
+            subScan = subScans[i].get();
+        }
+
+        BinaryDataArrayPtr mzArray = subScan->getMZArray();
+        BinaryDataArrayPtr intensityArray = subScan->getIntensityArray();
+        if (!mzArray.get() || !intensityArray.get())
+            continue;
+
+        addPeakCursor(mzArray->data, intensityArray->data, i, cursors, sortedCopies);
+        totalPeaks += mzArray->data.size();
     }
 
-    vector<double>& summedMZ = s->getMZArray()->data;
-    vector<double>& summedIntensity = s->getIntensityArray()->data;
+    BinaryDataArrayPtr mergedMZArray = emptyArrayLike(*summedMZArray);
+    BinaryDataArrayPtr mergedIntensityArray = emptyArrayLike(*summedIntensityArray);
+    vector<double>& mergedMZs = mergedMZArray->data;
+    vector<double>& mergedIntensities = mergedIntensityArray->data;
+    mergedMZs.reserve(totalPeaks);
+    mergedIntensities.reserve(totalPeaks);
 
-    vector<int>::const_iterator InitialIt = pGroupIt->indexList.begin();
-    InitialIt++;
-    if (InitialIt != pGroupIt->indexList.end())
+    PeakCursorGreater greaterCursor;
+    make_heap(cursors.begin(), cursors.end(), greaterCursor);
+    while (!cursors.empty())
     {
+        pop_heap(cursors.begin(), cursors.end(), greaterCursor);
+        PeakCursor& cursor = cursors.back();
 
-        for( vector<int>::const_iterator listIt = InitialIt; listIt != pGroupIt->indexList.end(); ++listIt)
+        if (!mergedMZs.empty() && mergedMZs.back() == *cursor.mz)
+            mergedIntensities.back() += *cursor.intensity;
+        else
         {
-
-            SpectrumPtr s2 = inner_->spectrum( *listIt, detailLevel );
-            vector<double>& subMz = s2->getMZArray()->data;
-            vector<double>& subIntensity = s2->getIntensityArray()->data;
-
-            for( size_t j=0, jend=subMz.size(); j < jend ; ++j)
-            {
-
-                // check if this m/z point was recorded from a previous sub-scan
-                vector<double>::iterator pIonIt;
-                pIonIt = lower_bound(summedMZ.begin(),summedMZ.end(),subMz[j]); // first element that is greater than or equal to subMz[j]
-                int indexMZ = pIonIt - summedMZ.begin();
-                if (pIonIt == summedMZ.end()) // first check if mzs[j] is outside search range
-                {
-                    if ( subMz[j] > summedMZ[indexMZ-1] ) // insert at back
-                    {
-                        summedMZ.push_back(subMz[j]);
-                        summedIntensity.push_back(subIntensity[j]);
-                    }
-                    else // insert at front
-                    {
-                        summedMZ.insert(summedMZ.begin(),subMz[j]);
-                        summedIntensity.insert(summedIntensity.begin(),subIntensity[j]);
-                    }
-                }
-                else if (*pIonIt != subMz[j]) // if the closest value is not equal to mzs[i], start a new m/z point
-                {
-                    summedMZ.insert(pIonIt,subMz[j]);
-                    summedIntensity.insert(summedIntensity.begin()+indexMZ,subIntensity[j]);
-                }
-                else // m/z value recorded from previous sub-scan for this precursor; calculate the sum
-                {
-                    summedIntensity[indexMZ] += subIntensity[j];
-                }
-            
-
-            }
-
+            mergedMZs.push_back(*cursor.mz);
+            mergedIntensities.push_back(*cursor.intensity);
         }
 
+        ++cursor.mz;
+        ++cursor.intensity;
+        if (cursor.mz == cursor.mzEnd)
+            cursors.pop_back();
+        else
+            push_heap(cursors.begin(), cursors.end(), greaterCursor);
     }
 
-    x.resize(summedIntensity.size());
-    y.resize(summedIntensity.size());
-    for (size_t i=0, iend=summedIntensity.size(); i < iend ; ++i)
-    {
-            x[i] = summedMZ[i];
-            y[i] = summedIntensity[i];
-    }
-
-    
-
+    // the inner list may hand out the same arrays again, so they are replaced instead of modified
+    vector<BinaryDataArrayPtr>& arrays = summedSpectrum.binaryDataArrayPtrs;
+    for (size_t i=0; i < arrays.size(); ++i)
+        if (arrays[i] == summedMZArray)
+            arrays[i] = mergedMZArray;
+        else if (arrays[i] == summedIntensityArray)
+            arrays[i] = mergedIntensityArray;
+    summedSpectrum.defaultArrayLength = mergedMZs.size();
 }
 
 
-
-
-
 PWIZ_API_DECL SpectrumList_ScanSummer::SpectrumList_ScanSummer(const SpectrumListPtr& original, double precursorTol, double rTimeTol)
 :   SpectrumListWrapper(original), precursorTol_(precursorTol), rTimeTol_(rTimeTol)
 {
@@ -244,30 +309,23 @@ PWIZ_API_DECL SpectrumList_ScanSummer::SpectrumList_ScanSummer(const SpectrumLis
 
     // Some parameters
     double precursorMZ = 0.0; 
-    
-    ms2cnt=0;
+
+    // precursors and scan times are taken from the run's metadata table, which other wrappers may share,
+    // so grouping does not read any spectra
+    SpectrumListMetadataPtr metadata = SpectrumListMetadata::get(inner_);
 
     for (size_t i=0, end=inner_->size(); i < end; ++i )
     {
        
         const SpectrumIdentity& spectrumIdentity = inner_->spectrumIdentity(i);
-        SpectrumPtr s = inner_->spectrum(i, true); 
-        precursorMZ = getPrecursorMz(*s); 
+        precursorMZ = metadata->precursorMZ[i];
 
         if (precursorMZ == 0.0) // ms1 scans do not need summing
         {
             pushSpectrum(spectrumIdentity);
             continue;
         }
-        double rTime = s->scanList.scans[0].cvParam(MS_scan_start_time).timeInSeconds();
-        ms2cnt++;
-
-        if (ms2cnt==1) // set some parameters
-        {
-            lowerMZlimit = s->scanList.scans[0].scanWindows[0].cvParam(MS_scan_window_lower_limit).valueAs<double>();
-            upperMZlimit = s->scanList.scans[0].scanWindows[0].cvParam(MS_scan_window_upper_limit).valueAs<double>();
-            TotalDaltons = upperMZlimit - lowerMZlimit;
-        }
+        double rTime = metadata->scanStartTime[i];
 
         vector<precursorGroup>::iterator pGroupIt,prevIt;
         pGroupIt = lower_bound(precursorList.begin(),precursorList.end(),precursorMZ,pGroupCompare); // returns iterator to first element in precursorList where mz >= precursorMZ
@@ -352,10 +410,13 @@ PWIZ_API_DECL SpectrumList_ScanSummer::SpectrumList_ScanSummer(const SpectrumLis
 
     } // end for loop over all spectra
 
-    ms2RetentionTimes = precursorList;
-    sort(ms2RetentionTimes.begin(),ms2RetentionTimes.end(),sortRtime);
-    ms2cnt = 0; // reset
-
+    // each group is output at the index of its first sub-scan
+    groupIndex.resize(indexMap.size(), precursorList.size());
+    for (size_t i=0; i < precursorList.size(); ++i)
+    {
+        size_t firstIndex = precursorList[i].indexList[0];
+        groupIndex[lower_bound(indexMap.begin(), indexMap.end(), firstIndex) - indexMap.begin()] = i;
+    }
 }
 
 PWIZ_API_DECL size_t SpectrumList_ScanSummer::size() const
@@ -378,36 +439,25 @@ PWIZ_API_DECL SpectrumPtr SpectrumList_ScanSummer::spectrum(size_t index, bool g
 
 PWIZ_API_DECL SpectrumPtr SpectrumList_ScanSummer::spectrum(size_t index, DetailLevel detailLevel) const
 {
+    SpectrumPtr summedSpectrum = inner_->spectrum(indexMap.at(index), detailLevel);
 
-    size_t summedScanIndex = indexMap.at(index);
-    SpectrumPtr summedSpectrum = inner_->spectrum(summedScanIndex, detailLevel);
-    
-    if (summedSpectrum->cvParam(MS_ms_level).valueAs<int>() > 1) // MS/MS scan
+    if (groupIndex[index] < precursorList.size() && detailLevel >= DetailLevel_FullData) // MS/MS scan
     {
+        // the inner list may hand out the same spectrum again, so a shallow copy is summed
+        summedSpectrum.reset(new Spectrum(*summedSpectrum));
 
         try
         {
-            // output ms2 spectra by retention time, grab the appropriate spectrum
-            int newIndex = ms2RetentionTimes[ms2cnt].indexList[0];
-            summedSpectrum = inner_->spectrum(newIndex, detailLevel);
-            ms2cnt++;
-
-            vector<double>& mzs = summedSpectrum->getMZArray()->data;
-            vector<double>& intensities = summedSpectrum->getIntensityArray()->data;
-            sumSubScansNaive( mzs, intensities, newIndex, detailLevel );
-            summedSpectrum->defaultArrayLength = mzs.size();
-
+            sumSubScans(*summedSpectrum, precursorList[groupIndex[index]], detailLevel);
         }
         catch( exception& e )
         {
             throw runtime_error(std::string("[SpectrumList_ScanSummer::spectrum()] Error summing precursor sub-scans: ") + e.what());
         }
-    
     }
 
     summedSpectrum->index = index; // redefine the index
     return summedSpectrum;
-
 }
 
 
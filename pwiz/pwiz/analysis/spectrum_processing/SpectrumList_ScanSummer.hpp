@@ -54,25 +54,28 @@ class PWIZ_API_DECL SpectrumList_ScanSummer : public msdata::SpectrumListWrapper
     void pushSpectrum(const msdata::SpectrumIdentity&);
     double getPrecursorMz(const msdata::Spectrum&) const;
     //void sumSubScansResample( std::vector<double> &, std::vector<double> &, size_t, msdata::DetailLevel) const;
-    void sumSubScansNaive( std::vector<double> &, std::vector<double> &, size_t, msdata::DetailLevel) const;
+
+    /// merges the peaks of the group's other sub-scans into summedSpectrum (the group's first sub-scan);
+    /// peaks with identical m/z are summed, and the arrays are replaced rather than modified in place
+    void sumSubScans(msdata::Spectrum& summedSpectrum, const precursorGroup& group, msdata::DetailLevel) const;
+
     virtual size_t size() const;
     virtual const msdata::SpectrumIdentity& spectrumIdentity(size_t index) const;
+
+    /// returns the sum of the sub-scans grouped with spectrum index; the peaks are only summed
+    /// at DetailLevel_FullData, otherwise the metadata of the group's first sub-scan is returned
     virtual msdata::SpectrumPtr spectrum(size_t index, bool getBinaryData = false) const;
     virtual msdata::SpectrumPtr spectrum(size_t index, msdata::DetailLevel) const;
 
     private:
 
-    double lowerMZlimit;
-    double upperMZlimit;
-    double TotalDaltons;
     double precursorTol_;
     double rTimeTol_;
 
-    mutable int ms2cnt;
     std::vector<msdata::SpectrumIdentity> spectrumIdentities; // local cache, with fixed up index fields
     std::vector<size_t> indexMap; // maps index -> original index
+    std::vector<size_t> groupIndex; // maps index -> precursorList index, or precursorList.size() if not summed
     std::vector< precursorGroup > precursorList;
-    std::vector< precursorGroup > ms2RetentionTimes;
     SpectrumList_ScanSummer(SpectrumList_ScanSummer&); //copy constructor
     SpectrumList_ScanSummer& operator=(SpectrumList_ScanSummer&); //assignment operator
 };
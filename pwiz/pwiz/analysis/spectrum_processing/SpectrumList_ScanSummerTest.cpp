@@ -154,9 +154,14 @@ int test()
 
         SpectrumListPtr calculator(new SpectrumList_ScanSummer(originalList,0.05,10));
 
-        for (size_t i=0; i < calculator->size(); ++i) 
+        unit_assert_operator_equal(goldStandardSize, calculator->size());
+
+        // the summed spectra do not depend on the order in which they are requested
+        for (size_t n=0; n < 2 * calculator->size(); ++n) 
         {
+            size_t i = n < calculator->size() ? n : 2 * calculator->size() - n - 1;
             SpectrumPtr s = calculator->spectrum(i,true);
+            unit_assert_operator_equal(i, s->index);
             vector<double>& mzs = s->getMZArray()->data;
             vector<double>& intensities = s->getIntensityArray()->data;
             Precursor& precursor = s->precursors[0];
@@ -24,6 +24,7 @@
 #define PWIZ_SOURCE
 
 #include "SpectrumList_Sorter.hpp"
+#include "pwiz/data/msdata/SpectrumWorkerThreads.hpp"
 #include "pwiz/utility/misc/Std.hpp"
 
 
@@ -48,65 +49,106 @@ struct SpectrumList_Sorter::Impl
 
     Impl(const SpectrumListPtr& original,
          const Predicate& predicate,
-         bool stable);
-    void pushSpectrum(const SpectrumIdentity& spectrumIdentity);
+         bool stable,
+         size_t maxCachedSpectra);
+    Impl(const SpectrumListPtr& original,
+         const std::vector<size_t>& indexMap);
+    void createSpectrumIdentities();
 };
 
 
 namespace {
 
-// sorts index vector by calling the indexed spectra with the predicate
-struct SortPredicate
+// determines the minimum detail level needed using the first two spectra
+bool needDetails(const SpectrumListPtr& inner, const SpectrumList_Sorter::Predicate& predicate, DetailLevel& detailLevel)
 {
-    SortPredicate(const SpectrumListPtr& inner, const SpectrumList_Sorter::Predicate& predicate)
-    :   inner(inner), predicate(predicate), detailLevel(DetailLevel_InstantMetadata)
-    {
-        if (inner->size() < 2)
-            return;
-
-        using namespace boost::logic;
-
-        // determine the minimum detail level needed using the first two spectra
-
-        if (indeterminate(predicate.less(inner->spectrumIdentity(0), inner->spectrumIdentity(1))))
-        {
-            needDetails = true;
-
-            // not enough info -- we need to retrieve the Spectrum
-            do
-            {
-                SpectrumPtr spectrum0 = inner->spectrum(0, detailLevel);
-                SpectrumPtr spectrum1 = inner->spectrum(1, detailLevel);
-                tribool lessThan = predicate.less(*spectrum0, *spectrum1);
-
-                if (indeterminate(lessThan))
-                {
-                    if (detailLevel != DetailLevel_FullData)
-                        detailLevel = DetailLevel(int(detailLevel) + 1);
-                    else
-                        throw runtime_error("[SortPredicate::ctor] indeterminate result at full detail level");
-                }
-                else
-                    break;
-            }
-            while ((int) detailLevel <= (int) DetailLevel_FullData);
-        }
-        else
-            needDetails = false;
+    detailLevel = DetailLevel_InstantMetadata;
+
+    using namespace boost::logic;
+
+    if (inner->size() < 2 || !indeterminate(predicate.less(inner->spectrumIdentity(0), inner->spectrumIdentity(1))))
+        return false;
+
+    // not enough info -- we need to retrieve the Spectrum
+    while (true)
+    {
+        SpectrumPtr spectrum0 = inner->spectrum(0, detailLevel);
+        SpectrumPtr spectrum1 = inner->spectrum(1, detailLevel);
+        tribool lessThan = predicate.less(*spectrum0, *spectrum1);
+
+        if (!indeterminate(lessThan))
+            return true;
+
+        if (detailLevel == DetailLevel_FullData)
+            throw runtime_error("[SpectrumList_Sorter] indeterminate result at full detail level");
+        detailLevel = DetailLevel(int(detailLevel) + 1);
+    }
+}
+
+// retrieves each spectrum once at the needed detail level; metadata and full data
+// are retrieved ahead on worker threads, which are not worth starting for lower levels
+class SpectrumReader
+{
+    public:
+
+    SpectrumReader(const SpectrumListPtr& inner, DetailLevel detailLevel)
+    :   inner_(inner), detailLevel_(detailLevel)
+    {
+        if (detailLevel_ >= DetailLevel_FullMetadata)
+            workerThreads_.reset(new SpectrumWorkerThreads(*inner_));
     }
 
-    bool operator() (size_t lhs, size_t rhs)
+    SpectrumPtr spectrum(size_t index)
+    {
+        if (workerThreads_)
+            return workerThreads_->processBatch(index, detailLevel_ == DetailLevel_FullData);
+        return inner_->spectrum(index, detailLevel_);
+    }
+
+    private:
+    SpectrumListPtr inner_;
+    DetailLevel detailLevel_;
+    boost::scoped_ptr<SpectrumWorkerThreads> workerThreads_;
+};
+
+// sorts index vector on keys extracted once per spectrum
+struct SortKeyLessThan
+{
+    SortKeyLessThan(const vector<double>& keys) : keys(keys) {}
+
+    bool operator() (size_t lhs, size_t rhs) const {return keys[lhs] < keys[rhs];}
+
+    const vector<double>& keys;
+};
+
+// sorts index vector by calling the predicate with the indexed spectrum identities or
+// spectra; the spectra cached by the caller are used instead of retrieving them again
+// (the cache is held by reference because the sort algorithms copy the comparator)
+struct SortPredicate
+{
+    SortPredicate(const SpectrumListPtr& inner, const SpectrumList_Sorter::Predicate& predicate,
+                  bool needDetails, DetailLevel detailLevel, const vector<SpectrumPtr>& spectra)
+    :   inner(inner), predicate(predicate), needDetails(needDetails), detailLevel(detailLevel), spectra(spectra)
+    {}
+
+    bool operator() (size_t lhs, size_t rhs) const
     {
         if (needDetails)
-            return (bool) predicate.less(*inner->spectrum(lhs, detailLevel), *inner->spectrum(rhs, detailLevel));
+            return (bool) predicate.less(*spectrum(lhs), *spectrum(rhs));
         else
             return (bool) predicate.less(inner->spectrumIdentity(lhs), inner->spectrumIdentity(rhs));
     }
 
+    SpectrumPtr spectrum(size_t index) const
+    {
+        return index < spectra.size() ? spectra[index] : inner->spectrum(index, detailLevel);
+    }
+
     const SpectrumListPtr inner;
     const SpectrumList_Sorter::Predicate& predicate;
     bool needDetails; // false iff spectrumIdentity is sufficient for sorting
     DetailLevel detailLevel; // the detail level needed for a non-indeterminate result
+    const vector<SpectrumPtr>& spectra;
 };
 
 } // namespace
@@ -114,7 +156,8 @@ struct SortPredicate
 
 SpectrumList_Sorter::Impl::Impl(const SpectrumListPtr& _original,
                                 const Predicate& predicate,
-                                bool stable)
+                                bool stable,
+                                size_t maxCachedSpectra)
 :   original(_original)
 {
     if (!original.get()) throw runtime_error("[SpectrumList_Sorter] Null pointer");
@@ -123,11 +166,72 @@ SpectrumList_Sorter::Impl::Impl(const SpectrumListPtr& _original,
     for (size_t i=0, end=original->size(); i < end; ++i )
         indexMap[i] = i;
 
-    if (stable)
-        stable_sort(indexMap.begin(), indexMap.end(), SortPredicate(original, predicate));
+    DetailLevel detailLevel;
+    bool details = needDetails(original, predicate, detailLevel);
+
+    // if the predicate provides sort keys, extract them in a single pass and sort on them
+    if (details && predicate.sortKey(*original->spectrum(0, detailLevel)).is_initialized())
+    {
+        vector<double> keys(indexMap.size());
+        SpectrumReader reader(original, detailLevel);
+        double lastKey = 0;
+        for (size_t i=0; i < keys.size(); ++i)
+        {
+            boost::optional<double> key = predicate.sortKey(*reader.spectrum(i));
+            keys[i] = lastKey = key.get_value_or(lastKey);
+        }
+
+        if (stable)
+            stable_sort(indexMap.begin(), indexMap.end(), SortKeyLessThan(keys));
+        else
+            sort(indexMap.begin(), indexMap.end(), SortKeyLessThan(keys));
+    }
     else
-        sort(indexMap.begin(), indexMap.end(), SortPredicate(original, predicate));
+    {
+        // up to maxCachedSpectra spectra are cached unless they include binary data
+        vector<SpectrumPtr> spectra;
+        if (details && detailLevel != DetailLevel_FullData)
+        {
+            SpectrumReader reader(original, detailLevel);
+            spectra.resize(min(original->size(), maxCachedSpectra));
+            for (size_t i=0; i < spectra.size(); ++i)
+                spectra[i] = reader.spectrum(i);
+        }
+
+        SortPredicate sortPredicate(original, predicate, details, detailLevel, spectra);
+        if (stable)
+            stable_sort(indexMap.begin(), indexMap.end(), sortPredicate);
+        else
+            sort(indexMap.begin(), indexMap.end(), sortPredicate);
+    }
+
+    createSpectrumIdentities();
+}
+
+
+SpectrumList_Sorter::Impl::Impl(const SpectrumListPtr& _original,
+                                const std::vector<size_t>& _indexMap)
+:   original(_original), indexMap(_indexMap)
+{
+    if (!original.get()) throw runtime_error("[SpectrumList_Sorter] Null pointer");
+
+    if (indexMap.size() != original->size())
+        throw runtime_error("[SpectrumList_Sorter] index map size does not match the spectrum list size");
+
+    vector<bool> mapped(indexMap.size(), false);
+    for (size_t i=0, end=indexMap.size(); i < end; ++i)
+    {
+        if (indexMap[i] >= end || mapped[indexMap[i]])
+            throw runtime_error("[SpectrumList_Sorter] index map is not a permutation of the spectrum list");
+        mapped[indexMap[i]] = true;
+    }
+
+    createSpectrumIdentities();
+}
+
 
+void SpectrumList_Sorter::Impl::createSpectrumIdentities()
+{
     spectrumIdentities.reserve(indexMap.size());
     for (size_t i=0, end=indexMap.size(); i < end; ++i )
     {
@@ -144,11 +248,24 @@ SpectrumList_Sorter::Impl::Impl(const SpectrumListPtr& _original,
 
 PWIZ_API_DECL SpectrumList_Sorter::SpectrumList_Sorter(const SpectrumListPtr& original,
                                                        const Predicate& predicate,
-                                                       bool stable)
-:   SpectrumListWrapper(original), impl_(new Impl(original, predicate, stable))
+                                                       bool stable,
+                                                       size_t maxCachedSpectra)
+:   SpectrumListWrapper(original), impl_(new Impl(original, predicate, stable, maxCachedSpectra))
+{}
+
+
+PWIZ_API_DECL SpectrumList_Sorter::SpectrumList_Sorter(const SpectrumListPtr& original,
+                                                       const std::vector<size_t>& indexMap)
+:   SpectrumListWrapper(original), impl_(new Impl(original, indexMap))
 {}
 
 
+PWIZ_API_DECL const std::vector<size_t>& SpectrumList_Sorter::indexMap() const
+{
+    return impl_->indexMap;
+}
+
+
 PWIZ_API_DECL size_t SpectrumList_Sorter::size() const
 {
     return impl_->indexMap.size();
@@ -173,6 +290,12 @@ PWIZ_API_DECL SpectrumPtr SpectrumList_Sorter::spectrum(size_t index, bool getBi
 }
 
 
+PWIZ_API_DECL const std::vector<size_t>* SpectrumList_Sorter::innerIndexMap() const
+{
+    return &impl_->indexMap;
+}
+
+
 //
 // SpectrumList_SorterPredicate_ScanStartTime
 //
@@ -192,5 +315,17 @@ tribool SpectrumList_SorterPredicate_ScanStartTime::less(const msdata::Spectrum&
 }
 
 
+PWIZ_API_DECL
+boost::optional<double> SpectrumList_SorterPredicate_ScanStartTime::sortKey(const msdata::Spectrum& spectrum) const
+{
+    if (spectrum.scanList.empty())
+        return boost::none;
+    CVParam time = spectrum.scanList.scans[0].cvParam(MS_scan_start_time);
+    if (time.empty())
+        return boost::none;
+    return time.timeInSeconds();
+}
+
+
 } // namespace analysis
 } // namespace pwiz
@@ -29,6 +29,7 @@
 #include "pwiz/utility/misc/Export.hpp"
 #include "pwiz/data/msdata/SpectrumListWrapper.hpp"
 #include "boost/logic/tribool.hpp"
+#include "boost/optional.hpp"
 
 
 namespace pwiz {
@@ -60,12 +61,34 @@ class PWIZ_API_DECL SpectrumList_Sorter : public msdata::SpectrumListWrapper
                                            const msdata::Spectrum& rhs) const
         {return lhs.index < rhs.index;}
 
+        /// optional: a key such that sorting keys ascending is equivalent to sorting with less();
+        /// when provided, the key is extracted once per spectrum and the sort is done on the keys
+        /// instead of retrieving both spectra for every comparison;
+        /// a spectrum without a key (boost::none) sorts with the spectrum preceding it
+        virtual boost::optional<double> sortKey(const msdata::Spectrum& spectrum) const
+        {return boost::none;}
+
         virtual ~Predicate() {}
     };
 
+    /// sorts the inner list with the predicate; when the predicate needs spectra but provides
+    /// no sortKey(), the spectra of the first maxCachedSpectra indexes are retrieved once and
+    /// kept until sorting is done, unless they need binary data; any other spectrum is retrieved
+    /// from the inner list again for every comparison it takes part in, so raise the limit
+    /// (at the cost of keeping that many metadata-level spectra in memory) or implement
+    /// sortKey() when sorting larger lists
     SpectrumList_Sorter(const msdata::SpectrumListPtr& inner,
                         const Predicate& predicate,
-                        bool stable = false);
+                        bool stable = false,
+                        size_t maxCachedSpectra = 50000);
+
+    /// uses a previously computed sort order (e.g. from indexMap()) instead of sorting again
+    SpectrumList_Sorter(const msdata::SpectrumListPtr& inner,
+                        const std::vector<size_t>& indexMap);
+
+    /// maps each index in the sorted list to its index in the inner list;
+    /// can be persisted and passed back to the constructor to restore the order without sorting
+    const std::vector<size_t>& indexMap() const;
 
     /// \name SpectrumList interface
     //@{
@@ -74,6 +97,8 @@ class PWIZ_API_DECL SpectrumList_Sorter : public msdata::SpectrumListWrapper
     virtual msdata::SpectrumPtr spectrum(size_t index, bool getBinaryData = false) const;
     //@}
 
+    virtual const std::vector<size_t>* innerIndexMap() const;
+
     private:
     struct Impl;
     boost::shared_ptr<Impl> impl_;
@@ -87,6 +112,8 @@ class PWIZ_API_DECL SpectrumList_SorterPredicate_ScanStartTime : public Spectrum
     public:
     virtual boost::logic::tribool less(const msdata::Spectrum& lhs,
                                        const msdata::Spectrum& rhs) const;
+
+    virtual boost::optional<double> sortKey(const msdata::Spectrum& spectrum) const;
 };
 
 
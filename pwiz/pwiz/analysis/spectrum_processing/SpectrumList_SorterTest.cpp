@@ -234,6 +234,53 @@ void test()
     for (size_t i=1, end=sillySortedList->size(); i < end; ++i)
         unit_assert(sillySortedList->spectrum(i)->defaultArrayLength >=
                     sillySortedList->spectrum(i-1)->defaultArrayLength);
+
+    // spectra beyond the cache limit are retrieved for each comparison instead, with the same result
+    SpectrumList_Sorter cachedList(originalList, MSLevelSorter(), true);
+    for (size_t maxCachedSpectra=0; maxCachedSpectra <= originalList->size(); ++maxCachedSpectra)
+    {
+        SpectrumList_Sorter partlyCachedList(originalList, MSLevelSorter(), true, maxCachedSpectra);
+        unit_assert(cachedList.indexMap() == partlyCachedList.indexMap());
+    }
+}
+
+
+void testScanStartTime()
+{
+    MSData msd;
+    examples::initializeTiny(msd);
+
+    SpectrumListPtr originalList = msd.run.spectrumListPtr;
+
+    // scan=21 has no scan start time, so it sorts with the spectrum preceding it (scan=20)
+    SpectrumList_Sorter scanTimeSortedList(originalList, SpectrumList_SorterPredicate_ScanStartTime(), true);
+    unit_assert_operator_equal(5, scanTimeSortedList.size());
+    unit_assert_operator_equal("sample=1 period=1 cycle=23 experiment=1", scanTimeSortedList.spectrumIdentity(0).id);
+    unit_assert_operator_equal("scan=19", scanTimeSortedList.spectrumIdentity(1).id);
+    unit_assert_operator_equal("scan=20", scanTimeSortedList.spectrumIdentity(2).id);
+    unit_assert_operator_equal("scan=21", scanTimeSortedList.spectrumIdentity(3).id);
+    unit_assert_operator_equal("scan=22", scanTimeSortedList.spectrumIdentity(4).id);
+    unit_assert_operator_equal(4, scanTimeSortedList.indexMap()[0]);
+    unit_assert_operator_equal(0, scanTimeSortedList.indexMap()[1]);
+
+    // restore the sort order from the index map
+    SpectrumList_Sorter restoredList(originalList, scanTimeSortedList.indexMap());
+    unit_assert(scanTimeSortedList.indexMap() == restoredList.indexMap());
+    for (size_t i=0, end=restoredList.size(); i < end; ++i)
+    {
+        unit_assert_operator_equal(scanTimeSortedList.spectrumIdentity(i).id, restoredList.spectrumIdentity(i).id);
+        unit_assert_operator_equal(i, restoredList.spectrumIdentity(i).index);
+        SpectrumPtr s = restoredList.spectrum(i);
+        unit_assert_operator_equal(scanTimeSortedList.spectrumIdentity(i).id, s->id);
+        unit_assert_operator_equal(i, s->index);
+    }
+
+    // index maps which are not a permutation of the inner list are rejected
+    vector<size_t> badIndexMap(scanTimeSortedList.indexMap());
+    badIndexMap[1] = badIndexMap[0];
+    unit_assert_throws(SpectrumList_Sorter(originalList, badIndexMap), runtime_error);
+    badIndexMap.pop_back();
+    unit_assert_throws(SpectrumList_Sorter(originalList, badIndexMap), runtime_error);
 }
 
 
@@ -245,6 +292,7 @@ int main(int argc, char* argv[])
     {
         if (argc>1 && !strcmp(argv[1],"-v")) os_ = &cout;
         test();
+        testScanStartTime();
     }
     catch (exception& e)
     {
@@ -29,6 +29,7 @@
 #include "pwiz/utility/minimxml/SAXParser.hpp"
 #include "pwiz/utility/misc/Filesystem.hpp"
 #include "pwiz/utility/misc/Std.hpp"
+#include "boost/static_assert.hpp"
 
 
 namespace pwiz {
@@ -42,6 +43,36 @@ using namespace boost::logic;
 using namespace util;
 
 
+namespace {
+
+// the attribute names that the param handlers look up by id
+enum Symbol
+{
+    Symbol_accession,
+    Symbol_name,
+    Symbol_type,
+    Symbol_unitAccession,
+    Symbol_value,
+    Symbol_Count
+};
+
+const char* symbolNames_[] =
+{
+    "accession",
+    "name",
+    "type",
+    "unitAccession",
+    "value",
+    0
+};
+
+BOOST_STATIC_ASSERT(sizeof(symbolNames_)/sizeof(symbolNames_[0]) == Symbol_Count+1);
+
+const SymbolTable paramSymbols_(symbolNames_);
+
+} // namespace
+
+
 // indexes the SequenceCollection so that SpectrumIdentificationItems and PeptideEvidences
 // can resolve references immediately
 struct SequenceIndex
@@ -251,7 +282,7 @@ struct HandlerCVParam : public SAXParser::Handler
 {
     CVParam* cvParam;
 
-    HandlerCVParam(CVParam* _cvParam = 0) :  cvParam(_cvParam) {}
+    HandlerCVParam(CVParam* _cvParam = 0) :  cvParam(_cvParam) {symbols = &paramSymbols_;}
 
     virtual Status startElement(const string& name, 
                                 const Attributes& attributes,
@@ -264,14 +295,14 @@ struct HandlerCVParam : public SAXParser::Handler
             throw runtime_error("[IO::HandlerCVParam] Null cvParam."); 
 
         string accession;
-        getAttribute(attributes, "accession", accession);
+        getAttribute(attributes, Symbol_accession, accession);
         if (!accession.empty())
             cvParam->cvid = cvTermInfo(accession).cvid;
 
-        getAttribute(attributes, "value", cvParam->value);
+        getAttribute(attributes, Symbol_value, cvParam->value);
 
         string unitAccession;
-        getAttribute(attributes, "unitAccession", unitAccession);
+        getAttribute(attributes, Symbol_unitAccession, unitAccession);
         if (!unitAccession.empty())
             cvParam->units = cvTermInfo(unitAccession).cvid;
 
@@ -306,7 +337,7 @@ PWIZ_API_DECL void write(minimxml::XMLWriter& writer, const UserParam& userParam
 struct HandlerUserParam : public SAXParser::Handler
 {
     UserParam* userParam;
-    HandlerUserParam(UserParam* _userParam = 0) : userParam(_userParam) {}
+    HandlerUserParam(UserParam* _userParam = 0) : userParam(_userParam) {symbols = &paramSymbols_;}
 
     virtual Status startElement(const string& name, 
                                 const Attributes& attributes,
@@ -318,12 +349,12 @@ struct HandlerUserParam : public SAXParser::Handler
         if (!userParam)
             throw runtime_error("[IO::HandlerUserParam] Null userParam.");
 
-        getAttribute(attributes, "name", userParam->name);
-        getAttribute(attributes, "value", userParam->value);
-        getAttribute(attributes, "type", userParam->type);
+        getAttribute(attributes, Symbol_name, userParam->name);
+        getAttribute(attributes, Symbol_value, userParam->value);
+        getAttribute(attributes, Symbol_type, userParam->type);
 
         string unitAccession;
-        getAttribute(attributes, "unitAccession", unitAccession);
+        getAttribute(attributes, Symbol_unitAccession, unitAccession);
         if (!unitAccession.empty())
             userParam->units = cvTermInfo(unitAccession).cvid;
 
@@ -35,6 +35,7 @@
 #include "Serializer_mzXML.hpp"
 #include "Serializer_MGF.hpp"
 #include "Serializer_MSn.hpp"
+#include "Serializer_mzBin.hpp"
 #ifndef WITHOUT_MZ5
 #include "Serializer_mz5.hpp"
 #endif
@@ -483,6 +484,42 @@ PWIZ_API_DECL void Reader_mz5::read(const std::string& filename,
 }
 
 
+//
+// Reader_mzBin
+//
+
+PWIZ_API_DECL std::string Reader_mzBin::identify(const string& filename, const string& head) const
+{
+    return Serializer_mzBin::hasSignature(head) ? getType() : "";
+}
+
+PWIZ_API_DECL void Reader_mzBin::read(const string& filename,
+                                      const string& head,
+                                      MSData& result,
+                                      int runIndex,
+                                      const Config& config) const
+{
+    if (runIndex != 0)
+        throw ReaderFail("[Reader_mzBin::read] multiple runs not supported");
+
+    Serializer_mzBin serializer;
+    serializer.read(filename, result);
+
+    // the file-level ids can't be empty
+    if (result.id.empty() || result.run.id.empty())
+        result.id = result.run.id = bfs::basename(filename);
+}
+
+PWIZ_API_DECL void Reader_mzBin::read(const std::string& filename,
+                                      const std::string& head,
+                                      std::vector<MSDataPtr>& results,
+                                      const Config& config) const
+{
+    results.push_back(MSDataPtr(new MSData));
+    read(filename, head, *results.back());
+}
+
+
 /// default Reader list
 PWIZ_API_DECL DefaultReaderList::DefaultReaderList()
 {
@@ -492,6 +529,7 @@ PWIZ_API_DECL DefaultReaderList::DefaultReaderList()
     push_back(ReaderPtr(new Reader_MSn));
     push_back(ReaderPtr(new Reader_BTDX));
     push_back(ReaderPtr(new Reader_mz5));
+    push_back(ReaderPtr(new Reader_mzBin));
 }
 
 
@@ -97,6 +97,16 @@ class PWIZ_API_DECL Reader_mz5 : public Reader
 };
 
 
+class PWIZ_API_DECL Reader_mzBin : public Reader
+{
+    public:
+    virtual std::string identify(const std::string& filename, const std::string& head) const;
+    virtual void read(const std::string& filename, const std::string& head, MSData& result, int runIndex = 0, const Config& config = Config()) const;
+    virtual void read(const std::string& filename, const std::string& head, std::vector<MSDataPtr>& results, const Config& config = Config()) const;
+    virtual const char* getType() const {return "mzBin";}
+};
+
+
 /// default Reader list
 class PWIZ_API_DECL DefaultReaderList : public ReaderList
 {
@@ -28,6 +28,8 @@
 #include "pwiz/utility/minimxml/SAXParser.hpp"
 #include "pwiz/utility/misc/Filesystem.hpp"
 #include "pwiz/utility/misc/Std.hpp"
+#include "pwiz/utility/misc/Singleton.hpp"
+#include "boost/static_assert.hpp"
 #include "SpectrumWorkerThreads.hpp"
 
 namespace pwiz {
@@ -40,6 +42,200 @@ using namespace minimxml::SAXParser;
 using namespace util;
 
 
+namespace {
+
+// the element and attribute names that the handlers look up by id
+enum Symbol
+{
+    Symbol_accession,
+    Symbol_acquisition,
+    Symbol_acquisitionList,
+    Symbol_acquisitionSettings,
+    Symbol_acquisitionSettingsList,
+    Symbol_activation,
+    Symbol_analyzer,
+    Symbol_arrayLength,
+    Symbol_binary,
+    Symbol_binaryDataArray,
+    Symbol_binaryDataArrayList,
+    Symbol_chromatogram,
+    Symbol_chromatogramList,
+    Symbol_componentList,
+    Symbol_contact,
+    Symbol_cv,
+    Symbol_cvList,
+    Symbol_cvParam,
+    Symbol_dataProcessing,
+    Symbol_dataProcessingList,
+    Symbol_dataProcessingRef,
+    Symbol_defaultArrayLength,
+    Symbol_defaultDataProcessingRef,
+    Symbol_defaultInstrumentConfigurationRef,
+    Symbol_defaultSourceFileRef,
+    Symbol_detector,
+    Symbol_encodedLength,
+    Symbol_externalNativeID,
+    Symbol_externalSpectrumID,
+    Symbol_fileContent,
+    Symbol_fileDescription,
+    Symbol_fullName,
+    Symbol_id,
+    Symbol_index,
+    Symbol_instrumentConfiguration,
+    Symbol_instrumentConfigurationList,
+    Symbol_instrumentConfigurationRef,
+    Symbol_isolationWindow,
+    Symbol_location,
+    Symbol_mzML,
+    Symbol_name,
+    Symbol_order,
+    Symbol_precursor,
+    Symbol_precursorList,
+    Symbol_processingMethod,
+    Symbol_product,
+    Symbol_productList,
+    Symbol_ref,
+    Symbol_referenceableParamGroup,
+    Symbol_referenceableParamGroupList,
+    Symbol_referenceableParamGroupRef,
+    Symbol_run,
+    Symbol_sample,
+    Symbol_sampleList,
+    Symbol_sampleRef,
+    Symbol_scan,
+    Symbol_scanList,
+    Symbol_scanSettings,
+    Symbol_scanSettingsList,
+    Symbol_scanWindow,
+    Symbol_scanWindowList,
+    Symbol_selectedIon,
+    Symbol_selectedIonList,
+    Symbol_software,
+    Symbol_softwareList,
+    Symbol_softwareParam,
+    Symbol_softwareRef,
+    Symbol_source,
+    Symbol_sourceFile,
+    Symbol_sourceFileList,
+    Symbol_sourceFileRef,
+    Symbol_sourceFileRefList,
+    Symbol_spectrum,
+    Symbol_spectrumDescription,
+    Symbol_spectrumList,
+    Symbol_spectrumRef,
+    Symbol_spotID,
+    Symbol_startTimeStamp,
+    Symbol_target,
+    Symbol_targetList,
+    Symbol_type,
+    Symbol_unitAccession,
+    Symbol_URI,
+    Symbol_userParam,
+    Symbol_value,
+    Symbol_version,
+    Symbol_xsi_schemaLocation,
+    Symbol_Count
+};
+
+const char* symbolNames_[] =
+{
+    "accession",
+    "acquisition",
+    "acquisitionList",
+    "acquisitionSettings",
+    "acquisitionSettingsList",
+    "activation",
+    "analyzer",
+    "arrayLength",
+    "binary",
+    "binaryDataArray",
+    "binaryDataArrayList",
+    "chromatogram",
+    "chromatogramList",
+    "componentList",
+    "contact",
+    "cv",
+    "cvList",
+    "cvParam",
+    "dataProcessing",
+    "dataProcessingList",
+    "dataProcessingRef",
+    "defaultArrayLength",
+    "defaultDataProcessingRef",
+    "defaultInstrumentConfigurationRef",
+    "defaultSourceFileRef",
+    "detector",
+    "encodedLength",
+    "externalNativeID",
+    "externalSpectrumID",
+    "fileContent",
+    "fileDescription",
+    "fullName",
+    "id",
+    "index",
+    "instrumentConfiguration",
+    "instrumentConfigurationList",
+    "instrumentConfigurationRef",
+    "isolationWindow",
+    "location",
+    "mzML",
+    "name",
+    "order",
+    "precursor",
+    "precursorList",
+    "processingMethod",
+    "product",
+    "productList",
+    "ref",
+    "referenceableParamGroup",
+    "referenceableParamGroupList",
+    "referenceableParamGroupRef",
+    "run",
+    "sample",
+    "sampleList",
+    "sampleRef",
+    "scan",
+    "scanList",
+    "scanSettings",
+    "scanSettingsList",
+    "scanWindow",
+    "scanWindowList",
+    "selectedIon",
+    "selectedIonList",
+    "software",
+    "softwareList",
+    "softwareParam",
+    "softwareRef",
+    "source",
+    "sourceFile",
+    "sourceFileList",
+    "sourceFileRef",
+    "sourceFileRefList",
+    "spectrum",
+    "spectrumDescription",
+    "spectrumList",
+    "spectrumRef",
+    "spotID",
+    "startTimeStamp",
+    "target",
+    "targetList",
+    "type",
+    "unitAccession",
+    "URI",
+    "userParam",
+    "value",
+    "version",
+    "xsi:schemaLocation",
+    0
+};
+
+BOOST_STATIC_ASSERT(sizeof(symbolNames_)/sizeof(symbolNames_[0]) == Symbol_Count+1);
+
+const SymbolTable mzMLSymbols_(symbolNames_);
+
+} // namespace
+
+
 //
 // CV
 //
@@ -59,18 +255,19 @@ PWIZ_API_DECL void write(minimxml::XMLWriter& writer, const CV& cv)
 struct HandlerCV : public SAXParser::Handler
 {
     CV* cv;
-    HandlerCV(CV* _cv = 0) : cv(_cv) {}
+    HandlerCV(CV* _cv = 0) : cv(_cv) {symbols = &mzMLSymbols_;}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
-        if (name != "cv")
-            throw runtime_error(("[IO::HandlerCV] Unexpected element name: " + name).c_str());
-        decode_xml_id(getAttribute(attributes, "id", cv->id));
-        getAttribute(attributes, "fullName", cv->fullName);
-        getAttribute(attributes, "version", cv->version);
-        getAttribute(attributes, "URI", cv->URI);
+        if (elementId != Symbol_cv)
+            throw runtime_error(("[IO::HandlerCV] Unexpected element name: " + string(name)).c_str());
+        decode_xml_id(getAttribute(attributes, Symbol_id, cv->id));
+        getAttribute(attributes, Symbol_fullName, cv->fullName);
+        getAttribute(attributes, Symbol_version, cv->version);
+        getAttribute(attributes, Symbol_URI, cv->URI);
         return Status::Ok;
     }
 
@@ -89,9 +286,51 @@ PWIZ_API_DECL void read(std::istream& is, CV& cv)
 //
 
 
+namespace {
+
+/// the cvRef, accession and name attribute values of every CV term, escaped once
+/// so that writing a cvParam needs neither a string copy nor escaping
+class EscapedCVTerms : public boost::singleton<EscapedCVTerms>
+{
+    public:
+
+    struct Term
+    {
+        string cvRef;
+        string accession;
+        string name;
+    };
+
+    EscapedCVTerms(boost::restricted)
+    {
+        for (vector<CVID>::const_iterator it=cvids().begin(); it!=cvids().end(); ++it)
+        {
+            const CVTermInfo& info = cvTermInfo(*it);
+            Term& term = terms_[*it];
+            term.cvRef = escape_xml_attribute_copy(info.prefix());
+            term.accession = escape_xml_attribute_copy(info.id);
+            term.name = escape_xml_attribute_copy(info.name);
+        }
+    }
+
+    const Term& term(CVID cvid) const
+    {
+        map<CVID, Term>::const_iterator itr = terms_.find(cvid);
+        if (itr == terms_.end())
+            throw invalid_argument("[IO::write] no term associated with CVID \"" + lexical_cast<string>(cvid) + "\"");
+        return itr->second;
+    }
+
+    private:
+    map<CVID, Term> terms_;
+};
+
+} // namespace
+
+
 PWIZ_API_DECL void write(minimxml::XMLWriter& writer, const UserParam& userParam)
 {
-    XMLWriter::Attributes attributes;
+    XMLWriter::AttributeBuilder& attributes = writer.attributeBuilder();
     attributes.add("name", userParam.name);
     if (!userParam.value.empty())
         attributes.add("value", userParam.value);
@@ -99,8 +338,9 @@ PWIZ_API_DECL void write(minimxml::XMLWriter& writer, const UserParam& userParam
         attributes.add("type", userParam.type);
     if (userParam.units != CVID_Unknown)
     {
-        attributes.add("unitAccession", cvTermInfo(userParam.units).id);
-        attributes.add("unitName", cvTermInfo(userParam.units).name);
+        const EscapedCVTerms::Term& units = EscapedCVTerms::instance->term(userParam.units);
+        attributes.addEscaped("unitAccession", units.accession);
+        attributes.addEscaped("unitName", units.name);
     }
 
     writer.startElement("userParam", attributes, XMLWriter::EmptyElement);
@@ -110,24 +350,25 @@ PWIZ_API_DECL void write(minimxml::XMLWriter& writer, const UserParam& userParam
 struct HandlerUserParam : public SAXParser::Handler
 {
     UserParam* userParam;
-    HandlerUserParam(UserParam* _userParam = 0) : userParam(_userParam) {}
+    HandlerUserParam(UserParam* _userParam = 0) : userParam(_userParam) {symbols = &mzMLSymbols_;}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
-        if (name != "userParam")
-            throw runtime_error(("[IO::HandlerUserParam] Unexpected element name: " + name).c_str());
+        if (elementId != Symbol_userParam)
+            throw runtime_error(("[IO::HandlerUserParam] Unexpected element name: " + string(name)).c_str());
 
         if (!userParam)
             throw runtime_error("[IO::HandlerUserParam] Null userParam.");
 
-        getAttribute(attributes, "name", userParam->name);
-        getAttribute(attributes, "value", userParam->value);
-        getAttribute(attributes, "type", userParam->type);
+        getAttribute(attributes, Symbol_name, userParam->name);
+        getAttribute(attributes, Symbol_value, userParam->value);
+        getAttribute(attributes, Symbol_type, userParam->type);
 
         string unitAccession;
-        getAttribute(attributes, "unitAccession", unitAccession);
+        getAttribute(attributes, Symbol_unitAccession, unitAccession);
         if (!unitAccession.empty())
             userParam->units = cvTermInfo(unitAccession).cvid;
 
@@ -150,16 +391,19 @@ PWIZ_API_DECL void read(std::istream& is, UserParam& userParam)
 
 PWIZ_API_DECL void write(minimxml::XMLWriter& writer, const CVParam& cvParam)
 {
-    XMLWriter::Attributes attributes;
-    attributes.add("cvRef", cvTermInfo(cvParam.cvid).prefix());
-    attributes.add("accession", cvTermInfo(cvParam.cvid).id);
-    attributes.add("name", cvTermInfo(cvParam.cvid).name);
+    const EscapedCVTerms::Term& term = EscapedCVTerms::instance->term(cvParam.cvid);
+
+    XMLWriter::AttributeBuilder& attributes = writer.attributeBuilder();
+    attributes.addEscaped("cvRef", term.cvRef);
+    attributes.addEscaped("accession", term.accession);
+    attributes.addEscaped("name", term.name);
     attributes.add("value", cvParam.value);
     if (cvParam.units != CVID_Unknown)
     {
-        attributes.add("unitCvRef", cvTermInfo(cvParam.units).prefix());
-        attributes.add("unitAccession", cvTermInfo(cvParam.units).id);
-        attributes.add("unitName", cvTermInfo(cvParam.units).name);
+        const EscapedCVTerms::Term& units = EscapedCVTerms::instance->term(cvParam.units);
+        attributes.addEscaped("unitCvRef", units.cvRef);
+        attributes.addEscaped("unitAccession", units.accession);
+        attributes.addEscaped("unitName", units.name);
     }
     writer.startElement("cvParam", attributes, XMLWriter::EmptyElement);
 }
@@ -169,25 +413,26 @@ struct HandlerCVParam : public SAXParser::Handler
 {
     CVParam* cvParam;
 
-    HandlerCVParam(CVParam* _cvParam = 0) :  cvParam(_cvParam) {}
+    HandlerCVParam(CVParam* _cvParam = 0) :  cvParam(_cvParam) {symbols = &mzMLSymbols_;}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
-        if (name != "cvParam")
-            throw runtime_error(("[IO::HandlerCVParam] Unexpected element name: " + name).c_str());
+        if (elementId != Symbol_cvParam)
+            throw runtime_error(("[IO::HandlerCVParam] Unexpected element name: " + string(name)).c_str());
 
         if (!cvParam)
             throw runtime_error("[IO::HandlerCVParam] Null cvParam."); 
 
-        const char *accession = getAttribute(attributes, "accession",  NoXMLUnescape); 
+        const char *accession = getAttribute(attributes, Symbol_accession,  NoXMLUnescape); 
         if (accession)
             cvParam->cvid = cvTermInfo(accession).cvid;
 
-        getAttribute(attributes, "value", cvParam->value);
+        getAttribute(attributes, Symbol_value, cvParam->value);
 
-        const char *unitAccession = getAttribute(attributes, "unitAccession", NoXMLUnescape); 
+        const char *unitAccession = getAttribute(attributes, Symbol_unitAccession, NoXMLUnescape); 
         if (unitAccession)
             cvParam->units = cvTermInfo(unitAccession).cvid;
 
@@ -213,7 +458,7 @@ PWIZ_API_DECL void read(std::istream& is, CVParam& cvParam)
 
 PWIZ_API_DECL void writeParamGroupRef(minimxml::XMLWriter& writer, const ParamGroup& paramGroup)
 {
-    XMLWriter::Attributes attributes;
+    XMLWriter::AttributeBuilder& attributes = writer.attributeBuilder();
     attributes.add("ref", paramGroup.id);
     writer.startElement("referenceableParamGroupRef", attributes, XMLWriter::EmptyElement);
 }
@@ -241,38 +486,41 @@ struct HandlerParamContainer : public SAXParser::Handler
 
     HandlerParamContainer(ParamContainer* _paramContainer = 0)
     :   paramContainer(_paramContainer)
-    {}
+    {
+        symbols = &mzMLSymbols_;
+    }
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!paramContainer)
             throw runtime_error("[IO::HandlerParamContainer] Null paramContainer.");
 
-        if (name == "cvParam")
+        if (elementId == Symbol_cvParam)
         {
             paramContainer->cvParams.push_back(CVParam()); 
             handlerCVParam_.cvParam = &paramContainer->cvParams.back();
             return Status(Status::Delegate, &handlerCVParam_);
         }
-        else if (name == "userParam")
+        else if (elementId == Symbol_userParam)
         {
             paramContainer->userParams.push_back(UserParam()); 
             handlerUserParam_.userParam = &paramContainer->userParams.back();
             return Status(Status::Delegate, &handlerUserParam_);
         }
-        else if (name == "referenceableParamGroupRef")
+        else if (elementId == Symbol_referenceableParamGroupRef)
         {
             // note: placeholder
             string id;
-            decode_xml_id(getAttribute(attributes, "ref", id));
+            decode_xml_id(getAttribute(attributes, Symbol_ref, id));
             if (!id.empty())
                 paramContainer->paramGroupPtrs.push_back(ParamGroupPtr(new ParamGroup(id))); 
             return Status::Ok;
         }
 
-        throw runtime_error(("[IO::HandlerParamContainer] Unknown element " + name).c_str()); 
+        throw runtime_error(("[IO::HandlerParamContainer] Unknown element " + string(name)).c_str()); 
     }
 
     private:
@@ -284,20 +532,21 @@ struct HandlerParamContainer : public SAXParser::Handler
     
 struct HandlerNamedParamContainer : public HandlerParamContainer
 {
-    const string name_;
+    const int nameId_;
 
-    HandlerNamedParamContainer(const string& name, ParamContainer* paramContainer = 0)
-    :   HandlerParamContainer(paramContainer), name_(name)
+    HandlerNamedParamContainer(int nameId, ParamContainer* paramContainer = 0)
+    :   HandlerParamContainer(paramContainer), nameId_(nameId)
     {}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
-        if (name == name_)
+        if (elementId == nameId_)
             return Status::Ok;
 
-        return HandlerParamContainer::startElement(name, attributes, position);
+        return HandlerParamContainer::startElementById(elementId, name, attributes, position);
     }
 };
 
@@ -325,21 +574,22 @@ struct HandlerParamGroup : public HandlerParamContainer
     :   paramGroup(_paramGroup)
     {}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!paramGroup)
             throw runtime_error("[IO::HandlerParamGroup] Null paramGroup.");
 
-        if (name == "referenceableParamGroup")
+        if (elementId == Symbol_referenceableParamGroup)
         {
-            decode_xml_id(getAttribute(attributes, "id", paramGroup->id));
+            decode_xml_id(getAttribute(attributes, Symbol_id, paramGroup->id));
             return Status::Ok;
         }
 
         HandlerParamContainer::paramContainer = paramGroup;
-        return HandlerParamContainer::startElement(name, attributes, position);
+        return HandlerParamContainer::startElementById(elementId, name, attributes, position);
     }
 };
 
@@ -366,7 +616,7 @@ PWIZ_API_DECL void write(minimxml::XMLWriter& writer, const FileContent& fc)
 
 PWIZ_API_DECL void read(std::istream& is, FileContent& fc)
 {
-    HandlerNamedParamContainer handler("fileContent", &fc);
+    HandlerNamedParamContainer handler(Symbol_fileContent, &fc);
     SAXParser::parse(is, handler);
 }
 
@@ -404,23 +654,24 @@ struct HandlerSourceFile : public HandlerParamContainer
     :   sourceFile(_sourceFile)
     {}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!sourceFile)
             throw runtime_error("[IO::HandlerSourceFile] Null sourceFile.");
 
-        if (name == "sourceFile")
+        if (elementId == Symbol_sourceFile)
         {
-            decode_xml_id(getAttribute(attributes, "id", sourceFile->id));
-            getAttribute(attributes, "name", sourceFile->name);
-            getAttribute(attributes, "location", sourceFile->location);
+            decode_xml_id(getAttribute(attributes, Symbol_id, sourceFile->id));
+            getAttribute(attributes, Symbol_name, sourceFile->name);
+            getAttribute(attributes, Symbol_location, sourceFile->location);
             return Status::Ok;
         }
 
         HandlerParamContainer::paramContainer = sourceFile;
-        return HandlerParamContainer::startElement(name, attributes, position);
+        return HandlerParamContainer::startElementById(elementId, name, attributes, position);
     }
 };
 
@@ -447,7 +698,7 @@ PWIZ_API_DECL void write(minimxml::XMLWriter& writer, const Contact& c)
 
 PWIZ_API_DECL void read(std::istream& is, Contact& c)
 {
-    HandlerNamedParamContainer handler("contact", &c);
+    HandlerNamedParamContainer handler(Symbol_contact, &c);
     SAXParser::parse(is, handler);
 }
 
@@ -485,44 +736,47 @@ struct HandlerFileDescription : public SAXParser::Handler
 
     HandlerFileDescription(FileDescription* _fileDescription = 0)
     :   fileDescription(_fileDescription),
-        handlerFileContent_("fileContent"),
-        handlerContact_("contact")
-    {}
+        handlerFileContent_(Symbol_fileContent),
+        handlerContact_(Symbol_contact)
+    {
+        symbols = &mzMLSymbols_;
+    }
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!fileDescription)
             throw runtime_error("[IO::HandlerFileDescription] Null fileDescription.");
         
-        if (name == "fileDescription")
+        if (elementId == Symbol_fileDescription)
         {
             return Status::Ok;
         }
-        else if (name == "fileContent")
+        else if (elementId == Symbol_fileContent)
         {
             handlerFileContent_.paramContainer = &fileDescription->fileContent;
             return Status(Status::Delegate, &handlerFileContent_);
         }
-        else if (name == "sourceFileList")
+        else if (elementId == Symbol_sourceFileList)
         {
             return Status::Ok;
         }
-        else if (name == "sourceFile")
+        else if (elementId == Symbol_sourceFile)
         {
             fileDescription->sourceFilePtrs.push_back(SourceFilePtr(new SourceFile));
             handlerSourceFile_.sourceFile = fileDescription->sourceFilePtrs.back().get();
             return Status(Status::Delegate, &handlerSourceFile_);
         }
-        else if (name == "contact")
+        else if (elementId == Symbol_contact)
         {
             fileDescription->contacts.push_back(Contact());
             handlerContact_.paramContainer = &fileDescription->contacts.back();
             return Status(Status::Delegate, &handlerContact_);
         }
 
-        throw runtime_error(("[IO::HandlerFileDescription] Unknown element " + name).c_str()); 
+        throw runtime_error(("[IO::HandlerFileDescription] Unknown element " + string(name)).c_str()); 
     }
 
     private:
@@ -564,22 +818,23 @@ struct HandlerSample : public HandlerParamContainer
     :   sample(_sample)
     {}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!sample)
             throw runtime_error("[IO::HandlerSample] Null sample.");
 
-        if (name == "sample")
+        if (elementId == Symbol_sample)
         {
-            decode_xml_id(getAttribute(attributes, "id", sample->id));
-            getAttribute(attributes, "name", sample->name);
+            decode_xml_id(getAttribute(attributes, Symbol_id, sample->id));
+            getAttribute(attributes, Symbol_name, sample->name);
             return Status::Ok;
         }
 
         HandlerParamContainer::paramContainer = sample;
-        return HandlerParamContainer::startElement(name, attributes, position);
+        return HandlerParamContainer::startElementById(elementId, name, attributes, position);
     }
 };
 
@@ -627,23 +882,24 @@ struct HandlerComponent : public HandlerParamContainer
     :   component(_component)
     {}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!component)
             throw runtime_error("[IO::HandlerComponent] Null component.");
 
-        if (name=="source" ||
-            name=="analyzer" ||
-            name=="detector")
+        if (elementId == Symbol_source ||
+            elementId == Symbol_analyzer ||
+            elementId == Symbol_detector)
         {
-            getAttribute(attributes, "order", component->order);
+            getAttribute(attributes, Symbol_order, component->order);
             return Status::Ok;
         }
 
         HandlerParamContainer::paramContainer = component;
-        return HandlerParamContainer::startElement(name, attributes, position);
+        return HandlerParamContainer::startElementById(elementId, name, attributes, position);
     }
 };
 
@@ -677,39 +933,40 @@ PWIZ_API_DECL void write(minimxml::XMLWriter& writer, const ComponentList& compo
 struct HandlerComponentList : public SAXParser::Handler
 {
     ComponentList* componentList;
-    HandlerComponentList(ComponentList* _componentList = 0) : componentList(_componentList) {}
+    HandlerComponentList(ComponentList* _componentList = 0) : componentList(_componentList) {symbols = &mzMLSymbols_;}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!componentList)
             throw runtime_error("[IO::HandlerComponentList] Null componentList.");
 
-        if (name == "componentList")
+        if (elementId == Symbol_componentList)
         {
             return Status::Ok;
         }
-        else if (name == "source")
+        else if (elementId == Symbol_source)
         {
             componentList->push_back(Component(ComponentType_Source, 1));
             handlerComponent_.component = &componentList->back();
             return Status(Status::Delegate, &handlerComponent_);
         }
-        else if (name == "analyzer")
+        else if (elementId == Symbol_analyzer)
         {
             componentList->push_back(Component(ComponentType_Analyzer, 1));
             handlerComponent_.component = &componentList->back();
             return Status(Status::Delegate, &handlerComponent_);
         }
-        else if (name == "detector")
+        else if (elementId == Symbol_detector)
         {
             componentList->push_back(Component(ComponentType_Detector, 1));
             handlerComponent_.component = &componentList->back();
             return Status(Status::Delegate, &handlerComponent_);
         }
 
-        throw runtime_error(("[IO::HandlerComponentList] Unexpected element name: " + name).c_str());
+        throw runtime_error(("[IO::HandlerComponentList] Unexpected element name: " + string(name)).c_str());
     }
 
     private:
@@ -746,34 +1003,35 @@ struct HandlerSoftware : public HandlerParamContainer
 
     HandlerSoftware(Software* _software = 0) : software(_software) {}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!software)
             throw runtime_error("[IO::HandlerSoftware] Null software.");
 
-        if (name == "software")
+        if (elementId == Symbol_software)
         {
-            decode_xml_id(getAttribute(attributes, "id", software->id));
-            getAttribute(attributes, "version", software->version);
+            decode_xml_id(getAttribute(attributes, Symbol_id, software->id));
+            getAttribute(attributes, Symbol_version, software->version);
             return Status::Ok;
         }
 
         // mzML 1.0
-        else if (version == 1 && name == "softwareParam")
+        else if (version == 1 && elementId == Symbol_softwareParam)
         {
             string accession;
-            getAttribute(attributes, "accession", accession);
+            getAttribute(attributes, Symbol_accession, accession);
             if (!accession.empty())
                 software->set(cvTermInfo(accession).cvid);
 
-            getAttribute(attributes, "version", software->version);
+            getAttribute(attributes, Symbol_version, software->version);
             return Status::Ok;
         }
 
         HandlerParamContainer::paramContainer = software;
-        return HandlerParamContainer::startElement(name, attributes, position);
+        return HandlerParamContainer::startElementById(elementId, name, attributes, position);
     }
 };
 
@@ -818,35 +1076,36 @@ struct HandlerInstrumentConfiguration : public HandlerParamContainer
     :   instrumentConfiguration(_instrumentConfiguration)
     {}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!instrumentConfiguration)
             throw runtime_error("[IO::HandlerInstrumentConfiguration] Null instrumentConfiguration.");
 
-        if (name == "instrumentConfiguration")
+        if (elementId == Symbol_instrumentConfiguration)
         {
-            decode_xml_id(getAttribute(attributes, "id", instrumentConfiguration->id));
+            decode_xml_id(getAttribute(attributes, Symbol_id, instrumentConfiguration->id));
             return Status::Ok;
         }
-        else if (name == "componentList")
+        else if (elementId == Symbol_componentList)
         {
             handlerComponentList_.componentList = &instrumentConfiguration->componentList;
             return Status(Status::Delegate, &handlerComponentList_);
         }
-        else if (name == "softwareRef")
+        else if (elementId == Symbol_softwareRef)
         {
             // note: placeholder
             string ref;
-            decode_xml_id(getAttribute(attributes, "ref", ref));
+            decode_xml_id(getAttribute(attributes, Symbol_ref, ref));
             if (!ref.empty())
                 instrumentConfiguration->softwarePtr = SoftwarePtr(new Software(ref));
             return Status::Ok;
         }
 
         HandlerParamContainer::paramContainer = instrumentConfiguration;
-        return HandlerParamContainer::startElement(name, attributes, position);
+        return HandlerParamContainer::startElementById(elementId, name, attributes, position);
     }
 
     private:
@@ -888,20 +1147,21 @@ struct HandlerProcessingMethod : public HandlerParamContainer
     :   processingMethod(_processingMethod)
     {}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!processingMethod)
             throw runtime_error("[IO::HandlerProcessingMethod] Null processingMethod.");
 
-        if (name == "processingMethod")
+        if (elementId == Symbol_processingMethod)
         {
-            getAttribute(attributes, "order", processingMethod->order);
+            getAttribute(attributes, Symbol_order, processingMethod->order);
 
             // note: placeholder
             string softwareRef;
-            decode_xml_id(getAttribute(attributes, "softwareRef", softwareRef));
+            decode_xml_id(getAttribute(attributes, Symbol_softwareRef, softwareRef));
             if (!softwareRef.empty())
                 processingMethod->softwarePtr = SoftwarePtr(new Software(softwareRef));
             else if (!defaultSoftwareRef.empty())
@@ -911,7 +1171,7 @@ struct HandlerProcessingMethod : public HandlerParamContainer
         }
 
         HandlerParamContainer::paramContainer = processingMethod;
-        return HandlerParamContainer::startElement(name, attributes, position);
+        return HandlerParamContainer::startElementById(elementId, name, attributes, position);
     }
 };
 
@@ -951,36 +1211,37 @@ struct HandlerDataProcessing : public HandlerParamContainer
     :   dataProcessing(_dataProcessing)
     {}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!dataProcessing)
             throw runtime_error("[IO::HandlerDataProcessing] Null dataProcessing.");
 
-        if (name == "dataProcessing")
+        if (elementId == Symbol_dataProcessing)
         {
-            decode_xml_id(getAttribute(attributes, "id", dataProcessing->id));
+            decode_xml_id(getAttribute(attributes, Symbol_id, dataProcessing->id));
 
             // mzML 1.0
             if (version == 1)
             {
                 string softwareRef;
-                getAttribute(attributes, "softwareRef", softwareRef);
+                getAttribute(attributes, Symbol_softwareRef, softwareRef);
                 if (!softwareRef.empty())
                     handlerProcessingMethod_.defaultSoftwareRef = softwareRef;
             }
 
             return Status::Ok;
         }
-        else if (name == "processingMethod")
+        else if (elementId == Symbol_processingMethod)
         {
             dataProcessing->processingMethods.push_back(ProcessingMethod());
             handlerProcessingMethod_.processingMethod = &dataProcessing->processingMethods.back(); 
             return Status(Status::Delegate, &handlerProcessingMethod_);
         }
 
-        throw runtime_error(("[IO::HandlerDataProcessing] Unexpected element name: " + name).c_str());
+        throw runtime_error(("[IO::HandlerDataProcessing] Unexpected element name: " + string(name)).c_str());
     }
 
     private:
@@ -1010,7 +1271,7 @@ PWIZ_API_DECL void write(minimxml::XMLWriter& writer, const Target& t)
 
 PWIZ_API_DECL void read(std::istream& is, Target& t)
 {
-    HandlerNamedParamContainer handler("target", &t);
+    HandlerNamedParamContainer handler(Symbol_target, &t);
     SAXParser::parse(is, handler);
 }
 
@@ -1061,43 +1322,44 @@ struct HandlerScanSettings : public HandlerParamContainer
 
     HandlerScanSettings(ScanSettings* _scanSettings = 0)
     :   scanSettings(_scanSettings), 
-        handlerTarget_("target")
+        handlerTarget_(Symbol_target)
     {}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!scanSettings)
             throw runtime_error("[IO::HandlerScanSettings] Null scanSettings.");
 
-        if ((version == 1 && name == "acquisitionSettings") /* mzML 1.0 */ ||
-            name == "scanSettings")
+        if ((version == 1 && elementId == Symbol_acquisitionSettings) /* mzML 1.0 */ ||
+            elementId == Symbol_scanSettings)
         {
-            decode_xml_id(getAttribute(attributes, "id", scanSettings->id));
+            decode_xml_id(getAttribute(attributes, Symbol_id, scanSettings->id));
             return Status::Ok;
         }
-        else if (name=="sourceFileRefList" || name=="targetList")
+        else if (elementId == Symbol_sourceFileRefList || elementId == Symbol_targetList)
         {
             return Status::Ok;
         }
-        else if (name=="sourceFileRef")
+        else if (elementId == Symbol_sourceFileRef)
         {
             // note: placeholder
             string sourceFileRef;
-            decode_xml_id(getAttribute(attributes, "ref", sourceFileRef));
+            decode_xml_id(getAttribute(attributes, Symbol_ref, sourceFileRef));
             if (!sourceFileRef.empty())
                 scanSettings->sourceFilePtrs.push_back(SourceFilePtr(new SourceFile(sourceFileRef)));
             return Status::Ok;
         }
-        else if (name=="target")
+        else if (elementId == Symbol_target)
         {
             scanSettings->targets.push_back(Target());
             handlerTarget_.paramContainer = &scanSettings->targets.back();
             return Status(Status::Delegate, &handlerTarget_);
         }
 
-        throw runtime_error(("[IO::HandlerScanSettings] Unexpected element name: " + name).c_str());
+        throw runtime_error(("[IO::HandlerScanSettings] Unexpected element name: " + string(name)).c_str());
     }
 
     private:
@@ -1127,7 +1389,7 @@ PWIZ_API_DECL void write(minimxml::XMLWriter& writer, const IsolationWindow& iso
 
 PWIZ_API_DECL void read(std::istream& is, IsolationWindow& isolationWindow)
 {
-    HandlerNamedParamContainer handler("isolationWindow", &isolationWindow);
+    HandlerNamedParamContainer handler(Symbol_isolationWindow, &isolationWindow);
     SAXParser::parse(is, handler);
 }
     
@@ -1147,7 +1409,7 @@ PWIZ_API_DECL void write(minimxml::XMLWriter& writer, const SelectedIon& selecte
 
 PWIZ_API_DECL void read(std::istream& is, SelectedIon& selectedIon)
 {
-    HandlerNamedParamContainer handler("selectedIon", &selectedIon);
+    HandlerNamedParamContainer handler(Symbol_selectedIon, &selectedIon);
     SAXParser::parse(is, handler);
 }
     
@@ -1167,7 +1429,7 @@ PWIZ_API_DECL void write(minimxml::XMLWriter& writer, const Activation& activati
 
 PWIZ_API_DECL void read(std::istream& is, Activation& activation)
 {
-    HandlerNamedParamContainer handler("activation", &activation);
+    HandlerNamedParamContainer handler(Symbol_activation, &activation);
     SAXParser::parse(is, handler);
 }
     
@@ -1238,22 +1500,23 @@ struct HandlerPrecursor : public HandlerParamContainer
     HandlerPrecursor(Precursor* _precursor = 0, const map<string, string>* legacyIdRefToNativeId = 0)
     :   precursor(_precursor), 
         legacyIdRefToNativeId(legacyIdRefToNativeId),
-        handlerIsolationWindow_("isolationWindow"), 
-        handlerSelectedIon_("selectedIon"), 
-        handlerActivation_("activation")
+        handlerIsolationWindow_(Symbol_isolationWindow), 
+        handlerSelectedIon_(Symbol_selectedIon), 
+        handlerActivation_(Symbol_activation)
     {}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!precursor)
             throw runtime_error("[IO::HandlerPrecursor] Null precursor.");
 
-        if (name == "precursor")
+        if (elementId == Symbol_precursor)
         {
-            getAttribute(attributes, "spectrumRef", precursor->spectrumID); // not an XML:IDREF
-            getAttribute(attributes, "externalSpectrumID", precursor->externalSpectrumID);
+            getAttribute(attributes, Symbol_spectrumRef, precursor->spectrumID); // not an XML:IDREF
+            getAttribute(attributes, Symbol_externalSpectrumID, precursor->externalSpectrumID);
 
             // mzML 1.0
             if (version == 1 && legacyIdRefToNativeId && !precursor->spectrumID.empty())
@@ -1265,35 +1528,35 @@ struct HandlerPrecursor : public HandlerParamContainer
 
             // note: placeholder
             string sourceFileRef;
-            decode_xml_id(getAttribute(attributes, "sourceFileRef", sourceFileRef));
+            decode_xml_id(getAttribute(attributes, Symbol_sourceFileRef, sourceFileRef));
             if (!sourceFileRef.empty())
                 precursor->sourceFilePtr = SourceFilePtr(new SourceFile(sourceFileRef));
 
             return Status::Ok;
         }
-        else if (name == "isolationWindow")
+        else if (elementId == Symbol_isolationWindow)
         {
             handlerIsolationWindow_.paramContainer = &precursor->isolationWindow;
             return Status(Status::Delegate, &handlerIsolationWindow_);
         }
-        else if (name == "selectedIon")
+        else if (elementId == Symbol_selectedIon)
         {
             precursor->selectedIons.push_back(SelectedIon());
             handlerSelectedIon_.paramContainer = &precursor->selectedIons.back();
             return Status(Status::Delegate, &handlerSelectedIon_);
         }
-        else if (name == "activation")
+        else if (elementId == Symbol_activation)
         {
             handlerActivation_.paramContainer = &precursor->activation;
             return Status(Status::Delegate, &handlerActivation_);
         }
-        else if (name == "selectedIonList")
+        else if (elementId == Symbol_selectedIonList)
         {
             return Status::Ok;
         }
 
         HandlerParamContainer::paramContainer = precursor;
-        return HandlerParamContainer::startElement(name, attributes, position);
+        return HandlerParamContainer::startElementById(elementId, name, attributes, position);
     }
 
     private:
@@ -1338,27 +1601,30 @@ struct HandlerProduct : public SAXParser::Handler
 
     HandlerProduct(Product* _product = 0)
     :   product(_product), 
-        handlerIsolationWindow_("isolationWindow")
-    {}
+        handlerIsolationWindow_(Symbol_isolationWindow)
+    {
+        symbols = &mzMLSymbols_;
+    }
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!product)
             throw runtime_error("[IO::HandlerProduct] Null product.");
 
-        if (name == "product")
+        if (elementId == Symbol_product)
         {
             return Status::Ok;
         }
-        else if (name == "isolationWindow")
+        else if (elementId == Symbol_isolationWindow)
         {
             handlerIsolationWindow_.paramContainer = &product->isolationWindow;
             return Status(Status::Delegate, &handlerIsolationWindow_);
         }
 
-        throw runtime_error(("[IO::HandlerProduct] Unknown element " + name).c_str()); 
+        throw runtime_error(("[IO::HandlerProduct] Unknown element " + string(name)).c_str()); 
     }
 
     private:
@@ -1388,7 +1654,7 @@ PWIZ_API_DECL void write(minimxml::XMLWriter& writer, const ScanWindow& scanWind
 
 PWIZ_API_DECL void read(std::istream& is, ScanWindow& scanWindow)
 {
-    HandlerNamedParamContainer handler("scanWindow", &scanWindow);
+    HandlerNamedParamContainer handler(Symbol_scanWindow, &scanWindow);
     SAXParser::parse(is, handler);
 }
     
@@ -1447,46 +1713,47 @@ struct HandlerScan : public HandlerParamContainer
     Scan* scan;
 
     HandlerScan(Scan* _scan = 0)
-    :   scan(_scan), handlerScanWindow_("scanWindow")
+    :   scan(_scan), handlerScanWindow_(Symbol_scanWindow)
     {}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!scan)
             throw runtime_error("[IO::HandlerScan] Null scan.");
 
-        if (name != "cvParam") 
+        if (elementId != Symbol_cvParam) 
         { // most common, but not handled here
-            if (name == "scan")
+            if (elementId == Symbol_scan)
             {
-                getAttribute(attributes, "spectrumRef", scan->spectrumID); // not an XML:IDREF
-                getAttribute(attributes, "externalSpectrumID", scan->externalSpectrumID);
+                getAttribute(attributes, Symbol_spectrumRef, scan->spectrumID); // not an XML:IDREF
+                getAttribute(attributes, Symbol_externalSpectrumID, scan->externalSpectrumID);
 
                 // note: placeholder
                 string sourceFileRef;
-                decode_xml_id(getAttribute(attributes, "sourceFileRef", sourceFileRef));
+                decode_xml_id(getAttribute(attributes, Symbol_sourceFileRef, sourceFileRef));
                 if (!sourceFileRef.empty())
                     scan->sourceFilePtr = SourceFilePtr(new SourceFile(sourceFileRef));
 
                 // note: placeholder
                 string instrumentConfigurationRef;
-                decode_xml_id(getAttribute(attributes, "instrumentConfigurationRef", instrumentConfigurationRef));
+                decode_xml_id(getAttribute(attributes, Symbol_instrumentConfigurationRef, instrumentConfigurationRef));
                 if (!instrumentConfigurationRef.empty())
                     scan->instrumentConfigurationPtr = InstrumentConfigurationPtr(new InstrumentConfiguration(instrumentConfigurationRef));
                 return Status::Ok;
             }
-            else if (version == 1 && name == "acquisition")
+            else if (version == 1 && elementId == Symbol_acquisition)
             {
                 // note: spectrumRef, externalNativeID, and externalSpectrumID are mutually exclusive
-                getAttribute(attributes, "spectrumRef", scan->spectrumID); // not an XML:IDREF
+                getAttribute(attributes, Symbol_spectrumRef, scan->spectrumID); // not an XML:IDREF
                 if (scan->spectrumID.empty())
                 {
                     string externalNativeID;
-                    getAttribute(attributes, "externalNativeID", externalNativeID);
+                    getAttribute(attributes, Symbol_externalNativeID, externalNativeID);
                     if (externalNativeID.empty())
-                        getAttribute(attributes, "externalSpectrumID", scan->externalSpectrumID);
+                        getAttribute(attributes, Symbol_externalSpectrumID, scan->externalSpectrumID);
                     else
                         try
                         {
@@ -1503,17 +1770,17 @@ struct HandlerScan : public HandlerParamContainer
 
                 // note: placeholder
                 string sourceFileRef;
-                decode_xml_id(getAttribute(attributes, "sourceFileRef", sourceFileRef));
+                decode_xml_id(getAttribute(attributes, Symbol_sourceFileRef, sourceFileRef));
                 if (!sourceFileRef.empty())
                     scan->sourceFilePtr = SourceFilePtr(new SourceFile(sourceFileRef));
 
                 return Status::Ok;
             }
-            else if (name == "scanWindowList")
+            else if (elementId == Symbol_scanWindowList)
             {
                 return Status::Ok;
             }
-            else if (name == "scanWindow")
+            else if (elementId == Symbol_scanWindow)
             {
                 scan->scanWindows.push_back(ScanWindow());
                 handlerScanWindow_.paramContainer = &scan->scanWindows.back();
@@ -1522,7 +1789,7 @@ struct HandlerScan : public HandlerParamContainer
         } // end if not cvParam
 
         HandlerParamContainer::paramContainer = scan;
-        return HandlerParamContainer::startElement(name, attributes, position);
+        return HandlerParamContainer::startElementById(elementId, name, attributes, position);
     }
 
     private:
@@ -1565,18 +1832,19 @@ struct HandlerScanList : public HandlerParamContainer
     :   scanList(_scanList)
     {}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!scanList)
             throw runtime_error("[IO::HandlerScanList] Null scanList.");
 
-        if (name == "scanList" || name == "acquisitionList")
+        if (elementId == Symbol_scanList || elementId == Symbol_acquisitionList)
         {
             return Status::Ok;
         }
-        else if (name == "scan" || name == "acquisition")
+        else if (elementId == Symbol_scan || elementId == Symbol_acquisition)
         {
             scanList->scans.push_back(Scan());
             handlerScan_.version = version;
@@ -1585,7 +1853,7 @@ struct HandlerScanList : public HandlerParamContainer
         }
 
         HandlerParamContainer::paramContainer = scanList;
-        return HandlerParamContainer::startElement(name, attributes, position);
+        return HandlerParamContainer::startElementById(elementId, name, attributes, position);
     }
 
     private:
@@ -1621,7 +1889,7 @@ void write(minimxml::XMLWriter& writer, const BinaryDataArray& binaryDataArray,
     encoder.encode(binaryDataArray.data, encoded);
     usedConfig = encoder.getConfig(); // config may have changed if numpress error was excessive
 
-    XMLWriter::Attributes attributes;
+    XMLWriter::AttributeBuilder& attributes = writer.attributeBuilder();
 
     // primary array types can never override the default array length
     if (!binaryDataArray.hasCVParam(MS_m_z_array) &&
@@ -1709,29 +1977,30 @@ struct HandlerBinaryDataArray : public HandlerParamContainer
         autoUnescapeCharacters = false;
     }
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!binaryDataArray)
             throw runtime_error("[IO::HandlerBinaryDataArray] Null binaryDataArray.");
 
-        if (name != "cvParam") // most common, but not handled here
+        if (elementId != Symbol_cvParam) // most common, but not handled here
         { 
-            if (name == "binaryDataArray")
+            if (elementId == Symbol_binaryDataArray)
             {
                 // note: placeholder
                 string dataProcessingRef;
-                decode_xml_id(getAttribute(attributes, "dataProcessingRef", dataProcessingRef));
+                decode_xml_id(getAttribute(attributes, Symbol_dataProcessingRef, dataProcessingRef));
                 if (!dataProcessingRef.empty())
                     binaryDataArray->dataProcessingPtr = DataProcessingPtr(new DataProcessing(dataProcessingRef));
 
-                    getAttribute(attributes, "encodedLength", encodedLength_, NoXMLUnescape);
-                    getAttribute(attributes, "arrayLength", arrayLength_, NoXMLUnescape, defaultArrayLength);
+                    getAttribute(attributes, Symbol_encodedLength, encodedLength_, NoXMLUnescape);
+                    getAttribute(attributes, Symbol_arrayLength, arrayLength_, NoXMLUnescape, defaultArrayLength);
 
                 return Status::Ok;
             }
-            else if (name == "binary")
+            else if (elementId == Symbol_binary)
             {
                 if (msd) References::resolve(*binaryDataArray, *msd);
                 config = getConfig();
@@ -1740,7 +2009,7 @@ struct HandlerBinaryDataArray : public HandlerParamContainer
         } // end if not cvParam
 
         HandlerParamContainer::paramContainer = binaryDataArray;
-        return HandlerParamContainer::startElement(name, attributes, position);
+        return HandlerParamContainer::startElementById(elementId, name, attributes, position);
     }
 
 
@@ -1894,7 +2163,7 @@ PWIZ_API_DECL
 void write(minimxml::XMLWriter& writer, const Spectrum& spectrum, const MSData& msd, 
            const BinaryDataEncoder::Config& config)
 {
-    XMLWriter::Attributes attributes;
+    XMLWriter::AttributeBuilder& attributes = writer.attributeBuilder();
     attributes.add("index", spectrum.index);
     attributes.add("id", spectrum.id); // not an XML:ID
     if (!spectrum.spotID.empty())
@@ -1976,23 +2245,24 @@ struct HandlerSpectrum : public HandlerParamContainer
     {
     }
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!spectrum)
             throw runtime_error("[IO::HandlerSpectrum] Null spectrum.");
 
-        if (name != "cvParam") // the most common, but not handled here
+        if (elementId != Symbol_cvParam) // the most common, but not handled here
         { 
-            if (name == "spectrum")
+            if (elementId == Symbol_spectrum)
             {
                 spectrum->sourceFilePosition = position;
 
-                getAttribute(attributes, "index", spectrum->index);
-                getAttribute(attributes, "spotID", spectrum->spotID);
-                getAttribute(attributes, "defaultArrayLength", spectrum->defaultArrayLength);
-                getAttribute(attributes, "id", spectrum->id); // not an XML:ID
+                getAttribute(attributes, Symbol_index, spectrum->index);
+                getAttribute(attributes, Symbol_spotID, spectrum->spotID);
+                getAttribute(attributes, Symbol_defaultArrayLength, spectrum->defaultArrayLength);
+                getAttribute(attributes, Symbol_id, spectrum->id); // not an XML:ID
 
                 // mzML 1.0
                 if (version == 1 && legacyIdRefToNativeId)
@@ -2004,42 +2274,42 @@ struct HandlerSpectrum : public HandlerParamContainer
 
                 // note: placeholder
                 string dataProcessingRef;
-                decode_xml_id(getAttribute(attributes, "dataProcessingRef", dataProcessingRef));
+                decode_xml_id(getAttribute(attributes, Symbol_dataProcessingRef, dataProcessingRef));
                 if (!dataProcessingRef.empty())
                     spectrum->dataProcessingPtr = DataProcessingPtr(new DataProcessing(dataProcessingRef));
 
                 // note: placeholder
                 string sourceFileRef;
-                decode_xml_id(getAttribute(attributes, "sourceFileRef", sourceFileRef));
+                decode_xml_id(getAttribute(attributes, Symbol_sourceFileRef, sourceFileRef));
                 if (!sourceFileRef.empty())
                     spectrum->sourceFilePtr = SourceFilePtr(new SourceFile(sourceFileRef));
 
                 return Status::Ok;
             }
-            else if (version == 1 && name == "acquisitionList" /* mzML 1.0 */ || name == "scanList")
+            else if (version == 1 && elementId == Symbol_acquisitionList /* mzML 1.0 */ || elementId == Symbol_scanList)
             {
                 handlerScanList_.scanList = &spectrum->scanList;
                 handlerScanList_.version = version;
                 return Status(Status::Delegate, &handlerScanList_);
             }
-            else if (name == "precursorList" || name == "productList")
+            else if (elementId == Symbol_precursorList || elementId == Symbol_productList)
             {
                 return Status::Ok;
             }
-            else if (name == "precursor")
+            else if (elementId == Symbol_precursor)
             {
                 spectrum->precursors.push_back(Precursor());
                 handlerPrecursor_.precursor = &spectrum->precursors.back();
                 handlerPrecursor_.version = version;
                 return Status(Status::Delegate, &handlerPrecursor_);
             }
-            else if (name == "product")
+            else if (elementId == Symbol_product)
             {
                 spectrum->products.push_back(Product());
                 handlerProduct_.product = &spectrum->products.back();
                 return Status(Status::Delegate, &handlerProduct_);
             }
-            else if (name == "binaryDataArray")
+            else if (elementId == Symbol_binaryDataArray)
             {
                 if (binaryDataFlag == IgnoreBinaryData)
                     return Status::Done;
@@ -2050,7 +2320,7 @@ struct HandlerSpectrum : public HandlerParamContainer
                 handlerBinaryDataArray_.msd = msd;
                 return Status(Status::Delegate, &handlerBinaryDataArray_);
             }
-            else if (name == "binaryDataArrayList")
+            else if (elementId == Symbol_binaryDataArrayList)
             {
                 // pretty likely to come right back here and read the
                 // binary data once the header info has been inspected, 
@@ -2060,12 +2330,12 @@ struct HandlerSpectrum : public HandlerParamContainer
                 }
                 return Status::Ok;
             }
-            else if (version == 1 && name == "spectrumDescription") // mzML 1.0
+            else if (version == 1 && elementId == Symbol_spectrumDescription) // mzML 1.0
             {
                 // read cvParams, userParams, and referenceableParamGroups in <spectrumDescription> into <spectrum>
                 return Status::Ok;
             }
-            else if (version == 1 && name == "scan") // mzML 1.0
+            else if (version == 1 && elementId == Symbol_scan) // mzML 1.0
             {
                 spectrum->scanList.scans.push_back(Scan());
                 handlerScan_.version = version;
@@ -2074,7 +2344,7 @@ struct HandlerSpectrum : public HandlerParamContainer
             }
         }  // end if name != cvParam
         HandlerParamContainer::paramContainer = spectrum;
-        return HandlerParamContainer::startElement(name, attributes, position);
+        return HandlerParamContainer::startElementById(elementId, name, attributes, position);
     }
 
     private:
@@ -2108,7 +2378,7 @@ PWIZ_API_DECL
 void write(minimxml::XMLWriter& writer, const Chromatogram& chromatogram, 
            const BinaryDataEncoder::Config& config)
 {
-    XMLWriter::Attributes attributes;
+    XMLWriter::AttributeBuilder& attributes = writer.attributeBuilder();
     attributes.add("index", chromatogram.index);
     attributes.add("id", chromatogram.id); // not an XML:ID
     attributes.add("defaultArrayLength", chromatogram.defaultArrayLength);
@@ -2153,40 +2423,41 @@ struct HandlerChromatogram : public HandlerParamContainer
         chromatogram(_chromatogram)
     {}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!chromatogram)
             throw runtime_error("[IO::HandlerChromatogram] Null chromatogram.");
 
-        if (name == "chromatogram")
+        if (elementId == Symbol_chromatogram)
         {
             chromatogram->sourceFilePosition = position;
 
-            getAttribute(attributes, "id", chromatogram->id); // not an XML:ID
-            getAttribute(attributes, "index", chromatogram->index);
-            getAttribute(attributes, "defaultArrayLength", chromatogram->defaultArrayLength);
+            getAttribute(attributes, Symbol_id, chromatogram->id); // not an XML:ID
+            getAttribute(attributes, Symbol_index, chromatogram->index);
+            getAttribute(attributes, Symbol_defaultArrayLength, chromatogram->defaultArrayLength);
 
             // note: placeholder
             string dataProcessingRef;
-            decode_xml_id(getAttribute(attributes, "dataProcessingRef", dataProcessingRef));
+            decode_xml_id(getAttribute(attributes, Symbol_dataProcessingRef, dataProcessingRef));
             if (!dataProcessingRef.empty())
                 chromatogram->dataProcessingPtr = DataProcessingPtr(new DataProcessing(dataProcessingRef));
 
             return Status::Ok;
         }
-        else if (name == "precursor")
+        else if (elementId == Symbol_precursor)
         {
             handlerPrecursor_.precursor = &chromatogram->precursor;
             return Status(Status::Delegate, &handlerPrecursor_);
         }
-        else if (name == "product")
+        else if (elementId == Symbol_product)
         {
             handlerProduct_.product = &chromatogram->product;
             return Status(Status::Delegate, &handlerProduct_);
         }
-        else if (name == "binaryDataArray")
+        else if (elementId == Symbol_binaryDataArray)
         {
             if (binaryDataFlag == IgnoreBinaryData)
                 return Status::Done;
@@ -2196,13 +2467,13 @@ struct HandlerChromatogram : public HandlerParamContainer
             handlerBinaryDataArray_.defaultArrayLength = chromatogram->defaultArrayLength;
             return Status(Status::Delegate, &handlerBinaryDataArray_);
         }
-        else if (name == "binaryDataArrayList")
+        else if (elementId == Symbol_binaryDataArrayList)
         {
             return Status::Ok;
         }
 
         HandlerParamContainer::paramContainer = chromatogram;
-        return HandlerParamContainer::startElement(name, attributes, position);
+        return HandlerParamContainer::startElementById(elementId, name, attributes, position);
     }
 
     private:
@@ -2230,7 +2501,8 @@ PWIZ_API_DECL
 void write(minimxml::XMLWriter& writer, const SpectrumList& spectrumList, const MSData& msd,
            const BinaryDataEncoder::Config& config,
            vector<boost::iostreams::stream_offset>* spectrumPositions,
-           const IterationListenerRegistry* iterationListenerRegistry)
+           const IterationListenerRegistry* iterationListenerRegistry,
+           size_t maxThreadCount)
 {
     XMLWriter::Attributes attributes;
     attributes.add("count", spectrumList.size());
@@ -2240,7 +2512,7 @@ void write(minimxml::XMLWriter& writer, const SpectrumList& spectrumList, const
                                         spectrumList.dataProcessingPtr()->id));
 
     writer.startElement("spectrumList", attributes);
-    SpectrumWorkerThreads spectrumWorkers(spectrumList);
+    SpectrumWorkerThreads spectrumWorkers(spectrumList, maxThreadCount);
 
     for (size_t i=0; i<spectrumList.size(); i++)
     {
@@ -2283,24 +2555,25 @@ struct HandlerSpectrumListSimple : public HandlerParamContainer
         handlerSpectrum_(ReadBinaryData)
     {}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!spectrumListSimple)
             throw runtime_error("[IO::HandlerSpectrumListSimple] Null spectrumListSimple.");
 
-        if (name == "spectrumList")
+        if (elementId == Symbol_spectrumList)
         {
             // note: placeholder
             string defaultDataProcessingRef;
-            decode_xml_id(getAttribute(attributes, "defaultDataProcessingRef", defaultDataProcessingRef));
+            decode_xml_id(getAttribute(attributes, Symbol_defaultDataProcessingRef, defaultDataProcessingRef));
             if (!defaultDataProcessingRef.empty())
                 spectrumListSimple->dp = DataProcessingPtr(new DataProcessing(defaultDataProcessingRef));
 
             return Status::Ok;
         }
-        else if (name == "spectrum")
+        else if (elementId == Symbol_spectrum)
         {
             spectrumListSimple->spectra.push_back(SpectrumPtr(new Spectrum));
             handlerSpectrum_.version = version;
@@ -2308,7 +2581,7 @@ struct HandlerSpectrumListSimple : public HandlerParamContainer
             return Status(Status::Delegate, &handlerSpectrum_);
         }
 
-        throw runtime_error(("[IO::HandlerSpectrumListSimple] Unexpected element name: " + name).c_str());
+        throw runtime_error(("[IO::HandlerSpectrumListSimple] Unexpected element name: " + string(name)).c_str());
     }
 
     private:
@@ -2381,31 +2654,32 @@ struct HandlerChromatogramListSimple : public HandlerParamContainer
         handlerChromatogram_(ReadBinaryData)
     {}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!chromatogramListSimple)
             throw runtime_error("[IO::HandlerChromatogramListSimple] Null chromatogramListSimple.");
 
-        if (name == "chromatogramList")
+        if (elementId == Symbol_chromatogramList)
         {
             // note: placeholder
             string defaultDataProcessingRef;
-            decode_xml_id(getAttribute(attributes, "defaultDataProcessingRef", defaultDataProcessingRef));
+            decode_xml_id(getAttribute(attributes, Symbol_defaultDataProcessingRef, defaultDataProcessingRef));
             if (!defaultDataProcessingRef.empty())
                 chromatogramListSimple->dp = DataProcessingPtr(new DataProcessing(defaultDataProcessingRef));
 
             return Status::Ok;
         }
-        else if (name == "chromatogram")
+        else if (elementId == Symbol_chromatogram)
         {
             chromatogramListSimple->chromatograms.push_back(ChromatogramPtr(new Chromatogram));
             handlerChromatogram_.chromatogram = chromatogramListSimple->chromatograms.back().get();
             return Status(Status::Delegate, &handlerChromatogram_);
         }
 
-        throw runtime_error(("[IO::HandlerChromatogramListSimple] Unexpected element name: " + name).c_str());
+        throw runtime_error(("[IO::HandlerChromatogramListSimple] Unexpected element name: " + string(name)).c_str());
     }
 
     private:
@@ -2430,7 +2704,8 @@ void write(minimxml::XMLWriter& writer, const Run& run, const MSData& msd,
            const BinaryDataEncoder::Config& config,
            vector<boost::iostreams::stream_offset>* spectrumPositions,
            vector<boost::iostreams::stream_offset>* chromatogramPositions,
-           const pwiz::util::IterationListenerRegistry* iterationListenerRegistry)
+           const pwiz::util::IterationListenerRegistry* iterationListenerRegistry,
+           size_t maxThreadCount)
 {
     XMLWriter::Attributes attributes;
     attributes.add("id", encode_xml_id_copy(run.id));
@@ -2460,7 +2735,7 @@ void write(minimxml::XMLWriter& writer, const Run& run, const MSData& msd,
     bool hasChromatogramList = run.chromatogramListPtr.get() && run.chromatogramListPtr->size() > 0;
 
     if (hasSpectrumList)
-        write(writer, *run.spectrumListPtr, msd, config, spectrumPositions, iterationListenerRegistry);
+        write(writer, *run.spectrumListPtr, msd, config, spectrumPositions, iterationListenerRegistry, maxThreadCount);
 
     if (hasChromatogramList)
         write(writer, *run.chromatogramListPtr, config, chromatogramPositions, iterationListenerRegistry);
@@ -2478,39 +2753,40 @@ struct HandlerRun : public HandlerParamContainer
     :   spectrumListFlag(_spectrumListFlag), run(_run)
     {}
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!run)
             throw runtime_error("[IO::HandlerRun] Null run.");
 
-        if (name == "run")
+        if (elementId == Symbol_run)
         {
-            decode_xml_id(getAttribute(attributes, "id", run->id));
-            getAttribute(attributes, "startTimeStamp", run->startTimeStamp);
+            decode_xml_id(getAttribute(attributes, Symbol_id, run->id));
+            getAttribute(attributes, Symbol_startTimeStamp, run->startTimeStamp);
 
             // note: placeholder
             string defaultInstrumentConfigurationRef;
-            decode_xml_id(getAttribute(attributes, "defaultInstrumentConfigurationRef", defaultInstrumentConfigurationRef));
+            decode_xml_id(getAttribute(attributes, Symbol_defaultInstrumentConfigurationRef, defaultInstrumentConfigurationRef));
             if (!defaultInstrumentConfigurationRef.empty())
                 run->defaultInstrumentConfigurationPtr = InstrumentConfigurationPtr(new InstrumentConfiguration(defaultInstrumentConfigurationRef));
 
             // note: placeholder
             string sampleRef;
-            decode_xml_id(getAttribute(attributes, "sampleRef", sampleRef));
+            decode_xml_id(getAttribute(attributes, Symbol_sampleRef, sampleRef));
             if (!sampleRef.empty())
                 run->samplePtr = SamplePtr(new Sample(sampleRef));
 
             // note: placeholder
             string defaultSourceFileRef;
-            decode_xml_id(getAttribute(attributes, "defaultSourceFileRef", defaultSourceFileRef));
+            decode_xml_id(getAttribute(attributes, Symbol_defaultSourceFileRef, defaultSourceFileRef));
             if (!defaultSourceFileRef.empty())
                 run->defaultSourceFilePtr = SourceFilePtr(new SourceFile(defaultSourceFileRef));
 
             return Status::Ok;
         }
-        else if (name == "spectrumList")
+        else if (elementId == Symbol_spectrumList)
         {
             if (spectrumListFlag == IgnoreSpectrumList)
                 return Status::Done;
@@ -2520,29 +2796,29 @@ struct HandlerRun : public HandlerParamContainer
             run->spectrumListPtr = temp;
             return Status(Status::Delegate, &handlerSpectrumListSimple_);
         }
-        else if (name == "chromatogramList")
+        else if (elementId == Symbol_chromatogramList)
         {
             shared_ptr<ChromatogramListSimple> temp(new ChromatogramListSimple);
             handlerChromatogramListSimple_.chromatogramListSimple = temp.get();
             run->chromatogramListPtr = temp;
             return Status(Status::Delegate, &handlerChromatogramListSimple_);
         }
-        else if (version == 1 && name == "sourceFileRefList")
+        else if (version == 1 && elementId == Symbol_sourceFileRefList)
         {
             return Status::Ok;
         }
-        else if (version == 1 && name == "sourceFileRef")
+        else if (version == 1 && elementId == Symbol_sourceFileRef)
         {
             // note: placeholder
             string sourceFileRef;
-            decode_xml_id(getAttribute(attributes, "ref", sourceFileRef));
+            decode_xml_id(getAttribute(attributes, Symbol_ref, sourceFileRef));
             if (!sourceFileRef.empty())
                 run->defaultSourceFilePtr = SourceFilePtr(new SourceFile(sourceFileRef));
             return Status::Ok;
         }
 
         HandlerParamContainer::paramContainer = run;
-        return HandlerParamContainer::startElement(name, attributes, position);
+        return HandlerParamContainer::startElementById(elementId, name, attributes, position);
     }
 
     private:
@@ -2586,7 +2862,8 @@ void write(minimxml::XMLWriter& writer, const MSData& msd,
            const BinaryDataEncoder::Config& config,
            vector<boost::iostreams::stream_offset>* spectrumPositions,
            vector<boost::iostreams::stream_offset>* chromatogramPositions,
-           const pwiz::util::IterationListenerRegistry* iterationListenerRegistry)
+           const pwiz::util::IterationListenerRegistry* iterationListenerRegistry,
+           size_t maxThreadCount)
 {
     XMLWriter::Attributes attributes;
     attributes.add("xmlns", "http://psi.hupo.org/ms/mzml");
@@ -2629,7 +2906,7 @@ void write(minimxml::XMLWriter& writer, const MSData& msd,
 
     writeList(writer, msd.allDataProcessingPtrs(), "dataProcessingList");
 
-    write(writer, msd.run, msd, config, spectrumPositions, chromatogramPositions, iterationListenerRegistry);
+    write(writer, msd.run, msd, config, spectrumPositions, chromatogramPositions, iterationListenerRegistry, maxThreadCount);
 
     writer.endElement();
 }
@@ -2641,25 +2918,28 @@ struct HandlerMSData : public SAXParser::Handler
 
     HandlerMSData(SpectrumListFlag spectrumListFlag, MSData* _msd = 0) 
     :  msd(_msd), handlerRun_(spectrumListFlag) 
-    {}
+    {
+        symbols = &mzMLSymbols_;
+    }
 
-    virtual Status startElement(const string& name, 
-                                const Attributes& attributes,
-                                stream_offset position)
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position)
     {
         if (!msd)
             throw runtime_error("[IO::HandlerMSData] Null msd."); 
 
-        if (name == "mzML")
+        if (elementId == Symbol_mzML)
         {
-            getAttribute(attributes, "accession", msd->accession);
-            getAttribute(attributes, "id", msd->id); // not an XML:ID
+            getAttribute(attributes, Symbol_accession, msd->accession);
+            getAttribute(attributes, Symbol_id, msd->id); // not an XML:ID
 
             // "http://psi.hupo.org/ms/mzml http://psidev.info/files/ms/mzML/xsd/mzML<version>.xsd"
             string schemaLocation;
-            getAttribute(attributes, "xsi:schemaLocation", schemaLocation);
+            getAttribute(attributes, Symbol_xsi_schemaLocation, schemaLocation);
             if (schemaLocation.empty())
-                getAttribute(attributes, "version", msd->version_); // deprecated?
+                getAttribute(attributes, Symbol_version, msd->version_); // deprecated?
             else
             {
                 schemaLocation = schemaLocation.substr(schemaLocation.find(' ')+1);
@@ -2672,77 +2952,77 @@ struct HandlerMSData : public SAXParser::Handler
 
             return Status::Ok;
         }
-        else if (name == "cvList" || 
-                 name == "referenceableParamGroupList" ||
-                 name == "sampleList" || 
-                 name == "instrumentConfigurationList" || 
-                 name == "softwareList" ||
-                 name == "dataProcessingList" ||
-                 (version == 1 && name == "acquisitionSettingsList") /* mzML 1.0 */ ||
-                 name == "scanSettingsList")
+        else if (elementId == Symbol_cvList || 
+                 elementId == Symbol_referenceableParamGroupList ||
+                 elementId == Symbol_sampleList || 
+                 elementId == Symbol_instrumentConfigurationList || 
+                 elementId == Symbol_softwareList ||
+                 elementId == Symbol_dataProcessingList ||
+                 (version == 1 && elementId == Symbol_acquisitionSettingsList) /* mzML 1.0 */ ||
+                 elementId == Symbol_scanSettingsList)
         {
             // ignore these, unless we want to validate the count attribute
             return Status::Ok;
         }
-        else if (name == "cv")
+        else if (elementId == Symbol_cv)
         {
             msd->cvs.push_back(CV());
             handlerCV_.cv = &msd->cvs.back();
             return Status(Status::Delegate, &handlerCV_);
         }
-        else if (name == "fileDescription")
+        else if (elementId == Symbol_fileDescription)
         {
             handlerFileDescription_.fileDescription = &msd->fileDescription;
             return Status(Status::Delegate, &handlerFileDescription_);
         }
-        else if (name == "referenceableParamGroup")
+        else if (elementId == Symbol_referenceableParamGroup)
         {
             msd->paramGroupPtrs.push_back(ParamGroupPtr(new ParamGroup));
             handlerParamGroup_.paramGroup = msd->paramGroupPtrs.back().get();
             return Status(Status::Delegate, &handlerParamGroup_);
         }
-        else if (name == "sample")
+        else if (elementId == Symbol_sample)
         {
             msd->samplePtrs.push_back(SamplePtr(new Sample));
             handlerSample_.sample = msd->samplePtrs.back().get();
             return Status(Status::Delegate, &handlerSample_);
         }
-        else if (name == "instrumentConfiguration")
+        else if (elementId == Symbol_instrumentConfiguration)
         {
             msd->instrumentConfigurationPtrs.push_back(InstrumentConfigurationPtr(new InstrumentConfiguration));
             handlerInstrumentConfiguration_.instrumentConfiguration = msd->instrumentConfigurationPtrs.back().get();
             return Status(Status::Delegate, &handlerInstrumentConfiguration_);
         }        
-        else if (name == "software")
+        else if (elementId == Symbol_software)
         {
             msd->softwarePtrs.push_back(SoftwarePtr(new Software));
             handlerSoftware_.version = version;
             handlerSoftware_.software = msd->softwarePtrs.back().get();
             return Status(Status::Delegate, &handlerSoftware_);
         }        
-        else if (name == "dataProcessing")
+        else if (elementId == Symbol_dataProcessing)
         {
             msd->dataProcessingPtrs.push_back(DataProcessingPtr(new DataProcessing));
             handlerDataProcessing_.version = version;
             handlerDataProcessing_.dataProcessing = msd->dataProcessingPtrs.back().get();
             return Status(Status::Delegate, &handlerDataProcessing_);
         }
-        else if (version == 1 && name == "acquisitionSettings" /* mzML 1.0 */ ||
-                 name == "scanSettings")
+        else if (version == 1 && elementId == Symbol_acquisitionSettings /* mzML 1.0 */ ||
+                 elementId == Symbol_scanSettings)
         {
             msd->scanSettingsPtrs.push_back(ScanSettingsPtr(new ScanSettings));
             handlerScanSettings_.version = version;
             handlerScanSettings_.scanSettings = msd->scanSettingsPtrs.back().get();
             return Status(Status::Delegate, &handlerScanSettings_);
         }
-        else if (name == "run")
+        else if (elementId == Symbol_run)
         {
             handlerRun_.version = version;
             handlerRun_.run = &msd->run;
             return Status(Status::Delegate, &handlerRun_);
         }
 
-        throw runtime_error(("[IO::HandlerMSData] Unexpected element name: " + name).c_str());
+        throw runtime_error(("[IO::HandlerMSData] Unexpected element name: " + string(name)).c_str());
     }
 
     private:
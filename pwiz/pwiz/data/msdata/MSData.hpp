@@ -631,6 +631,11 @@ enum DetailLevel
     DetailLevel_FullData
 };
 
+
+struct SpectrumListMetadata;
+struct SpectrumListMetadataCache;
+
+
 /// 
 /// Interface for accessing spectra, which may be stored in memory
 /// or backed by a data file (RAW, mzXML, mzML).  
@@ -700,7 +705,17 @@ class PWIZ_API_DECL SpectrumList
     /// issues a warning once per SpectrumList instance (based on string hash)
     virtual void warn_once(const char* msg) const; 
 
+    SpectrumList() {}
+
+    /// a copy builds its own SpectrumListMetadata
+    SpectrumList(const SpectrumList&) {}
+    SpectrumList& operator=(const SpectrumList&) {return *this;}
+
     virtual ~SpectrumList(){} 
+
+    private:
+    friend struct SpectrumListMetadata;
+    mutable boost::shared_ptr<SpectrumListMetadataCache> metadataCache_; // see SpectrumListMetadata::get()
 };
 
 
@@ -29,6 +29,7 @@
 #include "Serializer_mzXML.hpp"
 #include "Serializer_MGF.hpp"
 #include "Serializer_MSn.hpp"
+#include "Serializer_mzBin.hpp"
 #ifndef WITHOUT_MZ5
 #include "Serializer_mz5.hpp"
 #endif
@@ -40,6 +41,8 @@
 #include "boost/iostreams/device/file.hpp"
 #include "boost/iostreams/filtering_stream.hpp" 
 #include "boost/iostreams/filter/gzip.hpp" 
+#include <boost/thread.hpp>
+#include <boost/exception_ptr.hpp>
 
 
 namespace pwiz {
@@ -71,6 +74,102 @@ void calculateSourceFilePtrSHA1(const SourceFilePtr& sourceFilePtr)
 }
 
 
+// sets the path of the file a source file element refers to; returns false if
+// it has no local file URI or the file does not exist
+bool getSourceFilePath(const SourceFile& sourceFile, bfs::path& p)
+{
+    const string uriPrefix = "file://";
+    if (!bal::istarts_with(sourceFile.location, uriPrefix)) return false;
+    string location = sourceFile.location.substr(uriPrefix.size());
+    bal::trim_if(location, bal::is_any_of("/"));
+    p = location;
+    p /= sourceFile.name;
+
+    try
+    {
+        if (!bfs::exists(p))
+            // TODO: log warning about source file not available
+            return false;
+    }
+    catch (exception&)
+    {
+        // TODO: log warning about filesystem error
+        return false;
+    }
+    return true;
+}
+
+
+struct SHA1CacheKey
+{
+    string path;
+    boost::uintmax_t size;
+    time_t lastWriteTime;
+
+    bool operator< (const SHA1CacheKey& rhs) const
+    {
+        if (path != rhs.path) return path < rhs.path;
+        if (size != rhs.size) return size < rhs.size;
+        return lastWriteTime < rhs.lastWriteTime;
+    }
+};
+
+// an empty checksum means the file is being hashed by another thread
+map<SHA1CacheKey, string> sha1Cache_;
+boost::mutex sha1CacheMutex_;
+boost::condition_variable sha1CacheCondition_;
+
+
+// returns the SHA-1 of the file, from the cache if the file has not changed since it was last hashed;
+// if another thread is already hashing the file, waits for its result instead of reading the file again
+string hashFileCached(const bfs::path& p)
+{
+    SHA1CacheKey key;
+    try
+    {
+        key.path = bfs::system_complete(p).string();
+        key.size = bfs::file_size(p);
+        key.lastWriteTime = bfs::last_write_time(p);
+    }
+    catch (exception&)
+    {
+        // e.g. a directory: let hashFile() report the problem
+        return SHA1Calculator::hashFile(p.string());
+    }
+
+    {
+        boost::unique_lock<boost::mutex> lock(sha1CacheMutex_);
+        map<SHA1CacheKey, string>::iterator itr = sha1Cache_.find(key);
+        while (itr != sha1Cache_.end() && itr->second.empty())
+        {
+            sha1CacheCondition_.wait(lock);
+            itr = sha1Cache_.find(key);
+        }
+        if (itr != sha1Cache_.end())
+            return itr->second;
+        sha1Cache_[key] = ""; // claim the file
+    }
+
+    string sha1;
+    try
+    {
+        sha1 = SHA1Calculator::hashFile(p.string());
+    }
+    catch (...)
+    {
+        boost::lock_guard<boost::mutex> lock(sha1CacheMutex_);
+        sha1Cache_.erase(key);
+        sha1CacheCondition_.notify_all();
+        throw;
+    }
+
+    boost::lock_guard<boost::mutex> lock(sha1CacheMutex_);
+    sha1Cache_[key] = sha1;
+    sha1CacheCondition_.notify_all();
+    return sha1;
+}
+
+
 } // namespace
 
 
@@ -159,6 +258,7 @@ void writeStream(ostream& os, const MSData& msd, const MSDataFile::WriteConfig&
             Serializer_mzML::Config serializerConfig;
             serializerConfig.binaryDataEncoderConfig = config.binaryDataEncoderConfig;
             serializerConfig.indexed = config.indexed;
+            serializerConfig.maxThreadCount = config.maxThreadCount;
             Serializer_mzML serializer(serializerConfig);
             serializer.write(os, msd, iterationListenerRegistry);
             break;
@@ -168,42 +268,52 @@ void writeStream(ostream& os, const MSData& msd, const MSDataFile::WriteConfig&
             Serializer_mzXML::Config serializerConfig;
             serializerConfig.binaryDataEncoderConfig = config.binaryDataEncoderConfig;
             serializerConfig.indexed = config.indexed;
+            serializerConfig.maxThreadCount = config.maxThreadCount;
             Serializer_mzXML serializer(serializerConfig);
             serializer.write(os, msd, iterationListenerRegistry);
             break;
         }
         case MSDataFile::Format_MGF:
         {
-            Serializer_MGF serializer;
+            Serializer_MGF serializer(config.maxThreadCount);
             serializer.write(os, msd, iterationListenerRegistry);
             break;
         }
         case MSDataFile::Format_MS1:
         {
-            Serializer_MSn serializer(MSn_Type_MS1);
+            Serializer_MSn serializer(MSn_Type_MS1, config.maxThreadCount);
             serializer.write(os, msd, iterationListenerRegistry);
             break;
         }
         case MSDataFile::Format_CMS1:
         {
-            Serializer_MSn serializer(MSn_Type_CMS1);
+            Serializer_MSn serializer(MSn_Type_CMS1, config.maxThreadCount);
             serializer.write(os, msd, iterationListenerRegistry);
             break;
         }
         case MSDataFile::Format_MS2:
         {
-            Serializer_MSn serializer(MSn_Type_MS2);
+            Serializer_MSn serializer(MSn_Type_MS2, config.maxThreadCount);
             serializer.write(os, msd, iterationListenerRegistry);
             break;
         }
         case MSDataFile::Format_CMS2:
         {
-            Serializer_MSn serializer(MSn_Type_CMS2);
+            Serializer_MSn serializer(MSn_Type_CMS2, config.maxThreadCount);
             serializer.write(os, msd, iterationListenerRegistry);
             break;
         }
         case MSDataFile::Format_MZ5:
             throw runtime_error("[MSDataFile::write()] mz5 does not support writing with an output stream.");
+        case MSDataFile::Format_mzBin:
+        {
+            Serializer_mzBin::Config serializerConfig;
+            serializerConfig.binaryDataEncoderConfig = config.binaryDataEncoderConfig;
+            serializerConfig.maxThreadCount = config.maxThreadCount;
+            Serializer_mzBin serializer(serializerConfig);
+            serializer.write(os, msd, iterationListenerRegistry);
+            break;
+        }
         default:
             throw runtime_error("[MSDataFile::write()] Format not implemented.");
     }
@@ -231,6 +341,18 @@ void MSDataFile::write(const MSData& msd,
 #endif
             break;
         }
+        case MSDataFile::Format_mzBin:
+        {
+            // mzBin is read through a memory map, so it is not gzipped as a whole
+            if (config.gzipped)
+                throw runtime_error("[MSDataFile::write()] mzBin does not support gzipped output; its chunks are compressed already.");
+            Serializer_mzBin::Config serializerConfig;
+            serializerConfig.binaryDataEncoderConfig = config.binaryDataEncoderConfig;
+            serializerConfig.maxThreadCount = config.maxThreadCount;
+            Serializer_mzBin serializer(serializerConfig);
+            serializer.write(filename, msd, iterationListenerRegistry);
+            break;
+        }
         default:
         {
             shared_ptr<ostream> os = openFile(filename,config.gzipped);
@@ -256,26 +378,10 @@ PWIZ_API_DECL void calculateSourceFileSHA1(SourceFile& sourceFile)
 {
     if (sourceFile.hasCVParam(MS_SHA_1)) return;
 
-    const string uriPrefix = "file://";
-    if (!bal::istarts_with(sourceFile.location, uriPrefix)) return;
-    string location = sourceFile.location.substr(uriPrefix.size());
-    bal::trim_if(location, bal::is_any_of("/"));
-    bfs::path p(location);
-    p /= sourceFile.name;
+    bfs::path p;
+    if (!getSourceFilePath(sourceFile, p)) return;
 
-    try
-    {
-        if (!bfs::exists(p))
-            // TODO: log warning about source file not available
-            return;
-    }
-    catch (exception&)
-    {
-        // TODO: log warning about filesystem error
-        return;
-    }
-
-    string sha1 = SHA1Calculator::hashFile(p.string());
+    string sha1 = hashFileCached(p);
     sourceFile.set(MS_SHA_1, sha1); 
 }
 
@@ -289,6 +395,87 @@ void calculateSHA1Checksums(const MSData& msd)
 }
 
 
+class SHA1ChecksumCalculation::Impl
+{
+    public:
+    Impl(const MSData& msd) : joined_(false)
+    {
+        for (size_t i=0; i < msd.fileDescription.sourceFilePtrs.size(); ++i)
+        {
+            const SourceFilePtr& sourceFilePtr = msd.fileDescription.sourceFilePtrs[i];
+            bfs::path p;
+            if (!sourceFilePtr.get() || sourceFilePtr->hasCVParam(MS_SHA_1) || !getSourceFilePath(*sourceFilePtr, p))
+                continue;
+            sourceFilePtrs_.push_back(sourceFilePtr);
+            paths_.push_back(p);
+        }
+        checksums_.resize(paths_.size());
+
+        if (!paths_.empty())
+            thread_ = boost::thread(&Impl::calculate, this);
+    }
+
+    ~Impl()
+    {
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+    void join()
+    {
+        if (joined_) return;
+        joined_ = true;
+
+        if (thread_.joinable())
+            thread_.join();
+        if (error_)
+            boost::rethrow_exception(error_);
+
+        for (size_t i=0; i < sourceFilePtrs_.size(); ++i)
+            if (!sourceFilePtrs_[i]->hasCVParam(MS_SHA_1))
+                sourceFilePtrs_[i]->set(MS_SHA_1, checksums_[i]);
+    }
+
+    private:
+    void calculate()
+    {
+        try
+        {
+            for (size_t i=0; i < paths_.size(); ++i)
+                checksums_[i] = hashFileCached(paths_[i]);
+        }
+        catch (...)
+        {
+            error_ = boost::current_exception();
+        }
+    }
+
+    vector<SourceFilePtr> sourceFilePtrs_;
+    vector<bfs::path> paths_;
+    vector<string> checksums_;
+    boost::thread thread_;
+    boost::exception_ptr error_;
+    bool joined_;
+};
+
+
+PWIZ_API_DECL SHA1ChecksumCalculation::SHA1ChecksumCalculation(const MSData& msd)
+:   impl_(new Impl(msd))
+{
+}
+
+
+PWIZ_API_DECL SHA1ChecksumCalculation::~SHA1ChecksumCalculation()
+{
+}
+
+
+PWIZ_API_DECL void SHA1ChecksumCalculation::join()
+{
+    impl_->join();
+}
+
+
 PWIZ_API_DECL ostream& operator<<(ostream& os, MSDataFile::Format format)
 {
     switch (format)
@@ -320,6 +507,9 @@ PWIZ_API_DECL ostream& operator<<(ostream& os, MSDataFile::Format format)
         case MSDataFile::Format_MZ5:
             os << "mz5";
             return os;
+        case MSDataFile::Format_mzBin:
+            os << "mzBin";
+            return os;
         default:
             os << "Unknown";
             return os;
@@ -334,7 +524,8 @@ PWIZ_API_DECL ostream& operator<<(ostream& os, const MSDataFile::WriteConfig& co
         config.format == MSDataFile::Format_mzXML)
         os << " " << config.binaryDataEncoderConfig
            << " indexed=\"" << boolalpha << config.indexed << "\"";
-    else if (config.format == MSDataFile::Format_MZ5)
+    else if (config.format == MSDataFile::Format_MZ5 ||
+             config.format == MSDataFile::Format_mzBin)
         os << " " << config.binaryDataEncoderConfig;
     return os;
 }
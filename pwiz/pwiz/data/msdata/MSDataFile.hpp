@@ -30,6 +30,7 @@
 #include "Reader.hpp"
 #include "BinaryDataEncoder.hpp"
 #include "pwiz/utility/misc/IterationListener.hpp"
+#include <boost/shared_ptr.hpp>
 
 
 namespace pwiz {
@@ -46,7 +47,7 @@ struct PWIZ_API_DECL MSDataFile : public MSData
                bool calculateSourceFileChecksum = false);
 
     /// data format for write()
-    enum PWIZ_API_DECL Format {Format_Text, Format_mzML, Format_mzXML, Format_MGF, Format_MS1, Format_CMS1, Format_MS2, Format_CMS2, Format_MZ5};
+    enum PWIZ_API_DECL Format {Format_Text, Format_mzML, Format_mzXML, Format_MGF, Format_MS1, Format_CMS1, Format_MS2, Format_CMS2, Format_MZ5, Format_mzBin};
 
     /// configuration for write()
     struct PWIZ_API_DECL WriteConfig
@@ -55,9 +56,10 @@ struct PWIZ_API_DECL MSDataFile : public MSData
         BinaryDataEncoder::Config binaryDataEncoderConfig;
         bool indexed;
 		bool gzipped; // if true, file is written as .gz
+        size_t maxThreadCount; // threads reading spectra ahead while writing; 0 starts one per processor core
 
         WriteConfig(Format _format = Format_mzML,bool _gzipped = false)
-        :   format(_format), indexed(true), gzipped(_gzipped)
+        :   format(_format), indexed(true), gzipped(_gzipped), maxThreadCount(0)
         {}
     };
 
@@ -93,6 +95,29 @@ PWIZ_API_DECL void calculateSourceFileSHA1(SourceFile& sourceFile);
 /// Iterate and calculate SHA-1 for all source files
 PWIZ_API_DECL void calculateSHA1Checksums(const MSData& msd);
 
+/// calculates SHA-1 for all source files of an MSData on a background thread, so that reading
+/// the source files overlaps other work; join() waits for the calculation and adds the CV terms
+/// like calculateSHA1Checksums() does (it must be called before the MSData is written);
+/// checksums are cached by file path, size, and modification time, so a source file shared
+/// by several runs (or converted again by the same process) is only read once
+class PWIZ_API_DECL SHA1ChecksumCalculation
+{
+    public:
+    SHA1ChecksumCalculation(const MSData& msd);
+
+    /// waits for the calculation to finish without adding the CV terms
+    ~SHA1ChecksumCalculation();
+
+    /// waits for the calculation to finish and adds the CV terms; rethrows any error from reading a source file
+    void join();
+
+    private:
+    class Impl;
+    boost::shared_ptr<Impl> impl_;
+    SHA1ChecksumCalculation(SHA1ChecksumCalculation&);
+    SHA1ChecksumCalculation& operator=(SHA1ChecksumCalculation&);
+};
+
 PWIZ_API_DECL std::ostream& operator<<(std::ostream& os, MSDataFile::Format format);
 PWIZ_API_DECL std::ostream& operator<<(std::ostream& os, const MSDataFile::WriteConfig& config);
 
@@ -383,6 +383,14 @@ void testSHA1()
 
         unit_assert(!msd_sha1.fileDescription.sourceFilePtrs.empty());
         unit_assert(msd_sha1.fileDescription.sourceFilePtrs.back()->hasCVParam(MS_SHA_1));
+
+        // calculate SHA-1 on a background thread
+
+        SHA1ChecksumCalculation sha1Calculation(msd);
+        unit_assert(!msd.fileDescription.sourceFilePtrs.back()->hasCVParam(MS_SHA_1));
+        sha1Calculation.join();
+        unit_assert_operator_equal(msd_sha1.fileDescription.sourceFilePtrs.back()->cvParam(MS_SHA_1).value,
+                                   msd.fileDescription.sourceFilePtrs.back()->cvParam(MS_SHA_1).value);
     }
 
     // clean up
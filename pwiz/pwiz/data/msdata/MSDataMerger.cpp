@@ -28,6 +28,8 @@
 #include "pwiz/utility/misc/DateTime.hpp"
 #include "Diff.hpp"
 #include "References.hpp"
+#include <boost/thread.hpp>
+#include <boost/exception_ptr.hpp>
 
 
 using boost::shared_ptr;
@@ -51,45 +53,107 @@ void mergeParamContainers(ParamContainer& target, const ParamContainer& source)
     }
 }
 
+// reads the scan start time of every spectrum in the list; a spectrum without one
+// gets the time of the spectrum before it so it stays with its neighbors
+void readScanStartTimes(const SpectrumList& sl, vector<double>& scanStartTimes, boost::exception_ptr& error)
+{
+    try
+    {
+        scanStartTimes.resize(sl.size());
+        double lastTime = 0;
+        for (size_t i=0; i < sl.size(); ++i)
+        {
+            SpectrumPtr s = sl.spectrum(i, false);
+            if (!s->scanList.scans.empty())
+            {
+                CVParam scanStartTime = s->scanList.scans[0].cvParam(MS_scan_start_time);
+                if (!scanStartTime.empty())
+                    lastTime = scanStartTime.timeInSeconds();
+            }
+            scanStartTimes[i] = lastTime;
+        }
+    }
+    catch (...)
+    {
+        error = boost::current_exception();
+    }
+}
+
 class SpectrumListMerger : public SpectrumList
 {
     struct IndexEntry : public SpectrumIdentity
     {
-        SpectrumListPtr spectrumListPtr;
-        SourceFilePtr sourceFilePtr;
+        size_t inputIndex;
         size_t originalIndex;
     };
 
+    // orders index entries by scan start time, then by input, then by original index
+    struct ScanStartTimeLessThan
+    {
+        ScanStartTimeLessThan(const vector<vector<double> >& scanStartTimes) : scanStartTimes_(scanStartTimes) {}
+
+        bool operator() (const IndexEntry& lhs, const IndexEntry& rhs) const
+        {
+            double lhsTime = scanStartTimes_[lhs.inputIndex][lhs.originalIndex];
+            double rhsTime = scanStartTimes_[rhs.inputIndex][rhs.originalIndex];
+            if (lhsTime != rhsTime)
+                return lhsTime < rhsTime;
+            if (lhs.inputIndex != rhs.inputIndex)
+                return lhs.inputIndex < rhs.inputIndex;
+            return lhs.originalIndex < rhs.originalIndex;
+        }
+
+        const vector<vector<double> >& scanStartTimes_;
+    };
+
     const MSData& msd_;
     vector<MSDataPtr> inputMSDataPtrs_;
     vector<IndexEntry> index_;
     map<string, IndexList> idToIndexes_;
 
     public:
-    SpectrumListMerger(const MSData& msd, const vector<MSDataPtr>& inputs)
+    SpectrumListMerger(const MSData& msd, const vector<MSDataPtr>& inputs, MSDataMerger::SpectrumOrder spectrumOrder)
     : msd_(msd), inputMSDataPtrs_(inputs)
     {
-        BOOST_FOREACH(const MSDataPtr& input, inputs)
-            for (size_t i=0; i < input->run.spectrumListPtr->size(); ++i)
+        // the index only needs the identities, which spectrum lists provide without reading spectra
+        for (size_t inputIndex=0; inputIndex < inputs.size(); ++inputIndex)
+        {
+            const SpectrumList& sl = *inputs[inputIndex]->run.spectrumListPtr;
+            for (size_t i=0; i < sl.size(); ++i)
             {
-                SpectrumPtr s = input->run.spectrumListPtr->spectrum(i);
-                Spectrum& oldIdentity = *s;
-
-                idToIndexes_[oldIdentity.id].push_back(index_.size());
-
                 IndexEntry ie;
-                ie.id = oldIdentity.id;
-                ie.index = index_.size();
+                static_cast<SpectrumIdentity&>(ie) = sl.spectrumIdentity(i);
+                ie.inputIndex = inputIndex;
                 ie.originalIndex = i;
-                ie.spectrumListPtr = input->run.spectrumListPtr;
-
-                // because of the high chance of duplicate ids, sourceFilePtrs are always explicit
-                SourceFilePtr oldSourceFilePtr = oldIdentity.sourceFilePtr.get() ? oldIdentity.sourceFilePtr : input->run.defaultSourceFilePtr;
-                if (oldSourceFilePtr.get())
-                    ie.sourceFilePtr = SourceFilePtr(new SourceFile(input->run.id + "_" + oldSourceFilePtr->id));
-
                 index_.push_back(ie);
             }
+        }
+
+        if (spectrumOrder == MSDataMerger::SpectrumOrder_ScanStartTime)
+        {
+            // read each input's scan times in its own thread
+            vector<vector<double> > scanStartTimes(inputs.size());
+            vector<boost::exception_ptr> errors(inputs.size());
+            boost::thread_group readers;
+            for (size_t inputIndex=0; inputIndex < inputs.size(); ++inputIndex)
+                readers.create_thread(boost::bind(&readScanStartTimes,
+                                                  boost::cref(*inputs[inputIndex]->run.spectrumListPtr),
+                                                  boost::ref(scanStartTimes[inputIndex]),
+                                                  boost::ref(errors[inputIndex])));
+            readers.join_all();
+
+            BOOST_FOREACH(const boost::exception_ptr& error, errors)
+                if (error)
+                    boost::rethrow_exception(error);
+
+            sort(index_.begin(), index_.end(), ScanStartTimeLessThan(scanStartTimes));
+        }
+
+        for (size_t i=0; i < index_.size(); ++i)
+        {
+            index_[i].index = i;
+            idToIndexes_[index_[i].id].push_back(i);
+        }
     }
 
     virtual size_t size() const {return index_.size();}
@@ -116,11 +180,14 @@ class SpectrumListMerger : public SpectrumList
             throw runtime_error("[SpectrumListMerger::spectrum()] Bad index: " + lexical_cast<string>(index));
 
         const IndexEntry& ie = index_[index];
-        SpectrumPtr result = ie.spectrumListPtr->spectrum(ie.originalIndex, getBinaryData);
+        const MSData& input = *inputMSDataPtrs_[ie.inputIndex];
+        SpectrumPtr result = input.run.spectrumListPtr->spectrum(ie.originalIndex, getBinaryData);
         result->index = ie.index;
 
         // because of the high chance of duplicate ids, sourceFilePtrs are always explicit
-        result->sourceFilePtr = ie.sourceFilePtr;
+        SourceFilePtr oldSourceFilePtr = result->sourceFilePtr.get() ? result->sourceFilePtr : input.run.defaultSourceFilePtr;
+        if (oldSourceFilePtr.get())
+            result->sourceFilePtr = SourceFilePtr(new SourceFile(input.run.id + "_" + oldSourceFilePtr->id));
 
         // resolve references into MSData::*Ptrs that may be invalidated after merging
         References::resolve(*result, msd_);
@@ -132,7 +199,7 @@ class SpectrumListMerger : public SpectrumList
 } // namespace
 
 
-PWIZ_API_DECL MSDataMerger::MSDataMerger(const vector<MSDataPtr>& inputs)
+PWIZ_API_DECL MSDataMerger::MSDataMerger(const vector<MSDataPtr>& inputs, SpectrumOrder spectrumOrder)
 : inputMSDataPtrs_(inputs)
 {
     // MSData::id and Run::id are set to the longest common prefix of all inputs' Run::ids,
@@ -214,7 +281,7 @@ PWIZ_API_DECL MSDataMerger::MSDataMerger(const vector<MSDataPtr>& inputs)
     if (!runTimestamps.empty())
         this->run.startTimeStamp = encode_xml_datetime(*std::min_element(runTimestamps.begin(), runTimestamps.end()));
 
-    this->run.spectrumListPtr = SpectrumListPtr(new SpectrumListMerger(*this, inputMSDataPtrs_));
+    this->run.spectrumListPtr = SpectrumListPtr(new SpectrumListMerger(*this, inputMSDataPtrs_, spectrumOrder));
 }
 
 
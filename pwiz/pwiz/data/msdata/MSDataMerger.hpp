@@ -33,7 +33,20 @@ namespace msdata {
 
 struct PWIZ_API_DECL MSDataMerger : public MSData
 {
-    MSDataMerger(const std::vector<MSDataPtr>& inputs);
+    /// order of the spectra in the merged spectrum list
+    enum SpectrumOrder
+    {
+        /// all spectra of the first input, then all spectra of the second input, etc.
+        SpectrumOrder_Concatenated,
+
+        /// spectra of all inputs interleaved by scan start time; spectra with the same time keep input order
+        SpectrumOrder_ScanStartTime
+    };
+
+    /// merges file-level metadata and spectrum lists of the inputs; the merged spectrum list reads
+    /// spectra from the input lists on demand, so spectra from different inputs can be read concurrently;
+    /// SpectrumOrder_ScanStartTime reads spectrum metadata of all inputs in parallel to get their times
+    MSDataMerger(const std::vector<MSDataPtr>& inputs, SpectrumOrder spectrumOrder = SpectrumOrder_Concatenated);
 
     private:
     std::vector<MSDataPtr> inputMSDataPtrs_;
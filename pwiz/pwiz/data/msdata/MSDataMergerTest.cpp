@@ -101,6 +101,58 @@ void test()
 }
 
 
+void testScanStartTimeOrder()
+{
+    MSData tinyReference;
+    examples::initializeTiny(tinyReference);
+    size_t tinySpectrumCount = tinyReference.run.spectrumListPtr->size();
+
+    const size_t tinyCopyCount = 3;
+
+    // give spectrum j of copy i the time j minutes + i seconds, so the merge alternates between copies
+    vector<MSDataPtr> tinyExamples;
+    for (size_t i=0; i < tinyCopyCount; ++i)
+    {
+        tinyExamples.push_back(MSDataPtr(new MSData));
+        MSData& msd = *tinyExamples.back();
+        examples::initializeTiny(msd);
+        msd.id = msd.run.id = "tiny" + lexical_cast<string>(i);
+
+        SpectrumListSimple& sl = dynamic_cast<SpectrumListSimple&>(*msd.run.spectrumListPtr);
+        for (size_t j=0; j < sl.spectra.size(); ++j)
+        {
+            Spectrum& s = *sl.spectra[j];
+            s.scanList.scans.resize(1);
+            Scan& scan = s.scanList.scans[0];
+            scan.cvParams.erase(remove_if(scan.cvParams.begin(), scan.cvParams.end(), CVParamIs(MS_scan_start_time)), scan.cvParams.end());
+            scan.set(MS_scan_start_time, j * 60.0 + i, UO_second);
+        }
+    }
+
+    MSDataMerger tinyMerged(tinyExamples, MSDataMerger::SpectrumOrder_ScanStartTime);
+
+    SpectrumList& sl = *tinyMerged.run.spectrumListPtr;
+    unit_assert_operator_equal(tinyCopyCount * tinySpectrumCount, sl.size());
+    for (size_t index=0; index < sl.size(); ++index)
+    {
+        size_t referenceIndex = index / tinyCopyCount;
+        size_t copyIndex = index % tinyCopyCount;
+
+        const SpectrumIdentity& identity = sl.spectrumIdentity(index);
+        unit_assert(identity.index == index);
+        unit_assert(identity.id == tinyReference.run.spectrumListPtr->spectrumIdentity(referenceIndex).id);
+        unit_assert(sl.find(identity.id) == referenceIndex * tinyCopyCount); // first of the duplicates
+
+        SpectrumPtr spectrum = sl.spectrum(index);
+        unit_assert(spectrum->index == index);
+        unit_assert(spectrum->id == identity.id);
+        unit_assert(spectrum->sourceFilePtr.get());
+        unit_assert(bal::starts_with(spectrum->sourceFilePtr->id, "tiny" + lexical_cast<string>(copyIndex) + "_"));
+        unit_assert_equal(referenceIndex * 60.0 + copyIndex, spectrum->scanList.scans[0].cvParam(MS_scan_start_time).timeInSeconds(), 1e-6);
+    }
+}
+
+
 int main(int argc, char* argv[])
 {
     TEST_PROLOG(argc, argv)
@@ -109,6 +161,7 @@ int main(int argc, char* argv[])
     {
         if (argc>1 && !strcmp(argv[1],"-v")) os_ = &cout;
         test();
+        testScanStartTimeOrder();
     }
     catch (exception& e)
     {
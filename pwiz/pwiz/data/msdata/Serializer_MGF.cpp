@@ -42,13 +42,17 @@ class Serializer_MGF::Impl
 {
     public:
 
-    Impl()
+    Impl(size_t maxThreadCount)
+    :   maxThreadCount_(maxThreadCount)
     {}
 
     void write(ostream& os, const MSData& msd,
                const pwiz::util::IterationListenerRegistry* iterationListenerRegistry) const;
 
     void read(shared_ptr<istream> is, MSData& msd) const;
+
+    private:
+    size_t maxThreadCount_;
 };
 
 template <typename T>
@@ -72,7 +76,7 @@ void Serializer_MGF::Impl::write(ostream& os, const MSData& msd,
 
     os << std::setprecision(10); // 1234.567890
     SpectrumList& sl = *msd.run.spectrumListPtr;
-    SpectrumWorkerThreads spectrumWorkers(sl);
+    SpectrumWorkerThreads spectrumWorkers(sl, maxThreadCount_);
     for (size_t i=0, end=sl.size(); i < end; ++i)
     {
         //SpectrumPtr s = sl.spectrum(i, true);
@@ -191,8 +195,8 @@ void Serializer_MGF::Impl::read(shared_ptr<istream> is, MSData& msd) const
 //
 
 
-PWIZ_API_DECL Serializer_MGF::Serializer_MGF()
-:   impl_(new Impl())
+PWIZ_API_DECL Serializer_MGF::Serializer_MGF(size_t maxThreadCount)
+:   impl_(new Impl(maxThreadCount))
 {}
 
 
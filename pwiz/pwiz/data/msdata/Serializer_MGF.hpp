@@ -38,8 +38,9 @@ class PWIZ_API_DECL Serializer_MGF
 {
     public:
 
-    /// constructor
-    Serializer_MGF();
+    /// constructor; maxThreadCount limits the threads reading spectra ahead in write(),
+    /// 0 starts one per processor core
+    Serializer_MGF(size_t maxThreadCount = 0);
 
     /// write MSData object to ostream as MGF;
     /// iterationListenerRegistry may be used to receive progress updates
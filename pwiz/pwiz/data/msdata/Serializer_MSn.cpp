@@ -54,7 +54,7 @@ using namespace pwiz::chemistry;
 class Serializer_MSn::Impl
 {
     public:
-        Impl(MSn_Type filetype) : _filetype(filetype) {}
+        Impl(MSn_Type filetype, size_t maxThreadCount) : _filetype(filetype), _maxThreadCount(maxThreadCount) {}
         
         void write(ostream& os, const MSData& msd, 
                    const pwiz::util::IterationListenerRegistry* iterationListenerRegistry) const;
@@ -63,6 +63,7 @@ class Serializer_MSn::Impl
 
     private: 
         MSn_Type _filetype; // .ms1, .cms1, .bms1, .ms2, .cms2, .bms2
+        size_t _maxThreadCount;
 };
 
 namespace 
@@ -438,7 +439,7 @@ void Serializer_MSn::Impl::write(ostream& os, const MSData& msd,
     // Go through the spectrum list and write each spectrum
     bool ms1File = MSn_Type_MS1 == _filetype || MSn_Type_BMS1 == _filetype || MSn_Type_CMS1 == _filetype;
     SpectrumList& sl = *msd.run.spectrumListPtr;
-    SpectrumWorkerThreads spectrumWorkers(sl);
+    SpectrumWorkerThreads spectrumWorkers(sl, _maxThreadCount);
     for (size_t i=0, end=sl.size(); i < end; ++i)
     {
         //SpectrumPtr s = sl.spectrum(i, true);
@@ -509,8 +510,8 @@ void Serializer_MSn::Impl::read(shared_ptr<istream> is, MSData& msd) const
 // Serializer_MSn
 //
 
-PWIZ_API_DECL Serializer_MSn::Serializer_MSn(MSn_Type filetype)
-:   impl_(new Impl(filetype))
+PWIZ_API_DECL Serializer_MSn::Serializer_MSn(MSn_Type filetype, size_t maxThreadCount)
+:   impl_(new Impl(filetype, maxThreadCount))
 {}
 
 PWIZ_API_DECL void Serializer_MSn::write(ostream& os, const MSData& msd,
@@ -38,8 +38,9 @@ class PWIZ_API_DECL Serializer_MSn
 {
     public:
 
-    /// constructor
-    Serializer_MSn(MSn_Type filetype);
+    /// constructor; maxThreadCount limits the threads reading spectra ahead in write(),
+    /// 0 starts one per processor core
+    Serializer_MSn(MSn_Type filetype, size_t maxThreadCount = 0);
 
     /// write MSData object to ostream as MSn;
     /// iterationListenerRegistry may be used to receive progress updates
@@ -50,8 +50,8 @@ class Serializer_mz5::Impl
      * Default constructor.
      * @param config mz5 configuration
      */
-    Impl(const Configuration_mz5& config)
-        : config_(config)
+    Impl(const Configuration_mz5& config, size_t maxThreadCount = 0)
+        : config_(config), maxThreadCount_(maxThreadCount)
     {
     }
 
@@ -88,13 +88,18 @@ private:
      */
     mutable Configuration_mz5 config_;
 
+    /**
+     * Number of threads reading spectra ahead while writing.
+     */
+    size_t maxThreadCount_;
+
 };
 
 void Serializer_mz5::Impl::write(const std::string& filename,
                                  const MSData& msd,
                                  const pwiz::util::IterationListenerRegistry* iterationListenerRegistry) const
 {
-    ReferenceWrite_mz5 wref(msd);
+    ReferenceWrite_mz5 wref(msd, maxThreadCount_);
     Connection_mz5 con(filename, Connection_mz5::RemoveAndCreate, config_);
     wref.writeTo(con, iterationListenerRegistry);
 }
@@ -145,7 +150,7 @@ PWIZ_API_DECL Serializer_mz5::Serializer_mz5(const Configuration_mz5& config)
 }
 
 PWIZ_API_DECL Serializer_mz5::Serializer_mz5(const pwiz::msdata::MSDataFile::WriteConfig& config)
-    : impl_(new Impl(Configuration_mz5(config)))
+    : impl_(new Impl(Configuration_mz5(config), config.maxThreadCount))
 {
 }
 
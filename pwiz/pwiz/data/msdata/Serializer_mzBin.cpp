@@ -0,0 +1,1167 @@
+//
+// $Id$
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#define PWIZ_SOURCE
+
+#include "Serializer_mzBin.hpp"
+#include "IO.hpp"
+#include "References.hpp"
+#include "SpectrumListBase.hpp"
+#include "ChromatogramListBase.hpp"
+#include "SpectrumWorkerThreads.hpp"
+#include "pwiz/utility/minimxml/XMLWriter.hpp"
+#include "pwiz/utility/misc/mru_list.hpp"
+#include "pwiz/utility/misc/Std.hpp"
+#include "boost/iostreams/device/mapped_file.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/thread.hpp"
+#include "boost/cstdint.hpp"
+#include "zlib.h"
+
+
+namespace pwiz {
+namespace msdata {
+
+
+using namespace pwiz::util;
+using boost::uint32_t;
+using boost::uint64_t;
+using boost::int32_t;
+
+
+namespace {
+
+
+//
+// file layout
+//
+// header: signature, uint32 format version, uint32 byte order mark
+// run-level metadata (mzML), chunks, index
+// footer: uint64 index offset, uint64 index stored size, uint64 index size, signature
+//
+// Values are written in host byte order; the byte order mark rejects files written on
+// a machine with the other order. A block whose stored size equals its size is not compressed.
+//
+
+const char signature_[] = {'m', 'z', 'B', 'i', 'n', '\r', '\n', '\x1a'};
+const size_t signatureSize_ = sizeof(signature_);
+const uint32_t formatVersion_ = 1;
+const uint32_t byteOrderMark_ = 0x01020304;
+const size_t headerSize_ = signatureSize_ + 2*sizeof(uint32_t);
+const size_t footerSize_ = 3*sizeof(uint64_t) + signatureSize_;
+
+
+class BinaryWriter
+{
+    public:
+    BinaryWriter(string& buffer) : buffer_(buffer) {}
+
+    template <typename T>
+    void put(const T& value) {buffer_.append(reinterpret_cast<const char*>(&value), sizeof(T));}
+
+    void putString(const string& value) {put<uint32_t>(value.size()); buffer_ += value;}
+
+    template <typename T>
+    void putColumn(const vector<T>& column)
+    {
+        put<uint64_t>(column.size());
+        if (!column.empty())
+            buffer_.append(reinterpret_cast<const char*>(&column[0]), column.size()*sizeof(T));
+    }
+
+    void putStringColumn(const vector<string>& column)
+    {
+        vector<uint64_t> ends;
+        ends.reserve(column.size());
+        uint64_t end = 0;
+        BOOST_FOREACH(const string& value, column)
+            ends.push_back(end += value.size());
+        putColumn(ends);
+        BOOST_FOREACH(const string& value, column)
+            buffer_ += value;
+    }
+
+    private:
+    string& buffer_;
+};
+
+
+class BinaryReader
+{
+    public:
+    BinaryReader(const char* begin, const char* end) : p_(begin), end_(end) {}
+
+    template <typename T>
+    T get()
+    {
+        T value;
+        memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    string getString()
+    {
+        uint32_t size = get<uint32_t>();
+        return string(take(size), size);
+    }
+
+    template <typename T>
+    void getColumn(vector<T>& column)
+    {
+        uint64_t size = get<uint64_t>();
+        if (size > remaining() / sizeof(T))
+            throw runtime_error("[Serializer_mzBin] Column is larger than its file; the file is corrupt.");
+        column.resize(size);
+        if (size > 0)
+            memcpy(&column[0], take(size*sizeof(T)), size*sizeof(T));
+    }
+
+    void getStringColumn(vector<string>& column)
+    {
+        vector<uint64_t> ends;
+        getColumn(ends);
+        const char* chars = take(ends.empty() ? 0 : ends.back());
+        column.resize(ends.size());
+        for (size_t i=0, begin=0; i < ends.size(); begin=ends[i++])
+        {
+            if (ends[i] < begin)
+                throw runtime_error("[Serializer_mzBin] Bad string column; the file is corrupt.");
+            column[i].assign(chars + begin, chars + ends[i]);
+        }
+    }
+
+    const char* take(size_t size)
+    {
+        if (size > remaining())
+            throw runtime_error("[Serializer_mzBin] Unexpected end of data; the file is truncated or corrupt.");
+        const char* result = p_;
+        p_ += size;
+        return result;
+    }
+
+    size_t remaining() const {return end_ - p_;}
+
+    private:
+    const char* p_;
+    const char* end_;
+};
+
+
+/// compresses data into stored, or copies it if compressing does not make it smaller
+void compressBlock(const string& data, string& stored)
+{
+    uLongf storedSize = compressBound(data.size());
+    stored.resize(storedSize);
+    if (data.empty() ||
+        compress2(reinterpret_cast<Bytef*>(&stored[0]), &storedSize,
+                  reinterpret_cast<const Bytef*>(data.c_str()), data.size(), Z_DEFAULT_COMPRESSION) != Z_OK ||
+        storedSize >= data.size())
+        stored = data;
+    else
+        stored.resize(storedSize);
+}
+
+
+void uncompressBlock(const char* stored, size_t storedSize, size_t size, string& data)
+{
+    if (storedSize == size)
+    {
+        data.assign(stored, size);
+        return;
+    }
+
+    data.resize(size);
+    uLongf uncompressedSize = size;
+    if (uncompress(reinterpret_cast<Bytef*>(&data[0]), &uncompressedSize,
+                   reinterpret_cast<const Bytef*>(stored), storedSize) != Z_OK ||
+        uncompressedSize != size)
+        throw runtime_error("[Serializer_mzBin] Error decompressing a block; the file is corrupt.");
+}
+
+
+/// where a block of the file is, and its size before compression
+struct Block
+{
+    uint64_t offset;
+    uint64_t storedSize;
+    uint64_t size;
+
+    Block() : offset(0), storedSize(0), size(0) {}
+};
+
+
+/// the chunk, offset in the (uncompressed) chunk, and size of each item of a table
+struct ItemLocations
+{
+    vector<uint32_t> chunk;
+    vector<uint32_t> offset;
+    vector<uint32_t> size;
+
+    void write(BinaryWriter& writer) const {writer.putColumn(chunk); writer.putColumn(offset); writer.putColumn(size);}
+    void read(BinaryReader& reader) {reader.getColumn(chunk); reader.getColumn(offset); reader.getColumn(size);}
+};
+
+
+/// the columns describing the spectra or the chromatograms;
+/// the columns from msLevel to chargeState are empty for chromatograms
+struct Table
+{
+    string dataProcessingRef;
+    vector<string> id;
+    vector<string> spotID;
+    vector<uint64_t> defaultArrayLength;
+    vector<int32_t> msLevel;
+    vector<double> scanStartTime; // seconds; NaN if unknown
+    vector<double> precursorMz; // the first selected ion; NaN if none
+    vector<int32_t> chargeState; // of the first selected ion; 0 if unknown
+    ItemLocations metadata;
+    ItemLocations data;
+
+    void write(BinaryWriter& writer) const
+    {
+        writer.putString(dataProcessingRef);
+        writer.putStringColumn(id);
+        writer.putStringColumn(spotID);
+        writer.putColumn(defaultArrayLength);
+        writer.putColumn(msLevel);
+        writer.putColumn(scanStartTime);
+        writer.putColumn(precursorMz);
+        writer.putColumn(chargeState);
+        metadata.write(writer);
+        data.write(writer);
+    }
+
+    void read(BinaryReader& reader)
+    {
+        dataProcessingRef = reader.getString();
+        reader.getStringColumn(id);
+        reader.getStringColumn(spotID);
+        reader.getColumn(defaultArrayLength);
+        reader.getColumn(msLevel);
+        reader.getColumn(scanStartTime);
+        reader.getColumn(precursorMz);
+        reader.getColumn(chargeState);
+        metadata.read(reader);
+        data.read(reader);
+
+        size_t size = id.size();
+        if (defaultArrayLength.size() != size ||
+            metadata.chunk.size() != size || metadata.offset.size() != size || metadata.size.size() != size ||
+            data.chunk.size() != size || data.offset.size() != size || data.size.size() != size)
+            throw runtime_error("[Serializer_mzBin] Columns of different lengths; the file is corrupt.");
+    }
+};
+
+
+//
+// serialization of the spectrum and chromatogram metadata;
+// references are written by id, and read as placeholders for References::resolve()
+//
+
+
+template <typename T>
+void writeRef(BinaryWriter& writer, const boost::shared_ptr<T>& ptr)
+{
+    writer.putString(ptr.get() ? ptr->id : string());
+}
+
+
+template <typename T>
+void readRef(BinaryReader& reader, boost::shared_ptr<T>& ptr)
+{
+    string id = reader.getString();
+    if (!id.empty())
+        ptr.reset(new T(id));
+}
+
+
+void writeParamContainer(BinaryWriter& writer, const ParamContainer& pc)
+{
+    writer.put<uint32_t>(pc.paramGroupPtrs.size());
+    BOOST_FOREACH(const ParamGroupPtr& paramGroup, pc.paramGroupPtrs)
+        writeRef(writer, paramGroup);
+
+    writer.put<uint32_t>(pc.cvParams.size());
+    BOOST_FOREACH(const CVParam& cvParam, pc.cvParams)
+    {
+        writer.put<uint32_t>(cvParam.cvid);
+        writer.putString(cvParam.value);
+        writer.put<uint32_t>(cvParam.units);
+    }
+
+    writer.put<uint32_t>(pc.userParams.size());
+    BOOST_FOREACH(const UserParam& userParam, pc.userParams)
+    {
+        writer.putString(userParam.name);
+        writer.putString(userParam.value);
+        writer.putString(userParam.type);
+        writer.put<uint32_t>(userParam.units);
+    }
+}
+
+
+void readParamContainer(BinaryReader& reader, ParamContainer& pc)
+{
+    pc.paramGroupPtrs.resize(reader.get<uint32_t>());
+    BOOST_FOREACH(ParamGroupPtr& paramGroup, pc.paramGroupPtrs)
+        readRef(reader, paramGroup);
+
+    pc.cvParams.resize(reader.get<uint32_t>());
+    BOOST_FOREACH(CVParam& cvParam, pc.cvParams)
+    {
+        cvParam.cvid = static_cast<CVID>(reader.get<uint32_t>());
+        cvParam.value = reader.getString();
+        cvParam.units = static_cast<CVID>(reader.get<uint32_t>());
+    }
+
+    pc.userParams.resize(reader.get<uint32_t>());
+    BOOST_FOREACH(UserParam& userParam, pc.userParams)
+    {
+        userParam.name = reader.getString();
+        userParam.value = reader.getString();
+        userParam.type = reader.getString();
+        userParam.units = static_cast<CVID>(reader.get<uint32_t>());
+    }
+}
+
+
+void writePrecursor(BinaryWriter& writer, const Precursor& precursor)
+{
+    writeRef(writer, precursor.sourceFilePtr);
+    writer.putString(precursor.externalSpectrumID);
+    writer.putString(precursor.spectrumID);
+    writeParamContainer(writer, precursor);
+    writeParamContainer(writer, precursor.isolationWindow);
+    writer.put<uint32_t>(precursor.selectedIons.size());
+    BOOST_FOREACH(const SelectedIon& selectedIon, precursor.selectedIons)
+        writeParamContainer(writer, selectedIon);
+    writeParamContainer(writer, precursor.activation);
+}
+
+
+void readPrecursor(BinaryReader& reader, Precursor& precursor)
+{
+    readRef(reader, precursor.sourceFilePtr);
+    precursor.externalSpectrumID = reader.getString();
+    precursor.spectrumID = reader.getString();
+    readParamContainer(reader, precursor);
+    readParamContainer(reader, precursor.isolationWindow);
+    precursor.selectedIons.resize(reader.get<uint32_t>());
+    BOOST_FOREACH(SelectedIon& selectedIon, precursor.selectedIons)
+        readParamContainer(reader, selectedIon);
+    readParamContainer(reader, precursor.activation);
+}
+
+
+void writeScan(BinaryWriter& writer, const Scan& scan)
+{
+    writeRef(writer, scan.sourceFilePtr);
+    writer.putString(scan.externalSpectrumID);
+    writer.putString(scan.spectrumID);
+    writeRef(writer, scan.instrumentConfigurationPtr);
+    writeParamContainer(writer, scan);
+    writer.put<uint32_t>(scan.scanWindows.size());
+    BOOST_FOREACH(const ScanWindow& scanWindow, scan.scanWindows)
+        writeParamContainer(writer, scanWindow);
+}
+
+
+void readScan(BinaryReader& reader, Scan& scan)
+{
+    readRef(reader, scan.sourceFilePtr);
+    scan.externalSpectrumID = reader.getString();
+    scan.spectrumID = reader.getString();
+    readRef(reader, scan.instrumentConfigurationPtr);
+    readParamContainer(reader, scan);
+    scan.scanWindows.resize(reader.get<uint32_t>());
+    BOOST_FOREACH(ScanWindow& scanWindow, scan.scanWindows)
+        readParamContainer(reader, scanWindow);
+}
+
+
+/// writes the arrays' metadata to metadataWriter and their values to dataWriter,
+/// as 32-bit or 64-bit floats according to the configured precision
+void writeBinaryDataArrays(BinaryWriter& metadataWriter, BinaryWriter& dataWriter,
+                           const vector<BinaryDataArrayPtr>& arrays,
+                           const BinaryDataEncoder::Config& config)
+{
+    metadataWriter.put<uint32_t>(arrays.size());
+    BOOST_FOREACH(const BinaryDataArrayPtr& array, arrays)
+    {
+        BinaryDataEncoder::Precision precision = config.precision;
+        map<CVID, BinaryDataEncoder::Precision>::const_iterator itr =
+            config.precisionOverrides.find(array->cvParamChild(MS_binary_data_array).cvid);
+        if (itr != config.precisionOverrides.end())
+            precision = itr->second;
+
+        writeRef(metadataWriter, array->dataProcessingPtr);
+        writeParamContainer(metadataWriter, *array);
+        metadataWriter.put<uint64_t>(array->data.size());
+        metadataWriter.put<uint8_t>(precision == BinaryDataEncoder::Precision_32 ? 4 : 8);
+
+        if (precision == BinaryDataEncoder::Precision_32)
+        {
+            BOOST_FOREACH(double value, array->data)
+                dataWriter.put<float>(static_cast<float>(value));
+        }
+        else if (!array->data.empty())
+            dataWriter.putColumn(array->data);
+    }
+}
+
+
+/// reads the arrays' metadata, and their values too if dataReader is not null
+void readBinaryDataArrays(BinaryReader& metadataReader, BinaryReader* dataReader,
+                          vector<BinaryDataArrayPtr>& arrays)
+{
+    arrays.resize(metadataReader.get<uint32_t>());
+    BOOST_FOREACH(BinaryDataArrayPtr& array, arrays)
+    {
+        array.reset(new BinaryDataArray);
+        readRef(metadataReader, array->dataProcessingPtr);
+        readParamContainer(metadataReader, *array);
+        uint64_t size = metadataReader.get<uint64_t>();
+        uint8_t valueSize = metadataReader.get<uint8_t>();
+
+        if (!dataReader)
+            continue;
+
+        if (valueSize == 4)
+        {
+            if (size > dataReader->remaining() / sizeof(float))
+                throw runtime_error("[Serializer_mzBin] Array is larger than its chunk; the file is corrupt.");
+            array->data.resize(size);
+            const char* values = dataReader->take(size*sizeof(float));
+            for (size_t i=0; i < size; ++i)
+            {
+                float value;
+                memcpy(&value, values + i*sizeof(float), sizeof(float));
+                array->data[i] = value;
+            }
+        }
+        else if (size > 0)
+        {
+            dataReader->getColumn(array->data);
+            if (array->data.size() != size)
+                throw runtime_error("[Serializer_mzBin] Array has the wrong length; the file is corrupt.");
+        }
+    }
+}
+
+
+//
+// writing
+//
+
+
+/// writes the stored blocks to the stream, keeping track of their offsets
+class BlockWriter
+{
+    public:
+    BlockWriter(ostream& os) : os_(os), position_(0) {}
+
+    void write(const string& bytes)
+    {
+        os_.write(bytes.c_str(), bytes.size());
+        if (!os_)
+            throw runtime_error("[Serializer_mzBin] Error writing to stream.");
+        position_ += bytes.size();
+    }
+
+    Block writeBlock(const string& data)
+    {
+        compressBlock(data, stored_);
+        Block block;
+        block.offset = position_;
+        block.storedSize = stored_.size();
+        block.size = data.size();
+        write(stored_);
+        return block;
+    }
+
+    uint64_t position() const {return position_;}
+
+    private:
+    ostream& os_;
+    uint64_t position_;
+    string stored_;
+};
+
+
+/// packs items (the serialized metadata or data arrays of spectra or chromatograms) into chunks
+class ChunkWriter
+{
+    public:
+    ChunkWriter(BlockWriter& blockWriter, vector<Block>& chunks, size_t chunkSize)
+    :   blockWriter_(blockWriter), chunks_(chunks), chunkSize_(chunkSize), writer_(buffer_), itemBegin_(0)
+    {}
+
+    /// the writer for the current item
+    BinaryWriter& writer() {return writer_;}
+
+    /// records the location of the current item, and writes the chunk if it is full
+    void endItem(ItemLocations& locations)
+    {
+        if (buffer_.size() > numeric_limits<uint32_t>::max())
+            throw runtime_error("[Serializer_mzBin] Item larger than 4 GB.");
+
+        // the chunk index is known when the chunk is written
+        pendingItems_.push_back(make_pair(&locations, locations.chunk.size()));
+        locations.chunk.push_back(0);
+        locations.offset.push_back(itemBegin_);
+        locations.size.push_back(buffer_.size() - itemBegin_);
+        itemBegin_ = buffer_.size();
+
+        if (buffer_.size() >= chunkSize_)
+            flush();
+    }
+
+    void flush()
+    {
+        if (pendingItems_.empty()) return;
+        typedef pair<ItemLocations*, size_t> PendingItem;
+        BOOST_FOREACH(const PendingItem& item, pendingItems_)
+            item.first->chunk[item.second] = chunks_.size();
+        pendingItems_.clear();
+        chunks_.push_back(blockWriter_.writeBlock(buffer_));
+        buffer_.clear();
+        itemBegin_ = 0;
+    }
+
+    private:
+    BlockWriter& blockWriter_;
+    vector<Block>& chunks_;
+    size_t chunkSize_;
+    string buffer_;
+    BinaryWriter writer_;
+    size_t itemBegin_;
+    vector<pair<ItemLocations*, size_t> > pendingItems_;
+};
+
+
+double firstScanStartTime(const Spectrum& spectrum)
+{
+    if (spectrum.scanList.scans.empty())
+        return numeric_limits<double>::quiet_NaN();
+    CVParam scanStartTime = spectrum.scanList.scans[0].cvParam(MS_scan_start_time);
+    return scanStartTime.empty() ? numeric_limits<double>::quiet_NaN() : scanStartTime.timeInSeconds();
+}
+
+
+const SelectedIon* firstSelectedIon(const Spectrum& spectrum)
+{
+    if (spectrum.precursors.empty() || spectrum.precursors[0].selectedIons.empty())
+        return 0;
+    return &spectrum.precursors[0].selectedIons[0];
+}
+
+
+void appendSpectrum(Table& table, ChunkWriter& metadataChunks, ChunkWriter& dataChunks,
+                    const Spectrum& spectrum, const BinaryDataEncoder::Config& config)
+{
+    table.id.push_back(spectrum.id);
+    table.spotID.push_back(spectrum.spotID);
+    table.defaultArrayLength.push_back(spectrum.defaultArrayLength);
+
+    CVParam msLevel = spectrum.cvParam(MS_ms_level);
+    table.msLevel.push_back(msLevel.empty() ? 0 : msLevel.valueAs<int>());
+    table.scanStartTime.push_back(firstScanStartTime(spectrum));
+
+    const SelectedIon* selectedIon = firstSelectedIon(spectrum);
+    CVParam mz = selectedIon ? selectedIon->cvParam(MS_selected_ion_m_z) : CVParam();
+    CVParam charge = selectedIon ? selectedIon->cvParam(MS_charge_state) : CVParam();
+    table.precursorMz.push_back(mz.empty() ? numeric_limits<double>::quiet_NaN() : mz.valueAs<double>());
+    table.chargeState.push_back(charge.empty() ? 0 : charge.valueAs<int>());
+
+    BinaryWriter& writer = metadataChunks.writer();
+    writeRef(writer, spectrum.dataProcessingPtr);
+    writeRef(writer, spectrum.sourceFilePtr);
+    writeParamContainer(writer, spectrum);
+
+    writeParamContainer(writer, spectrum.scanList);
+    writer.put<uint32_t>(spectrum.scanList.scans.size());
+    BOOST_FOREACH(const Scan& scan, spectrum.scanList.scans)
+        writeScan(writer, scan);
+
+    writer.put<uint32_t>(spectrum.precursors.size());
+    BOOST_FOREACH(const Precursor& precursor, spectrum.precursors)
+        writePrecursor(writer, precursor);
+
+    writer.put<uint32_t>(spectrum.products.size());
+    BOOST_FOREACH(const Product& product, spectrum.products)
+        writeParamContainer(writer, product.isolationWindow);
+
+    writeBinaryDataArrays(writer, dataChunks.writer(), spectrum.binaryDataArrayPtrs, config);
+
+    metadataChunks.endItem(table.metadata);
+    dataChunks.endItem(table.data);
+}
+
+
+void appendChromatogram(Table& table, ChunkWriter& metadataChunks, ChunkWriter& dataChunks,
+                        const Chromatogram& chromatogram, const BinaryDataEncoder::Config& config)
+{
+    table.id.push_back(chromatogram.id);
+    table.spotID.push_back(string());
+    table.defaultArrayLength.push_back(chromatogram.defaultArrayLength);
+
+    BinaryWriter& writer = metadataChunks.writer();
+    writeRef(writer, chromatogram.dataProcessingPtr);
+    writeParamContainer(writer, chromatogram);
+    writePrecursor(writer, chromatogram.precursor);
+    writeParamContainer(writer, chromatogram.product.isolationWindow);
+    writeBinaryDataArrays(writer, dataChunks.writer(), chromatogram.binaryDataArrayPtrs, config);
+
+    metadataChunks.endItem(table.metadata);
+    dataChunks.endItem(table.data);
+}
+
+
+/// writes everything but the spectra and chromatograms as an mzML document
+string runMetadataAsMzML(const MSData& msd)
+{
+    MSData header;
+    header.accession = msd.accession;
+    header.id = msd.id;
+    header.cvs = msd.cvs;
+    header.fileDescription = msd.fileDescription;
+    header.paramGroupPtrs = msd.paramGroupPtrs;
+    header.samplePtrs = msd.samplePtrs;
+    header.softwarePtrs = msd.softwarePtrs;
+    header.scanSettingsPtrs = msd.scanSettingsPtrs;
+    header.instrumentConfigurationPtrs = msd.instrumentConfigurationPtrs;
+    header.dataProcessingPtrs = msd.allDataProcessingPtrs();
+
+    static_cast<ParamContainer&>(header.run) = msd.run;
+    header.run.id = msd.run.id;
+    header.run.defaultInstrumentConfigurationPtr = msd.run.defaultInstrumentConfigurationPtr;
+    header.run.samplePtr = msd.run.samplePtr;
+    header.run.startTimeStamp = msd.run.startTimeStamp;
+    header.run.defaultSourceFilePtr = msd.run.defaultSourceFilePtr;
+
+    ostringstream oss;
+    minimxml::XMLWriter writer(oss);
+    IO::write(writer, header);
+    return oss.str();
+}
+
+
+//
+// reading
+//
+
+
+/// an mzBin file mapped into memory, with its decoded index; shared by the spectrum
+/// and chromatogram lists, which decode chunks through a small cache
+class MappedFile
+{
+    public:
+
+    MappedFile(const string& filename)
+    :   file_(filename),
+        chunkCache_(max(4u, 2 * boost::thread::hardware_concurrency()))
+    {
+        const char* begin = file_.data();
+        const char* end = begin + file_.size();
+
+        if (file_.size() < headerSize_ + footerSize_ ||
+            !std::equal(signature_, signature_ + signatureSize_, begin) ||
+            !std::equal(signature_, signature_ + signatureSize_, end - signatureSize_))
+            throw runtime_error("[Serializer_mzBin] Not an mzBin file: " + filename);
+
+        BinaryReader header(begin + signatureSize_, begin + headerSize_);
+        if (header.get<uint32_t>() != formatVersion_)
+            throw runtime_error("[Serializer_mzBin] Unsupported mzBin version: " + filename);
+        if (header.get<uint32_t>() != byteOrderMark_)
+            throw runtime_error("[Serializer_mzBin] File written with a different byte order: " + filename);
+
+        BinaryReader footer(end - footerSize_, end);
+        Block indexBlock;
+        indexBlock.offset = footer.get<uint64_t>();
+        indexBlock.storedSize = footer.get<uint64_t>();
+        indexBlock.size = footer.get<uint64_t>();
+
+        string index;
+        uncompressBlock(storedBytes(indexBlock), indexBlock.storedSize, indexBlock.size, index);
+        BinaryReader reader(index.c_str(), index.c_str() + index.size());
+
+        runMetadata_.offset = reader.get<uint64_t>();
+        runMetadata_.storedSize = reader.get<uint64_t>();
+        runMetadata_.size = reader.get<uint64_t>();
+
+        vector<uint64_t> offsets, storedSizes, sizes;
+        reader.getColumn(offsets);
+        reader.getColumn(storedSizes);
+        reader.getColumn(sizes);
+        if (storedSizes.size() != offsets.size() || sizes.size() != offsets.size())
+            throw runtime_error("[Serializer_mzBin] Bad chunk table; the file is corrupt.");
+        chunks_.resize(offsets.size());
+        for (size_t i=0; i < chunks_.size(); ++i)
+        {
+            chunks_[i].offset = offsets[i];
+            chunks_[i].storedSize = storedSizes[i];
+            chunks_[i].size = sizes[i];
+            storedBytes(chunks_[i]); // checks the bounds
+        }
+
+        spectra_.read(reader);
+        chromatograms_.read(reader);
+        checkLocations(spectra_.metadata);
+        checkLocations(spectra_.data);
+        checkLocations(chromatograms_.metadata);
+        checkLocations(chromatograms_.data);
+    }
+
+    const Table& spectra() const {return spectra_;}
+    const Table& chromatograms() const {return chromatograms_;}
+
+    string runMetadata() const
+    {
+        string result;
+        uncompressBlock(storedBytes(runMetadata_), runMetadata_.storedSize, runMetadata_.size, result);
+        return result;
+    }
+
+    /// returns a reader for an item; chunk keeps the decoded chunk alive while it is read
+    BinaryReader item(const ItemLocations& locations, size_t index, boost::shared_ptr<const string>& chunk) const
+    {
+        chunk = decodedChunk(locations.chunk[index]);
+        const char* begin = chunk->c_str() + locations.offset[index];
+        return BinaryReader(begin, begin + locations.size[index]);
+    }
+
+    private:
+
+    boost::iostreams::mapped_file_source file_;
+    Block runMetadata_;
+    vector<Block> chunks_;
+    Table spectra_;
+    Table chromatograms_;
+
+    struct CachedChunk
+    {
+        size_t index;
+        boost::shared_ptr<const string> data;
+    };
+
+    typedef mru_list<CachedChunk, boost::multi_index::member<CachedChunk, size_t, &CachedChunk::index> > ChunkCache;
+    mutable ChunkCache chunkCache_;
+    mutable boost::mutex chunkCacheMutex_;
+
+    const char* storedBytes(const Block& block) const
+    {
+        if (block.offset > file_.size() || block.storedSize > file_.size() - block.offset)
+            throw runtime_error("[Serializer_mzBin] Block beyond the end of the file; the file is truncated or corrupt.");
+        return file_.data() + block.offset;
+    }
+
+    void checkLocations(const ItemLocations& locations) const
+    {
+        for (size_t i=0; i < locations.chunk.size(); ++i)
+            if (locations.chunk[i] >= chunks_.size() ||
+                uint64_t(locations.offset[i]) + locations.size[i] > chunks_[locations.chunk[i]].size)
+                throw runtime_error("[Serializer_mzBin] Item beyond the end of its chunk; the file is corrupt.");
+    }
+
+    /// the chunk is decoded outside the lock, so threads reading different chunks decode them in parallel
+    boost::shared_ptr<const string> decodedChunk(size_t index) const
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(chunkCacheMutex_);
+            BOOST_FOREACH(const CachedChunk& cached, chunkCache_)
+                if (cached.index == index)
+                {
+                    CachedChunk hit = cached;
+                    chunkCache_.insert(hit); // moves it to the front
+                    return hit.data;
+                }
+        }
+
+        const Block& block = chunks_[index];
+        boost::shared_ptr<string> data(new string);
+        uncompressBlock(storedBytes(block), block.storedSize, block.size, *data);
+
+        CachedChunk cached;
+        cached.index = index;
+        cached.data = data;
+        boost::lock_guard<boost::mutex> lock(chunkCacheMutex_);
+        chunkCache_.insert(cached);
+        return data;
+    }
+};
+
+typedef boost::shared_ptr<MappedFile> MappedFilePtr;
+
+
+DataProcessingPtr findDataProcessing(const MSData& msd, const string& id)
+{
+    if (id.empty())
+        return DataProcessingPtr();
+    BOOST_FOREACH(const DataProcessingPtr& dp, msd.dataProcessingPtrs)
+        if (dp.get() && dp->id == id)
+            return dp;
+    return DataProcessingPtr(new DataProcessing(id));
+}
+
+
+class SpectrumList_mzBin : public SpectrumListBase
+{
+    public:
+
+    SpectrumList_mzBin(const MappedFilePtr& file, const MSData& msd)
+    :   file_(file), table_(file->spectra()), msd_(msd)
+    {
+        identities_.resize(table_.id.size());
+        for (size_t i=0; i < identities_.size(); ++i)
+        {
+            identities_[i].index = i;
+            identities_[i].id = table_.id[i];
+            identities_[i].spotID = table_.spotID[i];
+            idToIndex_[table_.id[i]] = i;
+        }
+        dp_ = findDataProcessing(msd, table_.dataProcessingRef);
+    }
+
+    virtual size_t size() const {return identities_.size();}
+
+    virtual const SpectrumIdentity& spectrumIdentity(size_t index) const
+    {
+        if (index >= size())
+            throw runtime_error("[SpectrumList_mzBin::spectrumIdentity()] Bad index: " + lexical_cast<string>(index));
+        return identities_[index];
+    }
+
+    virtual size_t find(const string& id) const
+    {
+        map<string, size_t>::const_iterator itr = idToIndex_.find(id);
+        return itr == idToIndex_.end() ? size() : itr->second;
+    }
+
+    virtual SpectrumPtr spectrum(size_t index, bool getBinaryData) const
+    {
+        return spectrum(index, getBinaryData ? DetailLevel_FullData : DetailLevel_FullMetadata);
+    }
+
+    virtual SpectrumPtr spectrum(size_t index, DetailLevel detailLevel) const
+    {
+        const SpectrumIdentity& identity = spectrumIdentity(index);
+
+        SpectrumPtr result(new Spectrum);
+        result->index = index;
+        result->id = identity.id;
+        result->spotID = identity.spotID;
+        result->defaultArrayLength = table_.defaultArrayLength[index];
+
+        if (detailLevel == DetailLevel_InstantMetadata)
+        {
+            // only what the columns tell
+            if (table_.msLevel[index] > 0)
+                result->set(MS_ms_level, table_.msLevel[index]);
+
+            double scanStartTime = table_.scanStartTime[index];
+            if (scanStartTime == scanStartTime)
+            {
+                result->scanList.scans.push_back(Scan());
+                result->scanList.scans.back().set(MS_scan_start_time, scanStartTime, UO_second);
+            }
+
+            double precursorMz = table_.precursorMz[index];
+            if (precursorMz == precursorMz)
+                result->precursors.push_back(table_.chargeState[index] ? Precursor(precursorMz, table_.chargeState[index])
+                                                                       : Precursor(precursorMz));
+            return result;
+        }
+
+        boost::shared_ptr<const string> metadataChunk, dataChunk;
+        BinaryReader reader = file_->item(table_.metadata, index, metadataChunk);
+
+        readRef(reader, result->dataProcessingPtr);
+        readRef(reader, result->sourceFilePtr);
+        readParamContainer(reader, *result);
+
+        readParamContainer(reader, result->scanList);
+        result->scanList.scans.resize(reader.get<uint32_t>());
+        BOOST_FOREACH(Scan& scan, result->scanList.scans)
+            readScan(reader, scan);
+
+        result->precursors.resize(reader.get<uint32_t>());
+        BOOST_FOREACH(Precursor& precursor, result->precursors)
+            readPrecursor(reader, precursor);
+
+        result->products.resize(reader.get<uint32_t>());
+        BOOST_FOREACH(Product& product, result->products)
+            readParamContainer(reader, product.isolationWindow);
+
+        if (detailLevel == DetailLevel_FullData)
+        {
+            BinaryReader dataReader = file_->item(table_.data, index, dataChunk);
+            readBinaryDataArrays(reader, &dataReader, result->binaryDataArrayPtrs);
+        }
+        else
+            readBinaryDataArrays(reader, 0, result->binaryDataArrayPtrs);
+
+        References::resolve(*result, msd_);
+        return result;
+    }
+
+    private:
+    MappedFilePtr file_;
+    const Table& table_;
+    const MSData& msd_;
+    vector<SpectrumIdentity> identities_;
+    map<string, size_t> idToIndex_;
+};
+
+
+class ChromatogramList_mzBin : public ChromatogramListBase
+{
+    public:
+
+    ChromatogramList_mzBin(const MappedFilePtr& file, const MSData& msd)
+    :   file_(file), table_(file->chromatograms()), msd_(msd)
+    {
+        identities_.resize(table_.id.size());
+        for (size_t i=0; i < identities_.size(); ++i)
+        {
+            identities_[i].index = i;
+            identities_[i].id = table_.id[i];
+            idToIndex_[table_.id[i]] = i;
+        }
+        dp_ = findDataProcessing(msd, table_.dataProcessingRef);
+    }
+
+    virtual size_t size() const {return identities_.size();}
+
+    virtual const ChromatogramIdentity& chromatogramIdentity(size_t index) const
+    {
+        if (index >= size())
+            throw runtime_error("[ChromatogramList_mzBin::chromatogramIdentity()] Bad index: " + lexical_cast<string>(index));
+        return identities_[index];
+    }
+
+    virtual size_t find(const string& id) const
+    {
+        map<string, size_t>::const_iterator itr = idToIndex_.find(id);
+        return itr == idToIndex_.end() ? size() : itr->second;
+    }
+
+    virtual ChromatogramPtr chromatogram(size_t index, bool getBinaryData) const
+    {
+        const ChromatogramIdentity& identity = chromatogramIdentity(index);
+
+        ChromatogramPtr result(new Chromatogram);
+        result->index = index;
+        result->id = identity.id;
+        result->defaultArrayLength = table_.defaultArrayLength[index];
+
+        boost::shared_ptr<const string> metadataChunk, dataChunk;
+        BinaryReader reader = file_->item(table_.metadata, index, metadataChunk);
+
+        readRef(reader, result->dataProcessingPtr);
+        readParamContainer(reader, *result);
+        readPrecursor(reader, result->precursor);
+        readParamContainer(reader, result->product.isolationWindow);
+
+        if (getBinaryData)
+        {
+            BinaryReader dataReader = file_->item(table_.data, index, dataChunk);
+            readBinaryDataArrays(reader, &dataReader, result->binaryDataArrayPtrs);
+        }
+        else
+            readBinaryDataArrays(reader, 0, result->binaryDataArrayPtrs);
+
+        References::resolve(*result, msd_);
+        return result;
+    }
+
+    private:
+    MappedFilePtr file_;
+    const Table& table_;
+    const MSData& msd_;
+    vector<ChromatogramIdentity> identities_;
+    map<string, size_t> idToIndex_;
+};
+
+
+} // namespace
+
+
+class Serializer_mzBin::Impl
+{
+    public:
+
+    Impl(const Config& config)
+    :   config_(config)
+    {}
+
+    void write(ostream& os, const MSData& msd,
+               const pwiz::util::IterationListenerRegistry* iterationListenerRegistry) const;
+
+    void read(const string& filename, MSData& msd) const;
+
+    private:
+    Config config_;
+};
+
+
+void Serializer_mzBin::Impl::write(ostream& os, const MSData& msd,
+    const pwiz::util::IterationListenerRegistry* iterationListenerRegistry) const
+{
+    BlockWriter blockWriter(os);
+
+    string header(signature_, signatureSize_);
+    BinaryWriter(header).put(formatVersion_);
+    BinaryWriter(header).put(byteOrderMark_);
+    blockWriter.write(header);
+
+    Block runMetadata = blockWriter.writeBlock(runMetadataAsMzML(msd));
+
+    vector<Block> chunks;
+    ChunkWriter metadataChunks(blockWriter, chunks, config_.chunkSize);
+    ChunkWriter dataChunks(blockWriter, chunks, config_.chunkSize);
+
+    Table spectra;
+    const SpectrumList* sl = msd.run.spectrumListPtr.get();
+    if (sl)
+    {
+        if (sl->dataProcessingPtr().get())
+            spectra.dataProcessingRef = sl->dataProcessingPtr()->id;
+
+        SpectrumWorkerThreads spectrumWorkers(*sl, config_.maxThreadCount);
+        for (size_t i=0, end=sl->size(); i < end; ++i)
+        {
+            IterationListener::Status status = IterationListener::Status_Ok;
+            if (iterationListenerRegistry)
+                status = iterationListenerRegistry->broadcastUpdateMessage(IterationListener::UpdateMessage(i, end));
+            if (status == IterationListener::Status_Cancel)
+                break;
+
+            SpectrumPtr spectrum = spectrumWorkers.processBatch(i);
+            appendSpectrum(spectra, metadataChunks, dataChunks, *spectrum, config_.binaryDataEncoderConfig);
+        }
+        metadataChunks.flush();
+        dataChunks.flush();
+    }
+
+    Table chromatograms;
+    const ChromatogramList* cl = msd.run.chromatogramListPtr.get();
+    if (cl)
+    {
+        if (cl->dataProcessingPtr().get())
+            chromatograms.dataProcessingRef = cl->dataProcessingPtr()->id;
+
+        for (size_t i=0, end=cl->size(); i < end; ++i)
+        {
+            IterationListener::Status status = IterationListener::Status_Ok;
+            if (iterationListenerRegistry)
+                status = iterationListenerRegistry->broadcastUpdateMessage(IterationListener::UpdateMessage(i, end));
+            if (status == IterationListener::Status_Cancel)
+                break;
+
+            appendChromatogram(chromatograms, metadataChunks, dataChunks, *cl->chromatogram(i, true),
+                               config_.binaryDataEncoderConfig);
+        }
+        metadataChunks.flush();
+        dataChunks.flush();
+    }
+
+    string index;
+    BinaryWriter indexWriter(index);
+    indexWriter.put(runMetadata.offset);
+    indexWriter.put(runMetadata.storedSize);
+    indexWriter.put(runMetadata.size);
+
+    vector<uint64_t> offsets, storedSizes, sizes;
+    BOOST_FOREACH(const Block& chunk, chunks)
+    {
+        offsets.push_back(chunk.offset);
+        storedSizes.push_back(chunk.storedSize);
+        sizes.push_back(chunk.size);
+    }
+    indexWriter.putColumn(offsets);
+    indexWriter.putColumn(storedSizes);
+    indexWriter.putColumn(sizes);
+
+    spectra.write(indexWriter);
+    chromatograms.write(indexWriter);
+    Block indexBlock = blockWriter.writeBlock(index);
+
+    string footer;
+    BinaryWriter footerWriter(footer);
+    footerWriter.put(indexBlock.offset);
+    footerWriter.put(indexBlock.storedSize);
+    footerWriter.put(indexBlock.size);
+    footer.append(signature_, signatureSize_);
+    blockWriter.write(footer);
+    os.flush();
+}
+
+
+void Serializer_mzBin::Impl::read(const string& filename, MSData& msd) const
+{
+    MappedFilePtr file(new MappedFile(filename));
+
+    istringstream runMetadata(file->runMetadata());
+    IO::read(runMetadata, msd, IO::IgnoreSpectrumList);
+
+    msd.run.spectrumListPtr.reset(new SpectrumList_mzBin(file, msd));
+    msd.run.chromatogramListPtr.reset(new ChromatogramList_mzBin(file, msd));
+}
+
+
+//
+// Serializer_mzBin
+//
+
+
+PWIZ_API_DECL Serializer_mzBin::Serializer_mzBin(const Config& config)
+:   impl_(new Impl(config))
+{}
+
+
+PWIZ_API_DECL void Serializer_mzBin::write(const string& filename, const MSData& msd,
+    const pwiz::util::IterationListenerRegistry* iterationListenerRegistry) const
+{
+    ofstream os(filename.c_str(), ios::binary);
+    if (!os)
+        throw runtime_error("[Serializer_mzBin::write()] Unable to open file " + filename);
+    impl_->write(os, msd, iterationListenerRegistry);
+}
+
+
+PWIZ_API_DECL void Serializer_mzBin::write(ostream& os, const MSData& msd,
+    const pwiz::util::IterationListenerRegistry* iterationListenerRegistry) const
+{
+    impl_->write(os, msd, iterationListenerRegistry);
+}
+
+
+PWIZ_API_DECL void Serializer_mzBin::read(const string& filename, MSData& msd) const
+{
+    impl_->read(filename, msd);
+}
+
+
+PWIZ_API_DECL bool Serializer_mzBin::hasSignature(const string& head)
+{
+    return head.size() >= signatureSize_ && std::equal(signature_, signature_ + signatureSize_, head.begin());
+}
+
+
+} // namespace msdata
+} // namespace pwiz
@@ -0,0 +1,100 @@
+//
+// $Id$
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef _SERIALIZER_MZBIN_HPP_
+#define _SERIALIZER_MZBIN_HPP_
+
+
+#include "pwiz/utility/misc/Export.hpp"
+#include "MSData.hpp"
+#include "BinaryDataEncoder.hpp"
+#include "pwiz/utility/misc/IterationListener.hpp"
+
+
+namespace pwiz {
+namespace msdata {
+
+
+///
+/// MSData <-> mzBin file serialization.
+///
+/// mzBin is a binary container for a single run, laid out for repeated reading:
+/// - the run-level metadata (everything but the spectra and chromatograms) as a zlib-compressed mzML document;
+/// - the spectrum and chromatogram metadata, and separately their binary data arrays,
+///   packed into chunks of consecutive items, each chunk zlib-compressed on its own;
+/// - an index with the chunk table and one typed column per field of the spectrum and
+///   chromatogram tables (id, default array length, ms level, scan start time, precursor m/z,
+///   charge state, and the chunk location of the metadata and the data arrays);
+/// - a fixed-size footer, at the end of the file, locating the index.
+///
+/// The file is read through a memory map: opening it only decodes the index, the columns answer
+/// DetailLevel_InstantMetadata requests, and a spectrum's other fields decode one metadata or data chunk.
+/// The spectrum and chromatogram lists are thread-safe, so chunks can be decoded in parallel
+/// (e.g. by SpectrumWorkerThreads).
+///
+class PWIZ_API_DECL Serializer_mzBin
+{
+    public:
+
+    /// mzBin configuration
+    struct PWIZ_API_DECL Config
+    {
+        /// only the precision (and precisionOverrides) are used: arrays are stored as 32-bit or 64-bit floats
+        BinaryDataEncoder::Config binaryDataEncoderConfig;
+
+        /// a chunk is closed once its uncompressed size reaches this many bytes
+        size_t chunkSize;
+
+        /// number of threads reading spectra ahead in write(); 0 starts one per processor core
+        size_t maxThreadCount;
+
+        Config() : chunkSize(256 * 1024), maxThreadCount(0) {}
+    };
+
+    /// constructor
+    Serializer_mzBin(const Config& config = Config());
+
+    /// write MSData object to an mzBin file;
+    /// iterationListenerRegistry may be used to receive progress updates
+    void write(const std::string& filename, const MSData& msd,
+               const pwiz::util::IterationListenerRegistry* iterationListenerRegistry = 0) const;
+
+    /// write MSData object to a binary ostream in mzBin format
+    void write(std::ostream& os, const MSData& msd,
+               const pwiz::util::IterationListenerRegistry* iterationListenerRegistry = 0) const;
+
+    /// read in MSData object from an mzBin file;
+    /// the file stays mapped by the MSData's SpectrumList and ChromatogramList
+    void read(const std::string& filename, MSData& msd) const;
+
+    /// returns true iff the head of a file has the mzBin signature
+    static bool hasSignature(const std::string& head);
+
+    private:
+    class Impl;
+    boost::shared_ptr<Impl> impl_;
+    Serializer_mzBin(Serializer_mzBin&);
+    Serializer_mzBin& operator=(Serializer_mzBin&);
+};
+
+
+} // namespace msdata
+} // namespace pwiz
+
+
+#endif // _SERIALIZER_MZBIN_HPP_
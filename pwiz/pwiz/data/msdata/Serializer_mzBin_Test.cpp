@@ -0,0 +1,265 @@
+//
+// $Id$
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "pwiz/utility/misc/unit.hpp"
+#include "Serializer_mzBin.hpp"
+#include "Diff.hpp"
+#include "References.hpp"
+#include "SpectrumListBase.hpp"
+#include "SpectrumWorkerThreads.hpp"
+#include "examples.hpp"
+#include "pwiz/utility/misc/Std.hpp"
+#include "pwiz/utility/misc/Filesystem.hpp"
+#include "boost/thread/thread.hpp"
+#include <cstring>
+
+
+using namespace pwiz::util;
+using namespace pwiz::cv;
+using namespace pwiz::msdata;
+
+
+ostream* os_ = 0;
+
+
+string testFilename()
+{
+    return "Serializer_mzBin_Test_" + lexical_cast<string>(boost::this_thread::get_id()) + ".mzBin";
+}
+
+
+void testWriteRead(const MSData& msd, const Serializer_mzBin::Config& config)
+{
+    if (os_)
+        *os_ << "testWriteRead() " << config.binaryDataEncoderConfig << " chunkSize: " << config.chunkSize << endl;
+
+    string filename = testFilename();
+
+    {
+        MSData msd2;
+        Serializer_mzBin serializer(config);
+        IterationListenerRegistry ilr;
+        serializer.write(filename, msd, &ilr);
+
+        serializer.read(filename, msd2);
+
+        References::resolve(msd2);
+
+        Diff<MSData, DiffConfig> diff(msd, msd2);
+        if (os_ && diff)
+            *os_ << diff << endl;
+        unit_assert(!diff);
+    }
+
+    bfs::remove(filename);
+}
+
+
+void testWriteRead()
+{
+    MSData msd;
+    examples::initializeTiny(msd);
+
+    // test with 64 bit precision
+    Serializer_mzBin::Config config;
+    config.binaryDataEncoderConfig.precision = BinaryDataEncoder::Precision_64;
+    testWriteRead(msd, config);
+
+    // test with 32 bit precision
+    config.binaryDataEncoderConfig.precision = BinaryDataEncoder::Precision_32;
+    config.binaryDataEncoderConfig.precisionOverrides[MS_m_z_array] = BinaryDataEncoder::Precision_32;
+    config.binaryDataEncoderConfig.precisionOverrides[MS_intensity_array] = BinaryDataEncoder::Precision_32;
+    config.binaryDataEncoderConfig.precisionOverrides[MS_time_array] = BinaryDataEncoder::Precision_32;
+    testWriteRead(msd, config);
+
+    // test with one item per chunk
+    config.chunkSize = 1;
+    testWriteRead(msd, config);
+}
+
+
+void testStream()
+{
+    MSData msd;
+    examples::initializeTiny(msd);
+
+    ostringstream oss;
+    Serializer_mzBin().write(oss, msd);
+    unit_assert(Serializer_mzBin::hasSignature(oss.str()));
+    unit_assert(!Serializer_mzBin::hasSignature("<?xml version=\"1.0\" encoding=\"utf-8\"?>"));
+
+    string filename = testFilename();
+    {
+        ofstream os(filename.c_str(), ios::binary);
+        os << oss.str();
+    }
+
+    {
+        MSData msd2;
+        Serializer_mzBin().read(filename, msd2);
+        References::resolve(msd2);
+        Diff<MSData, DiffConfig> diff(msd, msd2);
+        if (os_ && diff)
+            *os_ << diff << endl;
+        unit_assert(!diff);
+    }
+
+    // a truncated file is rejected
+    {
+        ofstream os(filename.c_str(), ios::binary);
+        os << oss.str().substr(0, oss.str().size() / 2);
+    }
+
+    MSData msd3;
+    unit_assert_throws(Serializer_mzBin().read(filename, msd3), runtime_error);
+
+    bfs::remove(filename);
+}
+
+
+void testInstantMetadata()
+{
+    MSData msd;
+    examples::initializeTiny(msd);
+
+    string filename = testFilename();
+
+    {
+        Serializer_mzBin().write(filename, msd);
+
+        MSData msd2;
+        Serializer_mzBin().read(filename, msd2);
+        SpectrumList& sl = *msd2.run.spectrumListPtr;
+        unit_assert_operator_equal(msd.run.spectrumListPtr->size(), sl.size());
+        unit_assert_operator_equal(1, sl.find("scan=20"));
+        unit_assert_operator_equal(sl.size(), sl.find("bogus"));
+
+        for (size_t i=0; i < sl.size(); ++i)
+        {
+            SpectrumPtr expected = msd.run.spectrumListPtr->spectrum(i, false);
+            SpectrumPtr instant = sl.spectrum(i, DetailLevel_InstantMetadata);
+
+            unit_assert_operator_equal(expected->id, instant->id);
+            unit_assert_operator_equal(expected->defaultArrayLength, instant->defaultArrayLength);
+            unit_assert_operator_equal(expected->cvParam(MS_ms_level).valueAs<int>(),
+                                       instant->cvParam(MS_ms_level).valueAs<int>());
+            unit_assert(instant->binaryDataArrayPtrs.empty());
+
+            if (!expected->scanList.scans.empty() && expected->scanList.scans[0].hasCVParam(MS_scan_start_time))
+            {
+                unit_assert_operator_equal(1, instant->scanList.scans.size());
+                unit_assert_equal(expected->scanList.scans[0].cvParam(MS_scan_start_time).timeInSeconds(),
+                                  instant->scanList.scans[0].cvParam(MS_scan_start_time).timeInSeconds(), 1e-10);
+            }
+            else
+                unit_assert(instant->scanList.scans.empty());
+
+            if (!expected->precursors.empty())
+            {
+                unit_assert_operator_equal(1, instant->precursors.size());
+                const SelectedIon& expectedIon = expected->precursors[0].selectedIons[0];
+                const SelectedIon& instantIon = instant->precursors[0].selectedIons[0];
+                unit_assert_equal(expectedIon.cvParam(MS_selected_ion_m_z).valueAs<double>(),
+                                  instantIon.cvParam(MS_selected_ion_m_z).valueAs<double>(), 1e-10);
+                unit_assert_operator_equal(expectedIon.cvParam(MS_charge_state).value,
+                                           instantIon.cvParam(MS_charge_state).value);
+            }
+            else
+                unit_assert(instant->precursors.empty());
+
+            // metadata without data has the arrays' params but not their values
+            SpectrumPtr metadata = sl.spectrum(i, false);
+            unit_assert_operator_equal(expected->binaryDataArrayPtrs.size(), metadata->binaryDataArrayPtrs.size());
+            for (size_t j=0; j < metadata->binaryDataArrayPtrs.size(); ++j)
+                unit_assert(metadata->binaryDataArrayPtrs[j]->data.empty());
+        }
+    }
+
+    bfs::remove(filename);
+}
+
+
+void testParallelRead()
+{
+    // enough spectra for several chunks
+    MSData msd;
+    examples::initializeTiny(msd);
+    SpectrumListSimplePtr sl(new SpectrumListSimple);
+    const SpectrumList& tinyList = *msd.run.spectrumListPtr;
+    for (size_t i=0; i < 500; ++i)
+    {
+        SpectrumPtr s(new Spectrum(*tinyList.spectrum(i % tinyList.size(), true)));
+        s->index = i;
+        s->id = "scan=" + lexical_cast<string>(i);
+        sl->spectra.push_back(s);
+    }
+    msd.run.spectrumListPtr = sl;
+
+    string filename = testFilename();
+
+    {
+        Serializer_mzBin::Config config;
+        config.chunkSize = 4096;
+        Serializer_mzBin(config).write(filename, msd);
+
+        MSData msd2;
+        Serializer_mzBin().read(filename, msd2);
+        unit_assert_operator_equal(sl->size(), msd2.run.spectrumListPtr->size());
+
+        SpectrumWorkerThreads workers(*msd2.run.spectrumListPtr);
+        for (size_t i=0; i < sl->size(); ++i)
+        {
+            SpectrumPtr s = workers.processBatch(i);
+            unit_assert_operator_equal(i, s->index);
+
+            Diff<Spectrum, DiffConfig> diff(*sl->spectra[i], *s);
+            if (os_ && diff)
+                *os_ << diff << endl;
+            unit_assert(!diff);
+        }
+    }
+
+    bfs::remove(filename);
+}
+
+
+int main(int argc, char* argv[])
+{
+    TEST_PROLOG(argc, argv)
+
+    try
+    {
+        if (argc > 1 && !strcmp(argv[1], "-v"))
+            os_ = &cout;
+
+        testWriteRead();
+        testStream();
+        testInstantMetadata();
+        testParallelRead();
+    }
+    catch (exception& e)
+    {
+        TEST_FAILED(e.what())
+    }
+    catch (...)
+    {
+        TEST_FAILED("Caught unknown exception.")
+    }
+
+    TEST_EPILOG
+}
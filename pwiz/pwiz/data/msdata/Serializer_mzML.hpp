@@ -50,7 +50,10 @@ class PWIZ_API_DECL Serializer_mzML
         /// (indexed==true): read/write with <indexedmzML> wrapper
         bool indexed;
 
-        Config() : indexed(true) {}
+        /// number of threads reading spectra ahead in write(); 0 starts one per processor core
+        size_t maxThreadCount;
+
+        Config() : indexed(true), maxThreadCount(0) {}
     };
 
     /// constructor
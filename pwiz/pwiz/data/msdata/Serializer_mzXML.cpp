@@ -701,7 +701,7 @@ void write_scans(XMLWriter& xmlWriter, const MSData& msd,
     if (!sl.get()) return;
 
     CVID defaultNativeIdFormat = id::getDefaultNativeIDFormat(msd);
-    SpectrumWorkerThreads spectrumWorkers(*sl);
+    SpectrumWorkerThreads spectrumWorkers(*sl, config.maxThreadCount);
 
     for (size_t i=0; i<sl->size(); i++)
     {
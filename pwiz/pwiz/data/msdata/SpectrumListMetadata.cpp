@@ -0,0 +1,221 @@
+//
+// $Id$
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#define PWIZ_SOURCE
+
+#include "SpectrumListMetadata.hpp"
+#include "SpectrumListWrapper.hpp"
+#include "SpectrumWorkerThreads.hpp"
+#include "pwiz/utility/misc/Std.hpp"
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+
+namespace pwiz {
+namespace msdata {
+
+
+// the table of a list, kept by the list itself
+struct SpectrumListMetadataCache
+{
+    boost::mutex mutex; // held while the table is built
+    SpectrumListMetadataPtr table;
+};
+
+
+namespace {
+
+// held while a list's cache is created
+boost::mutex cacheCreationMutex_;
+
+} // namespace
+
+
+PWIZ_API_DECL SpectrumListMetadata::SpectrumListMetadata(const SpectrumList& sl)
+{
+    size_t size = sl.size();
+    spectrumType.resize(size, CVID_Unknown);
+    msLevel.resize(size, 0);
+    scanStartTime.resize(size, 0);
+    precursorMZ.resize(size, 0);
+    precursorCharge.resize(size, 0);
+    totalIonCurrent.resize(size, 0);
+    basePeakMZ.resize(size, 0);
+    basePeakIntensity.resize(size, 0);
+    precursorIndex.resize(size, size);
+    parentIndex.resize(size, size);
+    activation.resize(size, CVID_Unknown);
+    polarity.resize(size, CVID_Unknown);
+
+    if (size == 0)
+        return;
+
+    SpectrumWorkerThreads workerThreads(sl);
+    vector<size_t> lastIndexByMSLevel; // the last spectrum seen at each MS level
+
+    for (size_t i=0; i < size; ++i)
+    {
+        SpectrumPtr s = workerThreads.processBatch(i, DetailLevel_FullMetadata);
+
+        spectrumType[i] = s->cvParamChild(MS_spectrum_type).cvid;
+        msLevel[i] = s->cvParam(MS_ms_level).valueAs<int>();
+        totalIonCurrent[i] = s->cvParam(MS_total_ion_current).valueAs<double>();
+        basePeakMZ[i] = s->cvParam(MS_base_peak_m_z).valueAs<double>();
+        basePeakIntensity[i] = s->cvParam(MS_base_peak_intensity).valueAs<double>();
+        polarity[i] = s->cvParamChild(MS_scan_polarity).cvid;
+
+        if (!s->scanList.empty())
+            scanStartTime[i] = s->scanList.scans[0].cvParam(MS_scan_start_time).timeInSeconds();
+
+        bool hasSelectedIon = false;
+        for (size_t j=0; j < s->precursors.size() && !hasSelectedIon; ++j)
+            for (size_t k=0; k < s->precursors[j].selectedIons.size() && !hasSelectedIon; ++k)
+            {
+                const SelectedIon& selectedIon = s->precursors[j].selectedIons[k];
+                CVParam mz = selectedIon.cvParam(MS_selected_ion_m_z);
+                if (mz.cvid == CVID_Unknown)
+                    continue;
+                hasSelectedIon = true;
+                precursorMZ[i] = mz.valueAs<double>();
+                precursorCharge[i] = selectedIon.cvParam(MS_charge_state).valueAs<int>();
+            }
+
+        if (!s->precursors.empty())
+        {
+            const Precursor& precursor = s->precursors[0];
+            activation[i] = precursor.activation.cvParamChild(MS_dissociation_method).cvid;
+
+            // a precursor in another source file is not in this list
+            if (!precursor.spectrumID.empty() && !precursor.sourceFilePtr.get())
+                parentIndex[i] = precursorIndex[i] = sl.find(precursor.spectrumID);
+        }
+
+        if (parentIndex[i] == size)
+            for (int level = min(msLevel[i], (int) lastIndexByMSLevel.size()) - 1; level > 0; --level)
+                if (lastIndexByMSLevel[level] < size)
+                {
+                    parentIndex[i] = lastIndexByMSLevel[level];
+                    break;
+                }
+
+        if (msLevel[i] > 0)
+        {
+            if ((size_t) msLevel[i] >= lastIndexByMSLevel.size())
+                lastIndexByMSLevel.resize(msLevel[i] + 1, size);
+            lastIndexByMSLevel[msLevel[i]] = i;
+        }
+    }
+}
+
+
+PWIZ_API_DECL SpectrumListMetadata::SpectrumListMetadata(const SpectrumListMetadata& inner, const vector<size_t>& innerIndexMap)
+{
+    size_t size = innerIndexMap.size();
+    spectrumType.reserve(size);
+    msLevel.reserve(size);
+    scanStartTime.reserve(size);
+    precursorMZ.reserve(size);
+    precursorCharge.reserve(size);
+    totalIonCurrent.reserve(size);
+    basePeakMZ.reserve(size);
+    basePeakIntensity.reserve(size);
+    precursorIndex.reserve(size);
+    parentIndex.reserve(size);
+    activation.reserve(size);
+    polarity.reserve(size);
+
+    // maps inner index -> index in this table
+    vector<size_t> outerIndexMap(inner.size(), size);
+    for (size_t i=0; i < size; ++i)
+        outerIndexMap.at(innerIndexMap[i]) = i;
+
+    for (size_t i=0; i < size; ++i)
+    {
+        size_t innerIndex = innerIndexMap[i];
+        spectrumType.push_back(inner.spectrumType[innerIndex]);
+        msLevel.push_back(inner.msLevel[innerIndex]);
+        scanStartTime.push_back(inner.scanStartTime[innerIndex]);
+        precursorMZ.push_back(inner.precursorMZ[innerIndex]);
+        precursorCharge.push_back(inner.precursorCharge[innerIndex]);
+        totalIonCurrent.push_back(inner.totalIonCurrent[innerIndex]);
+        basePeakMZ.push_back(inner.basePeakMZ[innerIndex]);
+        basePeakIntensity.push_back(inner.basePeakIntensity[innerIndex]);
+        activation.push_back(inner.activation[innerIndex]);
+        polarity.push_back(inner.polarity[innerIndex]);
+
+        size_t innerPrecursorIndex = inner.precursorIndex[innerIndex];
+        precursorIndex.push_back(innerPrecursorIndex < inner.size() ? outerIndexMap[innerPrecursorIndex] : size);
+
+        size_t innerParentIndex = inner.parentIndex[innerIndex];
+        parentIndex.push_back(innerParentIndex < inner.size() ? outerIndexMap[innerParentIndex] : size);
+    }
+}
+
+
+shared_ptr<SpectrumListMetadataCache> SpectrumListMetadata::cache(const SpectrumList& sl)
+{
+    boost::lock_guard<boost::mutex> lock(cacheCreationMutex_);
+    if (!sl.metadataCache_)
+        sl.metadataCache_.reset(new SpectrumListMetadataCache);
+    return sl.metadataCache_;
+}
+
+
+PWIZ_API_DECL SpectrumListMetadataPtr SpectrumListMetadata::get(const SpectrumListPtr& sl)
+{
+    if (!sl.get()) throw runtime_error("[SpectrumListMetadata::get] null SpectrumListPtr");
+
+    shared_ptr<SpectrumListMetadataCache> cache = SpectrumListMetadata::cache(*sl);
+    boost::lock_guard<boost::mutex> lock(cache->mutex);
+    if (!cache->table)
+    {
+        const SpectrumListWrapper* wrapper = dynamic_cast<const SpectrumListWrapper*>(sl.get());
+        const vector<size_t>* innerIndexMap = wrapper ? wrapper->innerIndexMap() : 0;
+
+        // each list's table is built under its own lock, so the inner tables of nested wrappers can be built here
+        if (innerIndexMap)
+            cache->table.reset(new SpectrumListMetadata(*get(wrapper->inner()), *innerIndexMap));
+        else
+            cache->table.reset(new SpectrumListMetadata(*sl));
+    }
+    return cache->table;
+}
+
+
+PWIZ_API_DECL SpectrumListMetadataPtr SpectrumListMetadata::getIfBuilt(const SpectrumListPtr& sl)
+{
+    if (!sl.get()) throw runtime_error("[SpectrumListMetadata::getIfBuilt] null SpectrumListPtr");
+
+    shared_ptr<SpectrumListMetadataCache> cache = SpectrumListMetadata::cache(*sl);
+    boost::lock_guard<boost::mutex> lock(cache->mutex);
+    if (!cache->table)
+    {
+        const SpectrumListWrapper* wrapper = dynamic_cast<const SpectrumListWrapper*>(sl.get());
+        const vector<size_t>* innerIndexMap = wrapper ? wrapper->innerIndexMap() : 0;
+        if (!innerIndexMap)
+            return cache->table;
+
+        SpectrumListMetadataPtr innerTable = getIfBuilt(wrapper->inner());
+        if (innerTable.get())
+            cache->table.reset(new SpectrumListMetadata(*innerTable, *innerIndexMap));
+    }
+    return cache->table;
+}
+
+
+} // namespace msdata
+} // namespace pwiz
@@ -0,0 +1,78 @@
+//
+// $Id$
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef _SPECTRUMLISTMETADATA_HPP_
+#define _SPECTRUMLISTMETADATA_HPP_
+
+
+#include "pwiz/utility/misc/Export.hpp"
+#include "MSData.hpp"
+
+
+namespace pwiz {
+namespace msdata {
+
+
+/// columnar table of commonly used spectrum metadata for every spectrum in a SpectrumList;
+/// row i describes the spectrum at index i (its id is available from spectrumIdentity(i))
+struct PWIZ_API_DECL SpectrumListMetadata
+{
+    std::vector<CVID> spectrumType; ///< the MS_spectrum_type child, e.g. MS_MSn_spectrum; CVID_Unknown if unknown
+    std::vector<int> msLevel; ///< 0 if unknown
+    std::vector<double> scanStartTime; ///< in seconds, of the first scan; 0 if unknown
+    std::vector<double> precursorMZ; ///< the first selected ion m/z of any precursor; 0 if none
+    std::vector<int> precursorCharge; ///< the charge state of that selected ion; 0 if unknown
+    std::vector<double> totalIonCurrent; ///< 0 if unknown
+    std::vector<double> basePeakMZ; ///< 0 if unknown
+    std::vector<double> basePeakIntensity; ///< 0 if unknown
+    std::vector<size_t> precursorIndex; ///< the spectrum of the first precursor, if it is in this list; size() if none
+    std::vector<size_t> parentIndex; ///< precursorIndex, or else the last spectrum with a lower MS level; size() if none
+    std::vector<CVID> activation; ///< the first dissociation method of the first precursor; CVID_Unknown if none
+    std::vector<CVID> polarity; ///< MS_positive_scan, MS_negative_scan, or CVID_Unknown
+
+    size_t size() const {return msLevel.size();}
+
+    /// builds the table in one pass over the list's metadata, reading ahead on worker threads
+    explicit SpectrumListMetadata(const SpectrumList& sl);
+
+    /// builds the table of a list which selects and/or reorders the spectra of another list,
+    /// given the inner index of each of its spectra
+    SpectrumListMetadata(const SpectrumListMetadata& inner, const std::vector<size_t>& innerIndexMap);
+
+    /// returns the table for the list, building it on first use; the list keeps the table and shares
+    /// it with every later caller; a wrapper that reports an innerIndexMap() derives its table from
+    /// get(inner()), so a chain of such wrappers reads the spectra of the innermost list once
+    static boost::shared_ptr<const SpectrumListMetadata> get(const SpectrumListPtr& sl);
+
+    /// returns the table for the list if it is already built, or can be derived from the built table
+    /// of an inner list without reading any spectra; otherwise returns null
+    static boost::shared_ptr<const SpectrumListMetadata> getIfBuilt(const SpectrumListPtr& sl);
+
+    private:
+    static boost::shared_ptr<SpectrumListMetadataCache> cache(const SpectrumList& sl);
+};
+
+
+typedef boost::shared_ptr<const SpectrumListMetadata> SpectrumListMetadataPtr;
+
+
+} // namespace msdata
+} // namespace pwiz
+
+
+#endif // _SPECTRUMLISTMETADATA_HPP_
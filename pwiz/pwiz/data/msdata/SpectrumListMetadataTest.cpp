@@ -0,0 +1,234 @@
+//
+// $Id$
+//
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "SpectrumListMetadata.hpp"
+#include "SpectrumListWrapper.hpp"
+#include "examples.hpp"
+#include "pwiz/utility/misc/unit.hpp"
+#include "pwiz/utility/misc/Std.hpp"
+#include <cstring>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+
+using namespace pwiz::cv;
+using namespace pwiz::msdata;
+using namespace pwiz::util;
+
+
+ostream* os_ = 0;
+
+
+void testTiny()
+{
+    MSData msd;
+    examples::initializeTiny(msd);
+    SpectrumListPtr sl = msd.run.spectrumListPtr;
+
+    SpectrumListMetadataPtr metadata = SpectrumListMetadata::get(sl);
+    unit_assert_operator_equal(5, metadata->size());
+
+    if (os_)
+        for (size_t i=0; i < metadata->size(); ++i)
+            *os_ << sl->spectrumIdentity(i).id << " ms" << metadata->msLevel[i]
+                 << " rt=" << metadata->scanStartTime[i]
+                 << " precursor=" << metadata->precursorMZ[i] << "/" << metadata->precursorCharge[i]
+                 << " parent=" << metadata->parentIndex[i]
+                 << " activation=" << cvTermInfo(metadata->activation[i]).name << endl;
+
+    // scan=19
+    unit_assert_operator_equal(MS_MS1_spectrum, metadata->spectrumType[0]);
+    unit_assert_operator_equal(1, metadata->msLevel[0]);
+    unit_assert_equal(5.8905 * 60, metadata->scanStartTime[0], 1e-8);
+    unit_assert_operator_equal(0, metadata->precursorMZ[0]);
+    unit_assert_operator_equal(1.66755e+007, metadata->totalIonCurrent[0]);
+    unit_assert_operator_equal(445.347, metadata->basePeakMZ[0]);
+    unit_assert_operator_equal(120053, metadata->basePeakIntensity[0]);
+    unit_assert_operator_equal(5, metadata->precursorIndex[0]);
+    unit_assert_operator_equal(5, metadata->parentIndex[0]);
+    unit_assert_operator_equal(CVID_Unknown, metadata->activation[0]);
+
+    // scan=20
+    unit_assert_operator_equal(MS_MSn_spectrum, metadata->spectrumType[1]);
+    unit_assert_operator_equal(2, metadata->msLevel[1]);
+    unit_assert_equal(5.9905 * 60, metadata->scanStartTime[1], 1e-8);
+    unit_assert_operator_equal(445.34, metadata->precursorMZ[1]);
+    unit_assert_operator_equal(2, metadata->precursorCharge[1]);
+    unit_assert_operator_equal(0, metadata->parentIndex[1]);
+    unit_assert_operator_equal(MS_collision_induced_dissociation, metadata->activation[1]);
+
+    // scan=21 has no scans
+    unit_assert_operator_equal(1, metadata->msLevel[2]);
+    unit_assert_operator_equal(0, metadata->scanStartTime[2]);
+
+    // scan=22's precursor refers to scan=19
+    unit_assert_operator_equal(2, metadata->msLevel[3]);
+    unit_assert_operator_equal(545.34, metadata->precursorMZ[3]);
+    unit_assert_operator_equal(0, metadata->precursorIndex[3]);
+    unit_assert_operator_equal(0, metadata->parentIndex[3]);
+
+    // the table is shared
+    unit_assert(metadata == SpectrumListMetadata::get(sl));
+}
+
+
+// selects the MS2 spectra of the inner list in reverse order
+class ReversedMS2SpectrumList : public SpectrumListWrapper
+{
+    public:
+
+    ReversedMS2SpectrumList(const SpectrumListPtr& inner) : SpectrumListWrapper(inner)
+    {
+        for (size_t i=inner->size(); i > 0; --i)
+            if (inner->spectrum(i-1)->cvParam(MS_ms_level).valueAs<int>() == 2)
+                indexMap_.push_back(i-1);
+    }
+
+    virtual size_t size() const {return indexMap_.size();}
+    virtual const SpectrumIdentity& spectrumIdentity(size_t index) const {return inner_->spectrumIdentity(indexMap_.at(index));}
+    virtual SpectrumPtr spectrum(size_t index, bool getBinaryData = false) const {return inner_->spectrum(indexMap_.at(index), getBinaryData);}
+    virtual const vector<size_t>* innerIndexMap() const {return &indexMap_;}
+
+    private:
+    vector<size_t> indexMap_;
+};
+
+
+void testDerived()
+{
+    MSData msd;
+    examples::initializeTiny(msd);
+    SpectrumListPtr sl = msd.run.spectrumListPtr;
+    SpectrumListMetadataPtr innerMetadata = SpectrumListMetadata::get(sl);
+
+    SpectrumListPtr reversed(new ReversedMS2SpectrumList(sl));
+    SpectrumListMetadataPtr metadata = SpectrumListMetadata::get(reversed);
+    unit_assert_operator_equal(2, metadata->size());
+    unit_assert_operator_equal(545.34, metadata->precursorMZ[0]);
+    unit_assert_operator_equal(445.34, metadata->precursorMZ[1]);
+    unit_assert_operator_equal(innerMetadata->scanStartTime[1], metadata->scanStartTime[1]);
+
+    // the parent spectrum is not in the derived list
+    unit_assert_operator_equal(2, metadata->precursorIndex[0]);
+    unit_assert_operator_equal(2, metadata->parentIndex[0]);
+    unit_assert_operator_equal(2, metadata->parentIndex[1]);
+}
+
+
+// counts the spectra read from the inner list
+class CountingSpectrumList : public SpectrumListWrapper
+{
+    public:
+
+    CountingSpectrumList(const SpectrumListPtr& inner) : SpectrumListWrapper(inner), spectrumCount(0) {}
+
+    virtual SpectrumPtr spectrum(size_t index, bool getBinaryData = false) const
+    {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        ++spectrumCount;
+        return inner_->spectrum(index, getBinaryData);
+    }
+
+    mutable size_t spectrumCount;
+
+    private:
+    mutable boost::mutex mutex_;
+};
+
+
+void testChain()
+{
+    MSData msd;
+    examples::initializeTiny(msd);
+    boost::shared_ptr<CountingSpectrumList> counting(new CountingSpectrumList(msd.run.spectrumListPtr));
+
+    // the table of the outer wrapper is derived from the tables of the inner lists,
+    // which are built on the way and kept by those lists
+    SpectrumListPtr reversed(new ReversedMS2SpectrumList(counting));
+    SpectrumListPtr reversedTwice(new ReversedMS2SpectrumList(reversed));
+    size_t constructionCount = counting->spectrumCount;
+
+    // nothing is built yet, and getIfBuilt() does not build anything
+    unit_assert(!SpectrumListMetadata::getIfBuilt(reversedTwice).get());
+    unit_assert_operator_equal(constructionCount, counting->spectrumCount);
+
+    SpectrumListMetadataPtr metadata = SpectrumListMetadata::get(reversedTwice);
+    unit_assert_operator_equal(2, metadata->size());
+    unit_assert_operator_equal(445.34, metadata->precursorMZ[0]);
+    unit_assert_operator_equal(545.34, metadata->precursorMZ[1]);
+
+    size_t tableCount = counting->spectrumCount - constructionCount;
+    unit_assert(tableCount >= counting->size());
+
+    SpectrumListMetadataPtr innerMetadata = SpectrumListMetadata::get(reversed);
+    unit_assert_operator_equal(2, innerMetadata->size());
+    unit_assert_operator_equal(545.34, innerMetadata->precursorMZ[0]);
+    unit_assert_operator_equal(5, SpectrumListMetadata::get(counting)->size());
+    unit_assert_operator_equal(constructionCount + tableCount, counting->spectrumCount);
+
+    // a new wrapper of a list with a table derives its own table without reading any spectra
+    SpectrumListPtr reversedAgain(new ReversedMS2SpectrumList(counting));
+    size_t wrapperCount = counting->spectrumCount;
+    SpectrumListMetadataPtr builtMetadata = SpectrumListMetadata::getIfBuilt(reversedAgain);
+    unit_assert(builtMetadata.get());
+    unit_assert_operator_equal(545.34, builtMetadata->precursorMZ[0]);
+    unit_assert_operator_equal(wrapperCount, counting->spectrumCount);
+}
+
+
+void testCopy()
+{
+    MSData msd;
+    examples::initializeTiny(msd);
+    SpectrumListSimplePtr sl = boost::dynamic_pointer_cast<SpectrumListSimple>(msd.run.spectrumListPtr);
+    unit_assert(sl.get());
+    SpectrumListMetadataPtr metadata = SpectrumListMetadata::get(sl);
+
+    // a copy of a list may be changed independently, so it does not share the table
+    SpectrumListSimplePtr copy(new SpectrumListSimple(*sl));
+    copy->spectra.pop_back();
+    SpectrumListMetadataPtr copyMetadata = SpectrumListMetadata::get(copy);
+    unit_assert(metadata != copyMetadata);
+    unit_assert_operator_equal(5, metadata->size());
+    unit_assert_operator_equal(4, copyMetadata->size());
+}
+
+
+int main(int argc, char* argv[])
+{
+    TEST_PROLOG(argc, argv)
+
+    try
+    {
+        if (argc>1 && !strcmp(argv[1],"-v")) os_ = &cout;
+        testTiny();
+        testDerived();
+        testChain();
+        testCopy();
+    }
+    catch (exception& e)
+    {
+        TEST_FAILED(e.what())
+    }
+    catch (...)
+    {
+        TEST_FAILED("Caught unknown exception.")
+    }
+
+    TEST_EPILOG
+}
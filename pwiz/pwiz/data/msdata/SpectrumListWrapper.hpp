@@ -59,6 +59,10 @@ class PWIZ_API_DECL SpectrumListWrapper : public SpectrumList
 
     SpectrumListPtr inner() const {return inner_;}
 
+    /// for wrappers which only select and/or reorder the inner list's spectra without changing their metadata,
+    /// returns the inner index of each spectrum (e.g. to share SpectrumListMetadata with the inner list); otherwise null
+    virtual const std::vector<size_t>* innerIndexMap() const {return 0;}
+
     SpectrumListPtr innermost() const
     {
         if(dynamic_cast<SpectrumListWrapper*>(&*inner_))
@@ -39,6 +39,43 @@ using boost::iostreams::offset_to_position;
 
 namespace {
 
+/**
+ * Parse a peak list value. A plain decimal of at most 15 digits is an exact integer
+ * divided by an exact power of ten, so a single division rounds it the same as strtod
+ * (Clinger's fast path); other values (exponents, longer mantissas, inf/nan) go to strtod.
+ */
+double parsePeakValue(const char* str, const char** end)
+{
+    static const double powersOf10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+                                        1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+
+    const char* p = str;
+    bool negative = *p == '-';
+    if (negative || *p == '+')
+        ++p;
+
+    boost::uint64_t mantissa = 0;
+    int digits = 0, fractionDigits = 0;
+    for (; *p >= '0' && *p <= '9'; ++p, ++digits)
+        mantissa = mantissa * 10 + (*p - '0');
+    if (*p == '.')
+        for (++p; *p >= '0' && *p <= '9'; ++p, ++digits, ++fractionDigits)
+            mantissa = mantissa * 10 + (*p - '0');
+
+    if (digits == 0 || digits > 15 || *p == 'e' || *p == 'E' || *p == 'x' || *p == 'X')
+    {
+        char* strtodEnd;
+        double value = STRTOD(str, &strtodEnd);
+        *end = strtodEnd;
+        return value;
+    }
+
+    *end = p;
+    double value = double(mantissa) / powersOf10[fractionDigits];
+    return negative ? -value : value;
+}
+
+
 class SpectrumList_MGFImpl : public SpectrumList_MGF
 {
     public:
@@ -90,8 +127,7 @@ class SpectrumList_MGFImpl : public SpectrumList_MGF
 
     SpectrumPtr spectrum(size_t index, bool getBinaryData) const
     {
-        boost::lock_guard<boost::mutex> lock(readMutex);  // lock_guard will unlock mutex when out of scope or when exception thrown (during destruction)
-        if (index > index_.size())
+        if (index >= index_.size())
             throw runtime_error("[SpectrumList_MGF::spectrum] Index out of bounds");
 
         // allocate Spectrum object and read it in
@@ -102,11 +138,21 @@ class SpectrumList_MGFImpl : public SpectrumList_MGF
         result->index = index;
         result->sourceFilePosition = index_[index].sourceFilePosition;
 
-        is_->seekg(bio::offset_to_position(result->sourceFilePosition));
-        if (!*is_)
-            throw runtime_error("[SpectrumList_MGF::spectrum] Error seeking to BEGIN IONS tag");
+        // only reading the spectrum's text is serialized; it is parsed while other threads read theirs
+        string text;
+        {
+            boost::lock_guard<boost::mutex> lock(readMutex);  // lock_guard will unlock mutex when out of scope or when exception thrown (during destruction)
+            is_->clear();
+            is_->seekg(bio::offset_to_position(result->sourceFilePosition));
+            if (!*is_)
+                throw runtime_error("[SpectrumList_MGF::spectrum] Error seeking to BEGIN IONS tag");
+
+            text.resize(size_t(spectrumEnds_[index] - result->sourceFilePosition));
+            is_->read(&text[0], text.size());
+            text.resize(size_t(is_->gcount()));
+        }
 
-        parseSpectrum(*result, getBinaryData);
+        parseSpectrum(*result, text, getBinaryData);
 
         // resolve any references into the MSData object
         References::resolve(*result, msd_);
@@ -118,11 +164,18 @@ class SpectrumList_MGFImpl : public SpectrumList_MGF
     shared_ptr<istream> is_;
     const MSData& msd_;
     vector<SpectrumIdentity> index_;
+    vector<stream_offset> spectrumEnds_; // offset following each spectrum's END IONS line
     map<string, size_t> idToIndex_;
     map<string, IndexList> titleIDToIndexList_;
     mutable boost::mutex readMutex;
 
-    void parseSpectrum(Spectrum& spectrum, bool getBinaryData) const
+    static bool startsWith(const char* begin, const char* end, const char* prefix)
+    {
+        size_t length = strlen(prefix);
+        return size_t(end - begin) >= length && !memcmp(begin, prefix, length);
+    }
+
+    void parseSpectrum(Spectrum& spectrum, const string& text, bool getBinaryData) const
     {
         // Every MGF spectrum is assumed to be:
         // * MSn spectrum
@@ -158,48 +211,57 @@ class SpectrumList_MGFImpl : public SpectrumList_MGF
         spectrum.setMZIntensityArrays(vector<double>(), vector<double>(), MS_number_of_detector_counts);
         vector<double>& mzArray = spectrum.getMZArray()->data;
         vector<double>& intensityArray = spectrum.getIntensityArray()->data;
-	    while (getline(*is_, lineStr))
+
+        const char* textBegin = text.c_str();
+        const char* textEnd = textBegin + text.length();
+        const char* nextLine = textBegin;
+	    while (nextLine < textEnd)
 	    {
-            size_t lineBegin = lineStr.find_first_not_of(" \t");
-            if (lineBegin == string::npos)
+            const char* lineBegin = nextLine;
+            const char* lineEnd = static_cast<const char*>(memchr(lineBegin, '\n', textEnd - lineBegin));
+            if (!lineEnd)
+                lineEnd = textEnd;
+            nextLine = lineEnd + 1;
+            stream_offset lineOffset = spectrum.sourceFilePosition + (lineBegin - textBegin);
+
+            // Trim leading whitespace
+            while (lineBegin < lineEnd && (*lineBegin == ' ' || *lineBegin == '\t'))
+                ++lineBegin;
+            if (lineBegin == lineEnd)
             {
                 // Skip blank lines
                 continue;
             }
-            else if (lineBegin > 0)
-            {
-                // Trim leading whitespace
-                lineStr.erase(0, lineBegin);
-            }
 
-            if (!inBeginIons && (lineStr[0] == '#' || lineStr[0] == ';' || lineStr[0] == '!' || lineStr[0] == '/'))
+            if (!inBeginIons && (*lineBegin == '#' || *lineBegin == ';' || *lineBegin == '!' || *lineBegin == '/'))
             {
                 // Skip comment lines (lines beginning with #;!/ outside of BEGIN IONS)
                 continue;
             }
-		    if (lineStr.find("BEGIN IONS") == 0)
+		    if (startsWith(lineBegin, lineEnd, "BEGIN IONS"))
 		    {
 			    if (inBeginIons)
 			    {
                     throw runtime_error(("[SpectrumList_MGF::parseSpectrum] BEGIN IONS tag found without previous BEGIN IONS being closed at offset " +
-                                         lexical_cast<string>(size_t(is_->tellg())-lineStr.length()-1) + "\n"));
+                                         lexical_cast<string>(lineOffset) + "\n"));
 			    }
 			    inBeginIons = true;
 		    }
-            else if (lineStr.find("END IONS") == 0)
+            else if (startsWith(lineBegin, lineEnd, "END IONS"))
 		    {
 			    if (!inBeginIons)
 				    throw runtime_error(("[SpectrumList_MGF::parseSpectrum] END IONS tag found without opening BEGIN IONS tag at offset " +
-                                         lexical_cast<string>(size_t(is_->tellg())-lineStr.length()-1) + "\n"));
+                                         lexical_cast<string>(lineOffset) + "\n"));
 			    inBeginIons = false;
                 inPeakList = false;
                 break;
             }
             else
             {
-                try
+                if (!inPeakList)
                 {
-                    if (!inPeakList)
+                    lineStr.assign(lineBegin, lineEnd);
+                    try
                     {
                         size_t delim = lineStr.find('=');
                         if (delim == string::npos)
@@ -270,28 +332,36 @@ class SpectrumList_MGFImpl : public SpectrumList_MGF
 				            }
                         }
                     }
-                }
-                catch(bad_lexical_cast&)
-                {
-                    throw runtime_error(("[SpectrumList_MGF::parseSpectrum] Error parsing line at offset " +
-                                        lexical_cast<string>(size_t(is_->tellg())-lineStr.length()-1) + ": " + lineStr + "\n"));
+                    catch(bad_lexical_cast&)
+                    {
+                        throw runtime_error(("[SpectrumList_MGF::parseSpectrum] Error parsing line at offset " +
+                                            lexical_cast<string>(lineOffset) + ": " + lineStr + "\n"));
+                    }
                 }
 
                 if (inPeakList)
                 {
-                    // always parse the peaks (intensity must be summed to build TIC)
-                    size_t delim = lineStr.find_first_of(" \t");
-				    if(delim == string::npos)
+                    // always parse the peaks (intensity must be summed to build TIC);
+                    // the values are converted in place; the text ends in a null, so parsing stops at the end of the last line
+                    const char* delim = lineBegin;
+                    while (delim < lineEnd && *delim != ' ' && *delim != '\t')
+                        ++delim;
+				    if (delim == lineEnd)
 					    continue;
-                    size_t delim2 = lineStr.find_first_not_of(" \t", delim+1);
-     				if(delim2 == string::npos)
+                    const char* delim2 = delim;
+                    while (delim2 < lineEnd && (*delim2 == ' ' || *delim2 == '\t'))
+                        ++delim2;
+     				if (delim2 == lineEnd)
 					    continue;
-                    size_t delim3 = lineStr.find_first_of(" \t\r\n", delim2);
-				    if(delim3 == string::npos)
-                        delim3 = lineStr.length();
 
-                    double mz = lexical_cast<double>(lineStr.substr(0, delim));
-				    double inten = lexical_cast<double>(lineStr.substr(delim2, delim3-delim2));
+                    const char* mzEnd;
+                    const char* intenEnd;
+                    double mz = parsePeakValue(lineBegin, &mzEnd);
+				    double inten = parsePeakValue(delim2, &intenEnd);
+                    if (mzEnd == lineBegin || intenEnd == delim2)
+                        throw runtime_error(("[SpectrumList_MGF::parseSpectrum] Error parsing peak at offset " +
+                                            lexical_cast<string>(lineOffset) + ": " + string(lineBegin, lineEnd) + "\n"));
+
 				    tic += inten;
                     if (inten > basePeakIntensity)
                     {
@@ -392,49 +462,95 @@ class SpectrumList_MGFImpl : public SpectrumList_MGF
 
     void createIndex()
     {
-        string lineStr;
+        // the file is read in large blocks; lines are found with memchr and only a line
+        // continued in the next block is copied
+        const size_t bufferSize = 1024 * 1024;
+        vector<char> buffer(bufferSize);
+        string partialLine;
+        stream_offset lineOffset = is_->tellg();
 	    size_t lineCount = 0;
 	    bool inBeginIons = false;
-        vector<SpectrumIdentity>::iterator curIdentityItr;
-        map<string, size_t>::iterator curIdToIndexItr;
 
-	    while (getline(*is_, lineStr))
+	    while (*is_)
 	    {
-		    ++lineCount;
-		    if (lineStr.find("BEGIN IONS") == 0)
-		    {
-			    if (inBeginIons)
-			    {
-                    throw runtime_error(("[SpectrumList_MGF::createIndex] BEGIN IONS tag found without previous BEGIN IONS being closed at line " +
-                                         lexical_cast<string>(lineCount) + "\n"));
+            is_->read(&buffer[0], bufferSize);
+            const char* nextLine = &buffer[0];
+            const char* bufferEnd = nextLine + is_->gcount();
+            while (nextLine < bufferEnd)
+            {
+                const char* lineEnd = static_cast<const char*>(memchr(nextLine, '\n', bufferEnd - nextLine));
+                if (!lineEnd)
+                {
+                    partialLine.append(nextLine, bufferEnd);
+                    break;
+                }
 
-			    }
-                index_.push_back(SpectrumIdentity());
-			    curIdentityItr = index_.begin() + (index_.size()-1);
-                curIdentityItr->index = index_.size()-1;
-                curIdentityItr->id = "index=" + lexical_cast<string>(index_.size()-1);
-			    curIdentityItr->sourceFilePosition = size_t(is_->tellg())-lineStr.length()-1;
-                curIdToIndexItr = idToIndex_.insert(pair<string, size_t>(curIdentityItr->id, index_.size()-1)).first;
-			    inBeginIons = true;
-		    }
-            else if (lineStr.find("TITLE=") == 0)
-	    {
-                // if a title is found, use it as the id in the index used by findSpotID
-	        string title = lineStr.substr(6);
-                bal::trim(title);
-		titleIDToIndexList_[title].push_back(index_.size()-1);
-	    }
-            else if (lineStr.find("END IONS") == 0)
-		    {
-			    if (!inBeginIons)
-				    throw runtime_error(("[SpectrumList_MGF::createIndex] END IONS tag found without opening BEGIN IONS tag at line " +
-                                         lexical_cast<string>(lineCount) + "\n"));
-			    inBeginIons = false;
+                if (partialLine.empty())
+                {
+                    indexLine(nextLine, lineEnd, lineOffset, ++lineCount, inBeginIons);
+                    lineOffset += (lineEnd - nextLine) + 1;
+                }
+                else
+                {
+                    partialLine.append(nextLine, lineEnd);
+                    indexLine(partialLine.c_str(), partialLine.c_str() + partialLine.length(), lineOffset, ++lineCount, inBeginIons);
+                    lineOffset += partialLine.length() + 1;
+                    partialLine.clear();
+                }
+                nextLine = lineEnd + 1;
             }
         }
+
+        // last line without a newline
+        if (!partialLine.empty())
+        {
+            indexLine(partialLine.c_str(), partialLine.c_str() + partialLine.length(), lineOffset, ++lineCount, inBeginIons);
+            lineOffset += partialLine.length();
+        }
+
+        // a spectrum without END IONS runs to the end of the file
+        if (inBeginIons)
+            spectrumEnds_.back() = lineOffset;
+
         is_->clear();
         is_->seekg(0);
     }
+
+    void indexLine(const char* lineBegin, const char* lineEnd, stream_offset lineOffset, size_t lineCount, bool& inBeginIons)
+    {
+	    if (startsWith(lineBegin, lineEnd, "BEGIN IONS"))
+	    {
+		    if (inBeginIons)
+		    {
+                throw runtime_error(("[SpectrumList_MGF::createIndex] BEGIN IONS tag found without previous BEGIN IONS being closed at line " +
+                                     lexical_cast<string>(lineCount) + "\n"));
+
+		    }
+            index_.push_back(SpectrumIdentity());
+		    SpectrumIdentity& identity = index_.back();
+            identity.index = index_.size()-1;
+            identity.id = "index=" + lexical_cast<string>(index_.size()-1);
+		    identity.sourceFilePosition = lineOffset;
+            idToIndex_.insert(pair<string, size_t>(identity.id, index_.size()-1));
+            spectrumEnds_.push_back(lineOffset);
+		    inBeginIons = true;
+	    }
+        else if (startsWith(lineBegin, lineEnd, "TITLE="))
+        {
+            // if a title is found, use it as the id in the index used by findSpotID
+            string title(lineBegin + 6, lineEnd);
+            bal::trim(title);
+            titleIDToIndexList_[title].push_back(index_.size()-1);
+        }
+        else if (startsWith(lineBegin, lineEnd, "END IONS"))
+	    {
+		    if (!inBeginIons)
+			    throw runtime_error(("[SpectrumList_MGF::createIndex] END IONS tag found without opening BEGIN IONS tag at line " +
+                                     lexical_cast<string>(lineCount) + "\n"));
+            spectrumEnds_.back() = lineOffset + (lineEnd - lineBegin) + 1;
+		    inBeginIons = false;
+        }
+    }
 };
 
 
@@ -26,6 +26,7 @@
 #include "pwiz/utility/minimxml/XMLWriter.hpp"
 #include "pwiz/utility/misc/unit.hpp"
 #include "pwiz/utility/misc/Std.hpp"
+#include "boost/thread/thread.hpp"
 
 using namespace pwiz::cv;
 using namespace pwiz::msdata;
@@ -175,6 +176,78 @@ void test()
 }
 
 
+// an MGF larger than the indexing buffer, with CRLF line endings and
+// without a final END IONS (or newline), so lines span buffer reads
+string manySpectraMGF(size_t spectrumCount)
+{
+    ostringstream oss;
+    for (size_t i=0; i < spectrumCount; ++i)
+    {
+        oss << "BEGIN IONS\r\n"
+            << "TITLE=spectrum " << i << "\r\n"
+            << "PEPMASS=" << 400 + i << "\r\n"
+            << "CHARGE=2+\r\n";
+        for (size_t j=0; j < 10; ++j)
+            oss << 100 + i + j << ".25 " << j + 1 << "\r\n";
+        if (i+1 < spectrumCount)
+            oss << "END IONS\r\n";
+    }
+    return oss.str().substr(0, oss.str().length() - 2);
+}
+
+
+void checkManySpectra(const SpectrumList* sl, size_t first, size_t step)
+{
+    for (size_t i=first; i < sl->size(); i += step)
+    {
+        SpectrumPtr s = sl->spectrum(i, true);
+        unit_assert(s->index == i);
+        unit_assert(s->cvParam(MS_spectrum_title).value == "spectrum " + lexical_cast<string>(i));
+        unit_assert_equal(s->precursors[0].selectedIons[0].cvParam(MS_selected_ion_m_z).valueAs<double>(), 400.0 + i, 1e-10);
+        unit_assert(s->precursors[0].selectedIons[0].cvParam(MS_charge_state).value == "2");
+
+        vector<MZIntensityPair> pairs;
+        s->getMZIntensityPairs(pairs);
+        unit_assert(pairs.size() == 10);
+        for (size_t j=0; j < pairs.size(); ++j)
+        {
+            unit_assert_equal(pairs[j].mz, 100.25 + i + j, 1e-10);
+            unit_assert_equal(pairs[j].intensity, j + 1.0, 1e-10);
+        }
+        unit_assert_equal(s->cvParam(MS_total_ion_current).valueAs<double>(), 55, 1e-10);
+    }
+}
+
+
+void testManySpectra()
+{
+    if (os_) *os_ << "testManySpectra()\n";
+
+    const size_t spectrumCount = 10000;
+    string mgf = manySpectraMGF(spectrumCount);
+    unit_assert(mgf.length() > 1024 * 1024);
+
+    shared_ptr<istream> is(new istringstream(mgf));
+    MSData dummy;
+    SpectrumListPtr sl = SpectrumList_MGF::create(is, dummy);
+    unit_assert(sl->size() == spectrumCount);
+    unit_assert(sl->findSpotID("spectrum 4321").size() == 1);
+    unit_assert(sl->findSpotID("spectrum 4321")[0] == 4321);
+
+    for (size_t i=0; i < spectrumCount; i += 997)
+        unit_assert(mgf.compare(sl->spectrumIdentity(i).sourceFilePosition, 10, "BEGIN IONS") == 0);
+
+    // spectra parsed by several threads at once
+    const size_t threadCount = 4;
+    boost::thread_group threads;
+    for (size_t i=0; i < threadCount; ++i)
+        threads.add_thread(new boost::thread(checkManySpectra, sl.get(), i, threadCount));
+    threads.join_all();
+
+    unit_assert_throws(sl->spectrum(spectrumCount), runtime_error);
+}
+
+
 int main(int argc, char* argv[])
 {
     TEST_PROLOG(argc, argv)
@@ -183,6 +256,7 @@ int main(int argc, char* argv[])
     {
         if (argc>1 && !strcmp(argv[1],"-v")) os_ = &cout;
         test();
+        testManySpectra();
     }
     catch (exception& e)
     {
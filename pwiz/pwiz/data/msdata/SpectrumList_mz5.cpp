@@ -112,22 +112,53 @@ private:
      */
     boost::shared_ptr<Connection_mz5> conn_;
     /**
-     * List of meta information.
+     * List of meta information. The elements of blocks which are not read yet are zero.
      */
     mutable SpectrumMZ5* spectrumData_;
     /**
-     * List of binary data meta information.
+     * List of binary data meta information. The elements of blocks which are not read yet are zero.
      */
     mutable BinaryDataMZ5* binaryParamsData_;
     mutable std::vector<SpectrumIdentity> spectrumIdentityList_;
-    mutable std::map<size_t, std::pair<hsize_t, hsize_t> > spectrumRanges_;
+    mutable std::vector<std::pair<hsize_t, hsize_t> > spectrumRanges_;
     mutable std::map<std::string, size_t> idMap_;
     mutable std::map<std::string, IndexList> spotMap_;
     size_t numberOfSpectra_;
+    /**
+     * Number of spectra whose meta information is read at once; the chunk size of the meta information datasets.
+     */
+    mutable hsize_t blockSize_;
+    mutable std::vector<bool> blockLoaded_;
     mutable bool initSpectra_;
+    mutable bool initIdMaps_;
+    /**
+     * Guards the initialization and the reading of meta information blocks.
+     * The meta information of a spectrum does not change once it is read, so spectra are translated outside this lock.
+     */
     mutable boost::mutex readMutex;
 
+    /**
+     * Reads the spectrum index. Reads the meta information of all spectra too, unless the spectrum load policy is SLP_OnDemand.
+     */
     void initSpectra() const;
+
+    /**
+     * Reads the meta information of a block of spectra, if it is not read yet.
+     * @param block block index
+     */
+    void loadBlock(size_t block) const;
+
+    /**
+     * Reads the meta information of a spectrum and of the spectra referenced by its precursors and scans,
+     * so that ReferenceRead_mz5 knows their ids.
+     * @param index spectrum index
+     */
+    void loadSpectrum(size_t index) const;
+
+    /**
+     * Reads the meta information of all spectra and fills the id and spot id maps.
+     */
+    void initIdMaps() const;
 };
 
 SpectrumList_mz5Impl::~SpectrumList_mz5Impl()
@@ -154,6 +185,8 @@ SpectrumList_mz5Impl::SpectrumList_mz5Impl(boost::shared_ptr<ReferenceRead_mz5>
     : msd_(msd), rref_(readPtr), conn_(connectionPtr)
 {
     initSpectra_ = false;
+    initIdMaps_ = false;
+    blockSize_ = 0;
 
     setDataProcessingPtr(readPtr->getDefaultSpectrumDP(0));
 
@@ -178,6 +211,7 @@ void SpectrumList_mz5Impl::initSpectra() const
             index.resize(numberOfSpectra_);
             size_t dsend;
             conn_->readDataSet(Configuration_mz5::SpectrumIndex, dsend, &index[0]);
+            spectrumRanges_.resize(numberOfSpectra_);
             hsize_t last = 0, current = 0;
             hsize_t overflow_correction = 0; // mz5 writes these as 32 bit values, so deal with overflow
             for (size_t i = 0; i < index.size(); ++i)
@@ -188,29 +222,91 @@ void SpectrumList_mz5Impl::initSpectra() const
                     overflow_correction += 0x0100000000; // This assumes no scan has more than 4GB of peak data
                     current = static_cast<hsize_t> (index[i]) + overflow_correction;
                 }
-                spectrumRanges_.insert(make_pair(i, make_pair(last, current)));
+                spectrumRanges_[i] = make_pair(last, current);
                 last = current;
             }
 
-            spectrumData_ = (SpectrumMZ5*) calloc(numberOfSpectra_, sizeof(SpectrumMZ5));
-            conn_->readDataSet(Configuration_mz5::SpectrumMetaData, dsend, spectrumData_);
+            // blocks aligned to the chunks of the file decompress each chunk once;
+            // files without chunks are read in blocks of the default chunk size
+            blockSize_ = conn_->getChunkSize(Configuration_mz5::SpectrumMetaData);
+            if (blockSize_ == Configuration_mz5::EMPTY_CHUNK_SIZE)
+                blockSize_ = Configuration_mz5().getChunkSizeFor(Configuration_mz5::SpectrumMetaData);
+            if (blockSize_ == Configuration_mz5::EMPTY_CHUNK_SIZE)
+                blockSize_ = numberOfSpectra_;
+            blockLoaded_.assign((numberOfSpectra_ + blockSize_ - 1) / blockSize_, false);
 
-            binaryParamsData_ = (BinaryDataMZ5*) calloc(dsend, sizeof(BinaryDataMZ5));
-            conn_->readDataSet(Configuration_mz5::SpectrumBinaryMetaData, dsend, binaryParamsData_);
+            spectrumData_ = (SpectrumMZ5*) calloc(numberOfSpectra_, sizeof(SpectrumMZ5));
+            binaryParamsData_ = (BinaryDataMZ5*) calloc(numberOfSpectra_, sizeof(BinaryDataMZ5));
+            spectrumIdentityList_.resize(numberOfSpectra_);
 
-            spectrumIdentityList_.resize(dsend);
-            for (hsize_t i = 0; i < dsend; ++i)
+            if (conn_->getConfiguration().getSpectrumLoadPolicy()
+                    != Configuration_mz5::SLP_OnDemand)
             {
-                spectrumIdentityList_[i] = spectrumData_[i].getSpectrumIdentity();
-                idMap_.insert(make_pair(spectrumIdentityList_[i].id, i));
-                if (!spectrumIdentityList_[i].spotID.empty())
-                    spotMap_[spectrumIdentityList_[i].spotID].push_back(i);
+                for (size_t block = 0; block < blockLoaded_.size(); ++block)
+                    loadBlock(block);
             }
         }
         initSpectra_ = true;
     }
 }
 
+void SpectrumList_mz5Impl::loadBlock(size_t block) const
+{
+    if (blockLoaded_[block])
+        return;
+
+    hsize_t start = block * blockSize_;
+    hsize_t count = std::min(blockSize_, static_cast<hsize_t> (numberOfSpectra_) - start);
+    conn_->readDataSetRange(Configuration_mz5::SpectrumMetaData, start, count, spectrumData_ + start);
+    conn_->readDataSetRange(Configuration_mz5::SpectrumBinaryMetaData, start, count, binaryParamsData_ + start);
+
+    for (hsize_t i = start; i < start + count; ++i)
+    {
+        spectrumData_[i].fillSpectrumIdentity(spectrumIdentityList_[i]);
+        if (!spectrumIdentityList_[i].id.empty())
+            rref_->addSpectrumIndexPair(spectrumIdentityList_[i].id, spectrumData_[i].index);
+    }
+    blockLoaded_[block] = true;
+}
+
+void SpectrumList_mz5Impl::loadSpectrum(size_t index) const
+{
+    initSpectra();
+    loadBlock(index / blockSize_);
+
+    const SpectrumMZ5& s = spectrumData_[index];
+    for (size_t i = 0; i < s.precursorList.len; ++i)
+    {
+        unsigned long refID = s.precursorList.list[i].spectrumRefID.refID;
+        if (refID < numberOfSpectra_)
+            loadBlock(refID / blockSize_);
+    }
+    for (size_t i = 0; i < s.scanList.scanList.len; ++i)
+    {
+        unsigned long refID = s.scanList.scanList.list[i].spectrumRefID.refID;
+        if (refID < numberOfSpectra_)
+            loadBlock(refID / blockSize_);
+    }
+}
+
+void SpectrumList_mz5Impl::initIdMaps() const
+{
+    if (!initIdMaps_)
+    {
+        initSpectra();
+        for (size_t block = 0; block < blockLoaded_.size(); ++block)
+            loadBlock(block);
+
+        for (size_t i = 0; i < numberOfSpectra_; ++i)
+        {
+            idMap_.insert(make_pair(spectrumIdentityList_[i].id, i));
+            if (!spectrumIdentityList_[i].spotID.empty())
+                spotMap_[spectrumIdentityList_[i].spotID].push_back(i);
+        }
+        initIdMaps_ = true;
+    }
+}
+
 size_t SpectrumList_mz5Impl::size() const
 {
     return numberOfSpectra_;
@@ -218,9 +314,11 @@ size_t SpectrumList_mz5Impl::size() const
 
 const SpectrumIdentity& SpectrumList_mz5Impl::spectrumIdentity(size_t index) const
 {
-    initSpectra();
     if (index >= 0 && index < numberOfSpectra_)
     {
+        boost::lock_guard<boost::mutex> lock(readMutex);
+        initSpectra();
+        loadBlock(index / blockSize_);
         return spectrumIdentityList_[index];
     }
     throw std::out_of_range("[SpectrumList_mz5Impl::spectrumIdentity()] out of range");
@@ -228,14 +326,16 @@ const SpectrumIdentity& SpectrumList_mz5Impl::spectrumIdentity(size_t index) con
 
 size_t SpectrumList_mz5Impl::find(const std::string& id) const
 {
-    initSpectra();
+    boost::lock_guard<boost::mutex> lock(readMutex);
+    initIdMaps();
     std::map<std::string, size_t>::const_iterator it = idMap_.find(id);
     return it != idMap_.end() ? it->second : size();
 }
 
 IndexList SpectrumList_mz5Impl::findSpotID(const std::string& spotID) const
 {
-    initSpectra();
+    boost::lock_guard<boost::mutex> lock(readMutex);
+    initIdMaps();
     std::map<std::string, IndexList>::const_iterator it = spotMap_.find(spotID);
     return it != spotMap_.end() ? it->second : IndexList();
 }
@@ -247,18 +347,21 @@ SpectrumPtr SpectrumList_mz5Impl::spectrum(size_t index, DetailLevel detailLevel
 
 SpectrumPtr SpectrumList_mz5Impl::spectrum(size_t index, bool getBinaryData) const
 {
-    boost::lock_guard<boost::mutex> lock(readMutex);  // lock_guard will unlock mutex when out of scope or when exception thrown (during destruction)
-    initSpectra();
     if (index >= 0 && index < numberOfSpectra_)
     {
+        {
+            boost::lock_guard<boost::mutex> lock(readMutex);  // lock_guard will unlock mutex when out of scope or when exception thrown (during destruction)
+            loadSpectrum(index);
+        }
+
         SpectrumPtr ptr(spectrumData_[index].getSpectrum(*rref_));
-        std::pair<hsize_t, hsize_t> bounds = spectrumRanges_.find(index)->second;
-        hsize_t start = bounds.first;
-        hsize_t end = bounds.second;
+        hsize_t start = spectrumRanges_[index].first;
+        hsize_t end = spectrumRanges_[index].second;
         ptr->defaultArrayLength = end - start;
         if (getBinaryData)
         {
             if (!binaryParamsData_[index].empty()) {
+                // Connection_mz5 serializes the HDF5 reads of all threads, but not the decoding of the values
                 std::vector<double> mz, inten;
                 conn_->getData(mz, Configuration_mz5::SpectrumMZ, start, end);
                 conn_->getData(inten, Configuration_mz5::SpectrumIntensity, start, end);
@@ -28,6 +28,7 @@
 #include "pwiz/utility/minimxml/XMLWriter.hpp"
 #include "pwiz/utility/misc/Std.hpp"
 #include "pwiz/utility/misc/Filesystem.hpp"
+#include "boost/thread/thread.hpp"
 
 
 using namespace pwiz::cv;
@@ -168,6 +169,103 @@ void test()
     bfs::remove(testFilename);
 }
 
+// more spectra than the default meta information chunk size, so they are read in several blocks;
+// the MS2 spectrum at index 2000 references the MS1 spectrum at index 1999 of the previous block
+const size_t manySpectraCount = 5000;
+
+
+// id of the MS1 spectrum preceding a copy of a tiny spectrum
+string precursorSpectrumID(size_t index)
+{
+    size_t offset = (index + 1) % 5;
+    return offset > index ? "" : "scan=" + lexical_cast<string>(index - offset);
+}
+
+
+void writeManySpectra()
+{
+    MSData tiny;
+    examples::initializeTiny(tiny);
+    const SpectrumList& tinyList = *tiny.run.spectrumListPtr;
+
+    SpectrumListSimplePtr sl(new SpectrumListSimple);
+    for (size_t i = 0; i < manySpectraCount; ++i)
+    {
+        SpectrumPtr s(new Spectrum(*tinyList.spectrum((i + 1) % tinyList.size(), true)));
+        s->index = i;
+        s->id = "scan=" + lexical_cast<string>(i);
+        if (!s->precursors.empty())
+            s->precursors[0].spectrumID = precursorSpectrumID(i);
+        sl->spectra.push_back(s);
+    }
+    tiny.run.spectrumListPtr = sl;
+    tiny.run.chromatogramListPtr.reset();
+
+    Serializer_mz5 serializer;
+    serializer.write(testFilename, tiny);
+}
+
+
+void checkSpectrum(const SpectrumList& sl, size_t index)
+{
+    SpectrumPtr s = sl.spectrum(index, true);
+    unit_assert(s->index == index);
+    unit_assert(s->id == "scan=" + lexical_cast<string>(index));
+    unit_assert(sl.spectrumIdentity(index).id == s->id);
+
+    if (!s->precursors.empty())
+        unit_assert(s->precursors[0].spectrumID == precursorSpectrumID(index));
+
+    vector<MZIntensityPair> pairs;
+    s->getMZIntensityPairs(pairs);
+    unit_assert(pairs.size() == s->defaultArrayLength);
+}
+
+
+void checkSpectra(const SpectrumList* sl, size_t first, size_t step)
+{
+    for (size_t i = first; i < sl->size(); i += step)
+        checkSpectrum(*sl, i);
+}
+
+
+void testLoadPolicy(mz5::Configuration_mz5::SpectrumLoadPolicy policy)
+{
+    if (os_) *os_ << "testLoadPolicy() " << policy << endl;
+
+    mz5::Configuration_mz5 config;
+    config.setSpectrumLoadPolicy(policy);
+    Serializer_mz5 serializer(config);
+    MSData msd;
+    serializer.read(testFilename, msd);
+    SpectrumListPtr sl = msd.run.spectrumListPtr;
+    unit_assert(sl->size() == manySpectraCount);
+
+    // a spectrum whose precursor is in another block
+    checkSpectrum(*sl, 2000);
+    checkSpectrum(*sl, manySpectraCount - 1);
+
+    unit_assert(sl->find("scan=4321") == 4321);
+    unit_assert(sl->find("scan=5000") == sl->size());
+
+    // spectra read by several threads at once
+    const size_t threadCount = 4;
+    boost::thread_group threads;
+    for (size_t i = 0; i < threadCount; ++i)
+        threads.add_thread(new boost::thread(checkSpectra, sl.get(), i, threadCount));
+    threads.join_all();
+}
+
+
+void testLoadPolicies()
+{
+    writeManySpectra();
+    testLoadPolicy(mz5::Configuration_mz5::SLP_OnDemand);
+    testLoadPolicy(mz5::Configuration_mz5::SLP_InitializeAllOnFirstCall);
+    testLoadPolicy(mz5::Configuration_mz5::SLP_InitializeAllOnCreation);
+    bfs::remove(testFilename);
+}
+
 int main(int argc, char* argv[])
 {
     TEST_PROLOG(argc, argv)
@@ -176,6 +274,7 @@ int main(int argc, char* argv[])
     {
         if (argc > 1 && !strcmp(argv[1], "-v")) os_ = &cout;
         test();
+        testLoadPolicies();
     }
     catch (exception& e)
     {
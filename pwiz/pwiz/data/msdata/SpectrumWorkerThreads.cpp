@@ -26,6 +26,7 @@
 #include "pwiz/data/msdata/SpectrumListWrapper.hpp"
 #include "pwiz/utility/misc/mru_list.hpp"
 #include <boost/thread.hpp>
+#include <boost/exception_ptr.hpp>
 #include <deque>
 
 
@@ -36,13 +37,39 @@ using namespace pwiz::util;
 namespace pwiz {
 namespace msdata {
 
+
+namespace {
+
+// the maxThreadCount of the calling thread's innermost ThreadCountLimit
+boost::thread_specific_ptr<size_t> threadCountLimit_;
+
+size_t threadCount(size_t maxThreadCount)
+{
+    if (maxThreadCount == 0 && threadCountLimit_.get())
+        maxThreadCount = *threadCountLimit_;
+
+    size_t hardwareThreads = max(1u, boost::thread::hardware_concurrency());
+    return maxThreadCount == 0 ? hardwareThreads : min(maxThreadCount, hardwareThreads);
+}
+
+// metadata and data requests use the getBinaryData overload, which is the one all lists implement
+SpectrumPtr getSpectrum(const SpectrumList& sl, size_t index, DetailLevel detailLevel)
+{
+    if (detailLevel >= DetailLevel_FullMetadata)
+        return sl.spectrum(index, detailLevel == DetailLevel_FullData);
+    return sl.spectrum(index, detailLevel);
+}
+
+} // namespace
+
+
 class SpectrumWorkerThreads::Impl
 {
     public:
 
-    Impl(const SpectrumList& sl)
+    Impl(const SpectrumList& sl, size_t maxThreadCount)
         : sl_(sl)
-        , numThreads_(boost::thread::hardware_concurrency())
+        , numThreads_(threadCount(maxThreadCount))
         , maxProcessedTaskCount_(numThreads_ * 4)
         , taskMRU_(maxProcessedTaskCount_)
     {
@@ -81,16 +108,16 @@ class SpectrumWorkerThreads::Impl
             }
     }
 
-    SpectrumPtr spectrum(size_t index, bool getBinaryData)
+    SpectrumPtr spectrum(size_t index, DetailLevel detailLevel)
     {
         if (!useThreads_)
-            return sl_.spectrum(index, getBinaryData);
+            return getSpectrum(sl_, index, detailLevel);
 
         boost::unique_lock<boost::mutex> taskLock(taskMutex_);
 
-        // if the task is already finished and has binary data if getBinaryData is true, return it as-is
+        // if the task is already finished with at least the requested detail level, return it as-is
         Task& task = tasks_[index];
-        if (task.result && (!getBinaryData || task.getBinaryData))
+        if (task.result && task.detailLevel >= detailLevel)
             return task.result;
 
         // otherwise, add this task and the numThreads following tasks to the queue (skipping the tasks that are already processed or being worked on)
@@ -101,34 +128,43 @@ class SpectrumWorkerThreads::Impl
             // if the task result is already ready
             if (task.result)
             {
-                // if it has binary data and getBinaryData is true, the task need not be queued
-                if (task.getBinaryData || !getBinaryData)
+                // if it has at least the requested detail level, the task need not be queued
+                if (task.detailLevel >= detailLevel)
                     continue;
 
                 // otherwise the current result is cleared
                 task.result.reset();
             }
-            // if the task is already being worked on and the existing task will get binary data or binary data isn't being requested, the task need not be requeued
-            else if (task.worker != NULL && (task.getBinaryData || !getBinaryData))
+            // if the task is already being worked on with at least the requested detail level, the task need not be requeued
+            else if (task.worker != NULL && task.detailLevel >= detailLevel)
                 continue;
 
-            // if the task is already queued, set its getBinaryData variable to the logical OR of the current task and the current spectrum request
+            // if the task is already queued, raise its detail level to that of the current spectrum request
             if (!task.isQueued)
             {
                 taskQueue_.push_back(i);
                 task.isQueued = true;
+                task.error = boost::exception_ptr(); // a failed task is retried when it is requested again
             }
-            task.getBinaryData |= getBinaryData;
+            task.detailLevel = max(task.detailLevel, detailLevel);
         }
 
-        // wait for the result to be set
-        while (!task.result)
+        // wait for the result or the error to be set
+        while (!task.result && !task.error)
         {
             // notify workers that tasks are available
             taskQueuedCondition_.notify_all();
             taskFinishedCondition_.wait_for(taskLock, boost::chrono::milliseconds(100));
         }
 
+        // pass the worker's exception on to the caller
+        if (!task.result)
+        {
+            boost::exception_ptr error = task.error;
+            task.error = boost::exception_ptr();
+            boost::rethrow_exception(error);
+        }
+
         return task.result;
     }
 
@@ -148,11 +184,12 @@ class SpectrumWorkerThreads::Impl
     // each spectrum in the list is a task
     struct Task
     {
-        Task() : worker(NULL), getBinaryData(false), isQueued(false) {}
+        Task() : worker(NULL), detailLevel(DetailLevel_InstantMetadata), isQueued(false) {}
 
         TaskWorker* worker; // the thread currently working on this task
         SpectrumPtr result; // the spectrum produced by this task
-        bool getBinaryData;
+        boost::exception_ptr error; // the exception thrown by this task, if any
+        DetailLevel detailLevel;
         bool isQueued; // true if the task is currently in the taskQueue
     };
 
@@ -185,25 +222,39 @@ class SpectrumWorkerThreads::Impl
                 // set worker pointer on the Task
                 size_t taskIndex = queuedTask;
                 Task& task = tasks[taskIndex];
-                bool getBinaryData = task.getBinaryData;
+                DetailLevel detailLevel = task.detailLevel;
                 task.worker = worker;
                 task.isQueued = false;
-                //cout << taskIndex << " " << task.worker << " " << getBinaryData << endl;
+                //cout << taskIndex << " " << task.worker << " " << detailLevel << endl;
                 // unlock taskLock
                 taskLock.unlock();
 
-                // get the spectrum
-                SpectrumPtr result = instance->sl_.spectrum(taskIndex, getBinaryData);
+                // get the spectrum; a failure is handed to the thread waiting for this task instead of killing the worker
+                SpectrumPtr result;
+                boost::exception_ptr error;
+                try
+                {
+                    result = getSpectrum(instance->sl_, taskIndex, detailLevel);
+                }
+                catch (boost::thread_interrupted&)
+                {
+                    throw;
+                }
+                catch (...)
+                {
+                    error = boost::current_exception();
+                }
 
                 // lock the taskLock
                 taskLock.lock();
 
                 // set the result on the Task, and set its worker to empty
-                // if not getting binary data, check if another thread already finished this task which did get binary data
-                if (getBinaryData || !task.getBinaryData)
+                // if another request raised the task's detail level while it was being worked on, leave it for the requeued task
+                if (detailLevel >= task.detailLevel)
                 {
                     task.result = result;
-                    task.getBinaryData = getBinaryData;
+                    task.error = error;
+                    task.detailLevel = detailLevel;
                 }
                 task.worker = NULL;
 
@@ -223,7 +274,12 @@ class SpectrumWorkerThreads::Impl
                 // if the MRU list's LRU is different now, it means the LRU was popped and needs to be reset; if the popped LRU is the current task, don't reset it
                 if (lruToReset.is_initialized() && lruToReset.get() != taskMRU.lru() && lruToReset.get() != taskIndex)
                 {
-                    tasks[lruToReset.get()].result.reset();
+                    Task& lruTask = tasks[lruToReset.get()];
+                    lruTask.result.reset();
+
+                    // an evicted task is fetched again at the detail level of its next request, unless it has already been requeued
+                    if (!lruTask.isQueued && lruTask.worker == NULL)
+                        lruTask.detailLevel = DetailLevel_InstantMetadata;
                 }
 
                 taskLock.unlock();
@@ -260,13 +316,30 @@ class SpectrumWorkerThreads::Impl
 };
 
 
-SpectrumWorkerThreads::SpectrumWorkerThreads(const SpectrumList& sl) : impl_(new Impl(sl)) {}
+SpectrumWorkerThreads::SpectrumWorkerThreads(const SpectrumList& sl, size_t maxThreadCount) : impl_(new Impl(sl, maxThreadCount)) {}
 
 SpectrumWorkerThreads::~SpectrumWorkerThreads() {}
 
 SpectrumPtr SpectrumWorkerThreads::processBatch(size_t index, bool getBinaryData)
 {
-    return impl_->spectrum(index, getBinaryData);
+    return impl_->spectrum(index, getBinaryData ? DetailLevel_FullData : DetailLevel_FullMetadata);
+}
+
+SpectrumPtr SpectrumWorkerThreads::processBatch(size_t index, DetailLevel detailLevel)
+{
+    return impl_->spectrum(index, detailLevel);
+}
+
+
+SpectrumWorkerThreads::ThreadCountLimit::ThreadCountLimit(size_t maxThreadCount)
+    : previousMaxThreadCount_(threadCountLimit_.get() ? *threadCountLimit_ : 0)
+{
+    threadCountLimit_.reset(new size_t(maxThreadCount));
+}
+
+SpectrumWorkerThreads::ThreadCountLimit::~ThreadCountLimit()
+{
+    threadCountLimit_.reset(previousMaxThreadCount_ == 0 ? 0 : new size_t(previousMaxThreadCount_));
 }
 
 
@@ -35,10 +35,28 @@ class SpectrumWorkerThreads
 {
     public:
 
-    SpectrumWorkerThreads(const SpectrumList& sl);
+    /// starts up to maxThreadCount worker threads, or one per processor core if it is 0
+    /// (or up to the calling thread's ThreadCountLimit, if it has one);
+    /// lower it when several lists are processed at once
+    SpectrumWorkerThreads(const SpectrumList& sl, size_t maxThreadCount = 0);
     ~SpectrumWorkerThreads();
     SpectrumPtr processBatch(size_t index, bool getBinaryData = true);
 
+    /// retrieves the spectrum at the given detail level, queueing the following spectra at the same level
+    SpectrumPtr processBatch(size_t index, DetailLevel detailLevel);
+
+    /// while it exists, lowers the default thread count of every SpectrumWorkerThreads created on the
+    /// calling thread, including those started by SpectrumList wrappers that take no thread count
+    class ThreadCountLimit
+    {
+        public:
+        ThreadCountLimit(size_t maxThreadCount);
+        ~ThreadCountLimit();
+
+        private:
+        size_t previousMaxThreadCount_;
+    };
+
     private:
     class Impl;
     boost::scoped_ptr<Impl> impl_;
@@ -50,6 +50,7 @@ Configuration_mz5::Configuration_mz5(const Configuration_mz5& config)
 {
     config_ = config.config_;
     init(config.doTranslating(), config.doTranslating());
+    copySettings(config);
 }
 
 Configuration_mz5::Configuration_mz5(
@@ -65,6 +66,7 @@ Configuration_mz5& Configuration_mz5::operator=(const Configuration_mz5& rhs)
     {
         this->config_ = rhs.config_;
         init(rhs.doTranslating(), rhs.doTranslating());
+        copySettings(rhs);
     }
     return *this;
 }
@@ -322,10 +324,19 @@ void Configuration_mz5::init(const bool deltamz,
         deflateLvl_ = 0;
     }
 
-    spectrumLoadPolicy_ = SLP_InitializeAllOnFirstCall;
+    spectrumLoadPolicy_ = SLP_OnDemand;
     chromatogramLoadPolicy_ = CLP_InitializeAllOnFirstCall;
 }
 
+void Configuration_mz5::copySettings(const Configuration_mz5& config)
+{
+    bufferInMB_ = config.bufferInMB_;
+    rdccSolts_ = config.rdccSolts_;
+    variableChunkCaches_ = config.variableChunkCaches_;
+    spectrumLoadPolicy_ = config.spectrumLoadPolicy_;
+    chromatogramLoadPolicy_ = config.chromatogramLoadPolicy_;
+}
+
 const std::string& Configuration_mz5::getNameFor(const MZ5DataSets v)
 {
     if (variableNames_.find(v) != variableNames_.end())
@@ -384,16 +395,49 @@ const size_t Configuration_mz5::getBufferInB()
     return (bufferInMB_ * 1024L * 1024L);
 }
 
+void Configuration_mz5::setBufferInMb(const size_t bufferInMb)
+{
+    bufferInMB_ = bufferInMb;
+}
+
 const size_t& Configuration_mz5::getRdccSlots()
 {
     return rdccSolts_;
 }
 
+void Configuration_mz5::setRdccSlots(const size_t rdccSlots)
+{
+    rdccSolts_ = rdccSlots;
+}
+
+const size_t& Configuration_mz5::getChunkCacheFor(const MZ5DataSets v)
+{
+    std::map<MZ5DataSets, size_t>::iterator it = variableChunkCaches_.find(v);
+    if (it != variableChunkCaches_.end())
+    {
+        return it->second;
+    }
+    return NO_BUFFER_SIZE;
+}
+
+void Configuration_mz5::setChunkCacheFor(const MZ5DataSets v, const size_t bytes)
+{
+    if (bytes == NO_BUFFER_SIZE)
+        variableChunkCaches_.erase(v);
+    else
+        variableChunkCaches_[v] = bytes;
+}
+
 const Configuration_mz5::SpectrumLoadPolicy& Configuration_mz5::getSpectrumLoadPolicy() const
 {
     return spectrumLoadPolicy_;
 }
 
+void Configuration_mz5::setSpectrumLoadPolicy(const SpectrumLoadPolicy& policy)
+{
+    spectrumLoadPolicy_ = policy;
+}
+
 const Configuration_mz5::ChromatogramLoadPolicy& Configuration_mz5::getChromatogramLoadPolicy() const
 {
     return chromatogramLoadPolicy_;
@@ -56,9 +56,13 @@ public:
         /**
          * Initialzes all meta information of all spectra at the first getSpectrum() call.
          */
-        SLP_InitializeAllOnFirstCall
+        SLP_InitializeAllOnFirstCall,
+        /**
+         * Reads the meta information of spectra in blocks of the SpectrumMetaData chunk size, when a spectrum of the block is first requested.
+         * Only the spectrum index is read completely; find() and findSpotID() read all remaining blocks.
+         */
+        SLP_OnDemand
     //SLP_PreemptionMode not implemented yet
-    //SLP_OnDemand not implemented yet
     //SLP_CachedOnDemand not implemented yet
     };
 
@@ -263,6 +267,13 @@ public:
      */
     const size_t getBufferInB();
 
+    /**
+     * Setter for the mz5 cache in Mb (see getBufferInMb()).
+     * Random access to many spectra profits from a larger cache, a single sequential pass needs little more than one chunk per dataset.
+     * @param bufferInMb mz5 cache size
+     */
+    void setBufferInMb(const size_t bufferInMb);
+
     /**
      * Returns number of used rdcc slots.
      * This is currently constant 41957L, but should be the the next prime after 10-100 times the number of chunks fitting into the cache.
@@ -270,12 +281,39 @@ public:
      */
     const size_t& getRdccSlots();
 
+    /**
+     * Setter for the number of rdcc slots (see getRdccSlots()).
+     * @param rdccSlots number of rdcc slots
+     */
+    void setRdccSlots(const size_t rdccSlots);
+
+    /**
+     * Returns the chunk cache size of a dataset opened for reading.
+     * @param v dataset
+     * @return chunk cache in byte. NO_BUFFER_SIZE if the dataset uses the file-wide mz5 cache.
+     */
+    const size_t& getChunkCacheFor(const MZ5DataSets v);
+
+    /**
+     * Sets a chunk cache for a dataset opened for reading, instead of the file-wide mz5 cache.
+     * E.g. extracting chromatograms from SpectrumMZ and SpectrumIntensity profits from caching many chunks of these datasets.
+     * @param v dataset
+     * @param bytes chunk cache in byte; NO_BUFFER_SIZE to use the file-wide mz5 cache
+     */
+    void setChunkCacheFor(const MZ5DataSets v, const size_t bytes);
+
     /**
      * Getter for spectrum load policy.
      * @return spectrum load policy
      */
     const SpectrumLoadPolicy& getSpectrumLoadPolicy() const;
 
+    /**
+     * Setter for spectrum load policy.
+     * @param policy spectrum load policy
+     */
+    void setSpectrumLoadPolicy(const SpectrumLoadPolicy& policy);
+
     /**
      * Getter for chromatogram load policy.
      * @return spectrum load policy
@@ -323,6 +361,11 @@ private:
      */
     void init(const bool deltamz, const bool translateinten);
 
+    /**
+     * Copies the settings which can be changed after construction.
+     */
+    void copySettings(const Configuration_mz5& config);
+
     /**
      * Internal copy of pwiz configuration object.
      */
@@ -347,6 +390,10 @@ private:
      * Map which holds the buffer size for a dataset.
      */
     std::map<MZ5DataSets, size_t> variableBufferSizes_;
+    /**
+     * Map which holds the chunk cache size for a dataset opened for reading.
+     */
+    std::map<MZ5DataSets, size_t> variableChunkCaches_;
     /**
      * MZ5 cache in MB
      */
@@ -301,7 +301,7 @@ void *Connection_mz5::readDataSet(const Configuration_mz5::MZ5DataSets v,
 {
     boost::mutex::scoped_lock lock(connectionReadMutex_);
 
-    DataSet ds = file_->openDataSet(config_.getNameFor(v));
+    DataSet ds = openDataSet(v);
     DataSpace dsp = ds.getSpace();
     hsize_t start[1], end[1];
     dsp.getSelectBounds(start, end);
@@ -317,6 +317,75 @@ void *Connection_mz5::readDataSet(const Configuration_mz5::MZ5DataSets v,
     return ptr;
 }
 
+void Connection_mz5::readDataSetRange(const Configuration_mz5::MZ5DataSets v,
+        const hsize_t start, const hsize_t count, void* ptr)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    boost::mutex::scoped_lock lock(connectionReadMutex_);
+
+    std::map<Configuration_mz5::MZ5DataSets, DataSet>::iterator it =
+            bufferMap_.find(v);
+    if (it == bufferMap_.end())
+    {
+        it = bufferMap_.insert(std::pair<Configuration_mz5::MZ5DataSets,
+                DataSet>(v, openDataSet(v))).first;
+    }
+    DataSpace dataspace = it->second.getSpace();
+    hsize_t offset[1] =
+    { start };
+    hsize_t dims[1] =
+    { count };
+    dataspace.selectHyperslab(H5S_SELECT_SET, dims, offset);
+    DataSpace memspace(1, dims);
+    it->second.read(ptr, config_.getDataTypeFor(v), memspace, dataspace);
+    memspace.close();
+    dataspace.close();
+}
+
+hsize_t Connection_mz5::getChunkSize(const Configuration_mz5::MZ5DataSets v)
+{
+    boost::mutex::scoped_lock lock(connectionReadMutex_);
+
+    DataSet ds = file_->openDataSet(config_.getNameFor(v));
+    DSetCreatPropList cparms = ds.getCreatePlist();
+    hsize_t chunkSize = Configuration_mz5::EMPTY_CHUNK_SIZE;
+    if (cparms.getLayout() == H5D_CHUNKED)
+    {
+        hsize_t chunks[1];
+        cparms.getChunk(1, chunks);
+        chunkSize = chunks[0];
+    }
+    cparms.close();
+    ds.close();
+    return chunkSize;
+}
+
+DataSet Connection_mz5::openDataSet(const Configuration_mz5::MZ5DataSets v)
+{
+    size_t chunkCache = config_.getChunkCacheFor(v);
+    if (chunkCache == Configuration_mz5::NO_BUFFER_SIZE)
+    {
+        return file_->openDataSet(config_.getNameFor(v));
+    }
+
+    // the C++ API has no dataset access property list
+    hid_t dapl = H5Pcreate(H5P_DATASET_ACCESS);
+    H5Pset_chunk_cache(dapl, config_.getRdccSlots(), chunkCache,
+            H5D_CHUNK_CACHE_W0_DEFAULT);
+    hid_t id = H5Dopen2(file_->getId(), config_.getNameFor(v).c_str(), dapl);
+    H5Pclose(dapl);
+    if (id < 0)
+    {
+        throw std::runtime_error("Connection_mz5::openDataSet(): unable to open "
+                + config_.getNameFor(v));
+    }
+    return DataSet(id);
+}
+
 void Connection_mz5::clean(const Configuration_mz5::MZ5DataSets v, void* data,
         const size_t dsend)
 {
@@ -335,17 +404,17 @@ void Connection_mz5::getData(std::vector<double>& data,
         const Configuration_mz5::MZ5DataSets v, const hsize_t start,
         const hsize_t end)
 {
-    boost::mutex::scoped_lock lock(connectionReadMutex_);
-
     hsize_t scount = end - start;
     data.resize(scount);
     if (scount > 0)
     {
+        boost::mutex::scoped_lock lock(connectionReadMutex_);
+
         std::map<Configuration_mz5::MZ5DataSets, DataSet>::iterator it =
                 bufferMap_.find(v);
         if (it == bufferMap_.end())
         {
-            DataSet ds = file_->openDataSet(config_.getNameFor(v));
+            DataSet ds = openDataSet(v);
             bufferMap_.insert(
                     std::pair<Configuration_mz5::MZ5DataSets, DataSet>(v, ds));
             it = bufferMap_.find(v);
@@ -363,18 +432,20 @@ void Connection_mz5::getData(std::vector<double>& data,
         DataSpace memspace(1, dimsm);
 
         dataset.read(&data[0], PredType::NATIVE_DOUBLE, memspace, dataspace);
-        if (v == Configuration_mz5::SpectrumMZ && config_.doTranslating())
-        {
-            Translator_mz5::reverseTranslateMZ(data);
-        }
-        if (v == Configuration_mz5::SpectrumIntensity
-                && config_.doTranslating())
-        {
-            Translator_mz5::reverseTranslateIntensity(data);
-        }
         memspace.close();
         dataspace.close();
     }
+
+    // the values are decoded outside the lock, while other threads read from the file
+    if (v == Configuration_mz5::SpectrumMZ && config_.doTranslating())
+    {
+        Translator_mz5::reverseTranslateMZ(data);
+    }
+    if (v == Configuration_mz5::SpectrumIntensity
+            && config_.doTranslating())
+    {
+        Translator_mz5::reverseTranslateIntensity(data);
+    }
 }
 
 void Connection_mz5::flush(const Configuration_mz5::MZ5DataSets v)
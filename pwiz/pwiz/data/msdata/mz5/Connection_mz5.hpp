@@ -115,6 +115,26 @@ public:
     void* readDataSet(Configuration_mz5::MZ5DataSets v, size_t& dsend,
             void* ptr = 0);
 
+    /**
+     * Reads a range of a one dimensional dataset.
+     * Reading ranges aligned to the chunks of the dataset (see getChunkSize()) decompresses each chunk once.
+     * The memory can be released with clean(), for all ranges at once.
+     *
+     * @param v dataset enumeration value
+     * @param start index of the first element
+     * @param count number of elements
+     * @param ptr start pointer where the elements should be written to, with room for count elements
+     */
+    void readDataSetRange(Configuration_mz5::MZ5DataSets v, const hsize_t start,
+            const hsize_t count, void* ptr);
+
+    /**
+     * Returns the chunk size of a one dimensional dataset in this file.
+     * @param v dataset enumeration value
+     * @return chunk size. EMPTY_CHUNK_SIZE if the dataset is not chunked.
+     */
+    hsize_t getChunkSize(Configuration_mz5::MZ5DataSets v);
+
     /**
      * Clean up of open datasets and destruction of corresponding data elements.
      * This method calls vlenReclaim, free and close.
@@ -165,6 +185,13 @@ private:
     H5::DataSet getDataSet(int rank, hsize_t* dim, hsize_t* maxdim,
             const Configuration_mz5::MZ5DataSets v);
 
+    /**
+     * Opens a dataset for reading, with the chunk cache configured for it.
+     * @param v dataset enumeration value
+     * @return dataset
+     */
+    H5::DataSet openDataSet(const Configuration_mz5::MZ5DataSets v);
+
     /**
      * Initializes a file and read internal mz5 information.
      *
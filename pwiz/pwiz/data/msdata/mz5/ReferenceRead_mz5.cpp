@@ -41,11 +41,14 @@ pwiz::cv::CVID ReferenceRead_mz5::getCVID(const unsigned long index) const
 {
     if (cvrefs_.size() > index)
     {
-        std::map<unsigned long, pwiz::cv::CVID>::iterator it = bbmapping_.find(
-                index);
-        if (it != bbmapping_.end())
         {
-            return it->second;
+            boost::mutex::scoped_lock lock(mutex_);
+            std::map<unsigned long, pwiz::cv::CVID>::iterator it = bbmapping_.find(
+                    index);
+            if (it != bbmapping_.end())
+            {
+                return it->second;
+            }
         }
         char id[16];
         size_t n = sprintf(id, "%s:%07lu", cvrefs_[index].prefix,
@@ -53,6 +56,7 @@ pwiz::cv::CVID ReferenceRead_mz5::getCVID(const unsigned long index) const
         id[n] = '\0';
         pwiz::cv::CVID c = pwiz::cv::cvTermInfo(id).cvid;
         //caching of previous results speeds up the requests
+        boost::mutex::scoped_lock lock(mutex_);
         bbmapping_.insert(std::pair<unsigned long, pwiz::cv::CVID>(index, c));
         return c;
     }
@@ -215,6 +219,7 @@ pwiz::msdata::DataProcessingPtr ReferenceRead_mz5::getDataProcessingPtr(
 
 std::string ReferenceRead_mz5::getSpectrumId(const unsigned long index) const
 {
+    boost::mutex::scoped_lock lock(mutex_);
     std::map<unsigned long, std::string>::iterator it = spectrumIndex_.find(
             index);
     if (it != spectrumIndex_.end())
@@ -227,6 +232,7 @@ std::string ReferenceRead_mz5::getSpectrumId(const unsigned long index) const
 void ReferenceRead_mz5::addSpectrumIndexPair(const std::string& id,
         const unsigned long index) const
 {
+    boost::mutex::scoped_lock lock(mutex_);
     spectrumIndex_.insert(std::pair<unsigned long, std::string>(index, id));
 }
 
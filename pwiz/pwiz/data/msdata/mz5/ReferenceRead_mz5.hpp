@@ -30,6 +30,7 @@
 #include "Datastructures_mz5.hpp"
 #include "Connection_mz5.hpp"
 #include <boost/smart_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 #include <string>
 #include <vector>
 #include <map>
@@ -161,6 +162,10 @@ private:
     mutable std::vector<UserParamMZ5> usrParams_;
     mutable std::vector<RefMZ5> refParms_;
     mutable std::map<unsigned long, std::string> spectrumIndex_;
+    /**
+     * Guards bbmapping_ and spectrumIndex_, which are filled while spectra are read, possibly by several threads.
+     */
+    mutable boost::mutex mutex_;
 
     mutable unsigned long defaultChromatogramDataProcessingRefID_,
             defaultSpectrumDataProcessingRefID_;
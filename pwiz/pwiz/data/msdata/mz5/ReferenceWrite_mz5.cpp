@@ -32,8 +32,8 @@ namespace pwiz {
 namespace msdata {
 namespace mz5 {
 
-ReferenceWrite_mz5::ReferenceWrite_mz5(const pwiz::msdata::MSData& msd) :
-    msd_(msd)
+ReferenceWrite_mz5::ReferenceWrite_mz5(const pwiz::msdata::MSData& msd, size_t maxThreadCount) :
+    msd_(msd), maxThreadCount_(maxThreadCount)
 {
     SourceFileMZ5::read(msd_.fileDescription.sourceFilePtrs, *this);
     //TODO add source file when creating mz5
@@ -363,7 +363,7 @@ pwiz::util::IterationListener::Status ReferenceWrite_mz5::readAndWriteSpectra(
         pwiz::msdata::SpectrumPtr sp;
         pwiz::msdata::BinaryDataArrayPtr bdap;
         std::vector<double> mz;
-        SpectrumWorkerThreads spectrumWorkers(*sl);
+        SpectrumWorkerThreads spectrumWorkers(*sl, maxThreadCount_);
         for (size_t i = 0; i < sl->size(); i++)
         {
             status = pwiz::util::IterationListener::Status_Ok;
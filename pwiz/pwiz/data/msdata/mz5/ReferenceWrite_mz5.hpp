@@ -47,8 +47,9 @@ public:
     /**
      * Default constructor.
      * @param msd MSData input object
+     * @param maxThreadCount number of threads reading spectra ahead; 0 starts one per processor core
      */
-    ReferenceWrite_mz5(const pwiz::msdata::MSData& msd);
+    ReferenceWrite_mz5(const pwiz::msdata::MSData& msd, size_t maxThreadCount = 0);
 
     /**
      * Stores a CVID into internal maps and returns the corresponding index.
@@ -171,6 +172,11 @@ private:
      */
     const pwiz::msdata::MSData& msd_;
 
+    /**
+     * Number of threads reading spectra ahead while writing.
+     */
+    size_t maxThreadCount_;
+
     /**
      * Following lists are used as internal storage container.
      */
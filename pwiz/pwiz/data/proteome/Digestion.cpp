@@ -32,6 +32,9 @@
 #include "pwiz/utility/misc/Std.hpp"
 #include "pwiz/utility/misc/Singleton.hpp"
 #include <boost/xpressive/xpressive_dynamic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/math/special_functions/fpclassify.hpp>
 
 
 namespace pwiz {
@@ -351,6 +354,205 @@ string Digestion::disambiguateCleavageAgentRegex(const string& cleavageAgentRege
 }
 
 
+namespace {
+
+// residues are indexed by their unsigned char value; both termini are indexed by 256
+const size_t terminus = 256;
+const size_t residueCount = 257;
+
+// a cleavage rule made only of looks at single residues, as parsed by cutNoCutRegex,
+// compiled into a table of whether there is a digestion site between each pair of residues
+class CleavageRule
+{
+    public:
+
+    /// returns a null pointer if any of the regexes is not such a rule
+    static shared_ptr<const CleavageRule> compile(const vector<string>& cleavageAgentRegexes, bool disambiguate)
+    {
+        shared_ptr<CleavageRule> rule(new CleavageRule);
+        BOOST_FOREACH(const string& regex, cleavageAgentRegexes)
+            if (!rule->addAlternatives(regex, disambiguate))
+                return shared_ptr<const CleavageRule>();
+        return rule;
+    }
+
+    /// appends the offsets of the digestion sites in the sequence, in order;
+    /// the sites are between offset and offset+1
+    void findSites(const string& sequence, vector<int>& sites) const
+    {
+        const unsigned char* residues = reinterpret_cast<const unsigned char*>(sequence.c_str());
+        size_t length = sequence.length();
+        size_t before = terminus;
+        for (size_t i=0; i <= length; ++i)
+        {
+            size_t after = i < length ? residues[i] : terminus;
+            if (cuts_[before * residueCount + after])
+                sites.push_back(int(i) - 1);
+            before = after;
+        }
+    }
+
+    private:
+
+    CleavageRule() : cuts_(residueCount * residueCount, 0) {}
+
+    // adds each top-level alternative of the regex, e.g. "((?<=D))|((?=D))"
+    bool addAlternatives(const string& regex, bool disambiguate)
+    {
+        int depth = 0;
+        size_t alternativeBegin = 0;
+        for (size_t i=0; i <= regex.length(); ++i)
+        {
+            char c = i < regex.length() ? regex[i] : '|';
+            if (c == '(')
+                ++depth;
+            else if (c == ')' && --depth < 0)
+                return false;
+            else if (c == '|' && depth == 0)
+            {
+                if (!addAlternative(regex.substr(alternativeBegin, i - alternativeBegin), disambiguate))
+                    return false;
+                alternativeBegin = i + 1;
+            }
+        }
+        return depth == 0;
+    }
+
+    bool addAlternative(const string& alternative, bool disambiguate)
+    {
+        bxp::smatch what;
+        if (!bxp::regex_match(alternative, what, cutNoCutRegex))
+            return false;
+
+        bool hasLookbehind = what[1].matched && what[2].matched;
+        bool hasLookahead = what[3].matched && what[4].matched;
+        vector<char> lookbehindPasses = residuesPassing(hasLookbehind, hasLookbehind && what[1] == "=", what[2].str(), disambiguate);
+        vector<char> lookaheadPasses = residuesPassing(hasLookahead, hasLookahead && what[3] == "=", what[4].str(), disambiguate);
+
+        for (size_t before=0; before < residueCount; ++before)
+            if (lookbehindPasses[before])
+                for (size_t after=0; after < residueCount; ++after)
+                    if (lookaheadPasses[after])
+                        cuts_[before * residueCount + after] = 1;
+        return true;
+    }
+
+    // for each residue (and the terminus), whether a look like (?=[KR]) or (?<!P) passes on it;
+    // B, Z, J, and X are expanded like disambiguateCleavageAgentRegex() does
+    static vector<char> residuesPassing(bool hasLook, bool lookIsPositive, const string& residues, bool disambiguate)
+    {
+        if (!hasLook)
+            return vector<char>(residueCount, 1);
+
+        vector<char> isListed(residueCount, 0);
+        BOOST_FOREACH(char residue, residues)
+        {
+            if (residue == '[' || residue == ']')
+                continue;
+
+            isListed[(unsigned char) residue] = 1;
+            if (!disambiguate)
+                continue;
+
+            switch (residue)
+            {
+                case 'B': isListed['N'] = isListed['D'] = 1; break;
+                case 'Z': isListed['E'] = isListed['Q'] = 1; break;
+                case 'J': isListed['I'] = isListed['L'] = 1; break;
+                case 'X': for (char c='A'; c <= 'Z'; ++c) isListed[(unsigned char) c] = 1; break;
+                default: break;
+            }
+        }
+
+        vector<char> passes(residueCount);
+        for (size_t i=0; i < residueCount; ++i)
+            passes[i] = (isListed[i] != 0) == lookIsPositive;
+        return passes;
+    }
+
+    vector<char> cuts_; // indexed by before * residueCount + after
+};
+
+
+// the compiled rules are shared by all digestions using the same cleavage agents or regexes
+class CleavageRuleCache : public boost::singleton<CleavageRuleCache>
+{
+    public:
+    CleavageRuleCache(boost::restricted) {}
+
+    shared_ptr<const CleavageRule> getRule(const vector<string>& cleavageAgentRegexes, bool disambiguate)
+    {
+        string key(disambiguate ? "1" : "0");
+        BOOST_FOREACH(const string& regex, cleavageAgentRegexes)
+            key += "\n" + regex;
+
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        map<string, shared_ptr<const CleavageRule> >::const_iterator itr = rules_.find(key);
+        if (itr == rules_.end())
+            itr = rules_.insert(make_pair(key, CleavageRule::compile(cleavageAgentRegexes, disambiguate))).first;
+        return itr->second;
+    }
+
+    private:
+    boost::mutex mutex_;
+    map<string, shared_ptr<const CleavageRule> > rules_;
+};
+
+
+// the residue masses indexed by symbol, so the masses of digested peptides can be summed
+// without building their formulas
+class ResidueMassTable : public boost::singleton<ResidueMassTable>
+{
+    public:
+    ResidueMassTable(boost::restricted)
+    :   monoMasses_(256, numeric_limits<double>::quiet_NaN()), avgMasses_(256, numeric_limits<double>::quiet_NaN())
+    {
+        for (int type = AminoAcid::Alanine; type <= AminoAcid::Unknown; ++type)
+        {
+            const AminoAcid::Info::Record& record = AminoAcid::Info::record((AminoAcid::Type) type);
+            monoMasses_[(unsigned char) record.symbol] = record.residueFormula.monoisotopicMass();
+            avgMasses_[(unsigned char) record.symbol] = record.residueFormula.molecularWeight();
+        }
+
+        chemistry::Formula water("H2O1");
+        waterMonoMass_ = water.monoisotopicMass();
+        waterAvgMass_ = water.molecularWeight();
+    }
+
+    // fills the prefix sums of the sequence's residue masses, starting with 0,
+    // so the mass of the residues [a, b) is sums[b] - sums[a];
+    // residues without a mass (e.g. 'J' or '*') add nothing to the sums but are counted
+    // in unknownCounts, so a range with unknownCounts[b] - unknownCounts[a] > 0 has no mass
+    void sumResidueMasses(const string& sequence, vector<double>& monoMassSums, vector<double>& avgMassSums, vector<size_t>& unknownCounts) const
+    {
+        monoMassSums.resize(sequence.length()+1);
+        avgMassSums.resize(sequence.length()+1);
+        unknownCounts.resize(sequence.length()+1);
+        monoMassSums[0] = avgMassSums[0] = 0;
+        unknownCounts[0] = 0;
+        for (size_t i=0; i < sequence.length(); ++i)
+        {
+            unsigned char symbol = sequence[i];
+            bool unknown = boost::math::isnan(monoMasses_[symbol]);
+            monoMassSums[i+1] = monoMassSums[i] + (unknown ? 0 : monoMasses_[symbol]);
+            avgMassSums[i+1] = avgMassSums[i] + (unknown ? 0 : avgMasses_[symbol]);
+            unknownCounts[i+1] = unknownCounts[i] + (unknown ? 1 : 0);
+        }
+    }
+
+    double waterMonoMass() const {return waterMonoMass_;}
+    double waterAvgMass() const {return waterAvgMass_;}
+
+    private:
+    vector<double> monoMasses_;
+    vector<double> avgMasses_;
+    double waterMonoMass_;
+    double waterAvgMass_;
+};
+
+} // namespace
+
+
 class Digestion::Impl
 {
     public:
@@ -363,11 +565,23 @@ class Digestion::Impl
             if (cleavageAgent_ == MS_unspecific_cleavage)
                 config_.minimumSpecificity = Digestion::NonSpecific;
             else if (cleavageAgent_ != MS_no_cleavage)
-                cleavageAgentRegex_ = bxp::sregex::compile(disambiguateCleavageAgentRegex(getCleavageAgentRegex(cleavageAgent_)));
+            {
+                cleavageRule_ = CleavageRuleCache::instance->getRule(vector<string>(1, getCleavageAgentRegex(cleavageAgent_)), true);
+                if (!cleavageRule_)
+                    cleavageAgentRegex_ = bxp::sregex::compile(disambiguateCleavageAgentRegex(getCleavageAgentRegex(cleavageAgent_)));
+            }
             return;
         }
 
         cleavageAgent_ = CVID_Unknown; // Avoid testing uninitialized value in digest()
+
+        vector<string> cleavageAgentRegexes;
+        BOOST_FOREACH(CVID cleavageAgent, cleavageAgents)
+            cleavageAgentRegexes.push_back(getCleavageAgentRegex(cleavageAgent));
+        cleavageRule_ = CleavageRuleCache::instance->getRule(cleavageAgentRegexes, true);
+        if (cleavageRule_)
+            return;
+
         string mergedRegex = "((" + disambiguateCleavageAgentRegex(getCleavageAgentRegex(cleavageAgents[0]));
         for (size_t i=1; i < cleavageAgents.size(); ++i)
             mergedRegex += ")|(" + disambiguateCleavageAgentRegex(getCleavageAgentRegex(cleavageAgents[i]));
@@ -382,10 +596,16 @@ class Digestion::Impl
         cleavageAgent_ = CVID_Unknown; // Avoid testing uninitialized value in digest()
         if (cleavageAgentRegexes.size() == 1)
         {
-            cleavageAgentRegex_ = bxp::sregex::compile(cleavageAgentRegexes[0]); //disambiguateCleavageAgentRegex(cleavageAgentRegexes[0].str());
+            cleavageRule_ = CleavageRuleCache::instance->getRule(cleavageAgentRegexes, false);
+            if (!cleavageRule_)
+                cleavageAgentRegex_ = bxp::sregex::compile(cleavageAgentRegexes[0]); //disambiguateCleavageAgentRegex(cleavageAgentRegexes[0].str());
             return;
         }
 
+        cleavageRule_ = CleavageRuleCache::instance->getRule(cleavageAgentRegexes, true);
+        if (cleavageRule_)
+            return;
+
         string mergedRegex = "((" + disambiguateCleavageAgentRegex(cleavageAgentRegexes[0]);
         for (size_t i=1; i < cleavageAgentRegexes.size(); ++i)
             mergedRegex += ")|(" + disambiguateCleavageAgentRegex(cleavageAgentRegexes[i]);
@@ -420,17 +640,15 @@ class Digestion::Impl
                 //if (cleavageAgentRegex_.empty())
                 //    throw runtime_error("empty cleavage regex");
 
-                std::string::const_iterator start = sequence.begin();
-                std::string::const_iterator end = sequence.end();
-                bxp::smatch what;
-                bxp::regex_constants::match_flag_type flags = bxp::regex_constants::match_default;
-                while (bxp::regex_search(start, end, what, cleavageAgentRegex_, flags))
+                if (cleavageRule_)
+                    cleavageRule_->findSites(sequence, sites_);
+                else
                 {
-                    sites_.push_back(int(what[0].first-sequence.begin()-1));
-
-                    // update search position and flags
-                    start = max(what[0].second, start+1);
-                    flags = flags | bxp::regex_constants::match_prev_avail | bxp::regex_constants::match_not_bol;
+                    // the iterator lets lookbehinds see the residues before each search position
+                    // and doesn't match an empty string twice at the same position
+                    bxp::sregex_iterator itr(sequence.begin(), sequence.end(), cleavageAgentRegex_), end;
+                    for (; itr != end; ++itr)
+                        sites_.push_back(int((*itr)[0].first-sequence.begin()-1));
                 }
 
                 // if regex didn't match n-terminus, insert it
@@ -454,6 +672,16 @@ class Digestion::Impl
         }
     }
 
+    inline void sumResidueMasses() const
+    {
+        if (monoMassSums_.empty())
+        {
+            ResidueMassTable::instance->sumResidueMasses(peptide_.sequence(), monoMassSums_, avgMassSums_, unknownResidueCounts_);
+            waterMonoMass_ = ResidueMassTable::instance->waterMonoMass();
+            waterAvgMass_ = ResidueMassTable::instance->waterAvgMass();
+        }
+    }
+
     inline vector<DigestedPeptide> find_all(const Peptide& peptide)
     {
         typedef boost::iterator_range<string::const_iterator> const_string_iterator_range;
@@ -576,6 +804,7 @@ class Digestion::Impl
     Peptide peptide_;
     Config config_;
     CVID cleavageAgent_;
+    shared_ptr<const CleavageRule> cleavageRule_; // if null, the sites are found with cleavageAgentRegex_
     bxp::sregex cleavageAgentRegex_;
     friend class Digestion::const_iterator::Impl;
 
@@ -585,6 +814,13 @@ class Digestion::Impl
     // peptide_.sequence().length()-1 is the C terminus digestion site
     mutable vector<int> sites_;
     mutable set<int> sitesSet_;
+
+    // prefix sums of the residue masses, calculated on the first DigestedPeptideView
+    mutable vector<double> monoMassSums_;
+    mutable vector<double> avgMassSums_;
+    mutable vector<size_t> unknownResidueCounts_;
+    mutable double waterMonoMass_;
+    mutable double waterAvgMass_;
 };
 
 
@@ -764,60 +1000,79 @@ class Digestion::const_iterator::Impl
         }
     }
 
-    const DigestedPeptide& peptide() const
+    // fills the position and digestion metadata of the current peptide, but not its masses
+    inline void position(DigestedPeptideView& view) const
     {
-        try
+        int missedCleavages = int(end_ - begin_)-1;
+        if (missedCleavages > 0 && config_.clipNTerminalMethionine && begin_ != sites_.end() && *begin_ < 0 && sequence_[0] == 'M')
+            --missedCleavages;
+        view.missedCleavages = missedCleavages;
+
+        switch (config_.minimumSpecificity)
         {
-            string prefix = "";
-            string suffix = "";
+            default:
+            case FullySpecific:
+                view.begin = sequence_.begin()+(*begin_+1);
+                view.end = sequence_.begin()+(*end_+1);
+                view.NTerminusIsSpecific = view.CTerminusIsSpecific = true;
+                break;
 
-            int missedCleavages = int(end_ - begin_)-1;
-            if (missedCleavages > 0 && config_.clipNTerminalMethionine && begin_ != sites_.end() && *begin_ < 0 && sequence_[0] == 'M')
-                --missedCleavages;
+            case SemiSpecific:
+            case NonSpecific:
+                view.begin = sequence_.begin()+(beginNonSpecific_+1);
+                view.end = sequence_.begin()+(endNonSpecific_+1);
+                view.NTerminusIsSpecific = begin_ != sites_.end() && *begin_ == beginNonSpecific_;
+                view.CTerminusIsSpecific = end_ != sites_.end() && *end_ == endNonSpecific_;
+                break;
+        }
+        view.offset = view.begin - sequence_.begin();
+    }
 
-            if (!peptide_.get())
+    DigestedPeptideView view() const
+    {
+        try
+        {
+            DigestedPeptideView view;
+            position(view);
+
+            digestionImpl_.sumResidueMasses();
+            size_t endOffset = view.offset + view.length();
+            if (digestionImpl_.unknownResidueCounts_[endOffset] > digestionImpl_.unknownResidueCounts_[view.offset])
+                view.monoisotopicMass = view.molecularWeight = numeric_limits<double>::quiet_NaN();
+            else
             {
-                switch (config_.minimumSpecificity)
-                {
-                    default:
-                    case FullySpecific:
-                        if(*begin_ >= 0 && *begin_ < (int) sequence_.length())
-                            prefix = sequence_.substr(*begin_, 1); //this could be changed to be something other than 1 by a config option later
-                        if(*end_ != (int) sequence_.length())
-                            suffix = sequence_.substr(*end_+1, 1);
-
-                        peptide_.reset(
-                            new DigestedPeptide(sequence_.begin()+(*begin_+1),
-                                                sequence_.begin()+(*end_+1),
-                                                *begin_+1,
-                                                missedCleavages,
-                                                true,
-                                                true,
-                                                prefix, 
-                                                suffix
-						));
-			                    
-                    break;
+                view.monoisotopicMass = digestionImpl_.monoMassSums_[endOffset] - digestionImpl_.monoMassSums_[view.offset] + digestionImpl_.waterMonoMass_;
+                view.molecularWeight = digestionImpl_.avgMassSums_[endOffset] - digestionImpl_.avgMassSums_[view.offset] + digestionImpl_.waterAvgMass_;
+            }
+            return view;
+        }
+        catch (exception& e)
+        {
+            throw runtime_error(string("[Digestion::const_iterator::Impl::view()] ") + e.what());
+        }
+    }
 
-                    case SemiSpecific:
-                    case NonSpecific:
-                        if(beginNonSpecific_ >= 0 && beginNonSpecific_ < (int) sequence_.length())
-                            prefix = sequence_.substr(beginNonSpecific_, 1); //this could be changed to be something other than 1 by a config option later
-                        if(endNonSpecific_ != (int) sequence_.length())
-                            suffix = sequence_.substr(endNonSpecific_+1, 1);
-
-                        peptide_.reset(
-                            new DigestedPeptide(sequence_.begin()+(beginNonSpecific_+1),
-                                                sequence_.begin()+(endNonSpecific_+1),
-                                                beginNonSpecific_+1,
-                                                missedCleavages,
-                                                begin_ != sites_.end() && *begin_ == beginNonSpecific_,
-                                                end_ != sites_.end() && *end_ == endNonSpecific_,
-                                                prefix,
-                                                suffix
-						));
-                        break;
-                }
+    const DigestedPeptide& peptide() const
+    {
+        try
+        {
+            if (!peptide_.get())
+            {
+                DigestedPeptideView view;
+                position(view);
+
+                // this could be changed to be something other than 1 by a config option later
+                string prefix = view.offset > 0 ? sequence_.substr(view.offset-1, 1) : "";
+                string suffix = view.end != sequence_.end() ? string(view.end, view.end+1) : "";
+
+                peptide_.reset(new DigestedPeptide(view.begin,
+                                                   view.end,
+                                                   view.offset,
+                                                   view.missedCleavages,
+                                                   view.NTerminusIsSpecific,
+                                                   view.CTerminusIsSpecific,
+                                                   prefix,
+                                                   suffix));
             }
             return *peptide_;
         }
@@ -1063,6 +1318,11 @@ PWIZ_API_DECL const DigestedPeptide* Digestion::const_iterator::operator->() con
     return &(impl_->peptide());
 }
 
+PWIZ_API_DECL DigestedPeptideView Digestion::const_iterator::view() const
+{
+    return impl_->view();
+}
+
 PWIZ_API_DECL Digestion::const_iterator& Digestion::const_iterator::operator++()
 {
     ++(*impl_);
@@ -107,6 +107,25 @@ class PWIZ_API_DECL DigestedPeptide : public Peptide
 };
 
 
+/// digestion metadata and unmodified masses of a peptide, referring to the digested polypeptide's
+/// sequence instead of copying it; the polypeptide (i.e. the Digestion) must outlive the view
+struct PWIZ_API_DECL DigestedPeptideView
+{
+    std::string::const_iterator begin; ///< the first residue of the peptide
+    std::string::const_iterator end; ///< one past the last residue of the peptide
+    size_t offset; ///< zero-based offset of the N terminus in the polypeptide
+    size_t missedCleavages;
+    bool NTerminusIsSpecific;
+    bool CTerminusIsSpecific;
+    double monoisotopicMass; ///< neutral monoisotopic mass, ignoring modifications; NaN if a residue has no known mass
+    double molecularWeight; ///< neutral average mass, ignoring modifications; NaN if a residue has no known mass
+
+    size_t length() const {return end - begin;}
+    size_t specificTermini() const {return (NTerminusIsSpecific ? 1 : 0) + (CTerminusIsSpecific ? 1 : 0);}
+    std::string sequence() const {return std::string(begin, end);}
+};
+
+
 /// enumerates the peptides from proteolytic digestion of a polypeptide or protein;
 class PWIZ_API_DECL Digestion
 {
@@ -223,6 +242,11 @@ class PWIZ_API_DECL Digestion
 
         const DigestedPeptide& operator*() const;
         const DigestedPeptide* operator->() const;
+
+        /// returns the current peptide without constructing the DigestedPeptide that operator* returns;
+        /// the masses come from prefix sums of the residue masses, computed once per Digestion
+        DigestedPeptideView view() const;
+
         const_iterator& operator++();
         const_iterator operator++(int);
         bool operator!=(const const_iterator& that) const; 
@@ -30,6 +30,7 @@
 #include "boost/thread/barrier.hpp"
 #include "boost/exception/all.hpp"
 #include "boost/foreach_field.hpp"
+#include "boost/math/special_functions/fpclassify.hpp"
 
 
 using namespace pwiz::cv;
@@ -478,6 +479,37 @@ void testSemitrypticMethionineClippingBSA(const Digestion& semitrypticDigestion)
     unit_assert(!semitrypticPeptideSet.count("FAVEGPKLVVSTQTAL")); // non-tryptic
 }
 
+// digestions with a compiled cleavage rule and with a regex that is not compiled must give the same peptides
+void testSameDigestion(const Digestion& compiledDigestion, const Digestion& regexDigestion)
+{
+    vector<DigestedPeptide> compiledPeptides(compiledDigestion.begin(), compiledDigestion.end());
+    vector<DigestedPeptide> regexPeptides(regexDigestion.begin(), regexDigestion.end());
+    unit_assert(!compiledPeptides.empty());
+    unit_assert_operator_equal(regexPeptides.size(), compiledPeptides.size());
+    for (size_t i=0; i < compiledPeptides.size(); ++i)
+        unit_assert(compiledPeptides[i] == regexPeptides[i]);
+}
+
+// the views of a digestion must describe the same peptides as the DigestedPeptides it yields
+void testSameViews(const Digestion& digestion)
+{
+    size_t count = 0;
+    for (Digestion::const_iterator itr = digestion.begin(); itr != digestion.end(); ++itr, ++count)
+    {
+        DigestedPeptideView view = itr.view();
+        const DigestedPeptide& peptide = *itr;
+        unit_assert_operator_equal(peptide.sequence(), view.sequence());
+        unit_assert_operator_equal(peptide.offset(), view.offset);
+        unit_assert_operator_equal(peptide.missedCleavages(), view.missedCleavages);
+        unit_assert_operator_equal(peptide.NTerminusIsSpecific(), view.NTerminusIsSpecific);
+        unit_assert_operator_equal(peptide.CTerminusIsSpecific(), view.CTerminusIsSpecific);
+        unit_assert_operator_equal(peptide.specificTermini(), view.specificTermini());
+        unit_assert_equal(peptide.monoisotopicMass(), view.monoisotopicMass, 1e-8);
+        unit_assert_equal(peptide.molecularWeight(), view.molecularWeight, 1e-8);
+    }
+    unit_assert(count > 0);
+}
+
 void testBSADigestion()
 {
     if (os_) *os_ << "BSA digestion test" << endl;
@@ -528,6 +560,54 @@ void testBSADigestion()
     unit_assert_operator_equal("DEHVKLV", aspnPeptides[3].sequence());
     unit_assert_operator_equal("NELTEFAKTCVA", aspnPeptides[4].sequence());
 
+    // test compiled cleavage rules against regexes that can't be compiled (the lookbehinds and lookaheads are groups)
+    for (int specificity = Digestion::NonSpecific; specificity <= Digestion::FullySpecific; ++specificity)
+    {
+        Digestion::Config config(2, 5, 20, (Digestion::Specificity) specificity);
+        testSameDigestion(Digestion(bsa, MS_Trypsin, config), Digestion(bsa, "(?<=(K|R))(?!(P))", config));
+        testSameDigestion(Digestion(bsa, MS_Asp_N, config), Digestion(bsa, "(?=(B|N|D))", config));
+        testSameDigestion(Digestion(bsa, MS_Formic_acid, config), Digestion(bsa, "(?<=(D))|(?=(D))", config));
+        testSameDigestion(Digestion(bsa, "(?<!L)(?=[DE])", config), Digestion(bsa, "(?<=[^L])(?=(D|E))|^(?=(D|E))", config));
+
+        vector<CVID> cleavageAgents;
+        cleavageAgents.push_back(MS_Lys_C);
+        cleavageAgents.push_back(MS_Asp_N);
+        testSameDigestion(Digestion(bsa, cleavageAgents, config), Digestion(bsa, "(?<=(K))(?!(P))|(?=(B|N|D))", config));
+    }
+
+    // test peptide views
+    testSameViews(Digestion(bsa, MS_Trypsin_P, Digestion::Config(3, 5, 40)));
+    testSameViews(Digestion(bsa, "(?<=^M)|(?<=[KR])", Digestion::Config(1, 5, 20, Digestion::SemiSpecific)));
+    testSameViews(Digestion(bsa, MS_Trypsin_P, Digestion::Config(1, 5, 20, Digestion::NonSpecific)));
+    testSameViews(Digestion("ELVISLIVESK", MS_no_cleavage));
+
+    // residues without a mass only affect the views that contain them
+    Digestion unknownResidueDigestion("PEPTIDEKAJKELVISKLIVESR*", MS_Trypsin_P, Digestion::Config(1, 1, 40));
+    size_t unknownResidueViews = 0;
+    for (Digestion::const_iterator itr = unknownResidueDigestion.begin(); itr != unknownResidueDigestion.end(); ++itr)
+    {
+        DigestedPeptideView view = itr.view();
+        if (view.sequence().find_first_of("J*") != string::npos)
+        {
+            unit_assert(boost::math::isnan(view.monoisotopicMass));
+            unit_assert(boost::math::isnan(view.molecularWeight));
+            ++unknownResidueViews;
+            continue;
+        }
+        const DigestedPeptide& peptide = *itr;
+        unit_assert_equal(peptide.monoisotopicMass(), view.monoisotopicMass, 1e-8);
+        unit_assert_equal(peptide.molecularWeight(), view.molecularWeight, 1e-8);
+    }
+    unit_assert_operator_equal(5, unknownResidueViews); // PEPTIDEKAJK, AJK, AJKELVISK, LIVESR*, *
+
+    // test a compiled negative lookbehind
+    Digestion notAfterPDigestion("AKPKAK", "(?<!P)(?=K)", Digestion::Config(0, 1, 100, Digestion::FullySpecific, false));
+    vector<Peptide> notAfterPPeptides(notAfterPDigestion.begin(), notAfterPDigestion.end());
+    unit_assert_operator_equal(3, notAfterPPeptides.size());
+    unit_assert_operator_equal("A", notAfterPPeptides[0].sequence());
+    unit_assert_operator_equal("KPKA", notAfterPPeptides[1].sequence());
+    unit_assert_operator_equal("K", notAfterPPeptides[2].sequence());
+
     // test no cleavage "digestion"
     Digestion noCleavageDigestion("ELVISLIVESK", MS_no_cleavage);
     vector<Peptide> noCleavagePeptides(noCleavageDigestion.begin(), noCleavageDigestion.end());
@@ -196,19 +196,19 @@ class HandlerWrangler : public SAXParser::Handler
         return status;
     }
 
-    virtual Status startElement(const string& name,
-                                const Attributes& attributes,
-                                stream_offset position)
+    Status elementStart(const char* name, size_t length,
+                        const Attributes& attributes,
+                        stream_offset position)
     {
         HandlerInfo& top = handlers_.top();
          
         // element start/end validation
 
-        top.names.push(name);
+        top.names.push(string(name, length));
 
         // call handler
 
-        Handler::Status status = top.handler.startElement(name, attributes, position);
+        Handler::Status status = top.handler.startElementById(elementId(top.handler, name, length), name, attributes, position);
         if (status.flag != Handler::Status::Delegate)
             return status; 
 
@@ -217,22 +217,22 @@ class HandlerWrangler : public SAXParser::Handler
         if (!status.delegate) throw runtime_error("[SAXParser] Null delegate.");
         top.names.pop();            
         handlers_.push(*status.delegate);
-        return startElement(name, attributes, position);
+        return elementStart(name, length, attributes, position);
     }
 
-    virtual Status endElement(const string& name, stream_offset position)
+    Status elementEnd(const char* name, size_t length, stream_offset position)
     {
         HandlerInfo& top = handlers_.top();
 
         // element start/end validation
-        if (top.names.empty() || top.names.top()!=name) 
-            throw runtime_error("[SAXParser::ParserWrangler::elementEnd()] Illegal end tag \"" + name + "\" at offset " + lexical_cast<string>(position) + "."); 
+        if (top.names.empty() || top.names.top().compare(0, string::npos, name, length) != 0) 
+            throw runtime_error("[SAXParser::ParserWrangler::elementEnd()] Illegal end tag \"" + string(name, length) + "\" at offset " + lexical_cast<string>(position) + "."); 
 
         top.names.pop();
 
         // call handler
 
-        Status status = top.handler.endElement(name, position);
+        Status status = top.handler.endElementById(elementId(top.handler, name, length), name, position);
         verifyNoDelegate(status); 
 
         // delete handler if we're done with it 
@@ -258,6 +258,11 @@ class HandlerWrangler : public SAXParser::Handler
 
     private:
     stack<HandlerInfo> handlers_;
+
+    static int elementId(const Handler& handler, const char* name, size_t length)
+    {
+        return handler.symbols ? handler.symbols->find(name, length) : SymbolTable::Unknown;
+    }
 };
 
 
@@ -311,7 +316,7 @@ void Handler::Attributes::parseAttributes(string::size_type& index) const
                 indexNameEnd--; // work back from = to end of name
             textbuff[indexNameEnd]=0; // null terminate in-place
             textbuff[indexQuoteClose]=0; // null terminate in-place
-            attrs[nattrs++].set(textbuff+indexNameBegin,textbuff+indexQuoteOpen+1,autoUnescape);
+            attrs[nattrs++].set(textbuff+indexNameBegin,indexNameEnd-indexNameBegin,textbuff+indexQuoteOpen+1,autoUnescape);
 
             index = indexQuoteClose+1; // ready for next round
             while (textbuff[index] && strchr(ws,textbuff[index]))  // eat whitespace
@@ -322,6 +327,71 @@ void Handler::Attributes::parseAttributes(string::size_type& index) const
 }
 
 
+namespace {
+
+// FNV-1a, mixed with the table's seed
+inline size_t hashName(const char* name, size_t length, size_t seed)
+{
+    size_t hash = 2166136261u ^ seed;
+    for (size_t i=0; i < length; ++i)
+        hash = (hash ^ (unsigned char) name[i]) * 16777619u;
+    return hash ^ (hash >> 15);
+}
+
+} // namespace
+
+
+SymbolTable::SymbolTable(const char* const* names)
+:   seed_(0)
+{
+    for (; *names; ++names)
+    {
+        names_.push_back(*names);
+        lengths_.push_back(strlen(*names));
+    }
+
+    // find a table size and seed for which every name has its own slot
+    size_t tableSize = 16;
+    while (tableSize < names_.size() * 2)
+        tableSize *= 2;
+
+    for (;; tableSize *= 2)
+        for (seed_ = 0; seed_ < 256; ++seed_)
+        {
+            slots_.assign(tableSize, Unknown);
+            bool collision = false;
+            for (size_t i=0; i < names_.size() && !collision; ++i)
+            {
+                int& id = slots_[slot(names_[i], lengths_[i])];
+                if (id != Unknown)
+                {
+                    // duplicate names keep the first id
+                    collision = lengths_[id] != lengths_[i] || memcmp(names_[id], names_[i], lengths_[i]);
+                    continue;
+                }
+                id = (int) i;
+            }
+            if (!collision)
+                return;
+        }
+}
+
+
+size_t SymbolTable::slot(const char* name, size_t length) const
+{
+    return hashName(name, length, seed_) & (slots_.size()-1);
+}
+
+
+int SymbolTable::find(const char* name, size_t length) const
+{
+    int id = slots_[slot(name, length)];
+    if (id != Unknown && lengths_[id] == length && !memcmp(names_[id], name, length))
+        return id;
+    return Unknown;
+}
+
+
 void unescapeXML(std::string &str) 
 {
     if (std::string::npos != str.find('&')) 
@@ -508,7 +578,7 @@ PWIZ_API_DECL void parse(istream& is, Handler& handler)
             }
             case '/':
             {
-                Handler::Status status = wrangler.endElement(buffer.c_str()+1, position);
+                Handler::Status status = wrangler.elementEnd(buffer.c_str()+1, buffer.length()-1, position);
                 if (status.flag == Handler::Status::Done) return;
                 break;
             }
@@ -528,12 +598,12 @@ PWIZ_API_DECL void parse(istream& is, Handler& handler)
             {
                 StartTag tag(buffer, handler.autoUnescapeAttributes);
 
-                Handler::Status status = wrangler.startElement(tag.getName(), tag.attributes, position);
+                Handler::Status status = wrangler.elementStart(tag.getName(), tag.attributes.getTagNameLength(), tag.attributes, position);
                 if (status.flag == Handler::Status::Done) return;
                 
                 if (tag.end) 
                 {
-                    status = wrangler.endElement(tag.getName(), position);
+                    status = wrangler.elementEnd(tag.getName(), tag.attributes.getTagNameLength(), position);
                     if (status.flag == Handler::Status::Done) return;
                 }
             }
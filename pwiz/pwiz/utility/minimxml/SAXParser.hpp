@@ -311,6 +311,38 @@ template<> inline std::string textToValue(const char *txt)
 }
 
 
+///
+/// Maps the element and attribute names of a schema to consecutive ids, so handlers can
+/// dispatch on integers instead of comparing strings. The names are perfect-hashed: a lookup
+/// hashes the name once and compares it to at most one entry.
+///
+class PWIZ_API_DECL SymbolTable
+{
+    public:
+
+    enum {Unknown = -1};
+
+    /// names[i] gets id i; the array is terminated by a null pointer and must outlive the table
+    SymbolTable(const char* const* names);
+
+    /// returns the id of the name, or Unknown if it is not in the table
+    int find(const char* name, size_t length) const;
+    int find(const char* name) const {return find(name, strlen(name));}
+
+    const char* name(int id) const {return names_[id];}
+    size_t length(int id) const {return lengths_[id];}
+    size_t size() const {return names_.size();}
+
+    private:
+    size_t slot(const char* name, size_t length) const;
+
+    std::vector<const char*> names_;
+    std::vector<size_t> lengths_;
+    std::vector<int> slots_; // hash slot -> id, or Unknown
+    size_t seed_;
+};
+
+
 /// SAX event handler interface.
 class Handler
 {
@@ -328,6 +360,10 @@ class Handler
     /// the handler determines the meaning of any non-zero value
     int version;
 
+    /// optional names of the handler's schema; when set, startElementById() and endElementById()
+    /// receive the elements' ids in the table, and attributes can be looked up by id
+    const SymbolTable* symbols;
+
     /// Handler returns the Status struct as a means of changing the parser's behavior.  
     struct Status
     {
@@ -355,7 +391,7 @@ class Handler
         // instead of a bunch of little std::string operations
     public:
         Attributes(const char * _source_text, size_t _source_text_len, bool _autoUnescape) :
-          index(0),index_end(0),autoUnescape(_autoUnescape),firstread(true),attrs()
+          index(0),index_end(0),tagNameLength(0),autoUnescape(_autoUnescape),firstread(true),attrs()
         {
               size=_source_text_len;
               textbuff = (char *)malloc(size+1);
@@ -366,7 +402,7 @@ class Handler
               test_invariant(); // everything correct?
         };
         Attributes() :
-          index(0),index_end(0),autoUnescape(false),firstread(true),attrs()
+          index(0),index_end(0),tagNameLength(0),autoUnescape(false),firstread(true),attrs()
         {
               size=0;
               textbuff = NULL;
@@ -374,7 +410,7 @@ class Handler
               test_invariant(); // everything correct?
         };
         Attributes(saxstring &str, bool _autoUnescape) :
-          index(0),index_end(0),autoUnescape(_autoUnescape),firstread(true),attrs() 
+          index(0),index_end(0),tagNameLength(0),autoUnescape(_autoUnescape),firstread(true),attrs() 
         {
               textbuff = str.data();
               size=str.length();
@@ -396,6 +432,7 @@ class Handler
             size = rhs.size;
             index = rhs.index;
             index_end = rhs.index_end; // string bounds for attribute parsing
+            tagNameLength = rhs.tagNameLength;
             autoUnescape = rhs.autoUnescape; // do XML escape of attribute?
             firstread = rhs.firstread; // may change during const access
             if (managemem)
@@ -404,7 +441,7 @@ class Handler
                 textbuff = (char *)malloc(size+1);
             managemem = true; // we need to free textbuff at dtor
             memcpy(textbuff,rhs.textbuff,size+1);
-            attrs.resize(rhs.attrs.size()); 
+            attrs = rhs.attrs;
             // now fix up the char ptrs to point to our copy of attribute list
             for (size_t n=attrs.size();n--;) 
             {
@@ -435,6 +472,10 @@ class Handler
             test_invariant(); // everything correct?
             return textbuff+('/'==*textbuff);
         }
+        size_t getTagNameLength() const
+        {
+            return tagNameLength;
+        }
         const char *getTextBuffer() const 
         { // return pointer to our work area
             test_invariant(); // everything correct?
@@ -448,6 +489,7 @@ class Handler
         mutable char *textbuff; // we'll operate on this copy of string
         size_t size;
         mutable size_t index,index_end; // string bounds for attribute parsing
+        size_t tagNameLength;
         bool autoUnescape; // do XML escape of attribute?
         bool managemem; // if true we need to free on exit
         mutable bool firstread; // may change during const access
@@ -460,6 +502,7 @@ class Handler
             size_t indexNameEnd = c-textbuff;
             while (*c && strchr(" \n\r\t",*c)) c++;
             textbuff[indexNameEnd] = 0; // nullterm the name
+            tagNameLength = indexNameEnd - ('/'==*textbuff);
             index = c-textbuff; // should point to bar
             index_end = size;
             test_invariant(); // everything correct?
@@ -474,6 +517,10 @@ class Handler
             {
                 return !strcmp(test,name); // return true on match
             }
+            bool matchName(const char *test, size_t length) const 
+            {
+                return length == nameLength && !memcmp(test,name,length);
+            }
             const char *getName() const 
             {
                 return name;
@@ -509,11 +556,13 @@ class Handler
             friend class Attributes;
         protected:
             const char *name; // attribute name - a pointer into main text buffer
+            size_t nameLength;
             char *value; // also a pointer into main text buffer, content may change during read
             mutable bool needsUnescape; // may change during read
-            void set(const char *_name, char *_value, bool _needsUnescape) 
+            void set(const char *_name, size_t _nameLength, char *_value, bool _needsUnescape) 
             {
                 name = _name;
+                nameLength = _nameLength;
                 value = _value;
                 needsUnescape = _needsUnescape;
             }
@@ -570,6 +619,18 @@ class Handler
                 return NULL;
             }
 
+            // compares the lengths of the names before their text
+            const attribute *findAttributeByName(const char *name, size_t length) const 
+            {
+                access(); // parse the buffer if we haven't already
+                for (attribute_list::const_iterator it=attrs.begin();it!=attrs.end();it++) 
+                {
+                    if (it->matchName(name, length)) 
+                        return &(*it);
+                }
+                return NULL;
+            }
+
             // return value for name if any, or NULL
             const char *findValueByName(const char *name,XMLUnescapeBehavior_t Unescape = XMLUnescapeDefault) const 
             {
@@ -596,7 +657,19 @@ class Handler
     virtual Status characters(const SAXParser::saxstring& text,
                               stream_offset position) {return Status::Ok;}
 
-    Handler() : parseCharacters(false), autoUnescapeAttributes(true), autoUnescapeCharacters(true), version(0) {}
+    /// called by the parser instead of startElement() and endElement(); elementId is the id of the name
+    /// in symbols, or SymbolTable::Unknown if the name is not in the table or symbols is not set;
+    /// the default implementations call the std::string versions
+    virtual Status startElementById(int elementId,
+                                    const char* name,
+                                    const Attributes& attributes,
+                                    stream_offset position) {return startElement(name, attributes, position);}
+
+    virtual Status endElementById(int elementId,
+                                  const char* name,
+                                  stream_offset position) {return endElement(name, position);}
+
+    Handler() : parseCharacters(false), autoUnescapeAttributes(true), autoUnescapeCharacters(true), version(0), symbols(0) {}
     virtual ~Handler(){}
 
     protected:
@@ -668,6 +741,61 @@ class Handler
             result = defaultValue;
         return result;    
     }
+
+    // the same lookups by attribute id; symbols must be set
+    inline const Attributes::attribute* findAttribute(const Attributes& attributes, int attributeId) const
+    {
+        return attributes.findAttributeByName(symbols->name(attributeId), symbols->length(attributeId));
+    }
+
+    template <typename T>
+    inline T& getAttribute(const Attributes& attributes,
+                    int attributeId,
+                    T& result,
+                    XMLUnescapeBehavior_t Unescape,
+                    T defaultValue = T()) const
+    {
+        const Attributes::attribute *attr = findAttribute(attributes, attributeId);
+        if (attr) 
+            result = attr->valueAs<T>(Unescape);
+        else 
+            result = defaultValue;
+        return result;
+    }
+
+    const char *getAttribute(const Attributes& attributes,
+                    int attributeId,
+                    XMLUnescapeBehavior_t Unescape,
+                    const char * defaultValue = NULL) const
+    {
+        const Attributes::attribute *attr = findAttribute(attributes, attributeId);
+        return attr ? attr->getValuePtr(Unescape) : defaultValue;
+    }
+
+    template <typename T>
+    inline T& getAttribute(const Attributes& attributes,
+        int attributeId,
+        T& result) const
+    {
+        const Attributes::attribute *attr = findAttribute(attributes, attributeId);
+        if (attr) 
+            result = attr->valueAs<T>(XMLUnescapeDefault);
+        else 
+            result = T();
+        return result;
+    }
+
+    inline std::string& getAttribute(const Attributes& attributes,
+        int attributeId,
+        std::string& result) const
+    {
+        const Attributes::attribute *attr = findAttribute(attributes, attributeId);
+        if (attr) 
+            result = attr->getValuePtr(XMLUnescapeDefault);
+        else 
+            result = "";
+        return result;
+    }
 };
 
 
@@ -520,6 +520,82 @@ void testNested()
 }
 
 
+enum Symbol {Symbol_RootElement, Symbol_FirstElement, Symbol_param, Symbol_param3, Symbol_br};
+const char* symbolNames_[] = {"RootElement", "FirstElement", "param", "param3", "br", 0};
+
+
+// counts the elements by id and reads attributes by id
+struct SymbolHandler : public SAXParser::Handler
+{
+    vector<int> startCounts, endCounts;
+    int unknownCount;
+    string param, param3;
+
+    SymbolHandler(const SymbolTable& symbolTable)
+    :   startCounts(symbolTable.size()), endCounts(symbolTable.size()), unknownCount(0)
+    {
+        symbols = &symbolTable;
+    }
+
+    virtual Status startElementById(int elementId, const char* name, const Attributes& attributes, stream_offset position)
+    {
+        if (elementId == SymbolTable::Unknown)
+        {
+            ++unknownCount;
+            return Status::Ok;
+        }
+
+        unit_assert_operator_equal(symbols->name(elementId), string(name));
+        ++startCounts[elementId];
+        if (elementId == Symbol_RootElement)
+            getAttribute(attributes, Symbol_param, param);
+        getAttribute(attributes, Symbol_param3, param3);
+        return Status::Ok;
+    }
+
+    virtual Status endElementById(int elementId, const char* name, stream_offset position)
+    {
+        if (elementId != SymbolTable::Unknown)
+            ++endCounts[elementId];
+        return Status::Ok;
+    }
+};
+
+
+void testSymbols()
+{
+    if (os_) *os_ << "testSymbols()\n";
+
+    SymbolTable symbolTable(symbolNames_);
+    unit_assert_operator_equal(5, symbolTable.size());
+    for (size_t i=0; i < symbolTable.size(); ++i)
+        unit_assert_operator_equal((int) i, symbolTable.find(symbolNames_[i]));
+    unit_assert_operator_equal(SymbolTable::Unknown, symbolTable.find("SecondElement"));
+    unit_assert_operator_equal(SymbolTable::Unknown, symbolTable.find("RootElement", 4));
+    unit_assert_operator_equal(SymbolTable::Unknown, symbolTable.find(""));
+
+    istringstream is(sampleXML);
+    SymbolHandler handler(symbolTable);
+    parse(is, handler);
+    unit_assert_operator_equal(1, handler.startCounts[Symbol_RootElement]);
+    unit_assert_operator_equal(1, handler.startCounts[Symbol_FirstElement]);
+    unit_assert_operator_equal(1, handler.startCounts[Symbol_br]);
+    unit_assert_operator_equal(1, handler.endCounts[Symbol_br]);
+    unit_assert_operator_equal(1, handler.endCounts[Symbol_RootElement]);
+    unit_assert_operator_equal(0, handler.startCounts[Symbol_param]);
+    unit_assert_operator_equal(5, handler.unknownCount); // SecondElement, Inline, prefix:ThirdElement, empty_with_space, FifthElement
+    unit_assert_operator_equal("value", handler.param);
+    unit_assert_operator_equal("", handler.param3); // reset by the elements after SecondElement
+
+    // the string overloads are called when the handler doesn't override the id overloads
+    NestedHandler nestedHandler;
+    nestedHandler.symbols = &symbolTable;
+    istringstream nested("<RootElement><br/></RootElement>");
+    parse(nested, nestedHandler);
+    unit_assert_operator_equal(2, nestedHandler.count);
+}
+
+
 void testRootElement()
 {
     if (os_) *os_ << "testRootElement()\n";
@@ -596,6 +672,7 @@ int main(int argc, char* argv[])
         testDone();
         testBadXML();
         testNested();
+        testSymbols();
         testRootElement();
         testDecoding();
     }
@@ -72,6 +72,149 @@ PWIZ_API_DECL void XMLWriter::Attributes::add(const string& name, const int& val
 }
 
 
+namespace {
+
+const char* attributeEntity(char c)
+{
+    switch (c)
+    {
+        case '&': return "&amp;";
+        case '"': return "&quot;";
+        case '\'': return "&apos;";
+        case '<': return "&lt;";
+        case '>': return "&gt;";
+        default: return 0;
+    }
+}
+
+const char* textEntity(char c)
+{
+    switch (c)
+    {
+        case '&': return "&amp;";
+        case '<': return "&lt;";
+        case '>': return "&gt;";
+        default: return 0;
+    }
+}
+
+// appends str to out, replacing the characters for which entity() returns non-null;
+// runs of characters that need no escaping are appended at once
+template <const char* (*entity)(char)>
+void appendEscaped(string& out, const char* str, size_t length)
+{
+    const char* run = str;
+    for (const char* it = str, *end = str + length; it != end; ++it)
+    {
+        const char* replacement = entity(*it);
+        if (!replacement) continue;
+        out.append(run, it);
+        out.append(replacement);
+        run = it + 1;
+    }
+    out.append(run, str + length);
+}
+
+void appendEscapedAttributeXML(string& out, const string& str)
+{
+    appendEscaped<attributeEntity>(out, str.c_str(), str.size());
+}
+
+void appendEscapedTextXML(string& out, const string& str)
+{
+    appendEscaped<textEntity>(out, str.c_str(), str.size());
+}
+
+// appends the shortest of the %.15g, %.16g and %.17g forms that reads back as value;
+// %g drops trailing zeros, so values with up to 15 significant digits come out as
+// short as they can be written
+void appendShortestDouble(string& out, double value)
+{
+    char buffer[32];
+    int length = sprintf(buffer, "%.15g", value);
+    if (value == value && STRTOD(buffer, NULL) != value)
+    {
+        length = sprintf(buffer, "%.16g", value);
+        if (STRTOD(buffer, NULL) != value)
+            length = sprintf(buffer, "%.17g", value);
+    }
+    out.append(buffer, length);
+}
+
+template <typename T>
+void appendUnsigned(string& out, T value)
+{
+    char buffer[24];
+    char* p = buffer + sizeof(buffer);
+    do {*--p = '0' + static_cast<char>(value % 10); value /= 10;} while (value);
+    out.append(p, buffer + sizeof(buffer));
+}
+
+} // namespace
+
+
+PWIZ_API_DECL void XMLWriter::AttributeBuilder::addName(const char* name)
+{
+    offsets_.push_back(text_.size());
+    text_ += ' ';
+    text_ += name;
+    text_ += "=\"";
+}
+
+PWIZ_API_DECL void XMLWriter::AttributeBuilder::add(const char* name, const string& value)
+{
+    addName(name);
+    appendEscapedAttributeXML(text_, value);
+    text_ += '"';
+}
+
+PWIZ_API_DECL void XMLWriter::AttributeBuilder::add(const char* name, const char* value)
+{
+    addName(name);
+    appendEscaped<attributeEntity>(text_, value, strlen(value));
+    text_ += '"';
+}
+
+PWIZ_API_DECL void XMLWriter::AttributeBuilder::add(const char* name, double value)
+{
+    addName(name);
+    appendShortestDouble(text_, value);
+    text_ += '"';
+}
+
+PWIZ_API_DECL void XMLWriter::AttributeBuilder::add(const char* name, int value)
+{
+    addName(name);
+    if (value < 0)
+    {
+        text_ += '-';
+        appendUnsigned(text_, 0u - static_cast<unsigned int>(value));
+    }
+    else
+        appendUnsigned(text_, static_cast<unsigned int>(value));
+    text_ += '"';
+}
+
+PWIZ_API_DECL void XMLWriter::AttributeBuilder::add(const char* name, size_t value)
+{
+    addName(name);
+    appendUnsigned(text_, value);
+    text_ += '"';
+}
+
+PWIZ_API_DECL void XMLWriter::AttributeBuilder::addEscaped(const char* name, const string& escapedValue)
+{
+    addName(name);
+    text_ += escapedValue;
+    text_ += '"';
+}
+
+
+//
+// Each write is formatted into buffer_ and then written to the stream at once
+// (and passed to the output observer, if any), so the buffer's capacity is reused
+// from one element to the next.
+//
 class XMLWriter::Impl
 {
     public:
@@ -83,6 +226,10 @@ class XMLWriter::Impl
     void startElement(const string& name, 
                       const Attributes& attributes,
                       EmptyElementTag emptyElementTag);
+    void startElement(const string& name, 
+                      const AttributeBuilder& attributes,
+                      EmptyElementTag emptyElementTag);
+    AttributeBuilder& attributeBuilder() {attributeBuilder_.clear(); return attributeBuilder_;}
     void endElement();
     void characters(const string& text, bool autoEscape);
     bio::stream_offset position() const;
@@ -93,10 +240,17 @@ class XMLWriter::Impl
     Config config_;
     stack<string> elementStack_;
     stack<unsigned int> styleStack_;
+    string buffer_;
+    AttributeBuilder attributeBuilder_;
 
-    string indentation() const {return string(elementStack_.size()*config_.indentationStep, ' ');}
-    string indentation(size_t depth) const {return string(depth*config_.indentationStep, ' ');}
+    size_t indentationSize() const {return elementStack_.size()*config_.indentationStep;}
+    void indent() {buffer_.append(indentationSize(), ' ');}
+    void indent(size_t depth) {buffer_.append(depth*config_.indentationStep, ' ');}
     bool style(StyleFlag styleFlag) const {return styleStack_.top() & styleFlag ? true : false;}
+
+    void startTag(const string& name);
+    void endStartTag(const string& name, EmptyElementTag emptyElementTag);
+    void writeBuffer();
 };
 
 
@@ -121,53 +275,49 @@ void XMLWriter::Impl::popStyle()
 }
 
 
-void XMLWriter::Impl::processingInstruction(const string& name, const string& data) 
+void XMLWriter::Impl::writeBuffer()
 {
-    ostream* os = &os_;
-    if (config_.outputObserver) os = new ostringstream;
+    if (config_.outputObserver)
+        config_.outputObserver->update(buffer_);
+    os_.write(buffer_.c_str(), buffer_.size());
+    buffer_.clear();
+}
 
-    *os << indentation() << "<?" << name << " " << data << "?>\n"; 
 
-    if (config_.outputObserver)
-    {
-        config_.outputObserver->update(static_cast<ostringstream*>(os)->str());
-        os_ << static_cast<ostringstream*>(os)->str();
-        delete os;
-    }
+void XMLWriter::Impl::processingInstruction(const string& name, const string& data) 
+{
+    indent();
+    buffer_ += "<?";
+    buffer_ += name;
+    buffer_ += ' ';
+    buffer_ += data;
+    buffer_ += "?>\n";
+    writeBuffer();
 }
 
 
-void writeEscapedAttributeXML(ostream& os, const string& str)
+void XMLWriter::Impl::startTag(const string& name)
 {
-    for (size_t i=0, end=str.size(); i < end; ++i)
-    {
-        const char& c = str[i];
-        switch (c)
-        {
-            case '&': os << "&amp;"; break;
-            case '"': os << "&quot;"; break;
-            case '\'': os << "&apos;"; break;
-            case '<': os << "&lt;"; break;
-            case '>': os << "&gt;"; break;
-            default: os << c; break;
-        }
-    }
+    if (!style(StyleFlag_InlineOuter))
+        indent();
+
+    buffer_ += '<';
+    buffer_ += name;
 }
 
 
-void writeEscapedTextXML(ostream& os, const string& str)
+void XMLWriter::Impl::endStartTag(const string& name, EmptyElementTag emptyElementTag)
 {
-    for (size_t i=0, end=str.size(); i < end; ++i)
-    {
-        const char& c = str[i];
-        switch (c)
-        {
-            case '&': os << "&amp;"; break;
-            case '<': os << "&lt;"; break;
-            case '>': os << "&gt;"; break;
-            default: os << c; break;
-        }
-    }
+    buffer_ += (emptyElementTag==EmptyElement ? "/>" : ">");
+
+    if (!style(StyleFlag_InlineInner) || 
+        (!style(StyleFlag_InlineOuter) && emptyElementTag==EmptyElement))
+        buffer_ += '\n';
+
+    if (emptyElementTag == NotEmptyElement)
+        elementStack_.push(name);
+
+    writeBuffer();
 }
 
 
@@ -175,91 +325,91 @@ void XMLWriter::Impl::startElement(const string& name,
                   const Attributes& attributes,
                   EmptyElementTag emptyElementTag)
 {
-    ostream* os = &os_;
-    if (config_.outputObserver) os = new ostringstream;
-
-    if (!style(StyleFlag_InlineOuter))
-        *os << indentation();
-
-    *os << "<" << name;
-
-    string attributeIndentation(name.size()+1, ' ');
+    startTag(name);
 
     for (Attributes::const_iterator it=attributes.begin(); it!=attributes.end(); ++it)
     {
-        *os << " " << it->first << "=\"";
-        writeEscapedAttributeXML(*os, it->second);
-        *os << "\"";
+        buffer_ += ' ';
+        buffer_ += it->first;
+        buffer_ += "=\"";
+        appendEscapedAttributeXML(buffer_, it->second);
+        buffer_ += '"';
         if (style(StyleFlag_AttributesOnMultipleLines) && (it+1)!=attributes.end())
-            *os << "\n" << indentation() << attributeIndentation;
+        {
+            buffer_ += '\n';
+            indent();
+            buffer_.append(name.size()+1, ' ');
+        }
     }
 
-    *os << (emptyElementTag==EmptyElement ? "/>" : ">");
+    endStartTag(name, emptyElementTag);
+}
 
-    if (!style(StyleFlag_InlineInner) || 
-        (!style(StyleFlag_InlineOuter) && emptyElementTag==EmptyElement))
-        *os << "\n";
 
-    if (emptyElementTag == NotEmptyElement)
-        elementStack_.push(name);
+void XMLWriter::Impl::startElement(const string& name, 
+                  const AttributeBuilder& attributes,
+                  EmptyElementTag emptyElementTag)
+{
+    startTag(name);
 
-    if (config_.outputObserver)
+    if (!style(StyleFlag_AttributesOnMultipleLines))
+        buffer_ += attributes.text();
+    else
     {
-        config_.outputObserver->update(static_cast<ostringstream*>(os)->str());
-        os_ << static_cast<ostringstream*>(os)->str();
-        delete os;
+        // the builder's text has a space before each attribute; start each one after the first on a new line
+        const string& text = attributes.text();
+        const vector<size_t>& offsets = attributes.offsets();
+        for (size_t i=0; i < offsets.size(); ++i)
+        {
+            size_t begin = offsets[i], end = i+1 < offsets.size() ? offsets[i+1] : text.size();
+            if (i > 0)
+            {
+                buffer_ += '\n';
+                indent();
+                buffer_.append(name.size()+1, ' ');
+            }
+            buffer_.append(text, begin, end - begin);
+        }
     }
+
+    endStartTag(name, emptyElementTag);
 }
 
 
 void XMLWriter::Impl::endElement()
 {
-    ostream* os = &os_;
-    if (config_.outputObserver) os = new ostringstream;
-
     if (elementStack_.empty())
         throw runtime_error("[XMLWriter] Element stack underflow.");
 
     if (!style(StyleFlag_InlineInner))
-        *os << indentation(elementStack_.size()-1);
+        indent(elementStack_.size()-1);
 
-    *os << "</" << elementStack_.top() << ">";
+    buffer_ += "</";
+    buffer_ += elementStack_.top();
+    buffer_ += '>';
     elementStack_.pop();
 
     if (!style(StyleFlag_InlineOuter))
-        *os << "\n";
-        
-    if (config_.outputObserver)
-    {
-        config_.outputObserver->update(static_cast<ostringstream*>(os)->str());
-        os_ << static_cast<ostringstream*>(os)->str();
-        delete os;
-    }
+        buffer_ += '\n';
+
+    writeBuffer();
 }
 
 
 void XMLWriter::Impl::characters(const string& text, bool autoEscape)
 {
-    ostream* os = &os_;
-    if (config_.outputObserver) os = new ostringstream;
-
     if (!style(StyleFlag_InlineInner))
-        *os << indentation();
+        indent();
 
     if (autoEscape)
-        writeEscapedTextXML(*os, text);
+        appendEscapedTextXML(buffer_, text);
     else
-        *os << text;
+        buffer_ += text;
 
     if (!style(StyleFlag_InlineInner))
-        *os << "\n";
+        buffer_ += '\n';
 
-    if (config_.outputObserver)
-    {
-        config_.outputObserver->update(static_cast<ostringstream*>(os)->str());
-        os_ << static_cast<ostringstream*>(os)->str();
-        delete os;
-    }
+    writeBuffer();
 }
 
 
@@ -283,7 +433,7 @@ XMLWriter::stream_offset XMLWriter::Impl::positionNext() const
 {
     stream_offset offset = position(); 
     if (!style(StyleFlag_InlineOuter))
-        offset += indentation().size();
+        offset += indentationSize();
     return offset;
 }
 
@@ -313,6 +463,15 @@ PWIZ_API_DECL void XMLWriter::startElement(const string& name,
     impl_->startElement(name, attributes, emptyElementTag);
 }
 
+PWIZ_API_DECL void XMLWriter::startElement(const string& name, 
+                             const AttributeBuilder& attributes,
+                             EmptyElementTag emptyElementTag)
+{
+    impl_->startElement(name, attributes, emptyElementTag);
+}
+
+PWIZ_API_DECL XMLWriter::AttributeBuilder& XMLWriter::attributeBuilder() {return impl_->attributeBuilder();}
+
 PWIZ_API_DECL void XMLWriter::endElement() {impl_->endElement();}
 
 PWIZ_API_DECL void XMLWriter::characters(const string& text, bool autoEscape) {impl_->characters(text, autoEscape);}
@@ -386,6 +545,14 @@ PWIZ_API_DECL string encode_xml_id_copy(const string& str)
 }
 
 
+PWIZ_API_DECL string escape_xml_attribute_copy(const string& str)
+{
+    string escaped;
+    appendEscapedAttributeXML(escaped, str);
+    return escaped;
+}
+
+
 } // namespace minimxml
 } // namespace pwiz
 
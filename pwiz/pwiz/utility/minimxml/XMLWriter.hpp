@@ -91,6 +91,42 @@ class PWIZ_API_DECL XMLWriter
         }
     };
 
+    /// name/value pairs formatted straight into a reusable buffer as they are added,
+    /// for writing many small elements without building a string per attribute;
+    /// names are written as given, values are escaped unless added with addEscaped()
+    class PWIZ_API_DECL AttributeBuilder
+    {
+        public:
+
+        /// removes all attributes, keeping the buffer's capacity
+        void clear() {text_.clear(); offsets_.clear();}
+
+        bool empty() const {return offsets_.empty();}
+        size_t size() const {return offsets_.size();}
+
+        void add(const char* name, const std::string& value);
+        void add(const char* name, const char* value);
+
+        /// writes the shortest decimal string that reads back as the same double
+        void add(const char* name, double value);
+        void add(const char* name, int value);
+        void add(const char* name, size_t value);
+
+        /// adds a value that is already escaped, e.g. by escape_xml_attribute_copy()
+        void addEscaped(const char* name, const std::string& escapedValue);
+
+        /// the formatted attributes, each preceded by a space: ' name1="value1" name2="value2"'
+        const std::string& text() const {return text_;}
+
+        /// the offset in text() at which each attribute starts
+        const std::vector<size_t>& offsets() const {return offsets_;}
+
+        private:
+        void addName(const char* name);
+        std::string text_;
+        std::vector<size_t> offsets_;
+    };
+
     /// constructor
     XMLWriter(std::ostream& os, const Config& config = Config());
     virtual ~XMLWriter() {}
@@ -112,6 +148,15 @@ class PWIZ_API_DECL XMLWriter
                       const Attributes& attributes = Attributes(),
                       EmptyElementTag emptyElementTag = NotEmptyElement);
 
+    /// writes element start tag with attributes from an AttributeBuilder
+    void startElement(const std::string& name, 
+                      const AttributeBuilder& attributes,
+                      EmptyElementTag emptyElementTag = NotEmptyElement);
+
+    /// returns an empty AttributeBuilder owned by the writer; its buffer is reused
+    /// by every call, so it must be passed to startElement() before the next call
+    AttributeBuilder& attributeBuilder();
+
     /// writes element end tag
     void endElement();
 
@@ -149,6 +194,12 @@ PWIZ_API_DECL std::string& encode_xml_id(std::string& str);
 PWIZ_API_DECL std::string encode_xml_id_copy(const std::string& str);
 
 
+/// Returns a copy of the input string with the characters reserved in XML attribute
+/// values (ampersand, quote, apostrophe, less-than and greater-than) replaced by their
+/// entity references, e.g. "&" encodes as "&amp;"
+PWIZ_API_DECL std::string escape_xml_attribute_copy(const std::string& str);
+
+
 //
 // Template name: basic_charcounter.
 // Template paramters:
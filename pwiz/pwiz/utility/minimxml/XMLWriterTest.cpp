@@ -199,6 +199,70 @@ void testNormalization()
 }
 
 
+void testAttributeBuilder()
+{
+    // AttributeBuilder output matches Attributes output, including escaping and multi-line style
+    ostringstream expected, actual;
+    XMLWriter::Config config;
+    config.indentationStep = 4;
+    XMLWriter expectedWriter(expected, config), actualWriter(actual, config);
+
+    for (int multipleLines=0; multipleLines < 2; ++multipleLines)
+    {
+        if (multipleLines)
+        {
+            expectedWriter.pushStyle(XMLWriter::StyleFlag_AttributesOnMultipleLines);
+            actualWriter.pushStyle(XMLWriter::StyleFlag_AttributesOnMultipleLines);
+        }
+
+        XMLWriter::Attributes attributes;
+        attributes.push_back(make_pair("name", "\"Penn & Teller\""));
+        attributes.push_back(make_pair("color", "<red>"));
+        attributes.push_back(make_pair("number", "37"));
+        attributes.push_back(make_pair("index", "-42"));
+        attributes.push_back(make_pair("ref", "'"));
+        expectedWriter.startElement("record", attributes);
+        expectedWriter.startElement("empty", XMLWriter::Attributes(), XMLWriter::EmptyElement);
+        expectedWriter.endElement();
+
+        XMLWriter::AttributeBuilder& builder = actualWriter.attributeBuilder();
+        builder.add("name", string("\"Penn & Teller\""));
+        builder.add("color", "<red>");
+        builder.add("number", (size_t) 37);
+        builder.add("index", -42);
+        builder.addEscaped("ref", escape_xml_attribute_copy("'"));
+        unit_assert_operator_equal(5, builder.size());
+        actualWriter.startElement("record", builder);
+        unit_assert(actualWriter.attributeBuilder().empty());
+        actualWriter.startElement("empty", actualWriter.attributeBuilder(), XMLWriter::EmptyElement);
+        actualWriter.endElement();
+    }
+
+    if (os_) *os_ << "testAttributeBuilder:\n" << actual.str() << endl;
+    unit_assert_operator_equal(expected.str(), actual.str());
+
+    // doubles are written with the fewest digits that read back as the same value
+    XMLWriter::AttributeBuilder builder;
+    const double values[] = {0.1, 420, -0.666, 1.0/3, 2.0/3, 1e-5, 1e300, 445.120025, 0.30000000000000004, 0};
+    for (size_t i=0; i < sizeof(values)/sizeof(double); ++i)
+    {
+        builder.clear();
+        builder.add("v", values[i]);
+        string value = builder.text().substr(4, builder.text().size() - 5);
+        unit_assert_operator_equal(values[i], lexical_cast<double>(value));
+    }
+
+    builder.clear(); builder.add("v", 0.1);
+    unit_assert_operator_equal(" v=\"0.1\"", builder.text());
+    builder.clear(); builder.add("v", -0.666);
+    unit_assert_operator_equal(" v=\"-0.666\"", builder.text());
+    builder.clear(); builder.add("v", 445.120025);
+    unit_assert_operator_equal(" v=\"445.120025\"", builder.text());
+    builder.clear(); builder.add("v", 0.30000000000000004);
+    unit_assert_operator_equal(" v=\"0.30000000000000004\"", builder.text());
+}
+
+
 int main(int argc, char* argv[])
 {
     TEST_PROLOG(argc, argv)
@@ -208,6 +272,7 @@ int main(int argc, char* argv[])
         if (argc>1 && !strcmp(argv[1],"-v")) os_ = &cout;
         test();
         testNormalization();
+        testAttributeBuilder();
     }
     catch (exception& e)
     {
@@ -48,12 +48,36 @@
 #include "CommandLine.h"
 #include "SqliteRoutine.h"
 #include "boost/program_options.hpp"
+#include "boost/thread.hpp"
+#include "boost/bind.hpp"
+#include <deque>
 
 using namespace std;
 namespace ops = boost::program_options;
 
 namespace BiblioSpec {
 
+/**
+ * The redundant spectra of one peptide ion (same modified sequence and
+ * charge) on their way through the filter.  The reader fills in the
+ * spectra and their compressed peaks, a worker uncompresses the peaks
+ * and selects the best spectrum, and the writer copies the best
+ * spectrum to the filtered library.
+ */
+struct IonGroup
+{
+    IonGroup() : bestIndex(0), bestAverageScore(0), belowMinScore(false) {}
+    ~IonGroup() { clearVector(spectra); }
+
+    vector<RefSpectrum*> spectra;
+    vector<int> numPeaks;
+    vector< vector<Byte> > comprMz;        // peakMZ blobs, same order as spectra
+    vector< vector<Byte> > comprIntensity; // peakIntensity blobs
+    int bestIndex;
+    double bestAverageScore;
+    bool belowMinScore; // best average dot product was below min-score
+};
+
 class BlibFilter : public BlibMaker
 {
  public:
@@ -72,7 +96,9 @@ class BlibFilter : public BlibMaker
     vector<PEAK_T> getUncompressedPeaks(int& numPeaks,
                                         int& mzLen, Byte* comprM, 
                                         int& intensityLen, Byte* comprI);
-    void compAndInsert(vector<RefSpectrum*>& oneIon);
+    void selectBestSpectrum(IonGroup& ionGroup);
+    void insertIonGroup(IonGroup& ionGroup);
+    void flushRetentionTimes();
     map< int, vector<RefSpectrum*> > groupByScoreType(const vector<RefSpectrum*>& oneIon, map<RefSpectrum*, int>* outIndices);
     vector<RefSpectrum*> getBestScores(const vector<RefSpectrum*>& group, bool higherIsBetter);
 
@@ -86,8 +112,30 @@ class BlibFilter : public BlibMaker
     int tableVersion_;
     bool useBestScoring_;
     map<int, bool> higherIsBetter_;
+    int numThreads_;      // workers selecting best spectra, 0 for one per processor
     char zSql[2048];
 
+    // rows for RetentionTimes that have not been inserted yet
+    string retentionTimeValues_;
+    int retentionTimeRows_;
+
+    // pipeline state shared by the reader, the workers and the writer
+    boost::mutex pipelineMutex_;
+    boost::condition_variable pipelineCondition_;
+    deque< pair<int, IonGroup*> > unselectedIonGroups_; // read, waiting for a worker
+    map<int, IonGroup*> selectedIonGroups_;             // best spectrum selected, waiting for the writer
+    int ionGroupsRead_;
+    int ionGroupsWritten_;
+    int maxIonGroupsInFlight_;
+    bool readerDone_;
+    bool pipelineAborted_;
+    string pipelineError_;
+
+    void readIonGroups(string optionalCols);
+    void selectBestSpectra();
+    IonGroup* nextSelectedIonGroup();
+    void abortPipeline(const string& error);
+
     void getCommandLineValues(ops::variables_map& options_table);
 };
 } // namespace
@@ -132,6 +180,13 @@ BlibFilter::BlibFilter()
     minAverageScore_ = 0;
     tableVersion_ = 0;
     useBestScoring_ = false;
+    numThreads_ = 0;
+    retentionTimeRows_ = 0;
+    ionGroupsRead_ = 0;
+    ionGroupsWritten_ = 0;
+    maxIonGroupsInFlight_ = 0;
+    readerDone_ = false;
+    pipelineAborted_ = false;
     // Never append to a non-redundant library
     setOverwrite(true);
     setRedundant(false);
@@ -174,6 +229,10 @@ void BlibFilter::parseCommandLine(const int argc,
              value<bool>()->default_value(false),
              "Description of option.  Default false.")
 
+            ("threads,t",
+             value<int>()->default_value(0),
+             "Number of threads used to compare spectra.  Default 0 (one per processor).")
+
             ;
 
         // define the required command line args
@@ -211,6 +270,7 @@ void BlibFilter::getCommandLineValues(ops::variables_map& options_table){
     minAverageScore_ = options_table["min-score"].as<double>();
     setLibName(options_table["filtered-library"].as<string>());
     useBestScoring_ = options_table["best-scoring"].as<bool>();
+    numThreads_ = options_table["threads"].as<int>();
 }
 
 void BlibFilter::attachAll()
@@ -379,144 +439,47 @@ void BlibFilter::buildNonRedundantLib()
         }
     }
 
-    vector<RefSpectrum*> oneIon;
-    char lastPepModSeq[1024], pepModSeq[1024];
-    lastPepModSeq[0]='\0';
-    pepModSeq[0]='\0';
-
-    int lastCharge=0, charge=0;
-
     Verbosity::debug("Counting Spectra.");
     ProgressIndicator progress(getSpectrumCount(redundantDbName_));
 
-    Verbosity::debug("Sorting spectra by sequence and charge.");
-    //first Order by peptideModSeq and charge, filter by num peaks
-    sprintf(zSql,
-            "SELECT id,peptideSeq,precursorMZ,precursorCharge,peptideModSeq,"
-            "prevAA, nextAA, numPeaks, score, scoreType %s "
-            "FROM %s.RefSpectra "
-            "WHERE numPeaks >= %i "
-            "ORDER BY peptideModSeq, precursorCharge %s", optional_cols.c_str(), redundantDbName_, minPeaks_,
-            optional_cols.c_str());
-
-    smart_stmt pStmt;
-    int rc = sqlite3_prepare(getDb(), zSql, -1, &pStmt, 0);
-
-    check_rc(rc, zSql, 
-             "Failed selecting redundant spectra for comparison.");
-    Verbosity::debug("Successfully sorted.");
-
-    rc = sqlite3_step(pStmt);
-
-    // setup for getting peak data
-    sqlite3* peakConnection;
-    int peakRc = sqlite3_open(redundantFileName_.c_str(), &peakConnection);
-    if (peakRc != SQLITE_OK)
-    {
-        Verbosity::error("Could not open connection to database '%s'", redundantFileName_.c_str());
+    // One thread streams ion groups and their peaks out of the redundant
+    // library, a pool of workers selects the best spectrum of each group,
+    // and this thread copies the groups to the filtered library in the
+    // order they were read.
+    int numWorkers = numThreads_ > 0 ? numThreads_ 
+        : max(1, (int)boost::thread::hardware_concurrency());
+    maxIonGroupsInFlight_ = numWorkers * 8;
+    ionGroupsRead_ = 0;
+    ionGroupsWritten_ = 0;
+    readerDone_ = false;
+    pipelineAborted_ = false;
+
+    boost::thread_group threads;
+    threads.create_thread(boost::bind(&BlibFilter::readIonGroups, this, 
+                                      optional_cols));
+    for (int i = 0; i < numWorkers; ++i) {
+        threads.create_thread(boost::bind(&BlibFilter::selectBestSpectra, this));
     }
-    sqlite3_stmt* peakStmt;
-    char zSqlPeakQuery[2048];
-    strcpy(zSqlPeakQuery,
-           "SELECT peakMZ, peakIntensity "
-           "FROM RefSpectraPeaks "
-           "WHERE RefSpectraId = ");
-    char* idPos = zSqlPeakQuery;
-    idPos += strlen(zSqlPeakQuery);
-
-    // for each spectrum entry in table
-    while( rc==SQLITE_ROW ) {
-        progress.increment();
-        
-        // create a RefSpectrum object and populate all fields
-        // then get charge and seq
-        // TODO: RefSpectrum* tmpRef = nextRefSpec(pStmt);
-
-        RefSpectrum* tmpRef = new RefSpectrum();
-
-        strcpy(pepModSeq,
-               reinterpret_cast<const char*>(sqlite3_column_text(pStmt,4)));
-        charge = sqlite3_column_int(pStmt,3);
-        
-        tmpRef->setLibSpecID(sqlite3_column_int(pStmt,0));
-        tmpRef->setSeq(reinterpret_cast<const char*>(sqlite3_column_text(pStmt,
-                                                                         1)));
-        tmpRef->setMz(sqlite3_column_double(pStmt,2));
-        tmpRef->setCharge(charge);
-        // if not selected, value == 0
-        tmpRef->setIonMobility(sqlite3_column_double(pStmt, 12));
-        tmpRef->setIonMobilityType(sqlite3_column_int(pStmt, 13));
-        tmpRef->setIonMobilityHighEnergyDriftTimeOffsetMsec(sqlite3_column_double(pStmt, 14));
-        tmpRef->setRetentionTime(sqlite3_column_double(pStmt, 11));
-        tmpRef->setMods(pepModSeq);
-        tmpRef->setPrevAA("-");
-        tmpRef->setNextAA("-");
-        tmpRef->setScore(sqlite3_column_double(pStmt, 8));
-        tmpRef->setScoreType(sqlite3_column_int(pStmt, 9));
-        tmpRef->setScanNumber(sqlite3_column_int(pStmt, 10));
-
-        int numPeaks = sqlite3_column_int(pStmt,7);
-
-        // get peaks for this spectrum
-        int refSpectraId = sqlite3_column_int(pStmt, 0);
-        sprintf(idPos, "%i", refSpectraId);
-        peakRc = sqlite3_prepare(peakConnection, zSqlPeakQuery, -1, &peakStmt, NULL);
-        check_rc(peakRc, zSqlPeakQuery, "Failed selecting peaks.");
-        peakRc = sqlite3_step(peakStmt);
-        if (peakRc != SQLITE_ROW)
-        {
-            Verbosity::error("Did not find peaks for spectrum %d.", refSpectraId);
-        }
-        int numBytes1 = sqlite3_column_bytes(peakStmt, 0);
-        Byte* comprM = (Byte*)sqlite3_column_blob(peakStmt, 0);
-        int numBytes2 = sqlite3_column_bytes(peakStmt, 1);
-        Byte* comprI = (Byte*)sqlite3_column_blob(peakStmt, 1);        
-        
-        
-        // is this slow for copying the peak vector? better to return a ptr?
-        vector<PEAK_T> peaks = getUncompressedPeaks(numPeaks, numBytes1,
-                                                    comprM, numBytes2, comprI);
-        sqlite3_finalize(peakStmt);
-        if (peaks.size() == 0) {
-            Verbosity::error("Unable to read peaks for redundant library "
-                             "spectrum %i, sequence %s, charge %i.",
-                             tmpRef->getLibSpecID(), (tmpRef->getSeq()).c_str(),
-                             tmpRef->getCharge());
-        }
-        tmpRef->setRawPeaks(peaks);
-        // TODO end nextRefSpec
-
-        // if this spec has same seq and charge, add to the collection
-        if(strcmp(pepModSeq,lastPepModSeq) == 0 && lastCharge == charge) {
-            oneIon.push_back(tmpRef);
-        } else {// filter & start new collection for a different seq and charge
-            
-            if(!oneIon.empty()) {
-                Verbosity::comment(V_DETAIL, "Selecting spec for %s, charge %i"
-                                   " from %i spectra.", lastPepModSeq,
-                                   lastCharge, oneIon.size());
-                compAndInsert(oneIon);
-                clearVector(oneIon);
-            }
-            
-            oneIon.push_back(tmpRef);
-            strcpy(lastPepModSeq, pepModSeq);
-            lastCharge = charge;
-            Verbosity::comment(V_DETAIL, "Collecting spec for %s, charge %i,",
-                               pepModSeq, charge);
+
+    try {
+        IonGroup* ionGroup;
+        while ((ionGroup = nextSelectedIonGroup()) != NULL) {
+            progress.add(ionGroup->spectra.size());
+            insertIonGroup(*ionGroup);
+            delete ionGroup;
         }
-        
-        rc = sqlite3_step(pStmt);
-    }// next table entry
-    
-    // Insert the last spectrum
-    if (!oneIon.empty()) {
-        progress.increment();
-        Verbosity::comment(V_DETAIL, "Selecting spec for %s, charge %i"
-                           " from %i spectra.", lastPepModSeq,
-                           lastCharge, oneIon.size());
-        compAndInsert(oneIon);
-        clearVector(oneIon);
+        flushRetentionTimes();
+    } catch (...) {
+        abortPipeline("");
+        threads.join_all();
+        throw;
+    }
+    threads.join_all();
+
+    // errors in the reader and workers are only reported here, on the
+    // main thread, once they have all stopped
+    if (!pipelineError_.empty()) {
+        Verbosity::error("%s", pipelineError_.c_str());
     }
 
     // we may have selected fewer spectra than were in the library
@@ -524,6 +487,248 @@ void BlibFilter::buildNonRedundantLib()
     progress.finish();
 }
 
+/**
+ * Reader thread.  Select the redundant spectra ordered by sequence and
+ * charge on a separate connection to the redundant library and queue
+ * them up for the workers, one peptide ion at a time, along with their
+ * compressed peaks.  Stops reading ahead when the workers and writer
+ * fall behind.
+ */
+void BlibFilter::readIonGroups(string optionalCols)
+{
+    sqlite3* readConnection = NULL;
+    try {
+        if (sqlite3_open(redundantFileName_.c_str(), &readConnection) != SQLITE_OK) {
+            throw BlibException(false, "Could not open connection to database '%s'",
+                                redundantFileName_.c_str());
+        }
+
+        Verbosity::debug("Sorting spectra by sequence and charge.");
+        //first Order by peptideModSeq and charge, filter by num peaks
+        char spectraSql[2048];
+        sprintf(spectraSql,
+                "SELECT id,peptideSeq,precursorMZ,precursorCharge,peptideModSeq,"
+                "prevAA, nextAA, numPeaks, score, scoreType %s "
+                "FROM RefSpectra "
+                "WHERE numPeaks >= %i "
+                "ORDER BY peptideModSeq, precursorCharge %s", 
+                optionalCols.c_str(), minPeaks_, optionalCols.c_str());
+
+        smart_stmt pStmt;
+        int rc = sqlite3_prepare(readConnection, spectraSql, -1, &pStmt, 0);
+        check_rc(rc, spectraSql, 
+                 "Failed selecting redundant spectra for comparison.");
+        Verbosity::debug("Successfully sorted.");
+
+        // setup for getting peak data
+        const char* peakSql = "SELECT peakMZ, peakIntensity "
+                              "FROM RefSpectraPeaks "
+                              "WHERE RefSpectraId = ?";
+        smart_stmt peakStmt;
+        rc = sqlite3_prepare(readConnection, peakSql, -1, &peakStmt, 0);
+        check_rc(rc, peakSql, "Failed selecting peaks.");
+
+        IonGroup* ionGroup = NULL;
+        string lastPepModSeq;
+        int lastCharge = 0;
+
+        // for each spectrum entry in table
+        rc = sqlite3_step(pStmt);
+        while (rc == SQLITE_ROW) {
+            string pepModSeq = 
+                reinterpret_cast<const char*>(sqlite3_column_text(pStmt,4));
+            int charge = sqlite3_column_int(pStmt,3);
+
+            // a different seq and charge starts a new collection
+            if (ionGroup == NULL || pepModSeq != lastPepModSeq || 
+                charge != lastCharge) {
+                if (ionGroup != NULL) {
+                    boost::unique_lock<boost::mutex> lock(pipelineMutex_);
+                    while (!pipelineAborted_ && ionGroupsRead_ - ionGroupsWritten_ >= maxIonGroupsInFlight_) {
+                        pipelineCondition_.wait(lock);
+                    }
+                    if (pipelineAborted_) {
+                        delete ionGroup;
+                        break;
+                    }
+                    unselectedIonGroups_.push_back(make_pair(ionGroupsRead_++, ionGroup));
+                    pipelineCondition_.notify_all();
+                }
+                ionGroup = new IonGroup();
+                lastPepModSeq = pepModSeq;
+                lastCharge = charge;
+            }
+
+            // create a RefSpectrum object and populate all fields
+            RefSpectrum* tmpRef = new RefSpectrum();
+            tmpRef->setLibSpecID(sqlite3_column_int(pStmt,0));
+            tmpRef->setSeq(reinterpret_cast<const char*>(sqlite3_column_text(pStmt,
+                                                                             1)));
+            tmpRef->setMz(sqlite3_column_double(pStmt,2));
+            tmpRef->setCharge(charge);
+            // if not selected, value == 0
+            tmpRef->setIonMobility(sqlite3_column_double(pStmt, 12));
+            tmpRef->setIonMobilityType(sqlite3_column_int(pStmt, 13));
+            tmpRef->setIonMobilityHighEnergyDriftTimeOffsetMsec(sqlite3_column_double(pStmt, 14));
+            tmpRef->setRetentionTime(sqlite3_column_double(pStmt, 11));
+            tmpRef->setMods(pepModSeq.c_str());
+            tmpRef->setPrevAA("-");
+            tmpRef->setNextAA("-");
+            tmpRef->setScore(sqlite3_column_double(pStmt, 8));
+            tmpRef->setScoreType(sqlite3_column_int(pStmt, 9));
+            tmpRef->setScanNumber(sqlite3_column_int(pStmt, 10));
+            ionGroup->spectra.push_back(tmpRef);
+            ionGroup->numPeaks.push_back(sqlite3_column_int(pStmt,7));
+
+            // get the compressed peaks for this spectrum; the workers
+            // uncompress them
+            int refSpectraId = sqlite3_column_int(pStmt, 0);
+            sqlite3_bind_int(peakStmt, 1, refSpectraId);
+            if (sqlite3_step(peakStmt) != SQLITE_ROW) {
+                delete ionGroup;
+                throw BlibException(false, "Did not find peaks for spectrum %d.", refSpectraId);
+            }
+            const Byte* comprM = (const Byte*)sqlite3_column_blob(peakStmt, 0);
+            ionGroup->comprMz.push_back(
+                vector<Byte>(comprM, comprM + sqlite3_column_bytes(peakStmt, 0)));
+            const Byte* comprI = (const Byte*)sqlite3_column_blob(peakStmt, 1);
+            ionGroup->comprIntensity.push_back(
+                vector<Byte>(comprI, comprI + sqlite3_column_bytes(peakStmt, 1)));
+            sqlite3_reset(peakStmt);
+
+            rc = sqlite3_step(pStmt);
+        }// next table entry
+
+        // queue the last collection
+        boost::lock_guard<boost::mutex> lock(pipelineMutex_);
+        if (rc != SQLITE_ROW && ionGroup != NULL) {
+            unselectedIonGroups_.push_back(make_pair(ionGroupsRead_++, ionGroup));
+        }
+        readerDone_ = true;
+        pipelineCondition_.notify_all();
+    } catch (exception& e) {
+        abortPipeline(e.what());
+    } catch (...) {
+        abortPipeline("Unknown error reading redundant spectra.");
+    }
+    sqlite3_close(readConnection);
+}
+
+/**
+ * Worker thread.  Uncompress the peaks of queued ion groups and select
+ * the best spectrum of each until the reader is done and the queue is
+ * empty.
+ */
+void BlibFilter::selectBestSpectra()
+{
+    try {
+        while (true) {
+            pair<int, IonGroup*> next;
+            {
+                boost::unique_lock<boost::mutex> lock(pipelineMutex_);
+                while (!pipelineAborted_ && !readerDone_ && unselectedIonGroups_.empty()) {
+                    pipelineCondition_.wait(lock);
+                }
+                if (pipelineAborted_ || unselectedIonGroups_.empty()) {
+                    return;
+                }
+                next = unselectedIonGroups_.front();
+                unselectedIonGroups_.pop_front();
+            }
+
+            // the group is no longer queued, so it is freed here if it fails
+            try {
+                IonGroup& ionGroup = *next.second;
+                for (size_t i = 0; i < ionGroup.spectra.size(); i++) {
+                    RefSpectrum* tmpRef = ionGroup.spectra[i];
+                    int numBytes1 = ionGroup.comprMz[i].size();
+                    int numBytes2 = ionGroup.comprIntensity[i].size();
+                    vector<PEAK_T> peaks = getUncompressedPeaks(ionGroup.numPeaks[i], 
+                        numBytes1, numBytes1 > 0 ? &ionGroup.comprMz[i][0] : NULL, 
+                        numBytes2, numBytes2 > 0 ? &ionGroup.comprIntensity[i][0] : NULL);
+                    if (peaks.size() == 0) {
+                        throw BlibException(false, "Unable to read peaks for redundant library "
+                                            "spectrum %i, sequence %s, charge %i.",
+                                            tmpRef->getLibSpecID(), (tmpRef->getSeq()).c_str(),
+                                            tmpRef->getCharge());
+                    }
+                    tmpRef->setRawPeaks(peaks);
+                }
+                vector< vector<Byte> >().swap(ionGroup.comprMz);
+                vector< vector<Byte> >().swap(ionGroup.comprIntensity);
+
+                selectBestSpectrum(ionGroup);
+            } catch (...) {
+                delete next.second;
+                throw;
+            }
+
+            boost::lock_guard<boost::mutex> lock(pipelineMutex_);
+            if (pipelineAborted_) {
+                delete next.second;
+                return;
+            }
+            selectedIonGroups_[next.first] = next.second;
+            pipelineCondition_.notify_all();
+        }
+    } catch (exception& e) {
+        abortPipeline(e.what());
+    } catch (...) {
+        abortPipeline("Unknown error comparing redundant spectra.");
+    }
+}
+
+/**
+ * Writer side of the pipeline.  Wait for the next ion group in read
+ * order to have its best spectrum selected.
+ * \returns The ion group or NULL when all groups have been written or
+ * the pipeline was aborted.
+ */
+IonGroup* BlibFilter::nextSelectedIonGroup()
+{
+    boost::unique_lock<boost::mutex> lock(pipelineMutex_);
+    while (true) {
+        if (pipelineAborted_) {
+            return NULL;
+        }
+        map<int, IonGroup*>::iterator found = selectedIonGroups_.find(ionGroupsWritten_);
+        if (found != selectedIonGroups_.end()) {
+            IonGroup* ionGroup = found->second;
+            selectedIonGroups_.erase(found);
+            ++ionGroupsWritten_;
+            pipelineCondition_.notify_all();
+            return ionGroup;
+        }
+        if (readerDone_ && ionGroupsWritten_ == ionGroupsRead_) {
+            return NULL;
+        }
+        pipelineCondition_.wait(lock);
+    }
+}
+
+/**
+ * Stop the reader and workers, discard any queued ion groups and keep
+ * the first error to report.
+ */
+void BlibFilter::abortPipeline(const string& error)
+{
+    boost::lock_guard<boost::mutex> lock(pipelineMutex_);
+    if (!pipelineAborted_ && !error.empty()) {
+        pipelineError_ = error;
+    }
+    pipelineAborted_ = true;
+    for (size_t i = 0; i < unselectedIonGroups_.size(); i++) {
+        delete unselectedIonGroups_[i].second;
+    }
+    unselectedIonGroups_.clear();
+    for (map<int, IonGroup*>::iterator it = selectedIonGroups_.begin();
+         it != selectedIonGroups_.end(); ++it) {
+        delete it->second;
+    }
+    selectedIonGroups_.clear();
+    pipelineCondition_.notify_all();
+}
+
 vector<PEAK_T> BlibFilter::getUncompressedPeaks(int& numPeaks,
                                                 int& mzLen, Byte* comprM, 
                                                 int& intensityLen, Byte* comprI)
@@ -573,101 +778,82 @@ vector<PEAK_T> BlibFilter::getUncompressedPeaks(int& numPeaks,
 }
 
 /**
- * Given a vector containing RefSpectrum for the same sequence and
- * charge, find the best representative and insert into the current table.
- * The "best representative" is currently defined as the spectrum that
- * has the highest average dot product when compared to all other
- * spectra.  
+ * Given an ion group containing RefSpectrum for the same sequence and
+ * charge, find the best representative and store its index in the
+ * group.  The "best representative" is currently defined as the
+ * spectrum that has the highest average dot product when compared to
+ * all other spectra.
  *
- * When the collection contains exactly one spectrum, add it.  When the
+ * When the collection contains exactly one spectrum, use it.  When the
  * spectrum contains exactly two spectra, the average dot product will
  * be the same for both so use a different criterion to choose.
  * Eventually, when a quailty-of-match score (e.g. p-value) is stored,
  * use the spec with the higher score.  For now, use the one with more
  * peaks. 
+ *
+ * Called from the worker threads, so only looks at the group itself.
  */
-void BlibFilter::compAndInsert(vector<RefSpectrum*>& oneIon)
+void BlibFilter::selectBestSpectrum(IonGroup& ionGroup)
 {
+    vector<RefSpectrum*>& oneIon = ionGroup.spectra;
     int num_spec = oneIon.size();
-    int specID = 0; // id RefSpec table in filtered index
     int bestIndex = 0;
 
-    if(num_spec == 1){ // add that one spectrum
-        specID = transferSpectrum(redundantDbName_, 
-                                  oneIon.at(0)->getLibSpecID(), 
-                                  num_spec,
-                                  tableVersion_);
+    if(num_spec == 1){ // use that one spectrum
+        bestIndex = 0;
     } else if(!useBestScoring_) { // choose the one with more peaks
-		if (num_spec == 2){
-			// in the future, pick the one with the best search score
-			if( oneIon.at(0)->getNumRawPeaks() < oneIon.at(1)->getNumRawPeaks() ) {
-				bestIndex = 1;
-			}
-			// cerr << "selecting index " << bestIndex << ", scan " << oneIon.at(bestIndex)->getScanNumber() << " from " << oneIon.at(0)->getScanNumber() << " and " << oneIon.at(1)->getScanNumber() << endl;
-
-			specID = transferSpectrum(redundantDbName_, 
-									  oneIon.at(bestIndex)->getLibSpecID(), 
-									  num_spec,
-									  tableVersion_);
-		} else { // compute all-by-all dot-products
-
-				// preprocess all RefSpectrum in oneIon
-				PeakProcessor proc;
-				proc.setClearPrecursor(true);
-				proc.setNumTopPeaksToUse(100);
-				// TODO (BF Aug-12-09): all processing should be controlled by
-				// parameters available to the user
-            
-				RefSpectrum* tmpRef;
-				for(int i=0; i<(int)oneIon.size(); i++) {
-					tmpRef=oneIon.at(i);
-					proc.processPeaks(tmpRef);
-				}
-            
-				// create an array where we'll sum scores for each spectrum
-				// initialize to 0
-				vector<double> scores(oneIon.size(), 0);
-
-				// for each spectrum
-				for(int i=0; i<(int)oneIon.size(); i++) {
-					RefSpectrum* tmpRef1 = oneIon.at(i);
-
-					// compare to all subsequent spectrum
-					for(int j=i+1; j<(int)oneIon.size(); j++) {
-
-						RefSpectrum* tmpRef2 = oneIon.at(j);
-						Match thisMatch(tmpRef1, tmpRef2);
-						DotProduct::compare(thisMatch);
-						double dotProduct = thisMatch.getScore(DOTP);
-
-						// add the score to the running total for both spec
-						scores[i] += dotProduct;
-						scores[j] += dotProduct;
-					}
-				} // next spectrum
-
-				// find the best score and keep the spectrum associated with it
-				bestIndex = getMaxElementIndex(scores);
-				double bestScore = scores[bestIndex];
-				double bestAverageScore = bestScore / (double)oneIon.size() ;
-
-				// If best average score is too low, don't include it 
-				if ( bestAverageScore >= minAverageScore_ ){
-					specID = transferSpectrum(redundantDbName_, 
-											  oneIon.at(bestIndex)->getLibSpecID(), 
-											  oneIon.size(),
-											  tableVersion_);
-				} else {
-					Verbosity::warn("Best score is %f for %s, charge %d after "
-									"comparing %i spectra.  This sequence will not be "
-									"included in the filtered library.", 
-									bestAverageScore, (oneIon.at(0)->getSeq()).c_str(),
-									oneIon.at(0)->getCharge(), oneIon.size());
-					return;
-				}
-		}
+        if (num_spec == 2){
+            // in the future, pick the one with the best search score
+            if( oneIon.at(0)->getNumRawPeaks() < oneIon.at(1)->getNumRawPeaks() ) {
+                bestIndex = 1;
+            }
+        } else { // compute all-by-all dot-products
+
+            // preprocess all RefSpectrum in oneIon
+            PeakProcessor proc;
+            proc.setClearPrecursor(true);
+            proc.setNumTopPeaksToUse(100);
+            // TODO (BF Aug-12-09): all processing should be controlled by
+            // parameters available to the user
+
+            RefSpectrum* tmpRef;
+            for(int i=0; i<(int)oneIon.size(); i++) {
+                tmpRef=oneIon.at(i);
+                proc.processPeaks(tmpRef);
+            }
+
+            // create an array where we'll sum scores for each spectrum
+            // initialize to 0
+            vector<double> scores(oneIon.size(), 0);
+
+            // for each spectrum
+            for(int i=0; i<(int)oneIon.size(); i++) {
+                RefSpectrum* tmpRef1 = oneIon.at(i);
+
+                // compare to all subsequent spectrum
+                for(int j=i+1; j<(int)oneIon.size(); j++) {
+
+                    RefSpectrum* tmpRef2 = oneIon.at(j);
+                    Match thisMatch(tmpRef1, tmpRef2);
+                    DotProduct::compare(thisMatch);
+                    double dotProduct = thisMatch.getScore(DOTP);
+
+                    // add the score to the running total for both spec
+                    scores[i] += dotProduct;
+                    scores[j] += dotProduct;
+                }
+            } // next spectrum
+
+            // find the best score and keep the spectrum associated with it
+            bestIndex = getMaxElementIndex(scores);
+            double bestScore = scores[bestIndex];
+            ionGroup.bestAverageScore = bestScore / (double)oneIon.size() ;
+
+            // If best average score is too low, don't include it 
+            ionGroup.belowMinScore = ionGroup.bestAverageScore < minAverageScore_;
+        }
     } else {
-		map<RefSpectrum*, int> indices;
+        map<RefSpectrum*, int> indices;
         map< int, vector<RefSpectrum*> > groups = groupByScoreType(oneIon, &indices);
         RefSpectrum* winner = NULL;
 
@@ -675,7 +861,7 @@ void BlibFilter::compAndInsert(vector<RefSpectrum*>& oneIon)
         for (map< int, vector<RefSpectrum*> >::const_iterator i = groups.begin(); i != groups.end(); ++i) {
             map<int, bool>::const_iterator directionLookup = higherIsBetter_.find(i->first);
             if (directionLookup == higherIsBetter_.end()) {
-                Verbosity::error("Don't know if higher or lower is better for score type %d", i->first);
+                throw BlibException(false, "Don't know if higher or lower is better for score type %d", i->first);
             }
             vector<RefSpectrum*> bestScores = getBestScores(i->second, directionLookup->second);
             possibleWinners.insert(possibleWinners.end(), bestScores.begin(), bestScores.end());
@@ -685,52 +871,81 @@ void BlibFilter::compAndInsert(vector<RefSpectrum*>& oneIon)
             winner = possibleWinners.front();
         } else {
             // find highest TIC to determine final winner
-			double winningValue = -1.0;
-			for (vector<RefSpectrum*>::iterator i = possibleWinners.begin(); i != possibleWinners.end(); ++i) {
+            double winningValue = -1.0;
+            for (vector<RefSpectrum*>::iterator i = possibleWinners.begin(); i != possibleWinners.end(); ++i) {
                 double specValue = (*i)->getTotalIonCurrentRaw();
                 if (specValue > winningValue) {
                     winner = *i;
-					winningValue = specValue;
-				}
-			}
+                    winningValue = specValue;
+                }
+            }
 
-			/* cross-cross score among possible winners to determine final winner
-			PeakProcessor proc;
+            /* cross-cross score among possible winners to determine final winner
+            PeakProcessor proc;
             proc.setClearPrecursor(true);
             proc.setNumTopPeaksToUse(100);
             for (vector<RefSpectrum*>::iterator i = oneIon.begin(); i != oneIon.end(); ++i)
                 proc.processPeaks(*i);
-			
-			double winningScore = -1.0;
-			for (vector<RefSpectrum*>::iterator i = possibleWinners.begin(); i != possibleWinners.end(); ++i) {
+
+            double winningScore = -1.0;
+            for (vector<RefSpectrum*>::iterator i = possibleWinners.begin(); i != possibleWinners.end(); ++i) {
                 double crossScore = 0.0;
                 for (vector<RefSpectrum*>::iterator j = possibleWinners.begin(); j != possibleWinners.end(); ++j) {
                     if (*i == *j)
                         continue;
                     Match thisMatch(*i, *j);
                     DotProduct::compare(thisMatch);
-					crossScore += thisMatch.getScore(DOTP);
+                    crossScore += thisMatch.getScore(DOTP);
                 }
                 if (crossScore > winningScore) {
                     winner = *i;
                     winningScore = crossScore;
                 }
-			}*/
+            }*/
         }
-        specID = transferSpectrum(redundantDbName_, winner->getLibSpecID(),
-                                    oneIon.size(), tableVersion_);
-		bestIndex = indices[winner];
+        bestIndex = indices[winner];
     }
 
+    ionGroup.bestIndex = bestIndex;
+}
+
+/**
+ * Copy the best spectrum of an ion group into the filtered library and
+ * add a RetentionTimes row for every spectrum in the group.  Groups
+ * whose best average score is below min-score are left out.
+ */
+void BlibFilter::insertIonGroup(IonGroup& ionGroup)
+{
+    vector<RefSpectrum*>& oneIon = ionGroup.spectra;
+    int num_spec = oneIon.size();
+    int bestIndex = ionGroup.bestIndex;
+
+    Verbosity::comment(V_DETAIL, "Selecting spec for %s, charge %i"
+                       " from %i spectra.", oneIon.at(0)->getMods().c_str(),
+                       oneIon.at(0)->getCharge(), num_spec);
+
+    if (ionGroup.belowMinScore) {
+        Verbosity::warn("Best score is %f for %s, charge %d after "
+                        "comparing %i spectra.  This sequence will not be "
+                        "included in the filtered library.", 
+                        ionGroup.bestAverageScore, (oneIon.at(0)->getSeq()).c_str(),
+                        oneIon.at(0)->getCharge(), num_spec);
+        return;
+    }
+
+    int specID = transferSpectrum(redundantDbName_, 
+                                  oneIon.at(bestIndex)->getLibSpecID(), 
+                                  num_spec,
+                                  tableVersion_);
+
     // add rt, RefSpectraId for all refspec
+    char row[512];
     for(int i = 0; i < num_spec; i++){
         // if( oneIon.at(i)->getRetentionTime() == 0){ continue; }
         int specIdRedundant = oneIon.at(i)->getLibSpecID();
-        sprintf(zSql,
-                "INSERT INTO RetentionTimes (RefSpectraID, RedundantRefSpectraID, "
-                "SpectrumSourceID, ionMobilityValue, ionMobilityType, ionMobilityHighEnergyDriftTimeOffsetMsec, "
-                "retentionTime, bestSpectrum) "
-                "VALUES (%d, %d, %d, %f, %d, %f, %f, %d)",
+        sprintf(row,
+                "%s(%d, %d, %d, %f, %d, %f, %f, %d)",
+                retentionTimeRows_ == 0 ? "" : ",",
                 specID,
                 specIdRedundant,
                 getNewFileId(redundantDbName_, specIdRedundant),  // All files should exist by now
@@ -739,8 +954,30 @@ void BlibFilter::compAndInsert(vector<RefSpectrum*>& oneIon)
                 oneIon.at(i)->getIonMobilityHighEnergyDriftTimeOffsetMsec(),
                 oneIon.at(i)->getRetentionTime(),
                 i == bestIndex ? 1 : 0);
-        sql_stmt(zSql);
+        retentionTimeValues_ += row;
+        if (++retentionTimeRows_ >= 500) {
+            flushRetentionTimes();
+        }
+    }
+}
+
+/**
+ * Insert the RetentionTimes rows collected so far with a single
+ * statement.
+ */
+void BlibFilter::flushRetentionTimes()
+{
+    if (retentionTimeRows_ == 0) {
+        return;
     }
+    string insertSql = 
+        "INSERT INTO RetentionTimes (RefSpectraID, RedundantRefSpectraID, "
+        "SpectrumSourceID, ionMobilityValue, ionMobilityType, ionMobilityHighEnergyDriftTimeOffsetMsec, "
+        "retentionTime, bestSpectrum) "
+        "VALUES " + retentionTimeValues_;
+    sql_stmt(insertSql.c_str());
+    retentionTimeValues_.clear();
+    retentionTimeRows_ = 0;
 }
 
 map< int, vector<RefSpectrum*> > BlibFilter::groupByScoreType(const vector<RefSpectrum*>& oneIon, map<RefSpectrum*, int>* outIndices) {
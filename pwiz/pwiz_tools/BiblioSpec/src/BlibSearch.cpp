@@ -64,6 +64,11 @@ void ParseCommandline(const int argc,
                            ops::variables_map& options_table);
 string getTargetReportName(const string& specFileName, 
                            const ops::variables_map& options_table);
+void searchBatches(BiblioSpec::SearchLibrary& searcher,
+                   PwizReader* fileReader,
+                   BiblioSpec::Reportfile& targetReport,
+                   BiblioSpec::Reportfile& decoyReport,
+                   BiblioSpec::PsmFile* psmFile);
 
 /**
  * The starting point for BlibSearch.
@@ -126,32 +131,36 @@ int main(int argc, char* argv[])
                                   specFileName.c_str());
 
     // TODO include a progress indicator
-    BiblioSpec::Spectrum curSpectrum;
-    while( fileReader->getNextSpectrum(curSpectrum) ) {
-        
-        searcher.searchSpectrum(curSpectrum);
-
-        const vector<BiblioSpec::Match>& targetMatches = searcher.getTargetMatches();
-        const vector<BiblioSpec::Match>& decoyMatches = searcher.getDecoyMatches();
-        
-        if(targetMatches.size() == 0){
-            curSpectrum.clear();
-            continue;
-        }
-
-        // write to the .report file
-        targetReport.writeMatches(targetMatches);
-        decoyReport.writeMatches(decoyMatches);
+    if( searcher.isLibraryPreloaded() ){
+        searchBatches(searcher, fileReader, targetReport, decoyReport, psmFile);
+    } else {
+        BiblioSpec::Spectrum curSpectrum;
+        while( fileReader->getNextSpectrum(curSpectrum) ) {
+            
+            searcher.searchSpectrum(curSpectrum);
 
-        // write to the .psm file
-        if(psmFile) {
-            psmFile->insertMatches(targetMatches);
-            psmFile->insertMatches(decoyMatches);
-            // restore this eventually
-            //psmFile->insertSpecData(curSpectrum, allMatches, searcher);
-        }
-        curSpectrum.clear();
-    } // next spectrum
+            const vector<BiblioSpec::Match>& targetMatches = searcher.getTargetMatches();
+            const vector<BiblioSpec::Match>& decoyMatches = searcher.getDecoyMatches();
+            
+            if(targetMatches.size() == 0){
+                curSpectrum.clear();
+                continue;
+            }
+
+            // write to the .report file
+            targetReport.writeMatches(targetMatches);
+            decoyReport.writeMatches(decoyMatches);
+
+            // write to the .psm file
+            if(psmFile) {
+                psmFile->insertMatches(targetMatches);
+                psmFile->insertMatches(decoyMatches);
+                // restore this eventually
+                //psmFile->insertSpecData(curSpectrum, allMatches, searcher);
+            }
+            curSpectrum.clear();
+        } // next spectrum
+    }
 
     if( psmFile )
         psmFile->commit();
@@ -167,6 +176,51 @@ int main(int argc, char* argv[])
 }// end main
 
 
+/**
+ * Search the spectra in the file in batches against the preloaded
+ * library, writing the results in the order the spectra were read.
+ */
+void searchBatches(BiblioSpec::SearchLibrary& searcher,
+                   PwizReader* fileReader,
+                   BiblioSpec::Reportfile& targetReport,
+                   BiblioSpec::Reportfile& decoyReport,
+                   BiblioSpec::PsmFile* psmFile){
+    vector<BiblioSpec::Spectrum> batch;
+    vector<BiblioSpec::QueryMatches> batchMatches;
+    batch.reserve(BiblioSpec::SearchLibrary::QUERY_BATCH_SIZE);
+    bool moreSpectra = true;
+    while( moreSpectra ){
+        batch.clear();
+        while( (int)batch.size() < BiblioSpec::SearchLibrary::QUERY_BATCH_SIZE ){
+            batch.push_back(BiblioSpec::Spectrum());
+            if( ! fileReader->getNextSpectrum(batch.back()) ){
+                batch.pop_back();
+                moreSpectra = false;
+                break;
+            }
+        }
+        if( batch.empty() ){
+            break;
+        }
+
+        searcher.searchSpectra(batch, batchMatches);
+
+        for(size_t i = 0; i < batch.size(); i++){
+            const vector<BiblioSpec::Match>& targetMatches = batchMatches[i].targetMatches;
+            const vector<BiblioSpec::Match>& decoyMatches = batchMatches[i].decoyMatches;
+            if(targetMatches.size() == 0){
+                continue;
+            }
+            targetReport.writeMatches(targetMatches);
+            decoyReport.writeMatches(decoyMatches);
+            if(psmFile) {
+                psmFile->insertMatches(targetMatches);
+                psmFile->insertMatches(decoyMatches);
+            }
+        }
+    }
+}
+
 /**
  * Return the correct name of the report file for the target matches.
  */
@@ -247,6 +301,14 @@ void ParseCommandline(const int argc,
              "Search spectra in the order they appear in the file.  Default to search as sorted by precursor m/z."
              )
 
+            ("preload-library",
+             value<bool>()->default_value(false),
+             "Read all library spectra into memory before searching and score query spectra in parallel batches.")
+
+            ("threads",
+             value<int>()->default_value(0),
+             "Use ARG threads to score query spectra when the library is preloaded.  Default 0 uses one per processor.")
+
             /*
             ("",
              value<>(),
@@ -23,6 +23,8 @@
 
 #include "SearchLibrary.h"
 #include "BlibUtils.h"
+#include <limits>
+#include "boost/bind.hpp"
 
 namespace BiblioSpec {
 
@@ -42,8 +44,13 @@ SearchLibrary::SearchLibrary(vector<string>& libfilenames,
   decoyMzShift_(options_table["circ-shift"].as<double>()),
   shiftRawSpectra_(options_table["shift-raw-spectrum"].as<bool>()),
   querySorted_(options_table.count("mz-sort") != 0),
+  preloadLibrary_(options_table["preload-library"].as<bool>()),
+  numThreads_(options_table["threads"].as<int>()),
   printAll_(options_table["print-all-params"].as<bool>())
 {
+    if( numThreads_ < 1 ){
+        numThreads_ = max(1, (int)boost::thread::hardware_concurrency());
+    }
 
     // create a list of LibReaders from the filenames
     for(size_t i = 0; i < libfilenames.size(); i++){
@@ -66,6 +73,10 @@ SearchLibrary::SearchLibrary(vector<string>& libfilenames,
                           << endl;
         weibullParamFile_.precision(4);
     }
+
+    if( preloadLibrary_ ){
+        preloadLibraries();
+    }
 } 
 
 SearchLibrary::~SearchLibrary()
@@ -99,6 +110,18 @@ void SearchLibrary::searchSpectrum(BiblioSpec::Spectrum& querySpec){
 
     Verbosity::debug("Searching spectrum %i", querySpec.getScanNumber());
 
+    // scoreIndexed() processes the query and checks its peak count
+    if( preloadLibrary_ ){
+        QUERY_STATUS status = scoreIndexed(querySpec, targetMatches_, 
+                                           decoyMatches_);
+        if( status != QUERY_SCORED ){
+            warnQueryStatus(querySpec, status);
+            return;
+        }
+        finishSearch(querySpec);
+        return;
+    }
+
     // process query spectrum
     peakProcessor_.processPeaks(&querySpec);
     if( querySpec.getNumProcessedPeaks() < minPeaks_ ){
@@ -107,7 +130,7 @@ void SearchLibrary::searchSpectrum(BiblioSpec::Spectrum& querySpec){
                         querySpec.getNumProcessedPeaks());
         return;
     }
-    
+
     // clear out previous results and get new lib spec
     updateSpectrumCache(querySpec.getMz());
     targetMatches_.clear();
@@ -123,6 +146,224 @@ void SearchLibrary::searchSpectrum(BiblioSpec::Spectrum& querySpec){
     runSearch(querySpec);
 }
 
+/**
+ * Search a batch of query spectra against the preloaded library.
+ * Peak processing and scoring of the queries is divided among the
+ * search threads; the remaining steps (ranking, p-values, messages)
+ * are done afterwards in query order so that results are the same as
+ * searching the spectra one at a time.  results[i] holds the matches
+ * for querySpecs[i] and is empty if the query could not be searched.
+ * Matches refer to the query spectra, so querySpecs must outlive them.
+ */
+void SearchLibrary::searchSpectra(vector<Spectrum>& querySpecs,
+                                  vector<QueryMatches>& results){
+    if( ! preloadLibrary_ ){
+        Verbosity::error("SearchLibrary::searchSpectra requires a "
+                         "preloaded library.");
+    }
+
+    results.clear();
+    results.resize(querySpecs.size());
+    vector<QUERY_STATUS> status(querySpecs.size(), QUERY_SCORED);
+
+    size_t numThreads = min((size_t)numThreads_, querySpecs.size());
+    if( numThreads <= 1 ){
+        scoreBatchSlice(querySpecs, results, status, 0, 1);
+    } else {
+        boost::thread_group workers;
+        for(size_t i = 0; i < numThreads; i++){
+            workers.create_thread(boost::bind(&SearchLibrary::scoreBatchSlice,
+                                              this, boost::ref(querySpecs),
+                                              boost::ref(results),
+                                              boost::ref(status),
+                                              i, numThreads));
+        }
+        workers.join_all();
+    }
+
+    for(size_t i = 0; i < querySpecs.size(); i++){
+        if( status[i] != QUERY_SCORED ){
+            warnQueryStatus(querySpecs[i], status[i]);
+            continue;
+        }
+        targetMatches_.swap(results[i].targetMatches);
+        decoyMatches_.swap(results[i].decoyMatches);
+        finishSearch(querySpecs[i]);
+        targetMatches_.swap(results[i].targetMatches);
+        decoyMatches_.swap(results[i].decoyMatches);
+    }
+    targetMatches_.clear();
+    decoyMatches_.clear();
+}
+
+/**
+ * Process and score every step'th query spectrum starting with first.
+ * Run by each of the search threads; must not write messages.
+ */
+void SearchLibrary::scoreBatchSlice(vector<Spectrum>& querySpecs, 
+                                    vector<QueryMatches>& results,
+                                    vector<QUERY_STATUS>& status,
+                                    size_t first, size_t step){
+    for(size_t i = first; i < querySpecs.size(); i += step){
+        status[i] = scoreIndexed(querySpecs[i], results[i].targetMatches, 
+                                 results[i].decoyMatches);
+    }
+}
+
+/**
+ * Process the query peaks and score it against the preloaded target
+ * and decoy spectra in its precursor m/z window.  Does not write
+ * messages so it can be used by the search threads.
+ */
+SearchLibrary::QUERY_STATUS SearchLibrary::scoreIndexed(Spectrum& s, 
+                                                        vector<Match>& targetMatches, 
+                                                        vector<Match>& decoyMatches){
+    targetMatches.clear();
+    decoyMatches.clear();
+
+    peakProcessor_.processPeaks(&s);
+    if( s.getNumProcessedPeaks() < minPeaks_ ){
+        return QUERY_TOO_FEW_PEAKS;
+    }
+
+    size_t first = 0, last = 0;
+    targetIndex_.findRange(s.getMz() - mzWindow_, s.getMz() + mzWindow_,
+                           first, last);
+    if( first == last ){
+        return QUERY_NO_LIBRARY_SPEC;
+    }
+
+    scoreIndexedMatches(s, targetIndex_, targetMatches);
+    scoreIndexedMatches(s, decoyIndex_, decoyMatches);
+    return QUERY_SCORED;
+}
+
+/**
+ * Compare the given query spectrum to the indexed spectra in its
+ * precursor m/z window.  Equivalent to scoreMatches().
+ */
+void SearchLibrary::scoreIndexedMatches(Spectrum& s, 
+                                        const PrecursorIndex& index,
+                                        vector<Match>& matches){
+    const vector<int>& charges = s.getPossibleCharges();
+
+    size_t first = 0, last = 0;
+    index.findRange(s.getMz() - mzWindow_, s.getMz() + mzWindow_,
+                    first, last);
+
+    for(size_t i = first; i < last; i++){
+        if( index.getNumProcessedPeaks(i) == 0 ||
+            ! checkCharge(charges, index.getCharge(i)) ){
+            continue;
+        }
+
+        RefSpectrum* refSpec = index.getSpectrum(i);
+        Match thisMatch(&s, refSpec);
+        thisMatch.setMatchLibID(refSpec->getLibID());
+        DotProduct::compare(thisMatch);
+        matches.push_back(thisMatch);
+    }
+}
+
+/**
+ * Write the warning searchSpectrum() gives for a query that could not
+ * be scored.
+ */
+void SearchLibrary::warnQueryStatus(Spectrum& s, QUERY_STATUS status){
+    if( status == QUERY_TOO_FEW_PEAKS ){
+        Verbosity::warn("Spectrum %i has %i peaks, fewer than the minimum.",
+                        s.getScanNumber(), s.getNumProcessedPeaks());
+    } else if( status == QUERY_NO_LIBRARY_SPEC ){
+        Verbosity::warn("No library spectra found for query %d "
+                        "(precursor m/z %.2f).", s.getScanNumber(), 
+                        s.getMz());
+    }
+}
+
+/**
+ * True if the libraries were read into memory when the searcher was
+ * created so that searchSpectra() can be used.
+ */
+bool SearchLibrary::isLibraryPreloaded(){
+    return preloadLibrary_;
+}
+
+/**
+ * Read every spectrum of every library into the target index, process
+ * its peaks and create its decoys once, rather than for each search
+ * window.  Spectra are selected as getLibrarySpec() does.
+ */
+void SearchLibrary::preloadLibraries(){
+    vector<RefSpectrum*> targets;
+    for(size_t lib_i = 0; lib_i < libraries_.size(); lib_i++){
+        // library index is 0 for decoy spectra
+        int libIndex = lib_i + 1;
+        size_t startIdx = targets.size();
+        libraries_.at(lib_i)->getSpecInMzRange(0, 
+                                               numeric_limits<float>::max(),
+                                               MIN_PEAK_SIZE, targets);
+        for(size_t spec_i = startIdx; spec_i < targets.size(); spec_i++){
+            targets[spec_i]->setLibID(libIndex);
+        }
+    }
+    Verbosity::status("Preloading %d library spectra.", (int)targets.size());
+
+    processPeaksParallel(targets);
+
+    vector<RefSpectrum*> decoys;
+    double shiftMz = decoyMzShift_;
+    for(int i = 0; i < decoysPerTarget_; i++){
+        for(size_t spec_i = 0; spec_i < targets.size(); spec_i++){
+            RefSpectrum* decoy = targets[spec_i]->newDecoy(shiftMz, 
+                                                           shiftRawSpectra_);
+            if( decoy ){
+                decoys.push_back(decoy);
+            }
+        }
+        shiftMz += decoyMzShift_;
+    }
+    if( shiftRawSpectra_ ){ // decoys haven't been processed
+        processPeaksParallel(decoys);
+    }
+
+    for(size_t i = 0; i < targets.size(); i++){
+        targetIndex_.add(targets[i]);
+    }
+    for(size_t i = 0; i < decoys.size(); i++){
+        decoyIndex_.add(decoys[i]);
+    }
+    targetIndex_.build();
+    decoyIndex_.build();
+}
+
+/**
+ * Process the peaks of every step'th spectrum starting with first.
+ */
+void SearchLibrary::processPeaksSlice(vector<RefSpectrum*>& spectra, 
+                                      size_t first, size_t step){
+    for(size_t i = first; i < spectra.size(); i += step){
+        peakProcessor_.processPeaks(spectra[i]);
+    }
+}
+
+/**
+ * Process the peaks of all the given spectra using the search threads.
+ */
+void SearchLibrary::processPeaksParallel(vector<RefSpectrum*>& spectra){
+    size_t numThreads = min((size_t)numThreads_, spectra.size());
+    if( numThreads <= 1 ){
+        processPeaksSlice(spectra, 0, 1);
+        return;
+    }
+    boost::thread_group workers;
+    for(size_t i = 0; i < numThreads; i++){
+        workers.create_thread(boost::bind(&SearchLibrary::processPeaksSlice,
+                                          this, boost::ref(spectra),
+                                          i, numThreads));
+    }
+    workers.join_all();
+}
+
 /**
  * Update the contents of the spectrum cache for the next query
  * spectrum.  If query are NOT sorted, empties cache and fetches all
@@ -326,6 +567,15 @@ void SearchLibrary::runSearch(Spectrum& s)
     scoreMatches(s, cachedSpectra_, targetMatches_);
     scoreMatches(s, cachedDecoySpectra_, decoyMatches_);
 
+    finishSearch(s);
+}
+
+/**
+ * Rank the scored targetMatches_ and decoyMatches_ for the given query
+ * and compute p-values, if requested.
+ */
+void SearchLibrary::finishSearch(Spectrum& s)
+{
     // keep scores from all target psms for estimating Weibull parameters
     vector<double> allScores;
     if(compute_pvalues_){
@@ -514,6 +764,58 @@ void SearchLibrary::addNullScores(Spectrum s, vector<double>& allScores){
     } // next pass through all ref spectra
 }
 
+PrecursorIndex::PrecursorIndex(){
+}
+
+PrecursorIndex::~PrecursorIndex(){
+    for(size_t i = 0; i < spectra_.size(); i++){
+        delete spectra_[i];
+        spectra_[i] = NULL;
+    }
+}
+
+/**
+ * Add a spectrum whose peaks have been processed.  build() must be
+ * called after all spectra are added and before searching.
+ */
+void PrecursorIndex::add(RefSpectrum* spec){
+    spectra_.push_back(spec);
+}
+
+/**
+ * Sort the spectra by precursor m/z and fill the arrays of values
+ * tested during a search.
+ */
+void PrecursorIndex::build(){
+    stable_sort(spectra_.begin(), spectra_.end(), compSpecPtrMz());
+
+    precursorMzs_.resize(spectra_.size());
+    charges_.resize(spectra_.size());
+    numProcessedPeaks_.resize(spectra_.size());
+    for(size_t i = 0; i < spectra_.size(); i++){
+        precursorMzs_[i] = spectra_[i]->getMz();
+        charges_[i] = spectra_[i]->getCharge();
+        numProcessedPeaks_[i] = spectra_[i]->getNumProcessedPeaks();
+    }
+}
+
+size_t PrecursorIndex::size() const {
+    return spectra_.size();
+}
+
+/**
+ * Set first and last to the range of indexes of spectra with precursor
+ * m/z greater than minMz and no greater than maxMz, the same range
+ * LibReader::getSpecInMzRange() returns for the spectrum cache.
+ */
+void PrecursorIndex::findRange(double minMz, double maxMz, 
+                               size_t& first, size_t& last) const {
+    first = upper_bound(precursorMzs_.begin(), precursorMzs_.end(), minMz) 
+        - precursorMzs_.begin();
+    last = upper_bound(precursorMzs_.begin() + first, precursorMzs_.end(), 
+                       maxMz) - precursorMzs_.begin();
+}
+
 bool SearchLibrary::checkCharge(const vector<int>& queryCharges, int libCharge){
 
     // if no charges for the query spectrum, don't filter library spec by charge
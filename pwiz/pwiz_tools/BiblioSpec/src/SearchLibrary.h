@@ -38,16 +38,52 @@
 #include "WeibullPvalue.h"
 #include "Spectrum.h"
 #include "boost/program_options.hpp"
+#include "boost/thread/thread.hpp"
 
 using namespace std;
 namespace ops = boost::program_options;
 
 namespace BiblioSpec {
 
+/**
+ * Library spectra held in memory, sorted by precursor m/z.  The
+ * values tested for every candidate in a search window (precursor
+ * m/z, charge, number of processed peaks) are kept in parallel arrays
+ * so that a window can be located and filtered without touching the
+ * spectra themselves.  Owns the spectra added to it.
+ */
+class PrecursorIndex{
+ public:
+  PrecursorIndex();
+  ~PrecursorIndex();
+
+  void add(RefSpectrum* spec);
+  void build();
+  size_t size() const;
+  void findRange(double minMz, double maxMz, size_t& first, size_t& last) const;
+
+  int getCharge(size_t i) const { return charges_[i]; }
+  int getNumProcessedPeaks(size_t i) const { return numProcessedPeaks_[i]; }
+  RefSpectrum* getSpectrum(size_t i) const { return spectra_[i]; }
+
+ private:
+  vector<double> precursorMzs_;
+  vector<int> charges_;
+  vector<int> numProcessedPeaks_;
+  vector<RefSpectrum*> spectra_;
+};
+
+/// Matches for one query spectrum of a batch given to searchSpectra().
+struct QueryMatches{
+  vector<Match> targetMatches;
+  vector<Match> decoyMatches;
+};
+
 class SearchLibrary{
 
  public:
   const static int MIN_PEAK_SIZE = 5;
+  const static int QUERY_BATCH_SIZE = 1000;
 
  private:
   PeakProcessor peakProcessor_;
@@ -67,6 +103,10 @@ class SearchLibrary{
   vector<Match> decoyMatches_;           // decoy matches for a single spectrum
   deque<RefSpectrum*> cachedSpectra_;    // store spectra here for searching
   deque<RefSpectrum*> cachedDecoySpectra_;// store decoy spectra for searching
+  bool preloadLibrary_;                  // search from the indexes below
+  int numThreads_;                       // threads scoring a batch of queries
+  PrecursorIndex targetIndex_;           // all library spectra, if preloaded
+  PrecursorIndex decoyIndex_;            // decoys of all library spectra
    
   ofstream weibullParamFile_;
   bool printAll_;
@@ -78,6 +118,9 @@ class SearchLibrary{
   ~SearchLibrary();
 
   void searchSpectrum(BiblioSpec::Spectrum& querySpec);
+  void searchSpectra(vector<Spectrum>& querySpecs,
+                     vector<QueryMatches>& results);
+  bool isLibraryPreloaded();
   void getLibrarySpec(double minMz, double maxMz);
   void generateDecoySpectra(int startIdx);
   void runSearch(Spectrum& s);
@@ -91,7 +134,23 @@ class SearchLibrary{
   void getWeibullHistogram(int hist[], int numElements);
   
  private:
+  enum QUERY_STATUS { QUERY_SCORED, QUERY_TOO_FEW_PEAKS, QUERY_NO_LIBRARY_SPEC };
+
   void initLibraries(Spectrum& spec);
+  void preloadLibraries();
+  void processPeaksSlice(vector<RefSpectrum*>& spectra, 
+                         size_t first, size_t step);
+  void processPeaksParallel(vector<RefSpectrum*>& spectra);
+  QUERY_STATUS scoreIndexed(Spectrum& s, vector<Match>& targetMatches, 
+                            vector<Match>& decoyMatches);
+  void scoreIndexedMatches(Spectrum& s, const PrecursorIndex& index,
+                           vector<Match>& matches);
+  void scoreBatchSlice(vector<Spectrum>& querySpecs, 
+                       vector<QueryMatches>& results,
+                       vector<QUERY_STATUS>& status,
+                       size_t first, size_t step);
+  void warnQueryStatus(Spectrum& s, QUERY_STATUS status);
+  void finishSearch(Spectrum& s);
   bool checkCharge(const vector<int>& queryCharges, int libCharge);
   void scoreMatches(Spectrum& s, deque<RefSpectrum*>& spectra, 
                     vector<Match>& matches);
@@ -57,7 +57,7 @@ void ToStdStringVector(IList<String^>^ managedList, std::vector<std::string>& st
 } // namespace
 
 
-void Merger::Merge(String^ mergeTargetFilepath, IList<String^>^ mergeSourceFilepaths, int maxThreads, pwiz::CLI::util::IterationListenerRegistry^ ilr)
+void Merger::Merge(String^ mergeTargetFilepath, IList<String^>^ mergeSourceFilepaths, int maxThreads, pwiz::CLI::util::IterationListenerRegistry^ ilr, MergeMode mergeMode)
 {
     Logger::Initialize(); // make sure the logger is initialized
 
@@ -67,12 +67,18 @@ void Merger::Merge(String^ mergeTargetFilepath, IList<String^>^ mergeSourceFilep
         ToStdStringVector(mergeSourceFilepaths, nativeMergeSourceFilepaths);
 
         NativeMerger merger;
+        merger.mergeMode = (NativeMerger::MergeMode) mergeMode;
         merger.merge(ToStdString(mergeTargetFilepath), nativeMergeSourceFilepaths, maxThreads, ilr == nullptr ? 0 : (pwiz::util::IterationListenerRegistry*) ilr->void_base().ToPointer());
         System::GC::KeepAlive(ilr);
     }
     CATCH_AND_FORWARD
 }
 
+void Merger::Merge(String^ mergeTargetFilepath, IList<String^>^ mergeSourceFilepaths, int maxThreads, pwiz::CLI::util::IterationListenerRegistry^ ilr)
+{
+    Merge(mergeTargetFilepath, mergeSourceFilepaths, maxThreads, ilr, MergeMode::Pairwise);
+}
+
 void Merger::Merge(String^ mergeTargetFilepath, IList<String^>^ mergeSourceFilepaths)
 {
     Merge(mergeTargetFilepath, mergeSourceFilepaths, 8, nullptr);
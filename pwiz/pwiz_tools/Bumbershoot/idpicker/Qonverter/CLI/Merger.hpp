@@ -40,6 +40,17 @@ using namespace System::Collections::Generic;
 public ref struct Merger abstract
 {
 
+/// how multiple source files are merged into the target
+enum class MergeMode
+{
+    /// sources are merged two at a time to temporary files in random order, then the last temporary file becomes the target
+    Pairwise,
+
+    /// sources are read and their id remappings are built in parallel, then they are loaded into the target in input order
+    Ordered
+};
+
+static void Merge(String^ mergeTargetFilepath, IList<String^>^ mergeSourceFilepaths, int maxThreads, pwiz::CLI::util::IterationListenerRegistry^ ilr, MergeMode mergeMode);
 static void Merge(String^ mergeTargetFilepath, IList<String^>^ mergeSourceFilepaths, int maxThreads, pwiz::CLI::util::IterationListenerRegistry^ ilr);
 static void Merge(String^ mergeTargetFilepath, IList<String^>^ mergeSourceFilepaths);
 
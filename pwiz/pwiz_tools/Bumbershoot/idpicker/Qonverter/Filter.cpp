@@ -37,7 +37,9 @@
 #include "boost/thread.hpp"
 #include "boost/make_shared.hpp"
 #include "boost/functional/hash.hpp"
-#include <stack>
+#include "boost/unordered_map.hpp"
+#include "boost/bind.hpp"
+#include <numeric>
 #include <algorithm>
 
 
@@ -174,83 +176,6 @@ const string renameFilteredTablesSql(
     "ALTER TABLE FilteredSpectrum RENAME TO Spectrum"
 );
 
-const string assembleProteinGroupsSql(
-    "CREATE TEMP TABLE ProteinGroups AS\n"
-    "    SELECT pro.Id AS ProteinId, GROUP_CONCAT(DISTINCT pi.Peptide) AS ProteinGroup\n"
-    "    FROM PeptideInstance pi\n"
-    "    JOIN Protein pro ON pi.Protein = pro.Id\n"
-    "    GROUP BY pi.Protein;\n"
-    "\n"
-    "--ProteinGroup will be a continuous sequence starting at 1\n"
-    "CREATE TEMP TABLE TempProtein AS\n"
-    "    SELECT ProteinId, Accession, IsDecoy, Cluster, pg2.rowid, Length, GeneId, GeneGroup\n"
-    "    FROM ProteinGroups pg\n"
-    "    JOIN(\n"
-    "       SELECT pg.ProteinGroup\n"
-    "       FROM ProteinGroups pg\n"
-    "       GROUP BY pg.ProteinGroup\n"
-    "    ) pg2 ON pg.ProteinGroup = pg2.ProteinGroup\n"
-    "    JOIN Protein pro ON pg.ProteinId = pro.Id;\n"
-    "\n"
-    "DELETE FROM Protein;\n"
-    "INSERT INTO Protein SELECT * FROM TempProtein;\n"
-    "CREATE INDEX Protein_ProteinGroup ON Protein(ProteinGroup);\n"
-    "DROP TABLE ProteinGroups;\n"
-    "DROP TABLE TempProtein;"
-);
-
-const string assembleGeneGroupsSql(
-    "CREATE TEMP TABLE GeneGroups AS\n"
-    "    SELECT pro.GeneId AS GeneId, GROUP_CONCAT(DISTINCT pi.Peptide) AS GeneGroup\n"
-    "    FROM PeptideInstance pi\n"
-    "    JOIN Protein pro ON pi.Protein = pro.Id\n"
-    "    GROUP BY pro.GeneId;\n"
-    "\n"
-    "--GeneGroup will be a continuous sequence starting at 1\n"
-    "CREATE TEMP TABLE TempProtein AS\n"
-    "    SELECT pro.Id, Accession, IsDecoy, Cluster, ProteinGroup, Length, pro.GeneId, gg2.rowid AS GeneGroup\n"
-    "    FROM GeneGroups gg\n"
-    "    JOIN(\n"
-    "       SELECT gg.GeneGroup\n"
-    "       FROM GeneGroups gg\n"
-    "       GROUP BY gg.GeneGroup\n"
-    "       ORDER BY gg.GeneId\n"
-    "    ) gg2 ON gg.GeneGroup = gg2.GeneGroup\n"
-    "    JOIN Protein pro ON gg.GeneId = pro.GeneId\n"
-    "    GROUP BY pro.Id;\n"
-    "\n"
-    "DELETE FROM Protein;\n"
-    "INSERT INTO Protein SELECT * FROM TempProtein;\n"
-    "CREATE INDEX Protein_GeneGroup ON Protein(GeneGroup);\n"
-    "DROP TABLE GeneGroups;\n"
-    "DROP TABLE TempProtein;"
-);
-
-const string assemblePeptideGroupsSql(
-    "CREATE TEMP TABLE PeptideGroups AS\n"
-    "         SELECT pep.Id AS PeptideId, GROUP_CONCAT(DISTINCT pi.Protein) AS PeptideGroup\n"
-    "         FROM PeptideInstance pi\n"
-    "         JOIN Peptide pep ON pi.Peptide=pep.Id\n"
-    "         GROUP BY pi.Peptide;\n"
-    "\n"
-    "-- PeptideGroup will be a continuous sequence starting at 1\n"
-    "CREATE TEMP TABLE TempPeptide AS\n"
-    "         SELECT PeptideId, MonoisotopicMass, MolecularWeight, pg2.rowid, DecoySequence\n"
-    "         FROM PeptideGroups pg\n"
-    "         JOIN (\n"
-    "               SELECT pg.PeptideGroup\n"
-    "               FROM PeptideGroups pg\n"
-    "               GROUP BY pg.PeptideGroup\n"
-    "              ) pg2 ON pg.PeptideGroup = pg2.PeptideGroup\n"
-    "         JOIN Peptide pro ON pg.PeptideId = pro.Id;\n"
-    "\n"
-    "DELETE FROM Peptide;\n"
-    "INSERT INTO Peptide SELECT * FROM TempPeptide;\n"
-    "CREATE INDEX Peptide_PeptideGroup ON Peptide (PeptideGroup);\n"
-    "DROP TABLE PeptideGroups;\n"
-    "DROP TABLE TempPeptide;"
-);
-
 // DistinctMatchFormat
 boost::format assembleDistinctMatchesSql(
     "DROP TABLE IF EXISTS DistinctMatch;\n"
@@ -348,6 +273,164 @@ const string prepareCoverageSql(
     "INSERT INTO ProteinCoverage(Id, Coverage)\n" + prepareCoverageSelectSql2
 );
 
+
+/// the protein-peptide bipartite graph of the (filtered) PeptideInstance table, stored as compact adjacency arrays:
+/// the neighbors of vertex i are the sorted range [offsets[i], offsets[i+1]) of the corresponding adjacency array
+struct ProteinPeptideGraph
+{
+    vector<sqlite3_int64> proteinIds; // dense protein index -> Protein.Id (sorted)
+    vector<sqlite3_int64> peptideIds; // dense peptide index -> Peptide.Id (sorted)
+
+    vector<size_t> proteinOffsets;
+    vector<int> peptidesByProtein;
+
+    vector<size_t> peptideOffsets;
+    vector<int> proteinsByPeptide;
+
+    explicit ProteinPeptideGraph(sqlite3pp::database& db)
+    {
+        vector<pair<sqlite3_int64, sqlite3_int64> > edges; // protein, peptide
+        sqlite3pp::query edgeQuery(db, "SELECT Protein, Peptide FROM PeptideInstance");
+        BOOST_FOREACH(sqlite3pp::query::rows queryRow, edgeQuery)
+            edges.push_back(make_pair(queryRow.get<sqlite3_int64>(0), queryRow.get<sqlite3_int64>(1)));
+
+        // a peptide may occur more than once in the same protein
+        sort(edges.begin(), edges.end());
+        edges.erase(unique(edges.begin(), edges.end()), edges.end());
+
+        peptideIds.reserve(edges.size());
+        for (size_t i = 0; i < edges.size(); ++i)
+        {
+            if (proteinIds.empty() || proteinIds.back() != edges[i].first)
+            {
+                proteinIds.push_back(edges[i].first);
+                proteinOffsets.push_back(i);
+            }
+            peptideIds.push_back(edges[i].second);
+        }
+        proteinOffsets.push_back(edges.size());
+
+        sort(peptideIds.begin(), peptideIds.end());
+        peptideIds.erase(unique(peptideIds.begin(), peptideIds.end()), peptideIds.end());
+
+        // edges are sorted by protein, so the peptide adjacency array is built by counting sort
+        peptidesByProtein.resize(edges.size());
+        peptideOffsets.resize(peptideIds.size() + 1, 0);
+        for (size_t i = 0; i < edges.size(); ++i)
+        {
+            peptidesByProtein[i] = peptideIndex(edges[i].second);
+            ++peptideOffsets[peptidesByProtein[i] + 1];
+        }
+        std::partial_sum(peptideOffsets.begin(), peptideOffsets.end(), peptideOffsets.begin());
+
+        proteinsByPeptide.resize(edges.size());
+        vector<size_t> nextOffset(peptideOffsets.begin(), peptideOffsets.end() - 1);
+        for (size_t i = 0; i < proteinIds.size(); ++i)
+            for (size_t j = proteinOffsets[i]; j < proteinOffsets[i + 1]; ++j)
+                proteinsByPeptide[nextOffset[peptidesByProtein[j]]++] = (int) i;
+    }
+
+    int proteinIndex(sqlite3_int64 proteinId) const {return (int) (lower_bound(proteinIds.begin(), proteinIds.end(), proteinId) - proteinIds.begin());}
+    int peptideIndex(sqlite3_int64 peptideId) const {return (int) (lower_bound(peptideIds.begin(), peptideIds.end(), peptideId) - peptideIds.begin());}
+};
+
+
+void hashAdjacencyRows(const vector<size_t>* offsets, const vector<int>* adjacency, vector<size_t>* hashes, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; ++i)
+        (*hashes)[i] = boost::hash_range(adjacency->begin() + (*offsets)[i], adjacency->begin() + (*offsets)[i + 1]);
+}
+
+/// returns a group number for each row of an adjacency array such that rows with identical neighbor sets share a group;
+/// groups are numbered contiguously from 1 in order of their first row
+vector<int> groupIdenticalRows(const vector<size_t>& offsets, const vector<int>& adjacency)
+{
+    size_t rowCount = offsets.size() - 1;
+    vector<size_t> hashes(rowCount);
+
+    // hashing is split into contiguous blocks of rows across threads, but small graphs are not worth the overhead
+    size_t threadCount = min((size_t) max(1u, boost::thread::hardware_concurrency()), rowCount / 10000 + 1);
+    size_t blockSize = rowCount / threadCount + 1;
+    if (threadCount == 1)
+        hashAdjacencyRows(&offsets, &adjacency, &hashes, 0, rowCount);
+    else
+    {
+        boost::thread_group hashThreads;
+        for (size_t begin = 0; begin < rowCount; begin += blockSize)
+            hashThreads.create_thread(boost::bind(&hashAdjacencyRows, &offsets, &adjacency, &hashes, begin, min(begin + blockSize, rowCount)));
+        hashThreads.join_all();
+    }
+
+    vector<int> groupByRow(rowCount);
+    boost::unordered_multimap<size_t, size_t> firstRowByHash;
+    int groupCount = 0;
+    for (size_t i = 0; i < rowCount; ++i)
+    {
+        typedef boost::unordered_multimap<size_t, size_t>::const_iterator HashIterator;
+        pair<HashIterator, HashIterator> range = firstRowByHash.equal_range(hashes[i]);
+        for (; range.first != range.second; ++range.first)
+        {
+            size_t j = range.first->second;
+            if (offsets[i + 1] - offsets[i] == offsets[j + 1] - offsets[j] &&
+                std::equal(adjacency.begin() + offsets[i], adjacency.begin() + offsets[i + 1], adjacency.begin() + offsets[j]))
+                break;
+        }
+
+        if (range.first != range.second)
+            groupByRow[i] = groupByRow[range.first->second];
+        else
+        {
+            firstRowByHash.insert(make_pair(hashes[i], i));
+            groupByRow[i] = ++groupCount;
+        }
+    }
+    return groupByRow;
+}
+
+/// renumbers the groups returned by groupIdenticalRows() in the lexicographic order of their members' comma-separated
+/// neighbor ids, which is how groups were numbered when they were assembled with GROUP_CONCAT
+void orderGroupsByConcatenatedIds(vector<int>& groupByRow, const vector<size_t>& offsets, const vector<int>& adjacency,
+                                  const vector<sqlite3_int64>& neighborIds)
+{
+    int groupCount = groupByRow.empty() ? 0 : *max_element(groupByRow.begin(), groupByRow.end());
+    vector<pair<string, int> > groupKeys;
+    groupKeys.reserve(groupCount);
+    vector<char> hasKey(groupCount + 1, 0);
+    for (size_t i = 0; i < groupByRow.size(); ++i)
+    {
+        if (hasKey[groupByRow[i]])
+            continue;
+        hasKey[groupByRow[i]] = 1;
+
+        ostringstream key;
+        for (size_t j = offsets[i]; j < offsets[i + 1]; ++j)
+            key << (j > offsets[i] ? "," : "") << neighborIds[adjacency[j]];
+        groupKeys.push_back(make_pair(key.str(), groupByRow[i]));
+    }
+    sort(groupKeys.begin(), groupKeys.end());
+
+    vector<int> orderedGroup(groupCount + 1, 0);
+    for (size_t i = 0; i < groupKeys.size(); ++i)
+        orderedGroup[groupKeys[i].second] = (int) i + 1;
+    for (size_t i = 0; i < groupByRow.size(); ++i)
+        groupByRow[i] = orderedGroup[groupByRow[i]];
+}
+
+int findRoot(vector<int>& parent, int i)
+{
+    while (parent[i] != i)
+        i = parent[i] = parent[parent[i]];
+    return i;
+}
+
+void unionRoots(vector<int>& parent, int i, int j)
+{
+    i = findRoot(parent, i);
+    j = findRoot(parent, j);
+    if (i < j) parent[j] = i;
+    else if (j < i) parent[i] = j;
+}
+
 } // namespace
 
 
@@ -593,7 +676,20 @@ struct Filter::Impl
     void assemblePeptideGroups(sqlite3pp::database& db)
     {
         ITERATION_UPDATE(ilr, FilterStep_AssemblePeptideGroups, FilterStep_Count, "assembling peptide groups")
-        db.execute(assemblePeptideGroupsSql);
+
+        // peptides with the same set of proteins are in the same group
+        ProteinPeptideGraph graph(db);
+        vector<int> peptideGroups = groupIdenticalRows(graph.peptideOffsets, graph.proteinsByPeptide);
+        orderGroupsByConcatenatedIds(peptideGroups, graph.peptideOffsets, graph.proteinsByPeptide, graph.proteinIds);
+
+        sqlite3pp::command updatePeptideGroup(db, "UPDATE Peptide SET PeptideGroup = ? WHERE Id = ?");
+        for (size_t i = 0; i < graph.peptideIds.size(); ++i)
+        {
+            updatePeptideGroup.binder() << peptideGroups[i] << graph.peptideIds[i];
+            updatePeptideGroup.step();
+            updatePeptideGroup.reset();
+        }
+        db.execute("CREATE INDEX Peptide_PeptideGroup ON Peptide (PeptideGroup)");
     }
 
     void aggregateQuantitationStatistics(sqlite3pp::database& db)
@@ -631,13 +727,72 @@ struct Filter::Impl
     void assembleProteinGroups(sqlite3pp::database& db, FilterSteps filterStep)
     {
         ITERATION_UPDATE(ilr, filterStep, FilterStep_Count, "assembling protein groups")
-        db.execute(assembleProteinGroupsSql);
+
+        // proteins with the same set of peptides are in the same group; proteins without peptides are dropped
+        ProteinPeptideGraph graph(db);
+        vector<int> proteinGroups = groupIdenticalRows(graph.proteinOffsets, graph.peptidesByProtein);
+        orderGroupsByConcatenatedIds(proteinGroups, graph.proteinOffsets, graph.peptidesByProtein, graph.peptideIds);
+
+        db.execute("DELETE FROM Protein WHERE Id NOT IN (SELECT Protein FROM PeptideInstance)");
+        sqlite3pp::command updateProteinGroup(db, "UPDATE Protein SET ProteinGroup = ? WHERE Id = ?");
+        for (size_t i = 0; i < graph.proteinIds.size(); ++i)
+        {
+            updateProteinGroup.binder() << proteinGroups[i] << graph.proteinIds[i];
+            updateProteinGroup.step();
+            updateProteinGroup.reset();
+        }
+        db.execute("CREATE INDEX Protein_ProteinGroup ON Protein(ProteinGroup)");
 
         if (!hasGeneMetadata)
             return;
 
         ITERATION_UPDATE(ilr, filterStep+1, FilterStep_Count, "assembling gene groups")
-        db.execute(assembleGeneGroupsSql);
+
+        // genes with the same set of peptides (from all their proteins) are in the same group; genes are ordered by GeneId
+        map<string, int> geneIndexByGeneId;
+        vector<pair<int, int> > genePeptides;
+        vector<pair<string, sqlite3_int64> > proteinsByGeneId;
+        sqlite3pp::query geneQuery(db, "SELECT Id, GeneId FROM Protein WHERE GeneId IS NOT NULL");
+        BOOST_FOREACH(sqlite3pp::query::rows queryRow, geneQuery)
+        {
+            proteinsByGeneId.push_back(make_pair(queryRow.get<string>(1), queryRow.get<sqlite3_int64>(0)));
+            geneIndexByGeneId[proteinsByGeneId.back().first] = 0;
+        }
+
+        int geneCount = 0;
+        for (map<string, int>::iterator itr = geneIndexByGeneId.begin(); itr != geneIndexByGeneId.end(); ++itr)
+            itr->second = geneCount++;
+
+        typedef pair<string, sqlite3_int64> GeneProteinPair;
+        BOOST_FOREACH(const GeneProteinPair& geneProtein, proteinsByGeneId)
+        {
+            int proteinIndex = graph.proteinIndex(geneProtein.second);
+            int geneIndex = geneIndexByGeneId[geneProtein.first];
+            for (size_t j = graph.proteinOffsets[proteinIndex]; j < graph.proteinOffsets[proteinIndex + 1]; ++j)
+                genePeptides.push_back(make_pair(geneIndex, graph.peptidesByProtein[j]));
+        }
+        sort(genePeptides.begin(), genePeptides.end());
+        genePeptides.erase(unique(genePeptides.begin(), genePeptides.end()), genePeptides.end());
+
+        vector<size_t> geneOffsets(geneCount + 1, 0);
+        vector<int> peptidesByGene(genePeptides.size());
+        for (size_t i = 0; i < genePeptides.size(); ++i)
+        {
+            ++geneOffsets[genePeptides[i].first + 1];
+            peptidesByGene[i] = genePeptides[i].second;
+        }
+        std::partial_sum(geneOffsets.begin(), geneOffsets.end(), geneOffsets.begin());
+
+        vector<int> geneGroups = groupIdenticalRows(geneOffsets, peptidesByGene);
+
+        sqlite3pp::command updateGeneGroup(db, "UPDATE Protein SET GeneGroup = ? WHERE Id = ?");
+        BOOST_FOREACH(const GeneProteinPair& geneProtein, proteinsByGeneId)
+        {
+            updateGeneGroup.binder() << geneGroups[geneIndexByGeneId[geneProtein.first]] << geneProtein.second;
+            updateGeneGroup.step();
+            updateGeneGroup.reset();
+        }
+        db.execute("CREATE INDEX Protein_GeneGroup ON Protein(GeneGroup)");
     }
 
     void applyMaxProteinGroupsFilter(sqlite3pp::database& db)
@@ -665,54 +820,70 @@ struct Filter::Impl
     {
         ITERATION_UPDATE(ilr, FilterStep_AssembleClusters, FilterStep_Count, "assembling clusters")
 
-        typedef map<int, set<sqlite3_int64> > SpectrumSetByProteinGroup;
-        SpectrumSetByProteinGroup spectrumSetByProteinGroup;
-        map<sqlite3_int64, set<int> > proteinGroupSetBySpectrumId;
-
-        sqlite3pp::query query(db, "SELECT pro.ProteinGroup, psm.Spectrum "
-                                   "FROM PeptideSpectrumMatch psm "
-                                   "JOIN PeptideInstance pi ON psm.Peptide = pi.Peptide "
-                                   "JOIN Protein pro on pi.Protein = pro.Id");
+        // protein groups are connected by shared peptides and by spectra matching more than one peptide;
+        // clusters are the connected components, numbered in order of their lowest protein group
+        ProteinPeptideGraph graph(db);
 
-        BOOST_FOREACH(sqlite3pp::query::rows queryRow, query)
+        vector<int> proteinGroupByProtein(graph.proteinIds.size(), 0);
+        int proteinGroupCount = 0;
+        sqlite3pp::query proteinGroupQuery(db, "SELECT Id, ProteinGroup FROM Protein");
+        BOOST_FOREACH(sqlite3pp::query::rows queryRow, proteinGroupQuery)
         {
-            int proteinGroup = queryRow.get<int>(0);
-            sqlite3_int64 spectrumId = queryRow.get<sqlite3_int64>(1);
-
-            spectrumSetByProteinGroup[proteinGroup].insert(spectrumId);
-            proteinGroupSetBySpectrumId[spectrumId].insert(proteinGroup);
+            sqlite3_int64 proteinId = queryRow.get<sqlite3_int64>(0);
+            int proteinIndex = graph.proteinIndex(proteinId);
+            if (proteinIndex == (int) graph.proteinIds.size() || graph.proteinIds[proteinIndex] != proteinId)
+                continue;
+            proteinGroupByProtein[proteinIndex] = queryRow.get<int>(1);
+            proteinGroupCount = max(proteinGroupCount, proteinGroupByProtein[proteinIndex]);
         }
 
-        map<int, int> clusterByProteinGroup;
-        int clusterId = 0;
-        stack<SpectrumSetByProteinGroup::const_iterator> clusterStack;
+        vector<int> parent(proteinGroupCount + 1);
+        for (int i = 0; i <= proteinGroupCount; ++i)
+            parent[i] = i;
 
-        for (SpectrumSetByProteinGroup::const_iterator itr = spectrumSetByProteinGroup.begin(); itr != spectrumSetByProteinGroup.end(); ++itr)
-        {
-            int proteinGroup = itr->first;
+        for (size_t i = 0; i < graph.peptideIds.size(); ++i)
+            for (size_t j = graph.peptideOffsets[i] + 1; j < graph.peptideOffsets[i + 1]; ++j)
+                unionRoots(parent, proteinGroupByProtein[graph.proteinsByPeptide[graph.peptideOffsets[i]]], proteinGroupByProtein[graph.proteinsByPeptide[j]]);
 
-            if (clusterByProteinGroup.count(proteinGroup) > 0)
+        vector<char> isMatchedPeptide(graph.peptideIds.size(), 0);
+        sqlite3pp::query spectrumQuery(db, "SELECT Spectrum, Peptide FROM PeptideSpectrumMatch ORDER BY Spectrum");
+        sqlite3_int64 lastSpectrumId = 0;
+        int lastProteinGroup = 0;
+        BOOST_FOREACH(sqlite3pp::query::rows queryRow, spectrumQuery)
+        {
+            sqlite3_int64 spectrumId = queryRow.get<sqlite3_int64>(0);
+            sqlite3_int64 peptideId = queryRow.get<sqlite3_int64>(1);
+            int peptideIndex = graph.peptideIndex(peptideId);
+            if (peptideIndex == (int) graph.peptideIds.size() || graph.peptideIds[peptideIndex] != peptideId ||
+                graph.peptideOffsets[peptideIndex] == graph.peptideOffsets[peptideIndex + 1])
                 continue;
 
-            // for each protein without a cluster assignment, make a new cluster
-            ++clusterId;
-            clusterStack.push(itr);
-            while (clusterStack.size() > 0)
-            {
-                SpectrumSetByProteinGroup::const_iterator spectrumSetByProteinGroupItr = clusterStack.top();
-                clusterStack.pop();
+            int proteinGroup = proteinGroupByProtein[graph.proteinsByPeptide[graph.peptideOffsets[peptideIndex]]];
+            isMatchedPeptide[peptideIndex] = 1;
+            if (spectrumId == lastSpectrumId)
+                unionRoots(parent, lastProteinGroup, proteinGroup);
+            lastSpectrumId = spectrumId;
+            lastProteinGroup = proteinGroup;
+        }
 
-                // add all "cousin" proteins to the current cluster
-                BOOST_FOREACH(long spectrumId, spectrumSetByProteinGroupItr->second)
-                BOOST_FOREACH(int cousinProteinGroup, proteinGroupSetBySpectrumId[spectrumId])
-                {
-                    if (!clusterByProteinGroup.insert(make_pair(cousinProteinGroup, clusterId)).second)
-                        continue;
+        // only protein groups with at least one matched peptide get a cluster
+        vector<char> isMatchedGroup(proteinGroupCount + 1, 0);
+        for (size_t i = 0; i < graph.peptideIds.size(); ++i)
+            if (isMatchedPeptide[i])
+                for (size_t j = graph.peptideOffsets[i]; j < graph.peptideOffsets[i + 1]; ++j)
+                    isMatchedGroup[proteinGroupByProtein[graph.proteinsByPeptide[j]]] = 1;
 
-                    SpectrumSetByProteinGroup::const_iterator findItr = spectrumSetByProteinGroup.find(cousinProteinGroup);
-                    clusterStack.push(findItr);
-                }
-            }
+        map<int, int> clusterByProteinGroup;
+        vector<int> clusterByRoot(proteinGroupCount + 1, 0);
+        int clusterId = 0;
+        for (int proteinGroup = 1; proteinGroup <= proteinGroupCount; ++proteinGroup)
+        {
+            if (!isMatchedGroup[proteinGroup])
+                continue;
+            int root = findRoot(parent, proteinGroup);
+            if (clusterByRoot[root] == 0)
+                clusterByRoot[root] = ++clusterId;
+            clusterByProteinGroup[proteinGroup] = clusterByRoot[root];
         }
 
         sqlite3pp::command assignCluster(db, "UPDATE Protein SET Cluster = ? WHERE ProteinGroup = ?");
@@ -26,6 +26,7 @@
 #include "pwiz/utility/misc/Std.hpp"
 #include "pwiz/utility/misc/Filesystem.hpp"
 #include "boost/assign.hpp"
+#include "boost/foreach_field.hpp"
 #include "Filter.hpp"
 #include "SchemaUpdater.hpp"
 #include "sqlite3pp.h"
@@ -1375,6 +1376,85 @@ void testAdditionalPeptides()
 }
 
 
+/// returns "Id:Group:Cluster" for each row of the query, separated by spaces
+string groupNumbering(sqlite::database& db, const string& sql)
+{
+    ostringstream result;
+    sqlite::query query(db, sql.c_str());
+    bool hasCluster = query.column_count() > 2;
+    BOOST_FOREACH(sqlite::query::rows queryRow, query)
+    {
+        if (result.tellp() > 0)
+            result << ' ';
+        result << queryRow.get<sqlite3_int64>(0) << ':' << queryRow.get<int>(1);
+        if (hasCluster)
+            result << ':' << queryRow.get<int>(2);
+    }
+    return result.str();
+}
+
+
+// group and cluster numbers follow the order of the group members' concatenated ids,
+// e.g. protein group "10" comes before "2"; clusters follow the order of their lowest protein group
+void testGroupNumbering()
+{
+    Filter::Config config;
+    config.minDistinctPeptides = 1;
+    config.minSpectra = 1;
+    config.minAdditionalPeptides = 1;
+    config.geneLevelFiltering = false;
+
+    config.minSpectraPerDistinctMatch = 1;
+    config.minSpectraPerDistinctPeptide = 1;
+    config.maxProteinGroupsPerPeptide = 10;
+
+    config.distinctMatchFormat.isAnalysisDistinct = false;
+    config.distinctMatchFormat.isChargeDistinct = true;
+    config.distinctMatchFormat.areModificationsDistinct = true;
+    config.distinctMatchFormat.modificationMassRoundToNearest = 1.0;
+
+    TestDatabase db;
+
+    try
+    {
+        // Pro1 -> Pep2 (spectra 2)
+        // Pro2, Pro3 -> Pep10
+        // Pro10 -> Pep3 Pep4, Pro11 -> Pep4 Pep6 (shared peptide)
+        // Pro12 -> Pep5 (spectra 2, 5: spectrum 2 is ambiguous between Pep2 and Pep5)
+        const TestPSM testPSMs[] =
+        {
+            { 1, 2, 2 },
+            { 2, 10, 10 },
+            { 3, 10, 10 },
+            { 10, 3, 3 },
+            { 10, 4, 4 },
+            { 11, 4, 4 },
+            { 11, 6, 6 },
+            { 12, 5, 2 },
+            { 12, 5, 5 },
+        };
+
+        db = testCase(testPSMs);
+
+        Filter filter;
+        filter.config = config;
+        filter.filter(db->connected());
+
+        unit_assert_operator_equal("1:2:2 2:1:1 3:1:1 10:3:3 11:4:3 12:5:2", groupNumbering(*db, "SELECT Id, ProteinGroup, Cluster FROM Protein ORDER BY Id"));
+        unit_assert_operator_equal("2:1 3:2 4:3 5:5 6:4 10:6", groupNumbering(*db, "SELECT Id, PeptideGroup FROM Peptide ORDER BY Id"));
+    }
+    catch (runtime_error&)
+    {
+        if (db)
+        {
+            cerr << "Saving failed test case to assertion_failed.idpDB" << endl;
+            db->save_to_file("assert_failed.idpDB");
+        }
+        throw;
+    }
+}
+
+
 int main(int argc, char* argv[])
 {
     TEST_PROLOG(argc, argv)
@@ -1383,6 +1463,7 @@ int main(int argc, char* argv[])
     {
         testCoverage();
         testAdditionalPeptides();
+        testGroupNumbering();
     }
     catch (exception& e)
     {
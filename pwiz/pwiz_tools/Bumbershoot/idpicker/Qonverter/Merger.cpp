@@ -37,6 +37,7 @@
 #include "boost/atomic.hpp"
 #include "boost/thread.hpp"
 #include "boost/make_shared.hpp"
+#include "boost/bind.hpp"
 #include <deque>
 #include <algorithm>
 
@@ -339,6 +340,148 @@ class TemporaryFile
 };
 
 
+// the natural key queries used by the ordered merge; they must match the join conditions of the merge*Sql formats above
+const char* proteinKeysSql = "SELECT Id, Accession FROM %1%.Protein";
+const char* spectrumSourceGroupKeysSql = "SELECT Id, Name FROM %1%.SpectrumSourceGroup";
+const char* spectrumSourceKeysSql = "SELECT Id, Name FROM %1%.SpectrumSource";
+const char* spectrumSourceGroupLinkKeysSql = "SELECT Id, Source, Group_ FROM %1%.SpectrumSourceGroupLink";
+const char* modificationKeysSql = "SELECT Id, Formula, MonoMassDelta FROM %1%.Modification";
+const char* peptideSpectrumMatchScoreNameKeysSql = "SELECT Id, Name FROM %1%.PeptideSpectrumMatchScoreName";
+const char* analysisKeysSql =
+    "SELECT a.Id, SoftwareName || ' ' || SoftwareVersion || ' ' || GROUP_CONCAT(ap.Name || ' ' || ap.Value) AS DistinctKey\n"
+    "FROM %1%.Analysis a\n"
+    "LEFT JOIN %1%.AnalysisParameter ap ON a.Id = Analysis\n"
+    "GROUP BY a.Id";
+
+/// a row id and its natural key; a NULL key never matches another row
+struct MergeKey
+{
+    sqlite3_int64 id;
+    string key;
+    bool isNull;
+};
+
+/// a SpectrumSourceGroupLink row id and the ids it links
+struct MergeLink
+{
+    sqlite3_int64 id;
+    sqlite3_int64 source;
+    sqlite3_int64 group;
+};
+
+/// the natural keys of the rows in an idpDB that are matched against the target when merging
+struct MergeKeys
+{
+    vector<MergeKey> proteins;
+    vector<MergeKey> spectrumSourceGroups;
+    vector<MergeKey> spectrumSources;
+    vector<MergeLink> spectrumSourceGroupLinks;
+    vector<MergeKey> modifications;
+    vector<MergeKey> peptideSpectrumMatchScoreNames;
+    vector<MergeKey> analyses;
+};
+
+typedef map<string, sqlite3_int64> MergeKeyMap;
+typedef map<pair<sqlite3_int64, sqlite3_int64>, sqlite3_int64> MergeLinkMap;
+typedef map<sqlite3_int64, sqlite3_int64> MergeIdMap;
+
+/// the target ids of every natural key in the target, updated as each source is merged
+struct MergeKeyDictionary
+{
+    MergeKeyMap proteins;
+    MergeKeyMap spectrumSourceGroups;
+    MergeKeyMap spectrumSources;
+    MergeLinkMap spectrumSourceGroupLinks;
+    MergeKeyMap modifications;
+    MergeKeyMap peptideSpectrumMatchScoreNames;
+    MergeKeyMap analyses;
+};
+
+/// a source idpDB that a worker thread has updated, precached and read the merge keys from
+struct PreparedMergeSource
+{
+    string mergeSourceFilepath;
+    string tempMergeSourceFilepath;
+    boost::shared_ptr<TemporaryFile> tempMergeSourceFile;
+    bool skipped;
+    MergeKeys keys;
+    vector<sqlite3_int64> maxIds;
+    boost::exception_ptr exception;
+
+    PreparedMergeSource(const string& mergeSourceFilepath) : mergeSourceFilepath(mergeSourceFilepath), skipped(false) {}
+};
+
+/// hands out sources to the worker threads and gives the prepared sources back in input order;
+/// workers stay at most maxLookahead sources ahead of the merge so memory use is bounded
+struct OrderedMergeQueue
+{
+    OrderedMergeQueue(const vector<string>& mergeSourceFilepaths, const string& mergeTargetFilepath, size_t maxLookahead)
+        : mergeSourceFilepaths(mergeSourceFilepaths), mergeTargetFilepath(mergeTargetFilepath),
+          preparedSources(mergeSourceFilepaths.size()), maxLookahead(maxLookahead), nextToPrepare(0), nextToMerge(0), canceled(false)
+    {}
+
+    /// returns false when there are no more sources to prepare
+    bool nextSourceToPrepare(size_t& index)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (!canceled && nextToPrepare < mergeSourceFilepaths.size() && nextToPrepare >= nextToMerge + maxLookahead)
+            condition.wait(lock);
+        if (canceled || nextToPrepare == mergeSourceFilepaths.size())
+            return false;
+        index = nextToPrepare++;
+        return true;
+    }
+
+    void setPrepared(size_t index, const boost::shared_ptr<PreparedMergeSource>& source)
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(mutex);
+            preparedSources[index] = source;
+        }
+        condition.notify_all();
+    }
+
+    /// waits for the next source in input order to be prepared; rethrows the worker's exception if it failed
+    boost::shared_ptr<PreparedMergeSource> nextSourceToMerge()
+    {
+        boost::shared_ptr<PreparedMergeSource> source;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (!preparedSources[nextToMerge])
+                condition.wait(lock);
+            source.swap(preparedSources[nextToMerge]);
+            ++nextToMerge;
+        }
+        condition.notify_all();
+
+        if (source->exception)
+            boost::rethrow_exception(source->exception);
+        return source;
+    }
+
+    void cancel()
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(mutex);
+            canceled = true;
+        }
+        condition.notify_all();
+    }
+
+    const vector<string>& mergeSourceFilepaths;
+    const string& mergeTargetFilepath;
+
+    private:
+    vector<boost::shared_ptr<PreparedMergeSource> > preparedSources;
+    size_t maxLookahead;
+    size_t nextToPrepare;
+    size_t nextToMerge;
+    bool canceled;
+    boost::mutex mutex;
+    boost::condition_variable condition;
+};
+
+
 } // namespace
 
 
@@ -384,6 +527,71 @@ struct Merger::Impl
             mergeFiles();
     }
 
+    /// Merge the sources into the target in input order; up to maxThreads worker threads
+    /// update the sources and read their merge keys ahead of the merge.
+    void mergeOrdered(int maxThreads, pwiz::util::IterationListenerRegistry* ilr = 0)
+    {
+        this->ilr = ilr;
+
+        sqlite3pp::database inMemoryDb(":memory:");
+
+        mergeSourceDatabase = "new";
+
+        initializeTarget(inMemoryDb);
+
+        // a file given more than once is only prepared once, so two workers never update the same file
+        vector<string> uniqueSourceFilepaths;
+        set<string> seenSourceFilepaths;
+        BOOST_FOREACH(const string& mergeSourceFilepath, mergeSourceFilepaths)
+            if (seenSourceFilepaths.insert(mergeSourceFilepath).second)
+                uniqueSourceFilepaths.push_back(mergeSourceFilepath);
+
+        MergeKeys targetKeys;
+        readMergeKeys(inMemoryDb, "merged", targetKeys);
+
+        MergeKeyDictionary dictionary;
+        addMergeKeys(targetKeys.proteins, dictionary.proteins);
+        addMergeKeys(targetKeys.spectrumSourceGroups, dictionary.spectrumSourceGroups);
+        addMergeKeys(targetKeys.spectrumSources, dictionary.spectrumSources);
+        addMergeKeys(targetKeys.modifications, dictionary.modifications);
+        addMergeKeys(targetKeys.peptideSpectrumMatchScoreNames, dictionary.peptideSpectrumMatchScoreNames);
+        addMergeKeys(targetKeys.analyses, dictionary.analyses);
+        BOOST_FOREACH(const MergeLink& link, targetKeys.spectrumSourceGroupLinks)
+            dictionary.spectrumSourceGroupLinks.insert(make_pair(make_pair(link.source, link.group), link.id));
+
+        int workerCount = max(1, min(maxThreads, (int) boost::thread::hardware_concurrency()));
+        OrderedMergeQueue queue(uniqueSourceFilepaths, mergeTargetFilepath, workerCount * 2);
+
+        // prevent boost::path::codecvt facet initialization race condition
+        bfs::unique_path("%%%%%%%%%%%%%%%%.idpDB");
+
+        boost::thread_group workers;
+        for (int i = 0; i < workerCount; ++i)
+            workers.create_thread(boost::bind(&Impl::prepareMergeSources, boost::ref(queue)));
+
+        try
+        {
+            for (size_t i = 0; i < uniqueSourceFilepaths.size(); ++i)
+            {
+                ITERATION_UPDATE(ilr, i, uniqueSourceFilepaths.size(), "merging")
+
+                boost::shared_ptr<PreparedMergeSource> source = queue.nextSourceToMerge();
+                if (!source->skipped)
+                    mergePreparedSource(inMemoryDb, *source, dictionary);
+            }
+            ITERATION_UPDATE(ilr, uniqueSourceFilepaths.size(), uniqueSourceFilepaths.size(), "merging")
+        }
+        catch (...)
+        {
+            queue.cancel();
+            workers.join_all();
+            throw;
+        }
+        workers.join_all();
+
+        finalizeTarget(inMemoryDb);
+    }
+
     private:
 
     boost::format mergeProteinsSql;
@@ -638,21 +846,7 @@ struct Merger::Impl
                 mergeModifications(inMemoryDb);
                 mergePeptideSpectrumMatchScoreNames(inMemoryDb);
                 mergeAnalyses(inMemoryDb);
-                addNewProteins(inMemoryDb);
-                addNewPeptideInstances(inMemoryDb);
-                addNewPeptides(inMemoryDb);
-                addNewModifications(inMemoryDb);
-                addNewSpectrumSourceGroups(inMemoryDb);
-                addNewSpectrumSources(inMemoryDb);
-                addNewSpectrumSourceGroupLinks(inMemoryDb);
-                addNewSpectra(inMemoryDb);
-                addNewPeptideSpectrumMatches(inMemoryDb);
-                addNewPeptideSpectrumMatchScoreNames(inMemoryDb);
-                addNewPeptideSpectrumMatchScores(inMemoryDb);
-                addNewPeptideModifications(inMemoryDb);
-                addNewAnalyses(inMemoryDb);
-                addNewAnalysisParameters(inMemoryDb);
-                addNewQonverterSettings(inMemoryDb);
+                addNewRows(inMemoryDb);
 
                 mergeMergedFiles(inMemoryDb, sqliteSafeMergeSourceFilepath);
 
@@ -670,21 +864,275 @@ struct Merger::Impl
             inMemoryDb.execute("DETACH DATABASE new");
         }
 
-        sqlite3pp::transaction transaction(inMemoryDb);
+        finalizeTarget(inMemoryDb);
+    }
+
+    void finalizeTarget(sqlite3pp::database& db)
+    {
+        sqlite3pp::transaction transaction(db);
 
-        addIntegerSet(inMemoryDb);
-        inMemoryDb.execute("UPDATE SpectrumSourceMetadata SET MsDataBytes = NULL");
-        deleteEmptySpectrumSourceGroups(inMemoryDb);
+        addIntegerSet(db);
+        db.execute("UPDATE SpectrumSourceMetadata SET MsDataBytes = NULL");
+        deleteEmptySpectrumSourceGroups(db);
 
         transaction.commit();
 
-        inMemoryDb.execute("DETACH DATABASE merged");
+        db.execute("DETACH DATABASE merged");
 
         // if merging to a temporary file, copy it back to the real target; TemporaryFile dtor will remove temporary file
         if (tempMergeTargetFilepath != mergeTargetFilepath)
             bfs::copy_file(tempMergeTargetFilepath, mergeTargetFilepath);
     }
 
+    /// prepares sources from the queue until it is empty or canceled; runs on a worker thread
+    static void prepareMergeSources(OrderedMergeQueue& queue)
+    {
+        size_t index;
+        while (queue.nextSourceToPrepare(index))
+        {
+            const string& mergeSourceFilepath = queue.mergeSourceFilepaths[index];
+            boost::shared_ptr<PreparedMergeSource> source = boost::make_shared<PreparedMergeSource>(mergeSourceFilepath);
+
+            try
+            {
+                prepareMergeSource(*source, queue.mergeTargetFilepath);
+            }
+            catch (exception& e)
+            {
+                BOOST_LOG_SEV(logSource::get(), MessageSeverity::Error) << "[prepareMergeSources] " << boost::this_thread::get_id() << " error reading \"" + mergeSourceFilepath + "\": " + e.what();
+                source->exception = boost::copy_exception(runtime_error("[prepareMergeSources] error reading \"" + mergeSourceFilepath + "\": " + e.what()));
+            }
+            catch (...)
+            {
+                source->exception = boost::copy_exception(runtime_error("[prepareMergeSources] unknown error reading \"" + mergeSourceFilepath + "\""));
+            }
+
+            queue.setPrepared(index, source);
+        }
+    }
+
+    static void prepareMergeSource(PreparedMergeSource& source, const string& mergeTargetFilepath)
+    {
+        if (!bfs::exists(source.mergeSourceFilepath) || source.mergeSourceFilepath == mergeTargetFilepath)
+        {
+            source.skipped = true;
+            return;
+        }
+
+        // for non-fixed drives, copy source to a temporary file
+        if (!isPathOnFixedDrive(source.mergeSourceFilepath))
+        {
+            source.tempMergeSourceFile = boost::make_shared<TemporaryFile>(".idpDB");
+            source.tempMergeSourceFilepath = source.tempMergeSourceFile->path().string();
+            bfs::copy_file(source.mergeSourceFilepath, source.tempMergeSourceFilepath);
+        }
+        else
+            source.tempMergeSourceFilepath = source.mergeSourceFilepath;
+
+        precacheFile(source.tempMergeSourceFilepath);
+
+        // update source database schema
+        SchemaUpdater::update(source.tempMergeSourceFilepath);
+
+        // drop source database's basic data filters
+        Qonverter::dropFilters(source.tempMergeSourceFilepath);
+
+        sqlite3pp::database db(source.tempMergeSourceFilepath);
+        readMergeKeys(db, "main", source.keys);
+
+        string sql = (boost::format(::getNewMaxIdsSql) % "main").str();
+        sqlite3pp::query maxIdRowQuery(db, sql.c_str());
+        sqlite3pp::query::rows maxIdRow = *maxIdRowQuery.begin();
+        for (int i = 0; i < maxIdRowQuery.column_count(); ++i)
+            source.maxIds.push_back(maxIdRow.get<sqlite3_int64>(i));
+    }
+
+    static void readMergeKeys(sqlite3pp::database& db, const string& schema, vector<MergeKey>& keys, const char* keysSql)
+    {
+        string sql = (boost::format(keysSql) % schema).str();
+        sqlite3pp::query keysQuery(db, sql.c_str());
+        BOOST_FOREACH(sqlite3pp::query::rows row, keysQuery)
+        {
+            keys.push_back(MergeKey());
+            MergeKey& key = keys.back();
+            key.id = row.get<sqlite3_int64>(0);
+            key.isNull = row.column_type(1) == SQLITE_NULL;
+            if (!key.isNull)
+                key.key = row.get<string>(1);
+        }
+    }
+
+    static void readMergeKeys(sqlite3pp::database& db, const string& schema, MergeKeys& keys)
+    {
+        readMergeKeys(db, schema, keys.proteins, proteinKeysSql);
+        readMergeKeys(db, schema, keys.spectrumSourceGroups, spectrumSourceGroupKeysSql);
+        readMergeKeys(db, schema, keys.spectrumSources, spectrumSourceKeysSql);
+        readMergeKeys(db, schema, keys.peptideSpectrumMatchScoreNames, peptideSpectrumMatchScoreNameKeysSql);
+        readMergeKeys(db, schema, keys.analyses, analysisKeysSql);
+
+        string sql = (boost::format(spectrumSourceGroupLinkKeysSql) % schema).str();
+        sqlite3pp::query linksQuery(db, sql.c_str());
+        BOOST_FOREACH(sqlite3pp::query::rows row, linksQuery)
+        {
+            MergeLink link;
+            link.id = row.get<sqlite3_int64>(0);
+            link.source = row.get<sqlite3_int64>(1);
+            link.group = row.get<sqlite3_int64>(2);
+            keys.spectrumSourceGroupLinks.push_back(link);
+        }
+
+        // modifications match on IFNULL(Formula, 1) and MonoMassDelta, so a NULL formula only matches another NULL formula
+        sql = (boost::format(modificationKeysSql) % schema).str();
+        sqlite3pp::query modificationsQuery(db, sql.c_str());
+        BOOST_FOREACH(sqlite3pp::query::rows row, modificationsQuery)
+        {
+            keys.modifications.push_back(MergeKey());
+            MergeKey& key = keys.modifications.back();
+            key.id = row.get<sqlite3_int64>(0);
+            key.isNull = row.column_type(2) == SQLITE_NULL;
+            if (!key.isNull)
+                key.key = (row.column_type(1) == SQLITE_NULL ? string("N") : "F" + row.get<string>(1)) + "\t" + (boost::format("%.17g") % row.get<double>(2)).str();
+        }
+    }
+
+    static void addMergeKeys(const vector<MergeKey>& keys, MergeKeyMap& idByKey)
+    {
+        BOOST_FOREACH(const MergeKey& key, keys)
+            if (!key.isNull)
+                idByKey.insert(make_pair(key.key, key.id));
+    }
+
+    /// writes a merge map from the source keys: known keys map to their target id and new keys are offset by maxId;
+    /// new keys are only added to the dictionary after the whole source is mapped, like the LEFT JOINs in the merge*Sql formats
+    static void writeMergeMap(sqlite3pp::database& db, const string& mergeMapTable, const vector<MergeKey>& keys,
+                              MergeKeyMap& idByKey, sqlite3_int64 maxId, MergeIdMap* afterMergeIds = 0)
+    {
+        db.execute("DROP TABLE IF EXISTS " + mergeMapTable + ";\n"
+                   "CREATE TABLE " + mergeMapTable + "(BeforeMergeId INTEGER PRIMARY KEY, AfterMergeId INT)");
+
+        vector<pair<string, sqlite3_int64> > newKeys;
+        sqlite3pp::command insertMapping(db, ("INSERT INTO " + mergeMapTable + " VALUES (?,?)").c_str());
+        BOOST_FOREACH(const MergeKey& key, keys)
+        {
+            sqlite3_int64 afterMergeId = key.id + maxId;
+            if (!key.isNull)
+            {
+                MergeKeyMap::const_iterator findItr = idByKey.find(key.key);
+                if (findItr != idByKey.end())
+                    afterMergeId = findItr->second;
+                else
+                    newKeys.push_back(make_pair(key.key, afterMergeId));
+            }
+
+            insertMapping.binder() << key.id << afterMergeId;
+            insertMapping.step();
+            insertMapping.reset();
+
+            if (afterMergeIds)
+                (*afterMergeIds)[key.id] = afterMergeId;
+        }
+
+        idByKey.insert(newKeys.begin(), newKeys.end());
+    }
+
+    void mergePreparedSource(sqlite3pp::database& inMemoryDb, const PreparedMergeSource& source, MergeKeyDictionary& dictionary)
+    {
+        string sqliteSafeMergeSourceFilepath = bal::replace_all_copy(source.mergeSourceFilepath, "'", "''");
+
+        // skip files that have already been merged
+        if (sqlite3pp::query(inMemoryDb, ("SELECT COUNT(*) FROM merged.MergedFiles WHERE Filepath = '" + sqliteSafeMergeSourceFilepath + "'").c_str()).begin()->get<sqlite3_int64>(0) > 0)
+            return;
+
+        string sqliteSafeTempMergeSourceFilepath = bal::replace_all_copy(source.tempMergeSourceFilepath, "'", "''");
+
+        inMemoryDb.execute("ATTACH DATABASE '" + sqliteSafeTempMergeSourceFilepath + "' AS new");
+        inMemoryDb.execute("PRAGMA new.cache_size=" + lexical_cast<string>(newCacheSize));
+
+        sqlite3pp::transaction transaction(inMemoryDb);
+
+        try
+        {
+            writeMergeMap(inMemoryDb, "ProteinMergeMap", source.keys.proteins, dictionary.proteins, MaxProteinId);
+            inMemoryDb.execute("CREATE UNIQUE INDEX ProteinMergeMap_Index2 ON ProteinMergeMap(AfterMergeId);\n"
+                               "DROP TABLE IF EXISTS NewProteins;\n"
+                               "CREATE TABLE NewProteins AS SELECT BeforeMergeId, AfterMergeId FROM ProteinMergeMap WHERE AfterMergeId > " + lexical_cast<string>(MaxProteinId));
+
+            mergePeptideInstances(inMemoryDb);
+
+            MergeIdMap spectrumSourceGroupIds, spectrumSourceIds;
+            writeMergeMap(inMemoryDb, "SpectrumSourceGroupMergeMap", source.keys.spectrumSourceGroups, dictionary.spectrumSourceGroups, MaxSpectrumSourceGroupId, &spectrumSourceGroupIds);
+            writeMergeMap(inMemoryDb, "SpectrumSourceMergeMap", source.keys.spectrumSources, dictionary.spectrumSources, MaxSpectrumSourceId, &spectrumSourceIds);
+            inMemoryDb.execute("CREATE UNIQUE INDEX SpectrumSourceMergeMap_Index2 ON SpectrumSourceMergeMap(AfterMergeId)");
+
+            writeSpectrumSourceGroupLinkMergeMap(inMemoryDb, source.keys.spectrumSourceGroupLinks, spectrumSourceIds, spectrumSourceGroupIds, dictionary.spectrumSourceGroupLinks);
+
+            mergeSpectra(inMemoryDb);
+
+            writeMergeMap(inMemoryDb, "ModificationMergeMap", source.keys.modifications, dictionary.modifications, MaxModificationId);
+            writeMergeMap(inMemoryDb, "PeptideSpectrumMatchScoreNameMergeMap", source.keys.peptideSpectrumMatchScoreNames, dictionary.peptideSpectrumMatchScoreNames, MaxPeptideSpectrumMatchScoreNameId);
+            writeMergeMap(inMemoryDb, "AnalysisMergeMap", source.keys.analyses, dictionary.analyses, MaxAnalysisId);
+
+            addNewRows(inMemoryDb);
+
+            mergeMergedFiles(inMemoryDb, sqliteSafeMergeSourceFilepath);
+
+            clearSqlFormats();
+        }
+        catch (runtime_error& e)
+        {
+            throw runtime_error("Error merging " + source.mergeSourceFilepath + ": " + e.what());
+        }
+
+        MaxProteinId += source.maxIds[0];
+        MaxPeptideInstanceId += source.maxIds[1];
+        MaxPeptideId += source.maxIds[2];
+        MaxPeptideSpectrumMatchId += source.maxIds[3];
+        MaxPeptideSpectrumMatchScoreNameId += source.maxIds[4];
+        MaxPeptideModificationId += source.maxIds[5];
+        MaxModificationId += source.maxIds[6];
+        MaxSpectrumSourceGroupId += source.maxIds[7];
+        MaxSpectrumSourceId += source.maxIds[8];
+        MaxSpectrumSourceGroupLinkId += source.maxIds[9];
+        MaxSpectrumId += source.maxIds[10];
+        MaxAnalysisId += source.maxIds[11];
+
+        transaction.commit();
+        inMemoryDb.execute("DETACH DATABASE new");
+    }
+
+    /// links whose source or group is not mapped are left out, like the JOINs in mergeSpectrumSourceGroupLinksSql
+    void writeSpectrumSourceGroupLinkMergeMap(sqlite3pp::database& db, const vector<MergeLink>& links,
+                                              const MergeIdMap& spectrumSourceIds, const MergeIdMap& spectrumSourceGroupIds,
+                                              MergeLinkMap& idByLink)
+    {
+        db.execute("DROP TABLE IF EXISTS SpectrumSourceGroupLinkMergeMap;\n"
+                   "CREATE TABLE SpectrumSourceGroupLinkMergeMap(BeforeMergeId INTEGER PRIMARY KEY, AfterMergeId INT)");
+
+        vector<pair<MergeLinkMap::key_type, sqlite3_int64> > newLinks;
+        sqlite3pp::command insertMapping(db, "INSERT INTO SpectrumSourceGroupLinkMergeMap VALUES (?,?)");
+        BOOST_FOREACH(const MergeLink& link, links)
+        {
+            MergeIdMap::const_iterator sourceItr = spectrumSourceIds.find(link.source);
+            MergeIdMap::const_iterator groupItr = spectrumSourceGroupIds.find(link.group);
+            if (sourceItr == spectrumSourceIds.end() || groupItr == spectrumSourceGroupIds.end())
+                continue;
+
+            MergeLinkMap::key_type key(sourceItr->second, groupItr->second);
+            sqlite3_int64 afterMergeId = link.id + MaxSpectrumSourceGroupLinkId;
+            MergeLinkMap::const_iterator findItr = idByLink.find(key);
+            if (findItr != idByLink.end())
+                afterMergeId = findItr->second;
+            else
+                newLinks.push_back(make_pair(key, afterMergeId));
+
+            insertMapping.binder() << link.id << afterMergeId;
+            insertMapping.step();
+            insertMapping.reset();
+        }
+
+        idByLink.insert(newLinks.begin(), newLinks.end());
+    }
+
     void mergeConnection(sqlite3* conn)
     {
         sqlite3pp::database db(conn, false);
@@ -763,6 +1211,25 @@ struct Merger::Impl
     void addNewAnalysisParameters(sqlite3pp::database& db) { db.execute((addNewAnalysisParametersSql % mergeSourceDatabase % MaxAnalysisId).str()); }
     void addNewQonverterSettings(sqlite3pp::database& db) { db.execute((addNewQonverterSettingsSql % mergeSourceDatabase % MaxAnalysisId).str()); }
 
+    void addNewRows(sqlite3pp::database& db)
+    {
+        addNewProteins(db);
+        addNewPeptideInstances(db);
+        addNewPeptides(db);
+        addNewModifications(db);
+        addNewSpectrumSourceGroups(db);
+        addNewSpectrumSources(db);
+        addNewSpectrumSourceGroupLinks(db);
+        addNewSpectra(db);
+        addNewPeptideSpectrumMatches(db);
+        addNewPeptideSpectrumMatchScoreNames(db);
+        addNewPeptideSpectrumMatchScores(db);
+        addNewPeptideModifications(db);
+        addNewAnalyses(db);
+        addNewAnalysisParameters(db);
+        addNewQonverterSettings(db);
+    }
+
     void mergeMergedFiles(sqlite3pp::database& db, const string& sqliteSafeMergeSourceFilepath)
     {
         try
@@ -856,7 +1323,7 @@ int Merger::Impl::mergedCacheSize = 30000; // 1 GB
 int Merger::Impl::newCacheSize = 20000; // 655 MB
 
 
-Merger::Merger()
+Merger::Merger() : mergeMode(MergeMode_Pairwise)
 {}
 
 Merger::~Merger()
@@ -979,6 +1446,19 @@ void executePairwiseFileMergerTask(std::deque<shared_ptr<MergeTask> >& sourceQue
 
 void Merger::merge(const string& mergeTargetFilepath, const std::vector<string>& mergeSourceFilepaths, int maxThreads, pwiz::util::IterationListenerRegistry* ilr)
 {
+    if (mergeMode == MergeMode_Ordered)
+    {
+        try
+        {
+            _impl.reset(new Impl(mergeTargetFilepath, mergeSourceFilepaths));
+            _impl->mergeOrdered(maxThreads, ilr);
+        }
+        catch (cancellation_exception&)
+        {
+        }
+        return;
+    }
+
     // create a worker thread for each processor, up to maxThreads
     // each worker thread will consume 2 random source filepaths and merge them to a temporary filepath
     // the temporary filepath is added back to the source filepaths queue
@@ -59,9 +59,21 @@ using std::string;
 /// an object responsible for merging two or more idpDBs into a single output idpDB
 struct Merger
 {
+    /// how multiple source files are merged into the target
+    enum MergeMode
+    {
+        /// sources are merged two at a time to temporary files in random order, then the last temporary file becomes the target
+        MergeMode_Pairwise,
+
+        /// sources are read and their id remappings are built in parallel, then they are loaded into the target in input order
+        MergeMode_Ordered
+    };
+
     Merger();
     ~Merger();
 
+    MergeMode mergeMode;
+
     void merge(const string& mergeTargetFilepath, const std::vector<string>& mergeSourceFilepaths, int maxThreads = 8, pwiz::util::IterationListenerRegistry* ilr = 0);
     void merge(const string& mergeTargetFilepath, sqlite3* mergeSourceConnection, pwiz::util::IterationListenerRegistry* ilr = 0);
 
@@ -425,6 +425,7 @@ int main(int argc, const char* argv[])
                    "                   [-LogLevel <Error|Warning|BriefInfo|VerboseInfo|DebugInfo>]\n"
                    "                   [-LogFilepath <filepath to log to>]\n"
                    "                   [-cpus <max thread count>]\n"
+                   "                   [-OrderedMerge <boolean>]\n"
                    "                   [-b <file containing a long list of newline-separated idpDB filemasks>]\n"
                    "\n"
                    "Example: idpAssemble fraction1.idpDB fraction2.idpDB fraction3.idpDB -MergedOutputFilepath mudpit.idpDB\n"
@@ -462,6 +463,7 @@ int main(int argc, const char* argv[])
     int maxThreads = 8;
     string batchFile;
     bool summarizeSources = false;
+    bool orderedMerge = false;
     MessageSeverity logLevel = MessageSeverity::Warning;
 
     vector<string> args(argv + 1, argv + argc);
@@ -504,6 +506,8 @@ int main(int argc, const char* argv[])
             logFilepath = args[++i];
         else if (args[i] == "-cpus")
             maxThreads = lexical_cast<int>(args[++i]);
+        else if (args[i] == "-OrderedMerge")
+            orderedMerge = lexical_cast<bool>(args[++i]);
         else if (args[i] == "-b")
             batchFile = args[++i];
         else
@@ -603,6 +607,8 @@ int main(int argc, const char* argv[])
             BOOST_LOG_SEV(logSource::get(), MessageSeverity::BriefInfo) << "Merging " << mergeSourceFilepaths.size() << " files to: " << mergeTargetFilepath << endl;
             bpt::ptime start = bpt::microsec_clock::local_time();
             Merger merger;
+            if (orderedMerge)
+                merger.mergeMode = Merger::MergeMode_Ordered;
             merger.merge(mergeTargetFilepath, mergeSourceFilepaths, maxThreads, &ilr);
             //std::random_shuffle(mergeSourceFilepaths.begin(), mergeSourceFilepaths.end());
             //merger.merge(bfs::path(mergeTargetFilepath).replace_extension(".reverse.idpDB").string(), mergeSourceFilepaths, 1, &ilr);
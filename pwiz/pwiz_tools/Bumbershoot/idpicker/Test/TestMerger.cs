@@ -266,5 +266,102 @@ namespace Test
                 testModel.TestQonverterSettings();
             }*/
         }
+
+        // rows of each table keyed by natural keys instead of Ids, which depend on the order the sources are merged in
+        static readonly string[] naturalKeyQueries = new string[]
+        {
+            "SELECT 'pro', pro.Accession, pro.IsDecoy, pro.Length, pd.Sequence FROM Protein pro LEFT JOIN ProteinData pd ON pro.Id = pd.Id",
+            "SELECT 'pep', (SELECT SUBSTR(pd.Sequence, pi.Offset+1, pi.Length) FROM PeptideInstance pi JOIN ProteinData pd ON pi.Protein = pd.Id WHERE pi.Peptide = pep.Id ORDER BY pi.Protein, pi.Offset LIMIT 1), pep.MonoisotopicMass, pep.MolecularWeight, pep.DecoySequence FROM Peptide pep",
+            "SELECT 'pi', pro.Accession, pi.Offset, pi.Length, pi.NTerminusIsSpecific, pi.CTerminusIsSpecific, pi.MissedCleavages FROM PeptideInstance pi JOIN Protein pro ON pi.Protein = pro.Id",
+            "SELECT 'ssg', Name FROM SpectrumSourceGroup",
+            "SELECT 'ss', ss.Name, ss.URL, ssg.Name FROM SpectrumSource ss JOIN SpectrumSourceGroup ssg ON ss.Group_ = ssg.Id",
+            "SELECT 'ssgl', ss.Name, ssg.Name FROM SpectrumSourceGroupLink ssgl JOIN SpectrumSource ss ON ssgl.Source = ss.Id JOIN SpectrumSourceGroup ssg ON ssgl.Group_ = ssg.Id",
+            "SELECT 's', ss.Name, s.Index_, s.NativeID, s.PrecursorMZ FROM Spectrum s JOIN SpectrumSource ss ON s.Source = ss.Id",
+            "SELECT 'a', Name, SoftwareName, SoftwareVersion, Type FROM Analysis",
+            "SELECT 'ap', a.Name, ap.Name, ap.Value FROM AnalysisParameter ap JOIN Analysis a ON ap.Analysis = a.Id",
+            "SELECT 'mod', Name, MonoMassDelta, AvgMassDelta, Formula FROM Modification",
+            "SELECT 'psm', ss.Name, s.NativeID, a.Name, (SELECT SUBSTR(pd.Sequence, pi.Offset+1, pi.Length) FROM PeptideInstance pi JOIN ProteinData pd ON pi.Protein = pd.Id WHERE pi.Peptide = psm.Peptide ORDER BY pi.Protein, pi.Offset LIMIT 1), psm.QValue, psm.ObservedNeutralMass, psm.Rank, psm.Charge FROM PeptideSpectrumMatch psm JOIN Spectrum s ON psm.Spectrum = s.Id JOIN SpectrumSource ss ON s.Source = ss.Id JOIN Analysis a ON psm.Analysis = a.Id",
+            "SELECT 'pm', ss.Name, s.NativeID, a.Name, psm.Rank, psm.Charge, pm.Offset, pm.Site, mod.Name FROM PeptideModification pm JOIN PeptideSpectrumMatch psm ON pm.PeptideSpectrumMatch = psm.Id JOIN Spectrum s ON psm.Spectrum = s.Id JOIN SpectrumSource ss ON s.Source = ss.Id JOIN Analysis a ON psm.Analysis = a.Id JOIN Modification mod ON pm.Modification = mod.Id",
+            "SELECT 'score', ss.Name, s.NativeID, a.Name, psm.Rank, psm.Charge, sn.Name, score.Value FROM PeptideSpectrumMatchScore score JOIN PeptideSpectrumMatchScoreName sn ON score.ScoreNameId = sn.Id JOIN PeptideSpectrumMatch psm ON score.PsmId = psm.Id JOIN Spectrum s ON psm.Spectrum = s.Id JOIN SpectrumSource ss ON s.Source = ss.Id JOIN Analysis a ON psm.Analysis = a.Id",
+            "SELECT 'qs', a.Name, qs.QonverterMethod, qs.DecoyPrefix, qs.RerankMatches, qs.ScoreInfoByName FROM QonverterSettings qs JOIN Analysis a ON qs.Id = a.Id"
+        };
+
+        static List<string> getNaturalKeyRows (string idpDbFilepath)
+        {
+            var rows = new List<string>();
+            using (var sessionFactory = SessionFactoryFactory.CreateSessionFactory(idpDbFilepath))
+            using (var session = sessionFactory.OpenSession())
+                foreach (string sql in naturalKeyQueries)
+                    foreach (object[] row in session.CreateSQLQuery(sql).List<object[]>())
+                        rows.Add(String.Join("|", row.Select(o => o is byte[] ? Convert.ToBase64String((byte[]) o) : Convert.ToString(o, System.Globalization.CultureInfo.InvariantCulture)).ToArray()));
+            rows.Sort(StringComparer.Ordinal);
+            return rows;
+        }
+
+        [TestMethod]
+        [TestCategory("Model")]
+        public void TestOrderedMerger ()
+        {
+            // creates testMergeSource1.idpDB and testMergeSource2.idpDB and merges them pairwise into testMerger.idpDB
+            TestMergerModel();
+            var mergeSources = new string[] { "testMergeSource1.idpDB", "testMergeSource2.idpDB" };
+
+            File.Delete("testMergerOrdered.idpDB");
+            Merger.Merge("testMergerOrdered.idpDB", mergeSources, 8, null, Merger.MergeMode.Ordered);
+
+            var testModel = new TestModel();
+
+            // test that testMergerOrdered.idpDB passes the TestModel tests
+            using (var sessionFactory = SessionFactoryFactory.CreateSessionFactory("testMergerOrdered.idpDB"))
+            using (var session = testModel.session = sessionFactory.OpenSession())
+            {
+                testModel.TestOverallCounts();
+                testModel.TestSanity();
+                testModel.TestProteins();
+                testModel.TestPeptides();
+                testModel.TestPeptideInstances();
+                testModel.TestSpectrumSourceGroups();
+                testModel.TestSpectrumSources(false);
+                testModel.TestSpectra(false);
+                testModel.TestAnalyses();
+                testModel.TestPeptideSpectrumMatches();
+                testModel.TestModifications();
+                testModel.TestQonverterSettings();
+            }
+
+            // both modes must produce the same content; only the Ids may differ
+            var pairwiseRows = getNaturalKeyRows("testMerger.idpDB");
+            var orderedRows = getNaturalKeyRows("testMergerOrdered.idpDB");
+            Assert.AreNotEqual(0, pairwiseRows.Count);
+            CollectionAssert.AreEqual(pairwiseRows, orderedRows);
+        }
+
+        [TestMethod]
+        [TestCategory("Model")]
+        public void TestOrderedMergerSourceError ()
+        {
+            // creates testMergeSource1.idpDB and testMergeSource2.idpDB
+            TestMergerModel();
+            File.WriteAllText("testMergeSourceCorrupt.idpDB", "this is not an idpDB");
+            var mergeSources = new string[] { "testMergeSource1.idpDB", "testMergeSourceCorrupt.idpDB", "testMergeSource2.idpDB" };
+
+            foreach (var mergeMode in new Merger.MergeMode[] { Merger.MergeMode.Pairwise, Merger.MergeMode.Ordered })
+            {
+                File.Delete("testMergerError.idpDB");
+                try
+                {
+                    Merger.Merge("testMergerError.idpDB", mergeSources, 8, null, mergeMode);
+                    Assert.Fail("{0} merge of a corrupt source did not throw", mergeMode);
+                }
+                catch (AssertFailedException)
+                {
+                    throw;
+                }
+                catch (Exception e)
+                {
+                    StringAssert.Contains(e.Message, "testMergeSourceCorrupt.idpDB", "{0} merge error does not name the corrupt source", mergeMode);
+                }
+            }
+        }
     }
 }
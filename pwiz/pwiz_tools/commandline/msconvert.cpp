@@ -26,6 +26,7 @@
 #include "pwiz/data/msdata/MSDataMerger.hpp"
 #include "pwiz/data/msdata/IO.hpp"
 #include "pwiz/data/msdata/SpectrumInfo.hpp"
+#include "pwiz/data/msdata/SpectrumWorkerThreads.hpp"
 #include "pwiz/utility/misc/IterationListener.hpp"
 #include "pwiz/analysis/spectrum_processing/SpectrumListFactory.hpp"
 #include "pwiz/Version.hpp"
@@ -36,6 +37,7 @@
 #include "pwiz/utility/misc/Filesystem.hpp"
 #include "pwiz/utility/misc/Std.hpp"
 #include <boost/filesystem/detail/utf8_codecvt_facet.hpp>
+#include <boost/thread.hpp>
 
 using namespace pwiz::cv;
 using namespace pwiz::data;
@@ -58,9 +60,11 @@ struct Config : public Reader::Config
     MSDataFile::WriteConfig writeConfig;
     string contactFilename;
     bool merge;
+    bool mergeByScanTime;
+    int jobs;
 
     Config()
-        : outputPath("."), verbose(false), merge(false)
+        : outputPath("."), verbose(false), merge(false), mergeByScanTime(false), jobs(1)
     {
         simAsSpectra = false;
         srmAsSpectra = false;
@@ -94,7 +98,8 @@ string Config::outputFilename(const string& filename, const MSData& msd) const
             extension == ".cms1" ||
             extension == ".ms2" ||
             extension == ".cms2" ||
-            extension == ".mz5")
+            extension == ".mz5" ||
+            extension == ".mzbin")
             runId = bfs::basename(runId);
     }
 
@@ -116,6 +121,8 @@ ostream& operator<<(ostream& os, const Config& config)
     os << "outputPath: " << config.outputPath << endl;
     os << "extension: " << config.extension << endl; 
     os << "contactFilename: " << config.contactFilename << endl;
+    if (config.jobs > 1)
+        os << "jobs: " << config.jobs << endl;
     os << endl;
 
     os << "filters:\n  ";
@@ -174,6 +181,7 @@ Config parseCommandLine(int argc, char** argv)
     bool format_MS2 = false;
     bool format_CMS2 = false;
     bool format_mz5 = false;
+    bool format_mzBin = false;
     bool precision_32 = false;
     bool precision_64 = false;
     bool mz_precision_32 = false;
@@ -219,7 +227,7 @@ Config parseCommandLine(int argc, char** argv)
 #ifndef WITHOUT_MZ5
             "|mz5"
 #endif
-            "]")
+            "|mzBin]")
         ("mzML",
             po::value<bool>(&format_mzML)->zero_tokens(),
             ": write mzML format [default]")
@@ -231,6 +239,9 @@ Config parseCommandLine(int argc, char** argv)
             po::value<bool>(&format_mz5)->zero_tokens(),
             ": write mz5 format")
 #endif
+        ("mzBin",
+            po::value<bool>(&format_mzBin)->zero_tokens(),
+            ": write mzBin format (chunked binary with indexed metadata columns)")
         ("mgf",
             po::value<bool>(&format_MGF)->zero_tokens(),
             ": write Mascot generic format")
@@ -300,6 +311,12 @@ Config parseCommandLine(int argc, char** argv)
         ("merge",
             po::value<bool>(&config.merge)->zero_tokens(),
             ": create a single output file from multiple input files by merging file-level metadata and concatenating spectrum lists")
+        ("mergeByScanTime",
+            po::value<bool>(&config.mergeByScanTime)->zero_tokens(),
+            ": with --merge, interleave the spectra of all input files by scan start time instead of concatenating them")
+        ("jobs",
+            po::value<int>(&config.jobs)->default_value(config.jobs),
+            ": convert up to this many input files at once, dividing the processor cores between them; each file's console output is shown when it and the files before it are done, without spectrum progress")
         ("simAsSpectra",
             po::value<bool>(&config.simAsSpectra)->zero_tokens(),
             ": write selected ion monitoring as spectra, not chromatograms")
@@ -503,8 +520,9 @@ Config parseCommandLine(int argc, char** argv)
     if (config.filenames.empty())
         throw user_error("[msconvert] No files specified.");
 
-    int count = format_text + format_mzML + format_mzXML + format_MGF + format_MS2 + format_CMS2 + format_mz5;
+    int count = format_text + format_mzML + format_mzXML + format_MGF + format_MS2 + format_CMS2 + format_mz5 + format_mzBin;
     if (count > 1) throw user_error("[msconvert] Multiple format flags specified.");
+    if (config.jobs < 1) throw user_error("[msconvert] Number of jobs must be at least 1.");
     if (format_text) config.writeConfig.format = MSDataFile::Format_Text;
     if (format_mzML) config.writeConfig.format = MSDataFile::Format_mzML;
     if (format_mzXML) config.writeConfig.format = MSDataFile::Format_mzXML;
@@ -514,6 +532,7 @@ Config parseCommandLine(int argc, char** argv)
     if (format_MS2) config.writeConfig.format = MSDataFile::Format_MS2;
     if (format_CMS2) config.writeConfig.format = MSDataFile::Format_CMS2;
     if (format_mz5) config.writeConfig.format = MSDataFile::Format_MZ5;
+    if (format_mzBin) config.writeConfig.format = MSDataFile::Format_mzBin;
 
     config.writeConfig.gzipped = gzip; // if true, file is written as .gz
 
@@ -551,6 +570,9 @@ Config parseCommandLine(int argc, char** argv)
 #endif
                 config.extension = ".mz5";
                 break;
+            case MSDataFile::Format_mzBin:
+                config.extension = ".mzBin";
+                break;
             default:
                 throw user_error("[msconvert] Unsupported format."); 
         }
@@ -676,28 +698,78 @@ void calculateSourceFilePtrSHA1(const SourceFilePtr& sourceFilePtr)
 }
 
 
+/// Returns true if the output format includes the source file checksums,
+/// i.e. if it is worth reading the source files to calculate them.
+bool writesSourceFileChecksums(const Config& config)
+{
+    switch (config.writeConfig.format)
+    {
+        case MSDataFile::Format_mzML:
+        case MSDataFile::Format_mzXML:
+        case MSDataFile::Format_MZ5:
+        case MSDataFile::Format_mzBin:
+        case MSDataFile::Format_Text:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/// Reads every step'th file starting with the first; run by each of the threads
+/// opening the files to merge. Errors are stored for mergeFiles to report.
+void readMergeFiles(const vector<string>& filenames, const ReaderList::Config& readerConfig,
+                    vector<vector<MSDataPtr> >& msdLists, vector<string>& errors, size_t first, size_t step)
+{
+    // not every reader can be shared between threads, so each thread has its own
+    FullReaderList readers;
+
+    for (size_t i=first; i < filenames.size(); i += step)
+    {
+        try
+        {
+            readers.read(filenames[i], msdLists[i], readerConfig);
+        }
+        catch (exception& e)
+        {
+            errors[i] = e.what();
+        }
+        catch (...)
+        {
+            errors[i] = "unknown exception";
+        }
+    }
+}
+
 /// Combines multiple input files into a single MSData object. Called
 /// when the --merge argument is present on the command line.
-int mergeFiles(const vector<string>& filenames, const Config& config, const ReaderList& readers)
+int mergeFiles(const vector<string>& filenames, const Config& config)
 {
     vector<MSDataPtr> msdList;
     int failedFileCount = 0;
 
     ReaderList::Config readerConfig(config);
 
-    // Each file is read in separately in MSData objects in the msdList list.
-    BOOST_FOREACH(const string& filename, filenames)
+    // Each file is read in separately in MSData objects in the msdList list;
+    // the files are opened concurrently since opening may read a whole index.
+    vector<vector<MSDataPtr> > msdLists(filenames.size());
+    vector<string> errors(filenames.size());
+    size_t threadCount = min(filenames.size(), (size_t) max(1u, boost::thread::hardware_concurrency()));
+    boost::thread_group fileReaders;
+    for (size_t i=0; i < threadCount; ++i)
+        fileReaders.create_thread(boost::bind(&readMergeFiles, boost::cref(filenames), boost::cref(readerConfig),
+                                              boost::ref(msdLists), boost::ref(errors), i, threadCount));
+    fileReaders.join_all();
+
+    for (size_t i=0; i < filenames.size(); ++i)
     {
-        try
-        {
-            *os_ << "processing file: " << filename << endl;
-            readers.read(filename, msdList, readerConfig);
-        }
-        catch (exception& e)
+        *os_ << "processing file: " << filenames[i] << endl;
+        if (!errors[i].empty())
         {
             ++failedFileCount;
-            cerr << "Error reading file " << filename << ":\n" << e.what() << endl;
+            cerr << "Error reading file " << filenames[i] << ":\n" << errors[i] << endl;
+            continue;
         }
+        msdList.insert(msdList.end(), msdLists[i].begin(), msdLists[i].end());
     }
 
     // handle progress updates if requested
@@ -711,16 +783,25 @@ int mergeFiles(const vector<string>& filenames, const Config& config, const Read
     // MSDataMerger handles combining all files in msdList into a single MSDataFile object.
     try
     {
-        MSDataMerger msd(msdList);
+        MSDataMerger msd(msdList, config.mergeByScanTime ? MSDataMerger::SpectrumOrder_ScanStartTime
+                                                         : MSDataMerger::SpectrumOrder_Concatenated);
 
-        *os_ << "calculating source file checksums" << endl;
-        calculateSHA1Checksums(msd);
+        // read the source files for their checksums while the filters are set up
+        boost::scoped_ptr<SHA1ChecksumCalculation> sha1Calculation;
+        if (writesSourceFileChecksums(config))
+            sha1Calculation.reset(new SHA1ChecksumCalculation(msd));
 
         if (!config.contactFilename.empty())
             addContactInfo(msd, config.contactFilename);
 
         SpectrumListFactory::wrap(msd, config.filters);
 
+        if (sha1Calculation)
+        {
+            *os_ << "calculating source file checksums" << endl;
+            sha1Calculation->join();
+        }
+
         string outputFilename = config.outputFilename("merged-spectra", msd);
         *os_ << "writing output file: " << outputFilename << endl;
 
@@ -740,25 +821,30 @@ int mergeFiles(const vector<string>& filenames, const Config& config, const Read
 
 /// Handles the reading of a single input file. Called once for each
 /// input file when the --merge arguement is absent.
-void processFile(const string& filename, const Config& config, const ReaderList& readers)
+void processFile(const string& filename, const Config& config, const ReaderList& readers,
+                 ostream& log, ostream& errorLog, bool showProgress)
 {
     // read in data file
 
-    *os_ << "processing file: " << filename << endl;
+    log << "processing file: " << filename << endl;
 
     ReaderList::Config readerConfig(config);
 
     vector<MSDataPtr> msdList;
     readers.read(filename, msdList, readerConfig);
 
+    // start calculating SHA1 checksums in the background; runs from the same
+    // source file share one read of it
+    vector<boost::shared_ptr<SHA1ChecksumCalculation> > sha1Calculations(msdList.size());
+    if (writesSourceFileChecksums(config))
+        for (size_t i=0; i < msdList.size(); ++i)
+            sha1Calculations[i].reset(new SHA1ChecksumCalculation(*msdList[i]));
+
     for (size_t i=0; i < msdList.size(); ++i)
     {
         MSData& msd = *msdList[i];
         try
         {
-            // calculate SHA1 checksums
-            calculateSHA1Checksums(msd);
-
             // process the data 
 
             if (!config.contactFilename.empty())
@@ -772,11 +858,15 @@ void processFile(const string& filename, const Config& config, const ReaderList&
             // update on the first spectrum, the last spectrum, the 100th spectrum, the 200th spectrum, etc.
             const size_t iterationPeriod = 100;
             iterationListenerRegistry.addListener(IterationListenerPtr(new UserFeedbackIterationListener), iterationPeriod);
-            IterationListenerRegistry* pILR = config.verbose ? &iterationListenerRegistry : 0; 
+            IterationListenerRegistry* pILR = config.verbose && showProgress ? &iterationListenerRegistry : 0; 
+
+            // wait for the SHA1 checksums
+            if (sha1Calculations[i])
+                sha1Calculations[i]->join();
 
             // write out the new data file
             string outputFilename = config.outputFilename(filename, msd);
-            *os_ << "writing output file: " << outputFilename << endl;
+            log << "writing output file: " << outputFilename << endl;
 
             if (config.outputPath == "-")
                 MSDataFile::write(msd, cout, config.writeConfig, pILR);
@@ -792,10 +882,112 @@ void processFile(const string& filename, const Config& config, const ReaderList&
         }
         catch (exception& e)
         {
-            cerr << "Error writing run " << (i+1) << " in " << bfs::path(filename).leaf() << ":\n" << e.what() << endl;
+            errorLog << "Error writing run " << (i+1) << " in " << bfs::path(filename).leaf() << ":\n" << e.what() << endl;
         }
     }
-    *os_ << endl;
+    log << endl;
+}
+
+
+/// The input files of a concurrent conversion and the console output of
+/// each one, which is held until all the files before it are finished.
+struct FileJobQueue
+{
+    FileJobQueue(const Config& config)
+        : config(config),
+          logs(config.filenames.size()), errorLogs(config.filenames.size()), finished(config.filenames.size(), false),
+          nextFile(0), nextLog(0), failedFileCount(0)
+    {}
+
+    const Config& config;
+    vector<string> logs;
+    vector<string> errorLogs;
+    vector<bool> finished;
+    size_t nextFile; // the next file to convert
+    size_t nextLog; // the next file whose output to write
+    int failedFileCount;
+    boost::mutex mutex;
+};
+
+
+/// Converts files from the queue until it is empty. Run by each of the
+/// --jobs threads; errors in one file do not affect the others.
+void processFileJobs(FileJobQueue& queue)
+{
+    const vector<string>& filenames = queue.config.filenames;
+
+    // not every reader can be shared between threads, so each job has its own
+    FullReaderList readers;
+
+    // the spectrum worker threads started by this job's filters get the same share of the cores as its writer
+    SpectrumWorkerThreads::ThreadCountLimit threadCountLimit(queue.config.writeConfig.maxThreadCount);
+
+    while (true)
+    {
+        size_t fileIndex;
+        {
+            boost::lock_guard<boost::mutex> lock(queue.mutex);
+            if (queue.nextFile == filenames.size())
+                return;
+            fileIndex = queue.nextFile++;
+        }
+
+        ostringstream log, errorLog;
+        bool failed = false;
+        try
+        {
+            processFile(filenames[fileIndex], queue.config, readers, log, errorLog, false);
+        }
+        catch (exception& e)
+        {
+            failed = true;
+            log << e.what() << endl;
+            log << "Error processing file " << filenames[fileIndex] << "\n\n"; 
+        }
+        catch (...)
+        {
+            failed = true;
+            log << "Unknown error processing file " << filenames[fileIndex] << "\n\n"; 
+        }
+
+        boost::lock_guard<boost::mutex> lock(queue.mutex);
+        queue.logs[fileIndex] = log.str();
+        queue.errorLogs[fileIndex] = errorLog.str();
+        queue.finished[fileIndex] = true;
+        if (failed)
+            ++queue.failedFileCount;
+
+        // write the output of finished files in input order
+        for (; queue.nextLog < filenames.size() && queue.finished[queue.nextLog]; ++queue.nextLog)
+        {
+            *os_ << queue.logs[queue.nextLog] << flush;
+            cerr << queue.errorLogs[queue.nextLog] << flush;
+            queue.logs[queue.nextLog].clear();
+            queue.errorLogs[queue.nextLog].clear();
+        }
+    }
+}
+
+
+/// Converts the input files --jobs at a time, each file getting an equal share
+/// of the spectrum worker threads (and so of the spectra they hold in memory),
+/// both for writing it and for its filters.
+/// Returns the number of files that failed.
+int processFilesConcurrently(const Config& config)
+{
+    size_t jobCount = min((size_t) config.jobs, config.filenames.size());
+    size_t coreCount = max(1u, boost::thread::hardware_concurrency());
+
+    Config jobConfig(config);
+    jobConfig.writeConfig.maxThreadCount = max((size_t) 1, coreCount / jobCount);
+
+    FileJobQueue queue(jobConfig);
+    boost::thread_group jobs;
+    for (size_t i=0; i < jobCount; ++i)
+        jobs.create_thread(boost::bind(&processFileJobs, boost::ref(queue)));
+    jobs.join_all();
+
+    return queue.failedFileCount;
 }
 
 
@@ -808,21 +1000,22 @@ int go(const Config& config)
 
     boost::filesystem::create_directories(config.outputPath);
 
-    FullReaderList readers;
-
     int failedFileCount = 0;
 
     if (config.merge)
-        failedFileCount = mergeFiles(config.filenames, config, readers);
+        failedFileCount = mergeFiles(config.filenames, config);
+    else if (config.jobs > 1 && config.filenames.size() > 1 && config.outputPath != "-")
+        failedFileCount = processFilesConcurrently(config);
     else
     {
+        FullReaderList readers;
 
         for (vector<string>::const_iterator it=config.filenames.begin(); 
              it!=config.filenames.end(); ++it)
         {
             try
             {
-                processFile(*it, config, readers);
+                processFile(*it, config, readers, *os_, cerr, true);
             }
             catch (exception& e)
             {
@@ -45,7 +45,7 @@ using namespace pwiz::util;
 
 
 PWIZ_API_DECL MSDataAnalyzerApplication::MSDataAnalyzerApplication(int argc, const char* argv[])
-:   outputDirectory("."), verbose(false)
+:   outputDirectory("."), verbose(false), threadCount(1)
 {
     namespace po = boost::program_options;
 
@@ -73,6 +73,9 @@ PWIZ_API_DECL MSDataAnalyzerApplication::MSDataAnalyzerApplication(int argc, con
         ("verbose,v",
             po::value<bool>(&verbose)->zero_tokens(),
             ": print progress messages")
+        ("threads,j",
+            po::value<size_t>(&threadCount)->default_value(threadCount),
+            ": analyze the spectra of each file with up to this many threads (0 for one per processor); analyzers that cannot run in parallel use one thread")
         ("help",
             po::value<bool>(&detailedHelp)->zero_tokens(),
             ": show this message, with extra detail on filter options")
@@ -186,7 +189,7 @@ PWIZ_API_DECL void MSDataAnalyzerApplication::run(MSDataAnalyzer& analyzer, ostr
             dataInfo.outputDirectory = outputDirectory;
             dataInfo.log = log;
 
-            MSDataAnalyzerDriver driver(analyzer);
+            MSDataAnalyzerDriver driver(analyzer, threadCount);
             driver.analyze(dataInfo);
         }
         catch (exception& e)